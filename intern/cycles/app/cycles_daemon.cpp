@@ -0,0 +1,277 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <boost/asio.hpp>
+
+#include <istream>
+
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/film.h"
+#include "render/scene.h"
+#include "render/session.h"
+
+#include "util/util_path.h"
+#include "util/util_time.h"
+
+#include "app/cycles_daemon.h"
+#include "app/cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+using boost::asio::local::stream_protocol;
+
+/* Largest scene update a client may send in one command. */
+static const size_t DAEMON_MAX_UPDATE_SIZE = 256 * 1024 * 1024;
+
+/* Parse the size of an update, only plain decimal numbers are accepted. */
+static bool daemon_parse_size(const string& str, size_t *r_size)
+{
+	if(str.empty() || str[0] < '0' || str[0] > '9') {
+		return false;
+	}
+
+	char *end;
+	errno = 0;
+	const unsigned long long size = strtoull(str.c_str(), &end, 10);
+	if(errno != 0 || *end != '\0' || size > DAEMON_MAX_UPDATE_SIZE) {
+		return false;
+	}
+
+	*r_size = (size_t)size;
+	return true;
+}
+
+/* Handle commands of a single client, returns false on quit. */
+static bool daemon_serve_client(RenderDaemon& daemon, stream_protocol::socket& socket)
+{
+	boost::asio::streambuf buffer;
+	std::istream stream(&buffer);
+	boost::system::error_code error;
+
+	for(;;) {
+		boost::asio::read_until(socket, buffer, '\n', error);
+		if(error) {
+			/* client disconnected */
+			return true;
+		}
+
+		string line;
+		std::getline(stream, line);
+		line = string_strip(line);
+
+		const size_t split = line.find(' ');
+		const string command = line.substr(0, split);
+		const string argument = (split == string::npos)? "": line.substr(split + 1);
+
+		string reply;
+		bool quit = false;
+		bool disconnect = false;
+
+		if(command == "") {
+			continue;
+		}
+		else if(command == "update") {
+			size_t size;
+
+			if(!daemon_parse_size(argument, &size)) {
+				/* The payload can't be skipped without its size. */
+				reply = string_printf("error Invalid update size \"%s\", at most %d bytes",
+				                      argument.c_str(), (int)DAEMON_MAX_UPDATE_SIZE);
+				disconnect = true;
+			}
+			else {
+				if(buffer.size() < size) {
+					boost::asio::read(socket,
+					                  buffer,
+					                  boost::asio::transfer_exactly(size - buffer.size()),
+					                  error);
+					if(error) {
+						return true;
+					}
+				}
+
+				string data(size, '\0');
+				if(size > 0) {
+					stream.read(&data[0], size);
+				}
+
+				reply = daemon.update(data);
+			}
+		}
+		else if(command == "samples") {
+			reply = daemon.set_samples(atoi(argument.c_str()));
+		}
+		else if(command == "render") {
+			reply = daemon.render(argument);
+		}
+		else if(command == "quit") {
+			reply = "ok";
+			quit = true;
+		}
+		else {
+			reply = "error Unknown command \"" + command + "\"";
+		}
+
+		reply += "\n";
+		boost::asio::write(socket, boost::asio::buffer(reply), error);
+
+		if(quit) {
+			return false;
+		}
+		if(disconnect) {
+			return true;
+		}
+	}
+}
+#endif
+
+RenderDaemon::RenderDaemon(Session *session, const string& base, int samples)
+: session(session),
+  base(base),
+  samples(samples),
+  width(0),
+  height(0)
+{
+}
+
+bool RenderDaemon::run(const string& socket_path)
+{
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+	boost::asio::io_service io_service;
+	boost::system::error_code error;
+
+	/* remove socket left behind by a previous daemon */
+	path_remove(socket_path);
+
+	stream_protocol::acceptor acceptor(io_service);
+	stream_protocol::endpoint endpoint(socket_path);
+
+	acceptor.open(endpoint.protocol(), error);
+	if(!error) acceptor.bind(endpoint, error);
+	if(!error) acceptor.listen(boost::asio::socket_base::max_connections, error);
+
+	if(error) {
+		fprintf(stderr, "Failed to listen on %s: %s\n",
+		        socket_path.c_str(), error.message().c_str());
+		return false;
+	}
+
+	printf("Listening on %s\n", socket_path.c_str());
+	fflush(stdout);
+
+	bool running = true;
+
+	while(running) {
+		stream_protocol::socket socket(io_service);
+		acceptor.accept(socket, error);
+
+		if(error) {
+			fprintf(stderr, "Failed to accept connection: %s\n", error.message().c_str());
+			continue;
+		}
+
+		running = daemon_serve_client(*this, socket);
+	}
+
+	acceptor.close();
+	path_remove(socket_path);
+
+	return true;
+#else
+	fprintf(stderr, "Render daemon is not supported on this platform.\n");
+	(void)socket_path;
+	return false;
+#endif
+}
+
+string RenderDaemon::update(const string& data)
+{
+	string error;
+
+	if(!xml_read_update(session->scene, data, base.c_str(), &error)) {
+		return "error " + error;
+	}
+
+	return "ok";
+}
+
+string RenderDaemon::set_samples(int samples_)
+{
+	if(samples_ < 1) {
+		return "error Invalid number of samples";
+	}
+
+	samples = samples_;
+	return "ok";
+}
+
+string RenderDaemon::render(const string& filepath)
+{
+	if(filepath == "") {
+		return "error No file path specified";
+	}
+
+	double start_time = time_dt();
+	Camera *camera = session->scene->camera;
+
+	/* resolution changes since the previous render */
+	if(camera->width != width || camera->height != height) {
+		thread_scoped_lock scene_lock(session->scene->mutex);
+
+		width = camera->width;
+		height = camera->height;
+
+		camera->compute_auto_viewplane();
+		camera->need_update = true;
+		camera->need_device_update = true;
+	}
+
+	BufferParams buffer_params;
+	buffer_params.width = width;
+	buffer_params.height = height;
+	buffer_params.full_width = width;
+	buffer_params.full_height = height;
+	buffer_params.passes = session->scene->film->passes;
+
+	/* render, reusing the device and scene data of previous renders */
+	session->progress.reset();
+	session->reset(buffer_params, samples);
+	session->start();
+	session->wait();
+
+	if(session->progress.get_error()) {
+		return "error " + session->progress.get_error_message();
+	}
+	else if(session->progress.get_cancel()) {
+		return "error " + session->progress.get_cancel_message();
+	}
+
+	session->write_image(filepath, samples);
+
+	double render_time = time_dt() - start_time;
+	printf("Rendered %s in %.2fs\n", filepath.c_str(), render_time);
+	fflush(stdout);
+
+	return string_printf("ok %f", render_time);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CYCLES_DAEMON_H__
+#define __CYCLES_DAEMON_H__
+
+#include "util/util_string.h"
+
+CCL_NAMESPACE_BEGIN
+
+class Session;
+
+/* Render Daemon
+ *
+ * Keeps a session and its scene alive between render jobs, so kernels,
+ * images and BVHs stay loaded. Clients connect to a local socket and send
+ * newline terminated commands, each answered with a line starting with
+ * "ok" or "error":
+ *
+ *   update <size>     followed by <size> bytes of XML in the same format as
+ *                     scene files, applied as changes to the scene. An
+ *                     invalid or too large size closes the connection
+ *   samples <n>       number of samples for following renders
+ *   render <filepath> render the scene and write the image to filepath
+ *   quit              stop the daemon
+ */
+class RenderDaemon {
+public:
+	RenderDaemon(Session *session, const string& base, int samples);
+
+	/* Serve clients one at a time, until one of them sends quit. Returns
+	 * false if the socket could not be created. */
+	bool run(const string& socket_path);
+
+	/* Command handlers, returning the reply to send to the client. */
+	string update(const string& data);
+	string set_samples(int samples);
+	string render(const string& filepath);
+
+protected:
+	Session *session;
+	/* Directory relative paths in updates are resolved against. */
+	string base;
+	int samples;
+	int width, height;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __CYCLES_DAEMON_H__ */
@@ -18,6 +18,8 @@
 
 #include "render/buffers.h"
 #include "render/camera.h"
+#include "render/denoising.h"
+#include "render/film.h"
 #include "device/device.h"
 #include "render/scene.h"
 #include "render/session.h"
@@ -38,6 +40,7 @@
 #include "util/util_view.h"
 #endif
 
+#include "app/cycles_daemon.h"
 #include "app/cycles_xml.h"
 
 CCL_NAMESPACE_BEGIN
@@ -46,6 +49,13 @@ struct Options {
 	Session *session;
 	Scene *scene;
 	string filepath;
+	string daemon_socket;
+	/* Denoise existing renders instead of rendering a scene. */
+	bool denoise;
+	vector<string> denoise_files;
+	int denoise_frames, denoise_samples;
+	int denoise_radius;
+	float denoise_strength, denoise_feature_strength;
 	int width, height;
 	SceneParams scene_params;
 	SessionParams session_params;
@@ -93,6 +103,9 @@ static BufferParams& session_buffer_params()
 	buffer_params.height = options.height;
 	buffer_params.full_width = options.width;
 	buffer_params.full_height = options.height;
+	if(options.scene) {
+		buffer_params.passes = options.scene->film->passes;
+	}
 
 	return buffer_params;
 }
@@ -116,12 +129,28 @@ static void scene_init()
 
 	/* Calculate Viewplane */
 	options.scene->camera->compute_auto_viewplane();
+
+	/* Adaptive sampling passes, only supported for tiles rendered on the CPU
+	 * in one go. */
+	if(options.scene->integrator->use_adaptive_sampling) {
+		if(options.session_params.device.type == DEVICE_CPU &&
+		   !options.session_params.progressive_refine)
+		{
+			array<Pass> passes = options.scene->film->passes;
+			Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+			Pass::add(PASS_SAMPLE_COUNT, passes);
+			options.scene->film->tag_passes_update(options.scene, passes);
+			options.scene->film->tag_update(options.scene);
+		}
+		else {
+			fprintf(stderr, "Adaptive sampling is only supported for CPU rendering without progressive refine.\n");
+		}
+	}
 }
 
 static void session_init()
 {
 	options.session = new Session(options.session_params);
-	options.session->reset(session_buffer_params(), options.session_params.samples);
 
 	if(options.session_params.background && !options.quiet)
 		options.session->progress.set_update_callback(function_bind(&session_print_status));
@@ -134,9 +163,69 @@ static void session_init()
 	scene_init();
 	options.session->scene = options.scene;
 
+	options.session->reset(session_buffer_params(), options.session_params.samples);
 	options.session->start();
 }
 
+static void daemon_run()
+{
+	options.session = new Session(options.session_params);
+
+	if(!options.quiet)
+		options.session->progress.set_update_callback(function_bind(&session_print_status));
+
+	scene_init();
+	options.session->scene = options.scene;
+
+	/* Keep object transforms out of the mesh BVHs, so that transform updates
+	 * only need to rebuild the top level BVH. */
+	options.scene->params.bvh_type = SceneParams::BVH_DYNAMIC;
+
+	RenderDaemon daemon(options.session,
+	                    path_dirname(options.filepath),
+	                    options.session_params.samples);
+	bool success = daemon.run(options.daemon_socket);
+
+	/* images were written for each render already */
+	options.session->params.output_path = "";
+	delete options.session;
+	options.session = NULL;
+
+	if(!success)
+		exit(EXIT_FAILURE);
+}
+
+static void denoise_run()
+{
+	Denoiser denoiser(options.session_params.device);
+
+	denoiser.input = options.denoise_files;
+	denoiser.samples_override = options.denoise_samples;
+	denoiser.frame_radius = options.denoise_frames;
+	denoiser.radius = options.denoise_radius;
+	denoiser.strength = options.denoise_strength;
+	denoiser.feature_strength = options.denoise_feature_strength;
+
+	/* Without an output directory, the input files are overwritten. */
+	const string& output_dir = options.session_params.output_path;
+	foreach(const string& filepath, options.denoise_files) {
+		if(output_dir == "")
+			denoiser.output.push_back(filepath);
+		else
+			denoiser.output.push_back(path_join(output_dir, path_filename(filepath)));
+	}
+
+	double start_time = time_dt();
+
+	if(!denoiser.run()) {
+		fprintf(stderr, "Error: %s\n", denoiser.error.c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	if(!options.quiet)
+		printf("Denoised %d files in %.2fs\n", (int)denoiser.input.size(), time_dt() - start_time);
+}
+
 static void session_exit()
 {
 	if(options.session) {
@@ -317,6 +406,10 @@ static int files_parse(int argc, const char *argv[])
 	if(argc > 0)
 		options.filepath = argv[0];
 
+	/* denoising takes a sequence of files */
+	for(int i = 0; i < argc; i++)
+		options.denoise_files.push_back(argv[i]);
+
 	return 0;
 }
 
@@ -327,6 +420,12 @@ static void options_parse(int argc, const char **argv)
 	options.filepath = "";
 	options.session = NULL;
 	options.quiet = false;
+	options.denoise = false;
+	options.denoise_frames = 0;
+	options.denoise_samples = 0;
+	options.denoise_radius = 8;
+	options.denoise_strength = 0.5f;
+	options.denoise_feature_strength = 0.5f;
 
 	/* device names */
 	string device_names = "";
@@ -354,6 +453,8 @@ static void options_parse(int argc, const char **argv)
 	ArgParse ap;
 	bool help = false, debug = false, version = false;
 	int verbosity = 1;
+	int bvh_cache_size = 0;
+	bool no_bvh_refit = false;
 
 	ap.options ("Usage: cycles [options] file.xml",
 		"%*", files_parse, "",
@@ -370,6 +471,21 @@ static void options_parse(int argc, const char **argv)
 		"--height %d", &options.height, "Window height in pixel",
 		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
 		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
+		"--texture-cache", &options.scene_params.use_texture_cache, "Load image textures on demand (CPU only)",
+		"--texture-cache-size %d", &options.scene_params.texture_cache_size, "Texture cache memory budget in megabytes, 0 is unlimited",
+		"--no-bvh-refit", &no_bvh_refit, "Rebuild BVHs of deforming meshes instead of refitting them",
+		"--bvh-refit-threshold %f", &options.scene_params.bvh_refit_threshold, "SAH cost increase factor at which a refitted BVH is rebuilt",
+		"--bvh-cache", &options.scene_params.use_bvh_cache, "Reuse BVHs of unchanged meshes between scene updates",
+		"--bvh-cache-path %s", &options.scene_params.bvh_cache_path, "Directory to store cached BVHs in",
+		"--bvh-cache-size %d", &bvh_cache_size, "Size limit of the BVH cache directory in megabytes, 0 is unlimited",
+		"--compact-mesh", &options.scene_params.use_compact_mesh, "Store mesh normals and UVs with reduced precision to save memory",
+		"--daemon %s", &options.daemon_socket, "Keep running and render scene updates received on this local socket",
+		"--denoise", &options.denoise, "Denoise the given sequence of multilayer EXR files rendered with denoising data, writing them to the output directory",
+		"--denoise-frames %d", &options.denoise_frames, "Number of frames before and after each frame to use for temporal denoising (CPU only)",
+		"--denoise-samples %d", &options.denoise_samples, "Number of samples the files were rendered with, if not stored in their metadata",
+		"--denoise-radius %d", &options.denoise_radius, "Size of the image area used to denoise a pixel",
+		"--denoise-strength %f", &options.denoise_strength, "Denoising strength",
+		"--denoise-feature-strength %f", &options.denoise_feature_strength, "Denoising strength of the feature passes",
 		"--list-devices", &list, "List information about all available devices",
 #ifdef WITH_CYCLES_LOGGING
 		"--debug", &debug, "Enable debug logging",
@@ -417,6 +533,9 @@ static void options_parse(int argc, const char **argv)
 	else if(ssname == "svm")
 		options.scene_params.shadingsystem = SHADINGSYSTEM_SVM;
 
+	options.scene_params.bvh_cache_disk_size = (size_t)max(bvh_cache_size, 0) * 1024 * 1024;
+	options.scene_params.use_bvh_refit = !no_bvh_refit;
+
 #ifndef WITH_CYCLES_STANDALONE_GUI
 	options.session_params.background = true;
 #endif
@@ -460,6 +579,19 @@ static void options_parse(int argc, const char **argv)
 		fprintf(stderr, "No file path specified\n");
 		exit(EXIT_FAILURE);
 	}
+	else if(options.denoise && options.daemon_socket != "") {
+		fprintf(stderr, "Denoising can't be combined with the daemon\n");
+		exit(EXIT_FAILURE);
+	}
+	else if(options.denoise_frames < 0 || options.denoise_samples < 0) {
+		fprintf(stderr, "Invalid denoising frames or samples\n");
+		exit(EXIT_FAILURE);
+	}
+	else if(options.daemon_socket != "" && options.session_params.output_path == "") {
+		/* render buffers are only allocated when there is an output path */
+		fprintf(stderr, "Daemon requires an output path\n");
+		exit(EXIT_FAILURE);
+	}
 
 	/* For smoother Viewport */
 	options.session_params.start_resolution = 64;
@@ -475,6 +607,16 @@ int main(int argc, const char **argv)
 	path_init();
 	options_parse(argc, argv);
 
+	if(options.denoise) {
+		denoise_run();
+		return 0;
+	}
+
+	if(options.daemon_socket != "") {
+		daemon_run();
+		return 0;
+	}
+
 #ifdef WITH_CYCLES_STANDALONE_GUI
 	if(options.session_params.background) {
 #endif
@@ -57,12 +57,14 @@ struct XMLReadState : public XMLReader {
 	Shader *shader;		/* current shader */
 	string base;		/* base path to current file*/
 	float dicing_rate;	/* current dicing rate */
+	bool update;		/* modify existing nodes with the same name */
 
 	XMLReadState()
 	  : scene(NULL),
 	    smooth(false),
 	    shader(NULL),
-	    dicing_rate(1.0f)
+	    dicing_rate(1.0f),
+	    update(false)
 	{
 		tfm = transform_identity();
 	}
@@ -351,6 +353,20 @@ static void xml_read_shader_graph(XMLReadState& state, Shader *shader, xml_node
 
 static void xml_read_shader(XMLReadState& state, xml_node node)
 {
+	if(state.update) {
+		/* replace graph of existing shader */
+		string name;
+
+		if(xml_read_string(&name, node, "name")) {
+			foreach(Shader *shader, state.scene->shaders) {
+				if(shader->name == name) {
+					xml_read_shader_graph(state, shader, node);
+					return;
+				}
+			}
+		}
+	}
+
 	Shader *shader = new Shader();
 	xml_read_shader_graph(state, shader, node);
 	state.scene->shaders.push_back(shader);
@@ -362,6 +378,7 @@ static void xml_read_background(XMLReadState& state, xml_node node)
 {
 	/* Background Settings */
 	xml_read_node(state, state.scene->background, node);
+	state.scene->background->tag_update(state.scene);
 
 	/* Background Shader */
 	Shader *shader = state.scene->default_background;
@@ -391,6 +408,14 @@ static void xml_read_mesh(const XMLReadState& state, xml_node node)
 	Mesh *mesh = xml_add_mesh(state.scene, state.tfm);
 	mesh->used_shaders.push_back(state.shader);
 
+	/* name, to refer to the object in updates */
+	string name;
+
+	if(xml_read_string(&name, node, "name")) {
+		mesh->name = ustring(name);
+		state.scene->objects.back()->name = ustring(name);
+	}
+
 	/* read state */
 	int shader = 0;
 	bool smooth = state.smooth;
@@ -533,6 +558,21 @@ static void xml_read_mesh(const XMLReadState& state, xml_node node)
 
 static void xml_read_light(XMLReadState& state, xml_node node)
 {
+	if(state.update) {
+		/* modify existing light */
+		string name;
+
+		if(xml_read_string(&name, node, "name")) {
+			foreach(Light *light, state.scene->lights) {
+				if(light->name == name) {
+					xml_read_node(state, light, node);
+					light->tag_update(state.scene);
+					return;
+				}
+			}
+		}
+	}
+
 	Light *light = new Light();
 
 	light->shader = state.shader;
@@ -541,6 +581,32 @@ static void xml_read_light(XMLReadState& state, xml_node node)
 	state.scene->lights.push_back(light);
 }
 
+/* Object */
+
+static void xml_read_object(XMLReadState& state, xml_node node)
+{
+	/* set transform of existing object */
+	string name;
+
+	if(!xml_read_string(&name, node, "name")) {
+		fprintf(stderr, "Object without name.\n");
+		return;
+	}
+
+	bool found = false;
+
+	foreach(Object *object, state.scene->objects) {
+		if(object->name == name) {
+			object->tfm = state.tfm;
+			object->tag_update(state.scene);
+			found = true;
+		}
+	}
+
+	if(!found)
+		fprintf(stderr, "Unknown object \"%s\".\n", name.c_str());
+}
+
 /* Transform */
 
 static void xml_read_transform(xml_node node, Transform& tfm)
@@ -610,9 +676,11 @@ static void xml_read_scene(XMLReadState& state, xml_node scene_node)
 	for(xml_node node = scene_node.first_child(); node; node = node.next_sibling()) {
 		if(string_iequals(node.name(), "film")) {
 			xml_read_node(state, state.scene->film, node);
+			state.scene->film->tag_update(state.scene);
 		}
 		else if(string_iequals(node.name(), "integrator")) {
 			xml_read_node(state, state.scene->integrator, node);
+			state.scene->integrator->tag_update(state.scene);
 		}
 		else if(string_iequals(node.name(), "camera")) {
 			xml_read_camera(state, node);
@@ -629,6 +697,9 @@ static void xml_read_scene(XMLReadState& state, xml_node scene_node)
 		else if(string_iequals(node.name(), "light")) {
 			xml_read_light(state, node);
 		}
+		else if(string_iequals(node.name(), "object")) {
+			xml_read_object(state, node);
+		}
 		else if(string_iequals(node.name(), "transform")) {
 			XMLReadState substate = state;
 
@@ -694,5 +765,38 @@ void xml_read_file(Scene *scene, const char *filepath)
 	scene->params.bvh_type = SceneParams::BVH_STATIC;
 }
 
+bool xml_read_update(Scene *scene, const string& data, const char *base, string *error)
+{
+	xml_document doc;
+	xml_parse_result parse_result = doc.load_buffer(data.c_str(), data.size());
+
+	if(!parse_result) {
+		*error = parse_result.description();
+		return false;
+	}
+
+	xml_node cycles = doc.child("cycles");
+
+	if(!cycles) {
+		*error = "Missing cycles element";
+		return false;
+	}
+
+	XMLReadState state;
+
+	state.scene = scene;
+	state.tfm = transform_identity();
+	state.shader = scene->default_surface;
+	state.smooth = false;
+	state.dicing_rate = 1.0f;
+	state.base = base;
+	state.update = true;
+
+	thread_scoped_lock scene_lock(scene->mutex);
+	xml_read_scene(state, cycles);
+
+	return true;
+}
+
 CCL_NAMESPACE_END
 
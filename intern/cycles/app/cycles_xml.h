@@ -23,6 +23,11 @@ class Scene;
 
 void xml_read_file(Scene *scene, const char *filepath);
 
+/* Apply changes to a scene already read from a file. Shaders, lights and
+ * objects with the name of an existing one modify it instead of adding a
+ * new one. Returns false with an error message if the XML is invalid. */
+bool xml_read_update(Scene *scene, const string& data, const char *base, string *error);
+
 /* macros for importing */
 #define RAD2DEGF(_rad) ((_rad) * (float)(180.0 / M_PI))
 #define DEG2RADF(_deg) ((_deg) * (float)(M_PI / 180.0))
@@ -290,6 +290,32 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=0.0, max=1.0,
                 default=0.01,
                 )
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Select lights based on their estimated contribution to the shading point, "
+                            "using a hierarchy of lamps and emissive triangles (faster convergence in scenes with many lights)",
+                default=False,
+                )
+        cls.use_adaptive_sampling = BoolProperty(
+                name="Adaptive Sampling",
+                description="Stop sampling pixels once their noise falls below the threshold, "
+                            "finishing tiles early in smooth regions (CPU only, final renders)",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Adaptive Threshold",
+                description="Noise level at which a pixel stops being sampled, lower values give less noise",
+                min=0.0001, max=1.0,
+                soft_min=0.001, soft_max=0.1,
+                default=0.01,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Adaptive Min Samples",
+                description="Number of samples taken for every pixel before testing whether it converged",
+                min=2, max=4096,
+                default=16,
+                )
 
         cls.caustics_reflective = BoolProperty(
                 name="Reflective Caustics",
@@ -512,6 +538,59 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default=0,
                 min=0, max=16,
                 )
+        cls.use_bvh_refit = BoolProperty(
+                name="Refit Deforming BVH",
+                description="Refit the BVHs of meshes and objects which move or deform without changing "
+                            "topology, instead of rebuilding them every frame (final render with persistent images)",
+                default=True,
+                )
+        cls.bvh_refit_threshold = FloatProperty(
+                name="Refit Threshold",
+                description="Rebuild the BVH when refitting made its SAH cost this many times higher "
+                            "than when it was built",
+                default=1.5,
+                min=1.0, max=10.0,
+                )
+        cls.use_texture_cache = BoolProperty(
+                name="Texture Cache",
+                description="Load image textures on demand in tiles and mip levels when rendering on the CPU, "
+                            "instead of loading all images fully before rendering",
+                default=False,
+                )
+        cls.texture_cache_size = IntProperty(
+                name="Cache Size",
+                description="Memory budget of the texture cache in megabytes, least recently used tiles "
+                            "are freed when exceeded (0 means unlimited)",
+                default=4096,
+                min=0, max=1024 * 1024,
+                )
+        cls.use_bvh_cache = BoolProperty(
+                name="Cache BVH",
+                description="Keep the BVH of meshes whose geometry did not change between frames, "
+                            "instead of building it again for every frame",
+                default=False,
+                )
+        cls.bvh_cache_path = StringProperty(
+                name="Cache Directory",
+                description="Absolute path of a directory to store BVHs in, so they can be reused by "
+                            "other render processes; every built BVH is written (leave empty to only "
+                            "keep them in memory)",
+                default="",
+                subtype='DIR_PATH',
+                )
+        cls.bvh_cache_size = IntProperty(
+                name="Directory Size",
+                description="Maximum size of the BVH cache directory in megabytes, the least recently "
+                            "written BVHs are removed when exceeded (0 means unlimited)",
+                default=10240,
+                min=0, max=1024 * 1024,
+                )
+        cls.use_compact_mesh = BoolProperty(
+                name="Compact Meshes",
+                description="Store vertex normals and UV maps of meshes with reduced precision, "
+                            "to use less memory on the render device",
+                default=False,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -644,6 +723,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         cls.debug_use_cpu_sse2 = BoolProperty(name="SSE2", default=True)
         cls.debug_use_qbvh = BoolProperty(name="QBVH", default=True)
         cls.debug_use_cpu_split_kernel = BoolProperty(name="Split Kernel", default=False)
+        cls.debug_cpu_split_kernel_paths = IntProperty(
+                name="Paths",
+                description="Number of paths traced together by each thread with the split kernel, "
+                            "rays of these paths are sorted by shader before shading",
+                min=1, max=65536,
+                default=1024,
+                )
 
         cls.debug_use_cuda_adaptive_compile = BoolProperty(name="Adaptive Compile", default=False)
         cls.debug_use_cuda_split_kernel = BoolProperty(name="Split Kernel", default=False)
@@ -172,6 +172,9 @@ class CYCLES_RENDER_PT_sampling(CyclesButtonsPanel, Panel):
         sub.prop(cscene, "sample_clamp_direct")
         sub.prop(cscene, "sample_clamp_indirect")
         sub.prop(cscene, "light_sampling_threshold")
+        subsub = sub.row(align=True)
+        subsub.active = not (use_branched_path(context) and use_sample_all_lights(context))
+        subsub.prop(cscene, "use_light_tree")
 
         if cscene.progressive == 'PATH' or use_branched_path(context) is False:
             col = split.column()
@@ -205,6 +208,13 @@ class CYCLES_RENDER_PT_sampling(CyclesButtonsPanel, Panel):
 
         layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        row = layout.row(align=True)
+        row.prop(cscene, "use_adaptive_sampling", text="Adaptive")
+        sub = row.row(align=True)
+        sub.active = cscene.use_adaptive_sampling
+        sub.prop(cscene, "adaptive_threshold", text="Threshold")
+        sub.prop(cscene, "adaptive_min_samples", text="Min Samples")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -420,6 +430,14 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
 
         col.separator()
 
+        col.label(text="Images:")
+        col.prop(cscene, "use_texture_cache")
+        sub = col.column()
+        sub.active = cscene.use_texture_cache
+        sub.prop(cscene, "texture_cache_size")
+
+        col.separator()
+
         col.label(text="Acceleration structure:")
         col.prop(cscene, "debug_use_spatial_splits")
         col.prop(cscene, "debug_use_hair_bvh")
@@ -428,6 +446,22 @@ class CYCLES_RENDER_PT_performance(CyclesButtonsPanel, Panel):
         row.active = not cscene.debug_use_spatial_splits
         row.prop(cscene, "debug_bvh_time_steps")
 
+        col.prop(cscene, "use_bvh_refit")
+        sub = col.column()
+        sub.active = cscene.use_bvh_refit
+        sub.prop(cscene, "bvh_refit_threshold")
+
+        col.prop(cscene, "use_bvh_cache")
+        sub = col.column()
+        sub.active = cscene.use_bvh_cache
+        sub.prop(cscene, "bvh_cache_path", text="")
+        sub.prop(cscene, "bvh_cache_size")
+
+        col.separator()
+
+        col.label(text="Geometry:")
+        col.prop(cscene, "use_compact_mesh")
+
         col = layout.column()
         col.label(text="Viewport Resolution:")
         split = col.split()
@@ -537,9 +571,7 @@ class CYCLES_RENDER_PT_layer_passes(CyclesButtonsPanel, Panel):
 
         if context.scene.cycles.feature_set == 'EXPERIMENTAL':
             col.separator()
-            sub = col.column()
-            sub.active = crl.use_denoising
-            sub.prop(crl, "denoising_store_passes", text="Denoising")
+            col.prop(crl, "denoising_store_passes", text="Denoising")
 
         col = layout.column()
         col.prop(crl, "pass_debug_render_time")
@@ -1603,6 +1635,9 @@ class CYCLES_RENDER_PT_debug(CyclesButtonsPanel, Panel):
         row.prop(cscene, "debug_use_cpu_avx2", toggle=True)
         col.prop(cscene, "debug_use_qbvh")
         col.prop(cscene, "debug_use_cpu_split_kernel")
+        sub = col.column()
+        sub.active = cscene.debug_use_cpu_split_kernel
+        sub.prop(cscene, "debug_cpu_split_kernel_paths")
 
         col.separator()
 
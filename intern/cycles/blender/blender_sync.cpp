@@ -288,6 +288,11 @@ void BlenderSync::sync_integrator()
 	integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
 	integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
 	integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+	integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+
+	integrator->use_adaptive_sampling = get_boolean(cscene, "use_adaptive_sampling");
+	integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+	integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
 
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
@@ -328,8 +333,18 @@ void BlenderSync::sync_integrator()
 		integrator->ao_bounces = 0;
 	}
 
-	if(integrator->modified(previntegrator))
+	if(integrator->modified(previntegrator)) {
+		/* Light tree is built by the light manager, and depends on
+		 * whether all lights are sampled. */
+		if(integrator->use_light_tree != previntegrator.use_light_tree ||
+		   integrator->method != previntegrator.method ||
+		   integrator->sample_all_lights_direct != previntegrator.sample_all_lights_direct ||
+		   integrator->sample_all_lights_indirect != previntegrator.sample_all_lights_indirect)
+		{
+			scene->light_manager->tag_update(scene);
+		}
 		integrator->tag_update(scene);
+	}
 }
 
 /* Film */
@@ -575,9 +590,7 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 	}
 
 	PointerRNA crp = RNA_pointer_get(&b_srlay.ptr, "cycles");
-	if(get_boolean(crp, "denoising_store_passes") &&
-	   get_boolean(crp, "use_denoising"))
-	{
+	if(get_boolean(crp, "denoising_store_passes")) {
 		b_engine.add_pass("Denoising Normal",          3, "XYZ", b_srlay.name().c_str());
 		b_engine.add_pass("Denoising Normal Variance", 3, "XYZ", b_srlay.name().c_str());
 		b_engine.add_pass("Denoising Albedo",          3, "RGB", b_srlay.name().c_str());
@@ -620,6 +633,17 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		Pass::add(PASS_VOLUME_INDIRECT, passes);
 	}
 
+	/* Internal passes for adaptive sampling, only supported by the CPU
+	 * megakernel and not combined with denoising. */
+	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
+	if(get_boolean(cscene, "use_adaptive_sampling") &&
+	   session_params.device.type == DEVICE_CPU &&
+	   !get_boolean(crp, "use_denoising"))
+	{
+		Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+		Pass::add(PASS_SAMPLE_COUNT, passes);
+	}
+
 	return passes;
 }
 
@@ -646,6 +670,8 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
 	params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
+	params.use_bvh_refit = get_boolean(cscene, "use_bvh_refit");
+	params.bvh_refit_threshold = get_float(cscene, "bvh_refit_threshold");
 
 	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
 		params.persistent_data = r.use_persistent_data();
@@ -666,6 +692,17 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	params.use_texture_cache = get_boolean(cscene, "use_texture_cache");
+	params.texture_cache_size = get_int(cscene, "texture_cache_size");
+
+	params.use_bvh_cache = get_boolean(cscene, "use_bvh_cache");
+	if(params.use_bvh_cache) {
+		params.bvh_cache_path = get_string(cscene, "bvh_cache_path");
+		params.bvh_cache_disk_size = (size_t)get_int(cscene, "bvh_cache_size") * 1024 * 1024;
+	}
+
+	params.use_compact_mesh = get_boolean(cscene, "use_compact_mesh");
+
 	params.use_qbvh = DebugFlags().cpu.qbvh;
 
 	return params;
@@ -22,6 +22,7 @@
 
 #include "bvh/bvh2.h"
 #include "bvh/bvh4.h"
+#include "bvh/bvh8.h"
 #include "bvh/bvh_build.h"
 #include "bvh/bvh_node.h"
 
@@ -45,13 +46,15 @@ int BVHStackEntry::encodeIdx() const
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_), objects(objects_), build_sah_cost(0.0f)
 {
 }
 
 BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 {
-	if(params.use_qbvh)
+	if(params.use_obvh)
+		return new BVH8(params, objects);
+	else if(params.use_qbvh)
 		return new BVH4(params, objects);
 	else
 		return new BVH2(params, objects);
@@ -80,7 +83,7 @@ void BVH::build(Progress& progress)
 
 	/* pack triangles */
 	progress.set_substatus("Packing BVH triangles and strands");
-	pack_primitives();
+	pack_primitives(false);
 
 	if(progress.get_cancel()) {
 		root->deleteSubtree();
@@ -100,7 +103,7 @@ void BVH::build(Progress& progress)
 void BVH::refit(Progress& progress)
 {
 	progress.set_substatus("Packing BVH primitives");
-	pack_primitives();
+	pack_primitives(params.top_level);
 
 	if(progress.get_cancel()) return;
 
@@ -108,8 +111,41 @@ void BVH::refit(Progress& progress)
 	refit_nodes();
 }
 
+float BVH::compute_sah_cost()
+{
+	/* Only the leaves are taken into account, their layout is the same for
+	 * all BVH types and refitting degrades the tree mainly by leaves growing
+	 * and overlapping as primitives move apart. */
+	BoundBox root_bbox = BoundBox::empty;
+	float leaf_cost = 0.0f;
+
+	for(size_t i = 0; i < pack.leaf_nodes.size(); i++) {
+		const int4 data = pack.leaf_nodes[i];
+		BoundBox bbox = BoundBox::empty;
+		uint visibility = 0;
+
+		refit_primitives(data.x, data.y, bbox, visibility);
+
+		const int num_prims = (data.x < 0)? 1: data.y - data.x;
+		leaf_cost += bbox.safe_area() * num_prims;
+		root_bbox.grow(bbox);
+	}
+
+	const float root_area = root_bbox.safe_area();
+	if(root_area == 0.0f) {
+		return 0.0f;
+	}
+	return leaf_cost * params.sah_primitive_cost / root_area;
+}
+
 void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
 {
+	if(start < 0) {
+		/* Leaf of an object instance in the top level BVH, see pack_leaf(). */
+		start = ~start;
+		end = start + 1;
+	}
+
 	/* Refit range of primitives. */
 	for(int prim = start; prim < end; prim++) {
 		int pidx = pack.prim_index[prim];
@@ -177,13 +213,13 @@ void BVH::refit_primitives(int start, int end, BoundBox& bbox, uint& visibility)
 
 /* Triangles */
 
-void BVH::pack_triangle(int idx, float4 tri_verts[3])
+void BVH::pack_triangle(int idx, int tri_offset, float4 tri_verts[3])
 {
 	int tob = pack.prim_object[idx];
 	assert(tob >= 0 && tob < objects.size());
 	const Mesh *mesh = objects[tob]->mesh;
 
-	int tidx = pack.prim_index[idx];
+	int tidx = pack.prim_index[idx] - tri_offset;
 	Mesh::Triangle t = mesh->get_triangle(tidx);
 	const float3 *vpos = &mesh->verts[0];
 	float3 v0 = vpos[t.v[0]];
@@ -195,7 +231,7 @@ void BVH::pack_triangle(int idx, float4 tri_verts[3])
 	tri_verts[2] = float3_to_float4(v2);
 }
 
-void BVH::pack_primitives()
+void BVH::pack_primitives(bool use_mesh_offsets)
 {
 	const size_t tidx_size = pack.prim_index.size();
 	size_t num_prim_triangles = 0;
@@ -221,7 +257,8 @@ void BVH::pack_primitives()
 			int tob = pack.prim_object[i];
 			Object *ob = objects[tob];
 			if((pack.prim_type[i] & PRIMITIVE_ALL_TRIANGLE) != 0) {
-				pack_triangle(i, (float4*)&pack.prim_tri_verts[3 * prim_triangle_index]);
+				const int tri_offset = (use_mesh_offsets)? ob->mesh->tri_offset: 0;
+				pack_triangle(i, tri_offset, (float4*)&pack.prim_tri_verts[3 * prim_triangle_index]);
 				pack.prim_tri_index[i] = 3 * prim_triangle_index;
 				++prim_triangle_index;
 			}
@@ -249,6 +286,7 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 	 * top level BVH, adjusting indexes and offsets where appropriate.
 	 */
 	const bool use_qbvh = params.use_qbvh;
+	const bool use_obvh = params.use_obvh;
 
 	/* Adjust primitive index to point to the triangle in the global array, for
 	 * meshes with transform applied and already in the top level BVH.
@@ -425,14 +463,26 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 			for(size_t i = 0, j = 0; i < bvh_nodes_size; j++) {
 				size_t nsize, nsize_bbox;
 				if(bvh_nodes[i].x & PATH_RAY_NODE_UNALIGNED) {
-					nsize = use_qbvh
-					            ? BVH_UNALIGNED_QNODE_SIZE
-					            : BVH_UNALIGNED_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 13: 0;
+					if(use_obvh) {
+						nsize = BVH_UNALIGNED_ONODE_SIZE;
+						nsize_bbox = BVH_UNALIGNED_ONODE_SIZE-2;
+					}
+					else {
+						nsize = use_qbvh
+						            ? BVH_UNALIGNED_QNODE_SIZE
+						            : BVH_UNALIGNED_NODE_SIZE;
+						nsize_bbox = (use_qbvh)? 13: 0;
+					}
 				}
 				else {
-					nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
-					nsize_bbox = (use_qbvh)? 7: 0;
+					if(use_obvh) {
+						nsize = BVH_ONODE_SIZE;
+						nsize_bbox = BVH_ONODE_SIZE-2;
+					}
+					else {
+						nsize = (use_qbvh)? BVH_QNODE_SIZE: BVH_NODE_SIZE;
+						nsize_bbox = (use_qbvh)? 7: 0;
+					}
 				}
 
 				memcpy(pack_nodes + pack_nodes_offset,
@@ -445,19 +495,33 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 				data.z += (data.z < 0)? -noffset_leaf: noffset;
 				data.w += (data.w < 0)? -noffset_leaf: noffset;
 
-				if(use_qbvh) {
+				if(use_qbvh || use_obvh) {
 					data.x += (data.x < 0)? -noffset_leaf: noffset;
 					data.y += (data.y < 0)? -noffset_leaf: noffset;
 				}
 
 				pack_nodes[pack_nodes_offset + nsize_bbox] = data;
 
+				/* OBVH nodes store the indices of children 4 to 7 in the
+				 * next element.
+				 */
+				size_t nsize_children = 1;
+				if(use_obvh) {
+					data = bvh_nodes[i + nsize_bbox+1];
+					data.x += (data.x < 0)? -noffset_leaf: noffset;
+					data.y += (data.y < 0)? -noffset_leaf: noffset;
+					data.z += (data.z < 0)? -noffset_leaf: noffset;
+					data.w += (data.w < 0)? -noffset_leaf: noffset;
+					pack_nodes[pack_nodes_offset + nsize_bbox+1] = data;
+					nsize_children = 2;
+				}
+
 				/* Usually this copies nothing, but we better
 				 * be prepared for possible node size extension.
 				 */
-				memcpy(&pack_nodes[pack_nodes_offset + nsize_bbox+1],
-				       &bvh_nodes[i + nsize_bbox+1],
-				       sizeof(int4) * (nsize - (nsize_bbox+1)));
+				memcpy(&pack_nodes[pack_nodes_offset + nsize_bbox+nsize_children],
+				       &bvh_nodes[i + nsize_bbox+nsize_children],
+				       sizeof(int4) * (nsize - (nsize_bbox+nsize_children)));
 
 				pack_nodes_offset += nsize;
 				i += nsize;
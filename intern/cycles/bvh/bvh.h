@@ -82,21 +82,30 @@ public:
 	BVHParams params;
 	vector<Object*> objects;
 
+	/* SAH cost at the time the BVH was built, used to detect when refitting
+	 * degraded the tree too much. Zero if not computed. */
+	float build_sah_cost;
+
 	static BVH *create(const BVHParams& params, const vector<Object*>& objects);
 	virtual ~BVH() {}
 
 	void build(Progress& progress);
 	void refit(Progress& progress);
 
+	/* SAH cost of the leaves with the current primitive positions. */
+	float compute_sah_cost();
+
 protected:
 	BVH(const BVHParams& params, const vector<Object*>& objects);
 
 	/* Refit range of primitives. */
 	void refit_primitives(int start, int end, BoundBox& bbox, uint& visibility);
 
-	/* triangles and strands */
-	void pack_primitives();
-	void pack_triangle(int idx, float4 storage[3]);
+	/* triangles and strands, with use_mesh_offsets primitive indices include
+	 * the offset of the mesh, as in the top level BVH once instances are
+	 * packed */
+	void pack_primitives(bool use_mesh_offsets);
+	void pack_triangle(int idx, int tri_offset, float4 storage[3]);
 
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
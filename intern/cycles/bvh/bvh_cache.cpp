@@ -0,0 +1,444 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bvh/bvh_cache.h"
+#include "bvh/bvh_params.h"
+
+#include "render/attribute.h"
+#include "render/mesh.h"
+#include "render/object.h"
+
+#include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
+#include "util/util_time.h"
+
+#include <stdio.h>
+
+CCL_NAMESPACE_BEGIN
+
+/* Bump when the packed BVH layout or the key changes, so that BVHs stored
+ * on disk by older versions are no longer used. */
+#define BVH_CACHE_VERSION 1
+#define BVH_CACHE_MAGIC 0x48564243  /* "CBVH" */
+
+/* Key */
+
+static void hash_data(MD5Hash& md5, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t*)data;
+	while(size > 0) {
+		const int chunk = (size > (1 << 30))? (1 << 30): (int)size;
+		md5.append(bytes, chunk);
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
+template<typename T>
+static void hash_value(MD5Hash& md5, const T& value)
+{
+	hash_data(md5, &value, sizeof(value));
+}
+
+template<typename T>
+static void hash_array(MD5Hash& md5, const array<T>& data)
+{
+	hash_value(md5, (uint64_t)data.size());
+	hash_data(md5, data.data(), data.size() * sizeof(T));
+}
+
+/* float3 has padding which may contain arbitrary values, only hash the
+ * actual coordinates. */
+static void hash_float3(MD5Hash& md5, const float3 *data, size_t size)
+{
+	const size_t chunk_size = 1024;
+	float buffer[chunk_size * 3];
+
+	hash_value(md5, (uint64_t)size);
+
+	for(size_t i = 0; i < size; i += chunk_size) {
+		const size_t num = (size - i < chunk_size)? size - i: chunk_size;
+		for(size_t j = 0; j < num; j++) {
+			buffer[j*3 + 0] = data[i + j].x;
+			buffer[j*3 + 1] = data[i + j].y;
+			buffer[j*3 + 2] = data[i + j].z;
+		}
+		hash_data(md5, buffer, num * 3 * sizeof(float));
+	}
+}
+
+static void hash_motion_attribute(MD5Hash& md5, const AttributeSet& attributes)
+{
+	Attribute *attr = attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+	if(attr) {
+		hash_float3(md5, attr->data_float3(), attr->buffer.size() / sizeof(float3));
+	}
+	else {
+		hash_value(md5, (uint64_t)0);
+	}
+}
+
+/* Build parameters, hashed one by one to avoid struct padding. */
+static void hash_params(MD5Hash& md5, const BVHParams& params)
+{
+	hash_value(md5, params.use_spatial_split);
+	hash_value(md5, params.spatial_split_alpha);
+	hash_value(md5, params.unaligned_split_threshold);
+	hash_value(md5, params.sah_node_cost);
+	hash_value(md5, params.sah_primitive_cost);
+	hash_value(md5, params.min_leaf_size);
+	hash_value(md5, params.max_triangle_leaf_size);
+	hash_value(md5, params.max_motion_triangle_leaf_size);
+	hash_value(md5, params.max_curve_leaf_size);
+	hash_value(md5, params.max_motion_curve_leaf_size);
+	hash_value(md5, params.top_level);
+	hash_value(md5, params.use_qbvh);
+	hash_value(md5, params.use_obvh);
+	hash_value(md5, params.primitive_mask);
+	hash_value(md5, params.use_unaligned_nodes);
+	hash_value(md5, params.num_motion_curve_steps);
+	hash_value(md5, params.num_motion_triangle_steps);
+}
+
+static void hash_mesh(MD5Hash& md5, const Mesh *mesh)
+{
+	/* Geometry. */
+	hash_float3(md5, mesh->verts.data(), mesh->verts.size());
+	hash_array(md5, mesh->triangles);
+	hash_float3(md5, mesh->curve_keys.data(), mesh->curve_keys.size());
+	hash_array(md5, mesh->curve_radius);
+	hash_array(md5, mesh->curve_first_key);
+
+	/* Motion blur. */
+	const bool use_motion_blur = mesh->use_motion_blur;
+	hash_value(md5, use_motion_blur);
+	if(use_motion_blur) {
+		hash_value(md5, mesh->motion_steps);
+		hash_motion_attribute(md5, mesh->attributes);
+		hash_motion_attribute(md5, mesh->curve_attributes);
+	}
+}
+
+static void hash_pack(MD5Hash& md5, const PackedBVH& pack)
+{
+	hash_value(md5, pack.root_index);
+	hash_array(md5, pack.nodes);
+	hash_array(md5, pack.leaf_nodes);
+	hash_array(md5, pack.object_node);
+	hash_array(md5, pack.prim_tri_index);
+	hash_array(md5, pack.prim_tri_verts);
+	hash_array(md5, pack.prim_type);
+	hash_array(md5, pack.prim_visibility);
+	hash_array(md5, pack.prim_index);
+	hash_array(md5, pack.prim_object);
+	hash_array(md5, pack.prim_time);
+}
+
+string BVHCache::key(const Mesh *mesh, const BVHParams& params)
+{
+	MD5Hash md5;
+
+	hash_value(md5, (int)BVH_CACHE_VERSION);
+	hash_params(md5, params);
+	hash_mesh(md5, mesh);
+
+	return md5.get_hex();
+}
+
+string BVHCache::key(const vector<Object*>& objects, const BVHParams& params)
+{
+	MD5Hash md5;
+
+	hash_value(md5, (int)BVH_CACHE_VERSION);
+	hash_params(md5, params);
+
+	/* Everything of the objects which ends up in the packed BVH. */
+	map<const Mesh*, int> mesh_index;
+	hash_value(md5, (uint64_t)objects.size());
+	foreach(Object *ob, objects) {
+		const Mesh *mesh = ob->mesh;
+		const bool is_traceable = ob->is_traceable();
+		const uint visibility = ob->visibility_for_tracing();
+		hash_value(md5, is_traceable);
+		hash_value(md5, visibility);
+		hash_float3(md5, &ob->bounds.min, 1);
+		hash_float3(md5, &ob->bounds.max, 1);
+
+		/* Meshes shared between objects are hashed once. */
+		map<const Mesh*, int>::iterator it = mesh_index.find(mesh);
+		if(it != mesh_index.end()) {
+			hash_value(md5, it->second);
+			continue;
+		}
+		const int index = (int)mesh_index.size();
+		mesh_index[mesh] = index;
+		hash_value(md5, index);
+
+		const bool need_build_bvh = mesh->need_build_bvh();
+		const bool is_instanced = mesh->is_instanced();
+		hash_value(md5, need_build_bvh);
+		hash_value(md5, is_instanced);
+		hash_value(md5, mesh->tri_offset);
+		hash_value(md5, mesh->curve_offset);
+
+		/* The BVH of a mesh is packed into the top level one. It may have
+		 * been refitted, so hash the BVH itself and not the geometry. */
+		if(need_build_bvh && mesh->bvh != NULL) {
+			hash_pack(md5, mesh->bvh->pack);
+		}
+		else {
+			hash_mesh(md5, mesh);
+		}
+	}
+
+	return md5.get_hex();
+}
+
+/* Serialization */
+
+template<typename T>
+static void write_array(vector<uint8_t>& buffer, const array<T>& data)
+{
+	const uint64_t size = data.size();
+	const uint8_t *size_bytes = (const uint8_t*)&size;
+	buffer.insert(buffer.end(), size_bytes, size_bytes + sizeof(size));
+
+	const uint8_t *bytes = (const uint8_t*)data.data();
+	buffer.insert(buffer.end(), bytes, bytes + data.size() * sizeof(T));
+}
+
+template<typename T>
+static bool read_array(const vector<uint8_t>& buffer, size_t& offset, array<T>& data)
+{
+	uint64_t size;
+	if(offset + sizeof(size) > buffer.size()) {
+		return false;
+	}
+	memcpy(&size, &buffer[offset], sizeof(size));
+	offset += sizeof(size);
+
+	if(size > (buffer.size() - offset) / sizeof(T)) {
+		return false;
+	}
+
+	data.resize(size);
+	if(size > 0) {
+		memcpy(data.data(), &buffer[offset], size * sizeof(T));
+	}
+	offset += size * sizeof(T);
+	return true;
+}
+
+bool BVHCache::write(const string& filepath, const PackedBVH& pack)
+{
+	vector<uint8_t> buffer;
+	buffer.reserve(pack_size(pack) + 256);
+
+	const int header[3] = {BVH_CACHE_MAGIC, BVH_CACHE_VERSION, pack.root_index};
+	const uint8_t *header_bytes = (const uint8_t*)header;
+	buffer.insert(buffer.end(), header_bytes, header_bytes + sizeof(header));
+
+	write_array(buffer, pack.nodes);
+	write_array(buffer, pack.leaf_nodes);
+	write_array(buffer, pack.object_node);
+	write_array(buffer, pack.prim_tri_index);
+	write_array(buffer, pack.prim_tri_verts);
+	write_array(buffer, pack.prim_type);
+	write_array(buffer, pack.prim_visibility);
+	write_array(buffer, pack.prim_index);
+	write_array(buffer, pack.prim_object);
+	write_array(buffer, pack.prim_time);
+
+	/* Write to a temporary file first and then move it in place, other
+	 * processes may be reading the same directory. */
+	const string tmp_filepath = string_printf("%s.%llx.tmp",
+	                                          filepath.c_str(),
+	                                          (unsigned long long)(time_dt() * 1e6) ^
+	                                          (unsigned long long)(size_t)&buffer);
+	if(!path_write_binary(tmp_filepath, buffer)) {
+		return false;
+	}
+	if(rename(tmp_filepath.c_str(), filepath.c_str()) != 0) {
+		path_remove(tmp_filepath);
+		return false;
+	}
+	return true;
+}
+
+bool BVHCache::read(const string& filepath, PackedBVH& pack)
+{
+	vector<uint8_t> buffer;
+	if(!path_read_binary(filepath, buffer)) {
+		return false;
+	}
+
+	int header[3];
+	if(buffer.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(header, &buffer[0], sizeof(header));
+	if(header[0] != BVH_CACHE_MAGIC || header[1] != BVH_CACHE_VERSION) {
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+	if(!(read_array(buffer, offset, pack.nodes) &&
+	     read_array(buffer, offset, pack.leaf_nodes) &&
+	     read_array(buffer, offset, pack.object_node) &&
+	     read_array(buffer, offset, pack.prim_tri_index) &&
+	     read_array(buffer, offset, pack.prim_tri_verts) &&
+	     read_array(buffer, offset, pack.prim_type) &&
+	     read_array(buffer, offset, pack.prim_visibility) &&
+	     read_array(buffer, offset, pack.prim_index) &&
+	     read_array(buffer, offset, pack.prim_object) &&
+	     read_array(buffer, offset, pack.prim_time)))
+	{
+		return false;
+	}
+	pack.root_index = header[2];
+
+	return offset == buffer.size();
+}
+
+/* Cache */
+
+BVHCache::BVHCache()
+: num_hits(0),
+  num_disk_hits(0),
+  num_misses(0)
+{
+}
+
+BVHCache& BVHCache::get()
+{
+	static BVHCache instance;
+	return instance;
+}
+
+size_t BVHCache::pack_size(const PackedBVH& pack)
+{
+	return pack.nodes.size() * sizeof(int4) +
+	       pack.leaf_nodes.size() * sizeof(int4) +
+	       pack.object_node.size() * sizeof(int) +
+	       pack.prim_tri_index.size() * sizeof(uint) +
+	       pack.prim_tri_verts.size() * sizeof(float4) +
+	       pack.prim_type.size() * sizeof(int) +
+	       pack.prim_visibility.size() * sizeof(uint) +
+	       pack.prim_index.size() * sizeof(int) +
+	       pack.prim_object.size() * sizeof(int) +
+	       pack.prim_time.size() * sizeof(float2);
+}
+
+bool BVHCache::lookup(const string& key, const string& disk_path, PackedBVH& pack)
+{
+	{
+		thread_scoped_lock lock(mutex);
+		map<string, Entry>::iterator it = entries.find(key);
+		if(it != entries.end()) {
+			it->second.used = true;
+			pack = it->second.pack;
+			num_hits++;
+			return true;
+		}
+	}
+
+	if(!disk_path.empty()) {
+		/* Read outside of the lock, other meshes may be building meanwhile. */
+		PackedBVH disk_pack;
+		if(read(path_join(disk_path, key + ".bvh"), disk_pack)) {
+			pack = disk_pack;
+
+			thread_scoped_lock lock(mutex);
+			Entry& entry = entries[key];
+			entry.pack = disk_pack;
+			entry.used = true;
+			num_disk_hits++;
+			return true;
+		}
+	}
+
+	thread_scoped_lock lock(mutex);
+	num_misses++;
+	return false;
+}
+
+void BVHCache::insert(const string& key,
+                      const string& disk_path,
+                      size_t disk_size,
+                      const PackedBVH& pack)
+{
+	{
+		thread_scoped_lock lock(mutex);
+		Entry& entry = entries[key];
+		entry.pack = pack;
+		entry.used = true;
+	}
+
+	if(!disk_path.empty()) {
+		const string filepath = path_join(disk_path, key + ".bvh");
+		if(!write(filepath, pack)) {
+			VLOG(1) << "Failed to write BVH cache file " << filepath << ".";
+		}
+		else if(disk_size > 0) {
+			/* Deforming meshes write a file for every frame, keep the files
+			 * written last. */
+			path_cache_trim(disk_path, ".bvh", disk_size);
+		}
+	}
+}
+
+void BVHCache::prune()
+{
+	thread_scoped_lock lock(mutex);
+
+	size_t num_freed = 0, mem_used = 0;
+	map<string, Entry>::iterator it = entries.begin();
+	while(it != entries.end()) {
+		if(it->second.used) {
+			it->second.used = false;
+			mem_used += pack_size(it->second.pack);
+			++it;
+		}
+		else {
+			entries.erase(it++);
+			num_freed++;
+		}
+	}
+
+	VLOG(1) << "BVH cache: " << num_hits << " hits, "
+	        << num_disk_hits << " disk hits, "
+	        << num_misses << " misses, "
+	        << num_freed << " freed, "
+	        << entries.size() << " BVHs using "
+	        << string_human_readable_size(mem_used) << ".";
+
+	num_hits = 0;
+	num_disk_hits = 0;
+	num_misses = 0;
+}
+
+void BVHCache::clear()
+{
+	thread_scoped_lock lock(mutex);
+	entries.clear();
+	num_hits = 0;
+	num_disk_hits = 0;
+	num_misses = 0;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BVH_CACHE_H__
+#define __BVH_CACHE_H__
+
+#include "bvh/bvh.h"
+
+#include "util/util_map.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+class BVHParams;
+class Mesh;
+class Object;
+
+/* BVH Cache
+ *
+ * Keeps packed mesh BVHs alive between scene updates, keyed on a hash of
+ * the geometry and build parameters. Meshes which do not change between
+ * frames of an animation will reuse their BVH instead of building it again,
+ * regardless of which Mesh datablock or session they belong to.
+ *
+ * The top level BVH is cached the same way, keyed on the objects and all
+ * their geometry. It is only reused when nothing in the scene moved or
+ * deformed, which makes it useful for static scenes with an animated camera
+ * or shading, where final renders pack all meshes into the top level BVH.
+ *
+ * Optionally BVHs are also stored in a directory on disk, so that they can
+ * be shared between render processes, for example on a render farm.
+ */
+class BVHCache {
+public:
+	static BVHCache& get();
+
+	/* Key identifying the BVH built for the mesh with the given parameters. */
+	static string key(const Mesh *mesh, const BVHParams& params);
+	/* Key identifying the top level BVH built for the objects, the BVHs of
+	 * the meshes must be up to date. */
+	static string key(const vector<Object*>& objects, const BVHParams& params);
+
+	/* Copy the cached BVH into pack, looking in disk_path if it is not in
+	 * memory and the path is not empty. Returns false if there is none. */
+	bool lookup(const string& key, const string& disk_path, PackedBVH& pack);
+
+	/* Store a newly built BVH, also writing it to disk_path if not empty.
+	 * When disk_size is not zero, the least recently written files are
+	 * removed from disk_path to keep it below that many bytes. */
+	void insert(const string& key,
+	            const string& disk_path,
+	            size_t disk_size,
+	            const PackedBVH& pack);
+
+	/* Free BVHs which were not used since the previous call. Called once
+	 * per scene update, so that geometry which changes every frame does not
+	 * accumulate in memory. */
+	void prune();
+
+	/* Free all BVHs in memory. */
+	void clear();
+
+protected:
+	BVHCache();
+
+	struct Entry {
+		PackedBVH pack;
+		bool used;
+	};
+
+	static size_t pack_size(const PackedBVH& pack);
+	static bool read(const string& filepath, PackedBVH& pack);
+	static bool write(const string& filepath, const PackedBVH& pack);
+
+	thread_mutex mutex;
+	map<string, Entry> entries;
+
+	/* Statistics since the previous prune. */
+	size_t num_hits;
+	size_t num_disk_hits;
+	size_t num_misses;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __BVH_CACHE_H__ */
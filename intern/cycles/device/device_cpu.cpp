@@ -51,6 +51,7 @@
 #include "util/util_optimization.h"
 #include "util/util_progress.h"
 #include "util/util_system.h"
+#include "util/util_texture_cache.h"
 #include "util/util_thread.h"
 
 CCL_NAMESPACE_BEGIN
@@ -166,6 +167,8 @@ public:
 	device_vector<TextureInfo> texture_info;
 	bool need_texture_info;
 
+	TextureCache tex_cache;
+
 #ifdef WITH_OSL
 	OSLGlobals osl_globals;
 #endif
@@ -175,6 +178,10 @@ public:
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int)>                  adaptive_stopping_kernel;
+	KernelFunctions<bool(*)(KernelGlobals *, float *, int, int, int, int, int)>             adaptive_filter_x_kernel;
+	KernelFunctions<bool(*)(KernelGlobals *, float *, int, int, int, int, int)>             adaptive_filter_y_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>             adaptive_adjust_samples_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)> convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, int, int, int, int, int)>   shader_kernel;
@@ -184,14 +191,14 @@ public:
 	KernelFunctions<void(*)(int, int, float*, float*, float*, float*, int*, int)>                               filter_detect_outliers_kernel;
 	KernelFunctions<void(*)(int, int, float*, float*, float*, float*, int*, int)>                               filter_combine_halves_kernel;
 
-	KernelFunctions<void(*)(int, int, float*, float*, float*, int*, int, int, float, float)> filter_nlm_calc_difference_kernel;
+	KernelFunctions<void(*)(int, int, float*, float*, float*, int*, int, int, int, float, float)> filter_nlm_calc_difference_kernel;
 	KernelFunctions<void(*)(float*, float*, int*, int, int)>                                 filter_nlm_blur_kernel;
 	KernelFunctions<void(*)(float*, float*, int*, int, int)>                                 filter_nlm_calc_weight_kernel;
 	KernelFunctions<void(*)(int, int, float*, float*, float*, float*, int*, int, int)>       filter_nlm_update_output_kernel;
 	KernelFunctions<void(*)(float*, float*, int*, int)>                                      filter_nlm_normalize_kernel;
 
 	KernelFunctions<void(*)(float*, int, int, int, float*, int*, int*, int, int, float)>                         filter_construct_transform_kernel;
-	KernelFunctions<void(*)(int, int, float*, float*, float*, int*, float*, float3*, int*, int*, int, int, int)> filter_nlm_construct_gramian_kernel;
+	KernelFunctions<void(*)(int, int, float*, float*, float*, int*, float*, float3*, int*, int*, int, int, int, int)> filter_nlm_construct_gramian_kernel;
 	KernelFunctions<void(*)(int, int, int, float*, int*, float*, float3*, int*, int)>                            filter_finalize_kernel;
 
 	KernelFunctions<void(*)(KernelGlobals *, ccl_constant KernelData*, ccl_global void*, int, ccl_global char*,
@@ -210,8 +217,13 @@ public:
 	CPUDevice(DeviceInfo& info_, Stats &stats_, bool background_)
 	: Device(info_, stats_, background_),
 	  texture_info(this, "__texture_info", MEM_TEXTURE),
+	  tex_cache(stats_),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  REGISTER_KERNEL(adaptive_stopping),
+	  REGISTER_KERNEL(adaptive_filter_x),
+	  REGISTER_KERNEL(adaptive_filter_y),
+	  REGISTER_KERNEL(adaptive_adjust_samples),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
@@ -237,6 +249,7 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		kernel_globals.texture_cache = &tex_cache;
 		use_split_kernel = DebugFlags().cpu.split_kernel;
 		if(use_split_kernel) {
 			VLOG(1) << "Will be using split kernel.";
@@ -439,6 +452,11 @@ public:
 #endif
 	}
 
+	TextureCache *texture_cache()
+	{
+		return &tex_cache;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::RENDER) {
@@ -500,7 +518,7 @@ public:
 			                                    (float*) variance_ptr,
 			                                    difference,
 			                                    local_rect,
-			                                    w, 0,
+			                                    w, 0, 0,
 			                                    a, k_2);
 
 			filter_nlm_blur_kernel()       (difference, blurDifference, local_rect, w, f);
@@ -552,38 +570,46 @@ public:
 		float *difference     = (float*) task->reconstruction_state.temporary_1_ptr;
 		float *blurDifference = (float*) task->reconstruction_state.temporary_2_ptr;
 
+		/* Neighboring frames contribute to the same regression, with weights
+		 * from comparing their color against the current frame. */
 		int r = task->radius;
-		for(int i = 0; i < (2*r+1)*(2*r+1); i++) {
-			int dy = i / (2*r+1) - r;
-			int dx = i % (2*r+1) - r;
-
-			int local_rect[4] = {max(0, -dx), max(0, -dy),
-			                     task->reconstruction_state.source_w - max(0, dx),
-			                     task->reconstruction_state.source_h - max(0, dy)};
-			filter_nlm_calc_difference_kernel()(dx, dy,
-			                                    (float*) color_ptr,
-			                                    (float*) color_variance_ptr,
-			                                    difference,
-			                                    local_rect,
-			                                    task->buffer.stride,
-			                                    task->buffer.pass_stride,
-			                                    1.0f,
-			                                    task->nlm_k_2);
-			filter_nlm_blur_kernel()(difference, blurDifference, local_rect, task->buffer.stride, 4);
-			filter_nlm_calc_weight_kernel()(blurDifference, difference, local_rect, task->buffer.stride, 4);
-			filter_nlm_blur_kernel()(difference, blurDifference, local_rect, task->buffer.stride, 4);
-			filter_nlm_construct_gramian_kernel()(dx, dy,
-			                                      blurDifference,
-			                                      (float*)  task->buffer.mem.device_pointer,
-			                                      (float*)  task->storage.transform.device_pointer,
-			                                      (int*)    task->storage.rank.device_pointer,
-			                                      (float*)  task->storage.XtWX.device_pointer,
-			                                      (float3*) task->storage.XtWY.device_pointer,
-			                                      local_rect,
-			                                      &task->reconstruction_state.filter_window.x,
-			                                      task->buffer.stride,
-			                                      4,
-			                                      task->buffer.pass_stride);
+		for(int frame = 0; frame < task->buffer.frames; frame++) {
+			int frame_offset = frame * task->buffer.frame_stride;
+
+			for(int i = 0; i < (2*r+1)*(2*r+1); i++) {
+				int dy = i / (2*r+1) - r;
+				int dx = i % (2*r+1) - r;
+
+				int local_rect[4] = {max(0, -dx), max(0, -dy),
+				                     task->reconstruction_state.source_w - max(0, dx),
+				                     task->reconstruction_state.source_h - max(0, dy)};
+				filter_nlm_calc_difference_kernel()(dx, dy,
+				                                    (float*) color_ptr,
+				                                    (float*) color_variance_ptr,
+				                                    difference,
+				                                    local_rect,
+				                                    task->buffer.stride,
+				                                    task->buffer.pass_stride,
+				                                    frame_offset,
+				                                    1.0f,
+				                                    task->nlm_k_2);
+				filter_nlm_blur_kernel()(difference, blurDifference, local_rect, task->buffer.stride, 4);
+				filter_nlm_calc_weight_kernel()(blurDifference, difference, local_rect, task->buffer.stride, 4);
+				filter_nlm_blur_kernel()(difference, blurDifference, local_rect, task->buffer.stride, 4);
+				filter_nlm_construct_gramian_kernel()(dx, dy,
+				                                      blurDifference,
+				                                      (float*)  task->buffer.mem.device_pointer,
+				                                      (float*)  task->storage.transform.device_pointer,
+				                                      (int*)    task->storage.rank.device_pointer,
+				                                      (float*)  task->storage.XtWX.device_pointer,
+				                                      (float3*) task->storage.XtWY.device_pointer,
+				                                      local_rect,
+				                                      &task->reconstruction_state.filter_window.x,
+				                                      task->buffer.stride,
+				                                      4,
+				                                      task->buffer.pass_stride,
+				                                      frame_offset);
+			}
 		}
 		for(int y = 0; y < task->filter_area.w; y++) {
 			for(int x = 0; x < task->filter_area.z; x++) {
@@ -692,6 +718,11 @@ public:
 		int start_sample = tile.start_sample;
 		int end_sample = tile.start_sample + tile.num_samples;
 
+		/* Adaptive sampling needs all samples of a tile to be rendered at
+		 * once, to scale pixels which stopped early in the end. */
+		bool use_adaptive_sampling = kg->__data.film.pass_adaptive_aux_buffer &&
+		                             !task.need_finish_queue;
+
 		for(int sample = start_sample; sample < end_sample; sample++) {
 			if(task.get_cancel() || task_pool.canceled()) {
 				if(task.need_finish_queue == false)
@@ -708,9 +739,61 @@ public:
 			tile.sample = sample + 1;
 
 			task.update_progress(&tile, tile.w*tile.h);
+
+			if(use_adaptive_sampling && adaptive_sampling_converged(kg, tile)) {
+				/* Account for the skipped samples in the progress. */
+				int num_skipped = end_sample - tile.sample;
+				tile.sample = end_sample;
+				if(num_skipped > 0) {
+					task.update_progress(&tile, tile.w*tile.h*num_skipped);
+				}
+				break;
+			}
+		}
+
+		if(use_adaptive_sampling) {
+			int num_samples = tile.sample - start_sample;
+			for(int y = tile.y; y < tile.y + tile.h; y++) {
+				for(int x = tile.x; x < tile.x + tile.w; x++) {
+					adaptive_adjust_samples_kernel()(kg, render_buffer, num_samples,
+					                                 x, y, tile.offset, tile.stride);
+				}
+			}
 		}
 	}
 
+	/* Update the convergence of all pixels in the tile, returns true if all
+	 * of them converged and no more samples are needed. */
+	bool adaptive_sampling_converged(KernelGlobals *kg, RenderTile &tile)
+	{
+		const KernelIntegrator *kintegrator = &kg->__data.integrator;
+		const int num_samples = tile.sample - tile.start_sample;
+
+		if(num_samples < kintegrator->adaptive_min_samples ||
+		   (num_samples - kintegrator->adaptive_min_samples) % kintegrator->adaptive_step != 0)
+		{
+			return false;
+		}
+
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_stopping_kernel()(kg, render_buffer, x, y, tile.offset, tile.stride);
+			}
+		}
+
+		bool any = false;
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			any |= adaptive_filter_x_kernel()(kg, render_buffer, y, tile.x, tile.w, tile.offset, tile.stride);
+		}
+		for(int x = tile.x; x < tile.x + tile.w; x++) {
+			any |= adaptive_filter_y_kernel()(kg, render_buffer, x, tile.y, tile.h, tile.offset, tile.stride);
+		}
+
+		return !any;
+	}
+
 	void denoise(DeviceTask &task, DenoisingTask& denoising, RenderTile &tile)
 	{
 		tile.sample = tile.start_sample + tile.num_samples;
@@ -732,6 +815,11 @@ public:
 		task.map_neighbor_tiles(rtiles, this);
 		denoising.tiles_from_rendertiles(rtiles);
 
+		denoising.neighbor_frames.clear();
+		if(task.get_neighbor_frames) {
+			task.get_neighbor_frames(tile, denoising.neighbor_frames);
+		}
+
 		denoising.init_from_devicetask(task);
 
 		denoising.run_denoising();
@@ -840,6 +928,8 @@ public:
 
 		}
 
+		tex_cache.flush_thread_stats(&kg.texture_cache_stats);
+
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
@@ -891,6 +981,7 @@ protected:
 			kg.decoupled_volume_steps[i] = NULL;
 		}
 		kg.decoupled_volume_steps_index = 0;
+		kg.texture_cache_stats = TextureCacheThreadStats();
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
@@ -913,6 +1004,7 @@ protected:
 				free(kg->decoupled_volume_steps[i]);
 			}
 		}
+		tex_cache.flush_thread_stats(&kg->texture_cache_stats);
 #ifdef WITH_OSL
 		OSLShader::thread_free(kg);
 #endif
@@ -1023,7 +1115,9 @@ int2 CPUSplitKernel::split_kernel_local_size()
 }
 
 int2 CPUSplitKernel::split_kernel_global_size(device_memory& /*kg*/, device_memory& /*data*/, DeviceTask * /*task*/) {
-	return make_int2(1, 1);
+	/* Trace many paths at once, so that rays can be sorted by shader and
+	 * each shader is evaluated for a batch of rays. */
+	return make_int2(max(DebugFlags().cpu.split_kernel_paths, 1), 1);
 }
 
 uint64_t CPUSplitKernel::state_buffer_size(device_memory& kernel_globals, device_memory& /*data*/, size_t num_threads) {
@@ -1047,6 +1141,10 @@ void device_cpu_info(vector<DeviceInfo>& devices)
 	info.num = 0;
 	info.advanced_shading = true;
 	info.has_qbvh = system_cpu_support_sse2();
+	/* 8-wide BVH traversal is only compiled into the AVX2 kernel. */
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+	info.has_obvh = system_cpu_support_avx2();
+#endif
 	info.has_volume_decoupled = true;
 	info.has_osl = true;
 	info.has_half_images = true;
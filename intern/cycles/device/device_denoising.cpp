@@ -88,6 +88,102 @@ void DenoisingTask::tiles_from_rendertiles(RenderTile *rtiles)
 	functions.set_tiles(buffers);
 }
 
+void DenoisingTask::prefilter_shadowing(int frame_offset)
+{
+	device_ptr null_ptr = (device_ptr) 0;
+
+	device_sub_ptr unfiltered_a   (buffer.mem, frame_offset,                    buffer.pass_stride);
+	device_sub_ptr unfiltered_b   (buffer.mem, frame_offset + 1*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr sample_var     (buffer.mem, frame_offset + 2*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr sample_var_var (buffer.mem, frame_offset + 3*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr buffer_var     (buffer.mem, frame_offset + 5*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr filtered_var   (buffer.mem, frame_offset + 6*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr nlm_temporary_1(buffer.mem, frame_offset + 7*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr nlm_temporary_2(buffer.mem, frame_offset + 8*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr nlm_temporary_3(buffer.mem, frame_offset + 9*buffer.pass_stride, buffer.pass_stride);
+
+	nlm_state.temporary_1_ptr = *nlm_temporary_1;
+	nlm_state.temporary_2_ptr = *nlm_temporary_2;
+	nlm_state.temporary_3_ptr = *nlm_temporary_3;
+
+	/* Get the A/B unfiltered passes, the combined sample variance, the estimated variance of the sample variance and the buffer variance. */
+	functions.divide_shadow(*unfiltered_a, *unfiltered_b, *sample_var, *sample_var_var, *buffer_var);
+
+	/* Smooth the (generally pretty noisy) buffer variance using the spatial information from the sample variance. */
+	nlm_state.set_parameters(6, 3, 4.0f, 1.0f);
+	functions.non_local_means(*buffer_var, *sample_var, *sample_var_var, *filtered_var);
+
+	/* Reuse memory, the previous data isn't needed anymore. */
+	device_ptr filtered_a = *buffer_var,
+	           filtered_b = *sample_var;
+	/* Use the smoothed variance to filter the two shadow half images using each other for weight calculation. */
+	nlm_state.set_parameters(5, 3, 1.0f, 0.25f);
+	functions.non_local_means(*unfiltered_a, *unfiltered_b, *filtered_var, filtered_a);
+	functions.non_local_means(*unfiltered_b, *unfiltered_a, *filtered_var, filtered_b);
+
+	device_ptr residual_var = *sample_var_var;
+	/* Estimate the residual variance between the two filtered halves. */
+	functions.combine_halves(filtered_a, filtered_b, null_ptr, residual_var, 2, rect);
+
+	device_ptr final_a = *unfiltered_a,
+	           final_b = *unfiltered_b;
+	/* Use the residual variance for a second filter pass. */
+	nlm_state.set_parameters(4, 2, 1.0f, 0.5f);
+	functions.non_local_means(filtered_a, filtered_b, residual_var, final_a);
+	functions.non_local_means(filtered_b, filtered_a, residual_var, final_b);
+
+	/* Combine the two double-filtered halves to a final shadow feature. */
+	device_sub_ptr shadow_pass(buffer.mem, frame_offset + 4*buffer.pass_stride, buffer.pass_stride);
+	functions.combine_halves(final_a, final_b, *shadow_pass, null_ptr, 0, rect);
+}
+
+void DenoisingTask::prefilter_features(int frame_offset)
+{
+	device_sub_ptr unfiltered     (buffer.mem, frame_offset +  8*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr variance       (buffer.mem, frame_offset +  9*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr nlm_temporary_1(buffer.mem, frame_offset + 10*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr nlm_temporary_2(buffer.mem, frame_offset + 11*buffer.pass_stride, buffer.pass_stride);
+	device_sub_ptr nlm_temporary_3(buffer.mem, frame_offset + 12*buffer.pass_stride, buffer.pass_stride);
+
+	nlm_state.temporary_1_ptr = *nlm_temporary_1;
+	nlm_state.temporary_2_ptr = *nlm_temporary_2;
+	nlm_state.temporary_3_ptr = *nlm_temporary_3;
+
+	int mean_from[]     = { 0, 1, 2, 12, 6,  7, 8 };
+	int variance_from[] = { 3, 4, 5, 13, 9, 10, 11};
+	int pass_to[]       = { 1, 2, 3, 0,  5,  6,  7};
+	for(int pass = 0; pass < 7; pass++) {
+		device_sub_ptr feature_pass(buffer.mem, frame_offset + pass_to[pass]*buffer.pass_stride, buffer.pass_stride);
+		/* Get the unfiltered pass and its variance from the RenderBuffers. */
+		functions.get_feature(mean_from[pass], variance_from[pass], *unfiltered, *variance);
+		/* Smooth the pass and store the result in the denoising buffers. */
+		nlm_state.set_parameters(2, 2, 1.0f, 0.25f);
+		functions.non_local_means(*unfiltered, *unfiltered, *variance, *feature_pass);
+	}
+}
+
+void DenoisingTask::prefilter_color(int frame_offset)
+{
+	int mean_from[]     = {20, 21, 22};
+	int variance_from[] = {23, 24, 25};
+	int mean_to[]       = { 8,  9, 10};
+	int variance_to[]   = {11, 12, 13};
+	int num_color_passes = 3;
+
+	storage.temporary_color.alloc_to_device(3*buffer.pass_stride, false);
+
+	for(int pass = 0; pass < num_color_passes; pass++) {
+		device_sub_ptr color_pass(storage.temporary_color, pass*buffer.pass_stride, buffer.pass_stride);
+		device_sub_ptr color_var_pass(buffer.mem, frame_offset + variance_to[pass]*buffer.pass_stride, buffer.pass_stride);
+		functions.get_feature(mean_from[pass], variance_from[pass], *color_pass, *color_var_pass);
+	}
+
+	device_sub_ptr depth_pass    (buffer.mem, frame_offset,                                   buffer.pass_stride);
+	device_sub_ptr color_var_pass(buffer.mem, frame_offset + variance_to[0]*buffer.pass_stride, 3*buffer.pass_stride);
+	device_sub_ptr output_pass   (buffer.mem, frame_offset +     mean_to[0]*buffer.pass_stride, 3*buffer.pass_stride);
+	functions.detect_outliers(storage.temporary_color.device_pointer, *color_var_pass, *depth_pass, *output_pass);
+}
+
 bool DenoisingTask::run_denoising()
 {
 	/* Allocate denoising buffer. */
@@ -96,104 +192,35 @@ bool DenoisingTask::run_denoising()
 	buffer.stride = align_up(buffer.width, 4);
 	buffer.h = rect.w - rect.y;
 	buffer.pass_stride = align_up(buffer.stride * buffer.h, divide_up(device->mem_address_alignment(), sizeof(float)));
-	buffer.mem.alloc_to_device(buffer.pass_stride * buffer.passes, false);
-
-	device_ptr null_ptr = (device_ptr) 0;
-
-	/* Prefilter shadow feature. */
-	{
-		device_sub_ptr unfiltered_a   (buffer.mem, 0,                    buffer.pass_stride);
-		device_sub_ptr unfiltered_b   (buffer.mem, 1*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr sample_var     (buffer.mem, 2*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr sample_var_var (buffer.mem, 3*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr buffer_var     (buffer.mem, 5*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr filtered_var   (buffer.mem, 6*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr nlm_temporary_1(buffer.mem, 7*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr nlm_temporary_2(buffer.mem, 8*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr nlm_temporary_3(buffer.mem, 9*buffer.pass_stride, buffer.pass_stride);
-
-		nlm_state.temporary_1_ptr = *nlm_temporary_1;
-		nlm_state.temporary_2_ptr = *nlm_temporary_2;
-		nlm_state.temporary_3_ptr = *nlm_temporary_3;
-
-		/* Get the A/B unfiltered passes, the combined sample variance, the estimated variance of the sample variance and the buffer variance. */
-		functions.divide_shadow(*unfiltered_a, *unfiltered_b, *sample_var, *sample_var_var, *buffer_var);
-
-		/* Smooth the (generally pretty noisy) buffer variance using the spatial information from the sample variance. */
-		nlm_state.set_parameters(6, 3, 4.0f, 1.0f);
-		functions.non_local_means(*buffer_var, *sample_var, *sample_var_var, *filtered_var);
-
-		/* Reuse memory, the previous data isn't needed anymore. */
-		device_ptr filtered_a = *buffer_var,
-		           filtered_b = *sample_var;
-		/* Use the smoothed variance to filter the two shadow half images using each other for weight calculation. */
-		nlm_state.set_parameters(5, 3, 1.0f, 0.25f);
-		functions.non_local_means(*unfiltered_a, *unfiltered_b, *filtered_var, filtered_a);
-		functions.non_local_means(*unfiltered_b, *unfiltered_a, *filtered_var, filtered_b);
-
-		device_ptr residual_var = *sample_var_var;
-		/* Estimate the residual variance between the two filtered halves. */
-		functions.combine_halves(filtered_a, filtered_b, null_ptr, residual_var, 2, rect);
-
-		device_ptr final_a = *unfiltered_a,
-		           final_b = *unfiltered_b;
-		/* Use the residual variance for a second filter pass. */
-		nlm_state.set_parameters(4, 2, 1.0f, 0.5f);
-		functions.non_local_means(filtered_a, filtered_b, residual_var, final_a);
-		functions.non_local_means(filtered_b, filtered_a, residual_var, final_b);
-
-		/* Combine the two double-filtered halves to a final shadow feature. */
-		device_sub_ptr shadow_pass(buffer.mem, 4*buffer.pass_stride, buffer.pass_stride);
-		functions.combine_halves(final_a, final_b, *shadow_pass, null_ptr, 0, rect);
-	}
-
-	/* Prefilter general features. */
-	{
-		device_sub_ptr unfiltered     (buffer.mem,  8*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr variance       (buffer.mem,  9*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr nlm_temporary_1(buffer.mem, 10*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr nlm_temporary_2(buffer.mem, 11*buffer.pass_stride, buffer.pass_stride);
-		device_sub_ptr nlm_temporary_3(buffer.mem, 12*buffer.pass_stride, buffer.pass_stride);
-
-		nlm_state.temporary_1_ptr = *nlm_temporary_1;
-		nlm_state.temporary_2_ptr = *nlm_temporary_2;
-		nlm_state.temporary_3_ptr = *nlm_temporary_3;
-
-		int mean_from[]     = { 0, 1, 2, 12, 6,  7, 8 };
-		int variance_from[] = { 3, 4, 5, 13, 9, 10, 11};
-		int pass_to[]       = { 1, 2, 3, 0,  5,  6,  7};
-		for(int pass = 0; pass < 7; pass++) {
-			device_sub_ptr feature_pass(buffer.mem, pass_to[pass]*buffer.pass_stride, buffer.pass_stride);
-			/* Get the unfiltered pass and its variance from the RenderBuffers. */
-			functions.get_feature(mean_from[pass], variance_from[pass], *unfiltered, *variance);
-			/* Smooth the pass and store the result in the denoising buffers. */
-			nlm_state.set_parameters(2, 2, 1.0f, 0.25f);
-			functions.non_local_means(*unfiltered, *unfiltered, *variance, *feature_pass);
+	buffer.frames = 1 + neighbor_frames.size();
+	buffer.frame_stride = buffer.pass_stride * buffer.passes;
+	buffer.mem.alloc_to_device(buffer.frame_stride * buffer.frames, false);
+
+	prefilter_shadowing(0);
+	prefilter_features(0);
+	prefilter_color(0);
+
+	/* Prefilter neighboring frames the same way, reading from their buffers
+	 * with the tile layout of the current frame. */
+	if(!neighbor_frames.empty()) {
+		device_ptr center_buffers[9];
+		for(int i = 0; i < 9; i++) {
+			center_buffers[i] = tiles->buffers[i];
 		}
-	}
 
-	/* Copy color passes. */
-	{
-		int mean_from[]     = {20, 21, 22};
-		int variance_from[] = {23, 24, 25};
-		int mean_to[]       = { 8,  9, 10};
-		int variance_to[]   = {11, 12, 13};
-		int num_color_passes = 3;
-
-		storage.temporary_color.alloc_to_device(3*buffer.pass_stride, false);
-
-		for(int pass = 0; pass < num_color_passes; pass++) {
-			device_sub_ptr color_pass(storage.temporary_color, pass*buffer.pass_stride, buffer.pass_stride);
-			device_sub_ptr color_var_pass(buffer.mem, variance_to[pass]*buffer.pass_stride, buffer.pass_stride);
-			functions.get_feature(mean_from[pass], variance_from[pass], *color_pass, *color_var_pass);
-		}
+		for(int frame = 1; frame < buffer.frames; frame++) {
+			device_ptr frame_buffers[9];
+			for(int i = 0; i < 9; i++) {
+				frame_buffers[i] = neighbor_frames[frame-1];
+			}
+			functions.set_tiles(frame_buffers);
 
-		{
-			device_sub_ptr depth_pass    (buffer.mem,                                 0,   buffer.pass_stride);
-			device_sub_ptr color_var_pass(buffer.mem, variance_to[0]*buffer.pass_stride, 3*buffer.pass_stride);
-			device_sub_ptr output_pass   (buffer.mem,     mean_to[0]*buffer.pass_stride, 3*buffer.pass_stride);
-			functions.detect_outliers(storage.temporary_color.device_pointer, *color_var_pass, *depth_pass, *output_pass);
+			prefilter_shadowing(frame*buffer.frame_stride);
+			prefilter_features(frame*buffer.frame_stride);
+			prefilter_color(frame*buffer.frame_stride);
 		}
+
+		functions.set_tiles(center_buffers);
 	}
 
 	storage.w = filter_area.z;
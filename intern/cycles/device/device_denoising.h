@@ -47,6 +47,11 @@ public:
 	device_vector<int> tiles_mem;
 	void tiles_from_rendertiles(RenderTile *rtiles);
 
+	/* Render buffers of neighboring frames for temporal denoising. They are
+	 * accessed with the offset and stride of the current tile, so this is
+	 * only supported when a single buffer covers all neighbor tiles. */
+	vector<device_ptr> neighbor_frames;
+
 	int4 rect;
 	int4 filter_area;
 
@@ -151,6 +156,10 @@ public:
 		int stride;
 		int h;
 		int width;
+		/* Prefiltered passes of the current frame are followed by those of
+		 * the neighboring frames, frame_stride floats apart. */
+		int frames;
+		int frame_stride;
 		device_only_memory<float> mem;
 
 		DenoiseBuffers(Device *device)
@@ -160,6 +169,10 @@ public:
 
 protected:
 	Device *device;
+
+	void prefilter_shadowing(int frame_offset);
+	void prefilter_features(int frame_offset);
+	void prefilter_color(int frame_offset);
 };
 
 CCL_NAMESPACE_END
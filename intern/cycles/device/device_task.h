@@ -67,6 +67,8 @@ public:
 	function<bool(void)> get_cancel;
 	function<void(RenderTile*, Device*)> map_neighbor_tiles;
 	function<void(RenderTile*, Device*)> unmap_neighbor_tiles;
+	/* Buffers of neighboring frames for temporal denoising, CPU only. */
+	function<void(RenderTile&, vector<device_ptr>&)> get_neighbor_frames;
 
 	int denoising_radius;
 	float denoising_strength;
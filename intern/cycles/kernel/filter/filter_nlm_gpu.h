@@ -182,7 +182,7 @@ ccl_device_inline void kernel_filter_nlm_construct_gramian(int x, int y,
 
 	kernel_filter_construct_gramian(x, y,
 	                                rect_size(filter_window),
-	                                dx, dy,
+	                                dx, dy, 0,
 	                                stride,
 	                                pass_stride,
 	                                buffer,
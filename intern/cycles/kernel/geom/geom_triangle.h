@@ -74,15 +74,59 @@ ccl_device_inline void triangle_vertices(KernelGlobals *kg, int prim, float3 P[3
 	P[2] = float4_to_float3(kernel_tex_fetch(__prim_tri_verts, tri_vindex.w+2));
 }
 
+/* Compact mesh storage
+ *
+ * Vertex normals are stored as two 16 bit octahedral coordinates packed in
+ * one uint, and corner UVs as two half floats packed in one uint. */
+
+ccl_device_inline float3 triangle_normal_decode(uint packed)
+{
+	const float u = (float)(packed & 0xFFFF) * (2.0f/65535.0f) - 1.0f;
+	const float v = (float)(packed >> 16) * (2.0f/65535.0f) - 1.0f;
+	float3 N = make_float3(u, v, 1.0f - fabsf(u) - fabsf(v));
+
+	/* unfold lower hemisphere */
+	if(N.z < 0.0f) {
+		N.x = (1.0f - fabsf(v)) * ((u >= 0.0f)? 1.0f: -1.0f);
+		N.y = (1.0f - fabsf(u)) * ((v >= 0.0f)? 1.0f: -1.0f);
+	}
+
+	return normalize(N);
+}
+
+ccl_device_inline float triangle_half_to_float(uint h)
+{
+	/* only zero and normalized numbers are stored, see float_to_half */
+	const uint sign = (h & 0x8000) << 16;
+	const uint bits = h & 0x7FFF;
+	return __uint_as_float(sign | ((bits != 0)? (bits << 13) + 0x38000000: 0));
+}
+
+ccl_device_inline float3 triangle_half2_decode(uint packed)
+{
+	return make_float3(triangle_half_to_float(packed & 0xFFFF),
+	                   triangle_half_to_float(packed >> 16),
+	                   0.0f);
+}
+
+ccl_device_inline float3 triangle_vertex_normal(KernelGlobals *kg, uint vert)
+{
+	if(kernel_data.bvh.use_compact_mesh) {
+		return triangle_normal_decode(kernel_tex_fetch(__tri_vnormal_compact, vert));
+	}
+
+	return float4_to_float3(kernel_tex_fetch(__tri_vnormal, vert));
+}
+
 /* Interpolate smooth vertex normal from vertices */
 
 ccl_device_inline float3 triangle_smooth_normal(KernelGlobals *kg, float3 Ng, int prim, float u, float v)
 {
 	/* load triangle vertices */
 	const uint4 tri_vindex = kernel_tex_fetch(__tri_vindex, prim);
-	float3 n0 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.x));
-	float3 n1 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.y));
-	float3 n2 = float4_to_float3(kernel_tex_fetch(__tri_vnormal, tri_vindex.z));
+	float3 n0 = triangle_vertex_normal(kg, tri_vindex.x);
+	float3 n1 = triangle_vertex_normal(kg, tri_vindex.y);
+	float3 n2 = triangle_vertex_normal(kg, tri_vindex.z);
 
 	float3 N = safe_normalize((1.0f - u - v)*n2 + u*n0 + v*n1);
 
@@ -171,7 +215,10 @@ ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData
 
 		return sd->u*f0 + sd->v*f1 + (1.0f - sd->u - sd->v)*f2;
 	}
-	else if(desc.element == ATTR_ELEMENT_CORNER || desc.element == ATTR_ELEMENT_CORNER_BYTE) {
+	else if(desc.element == ATTR_ELEMENT_CORNER ||
+	        desc.element == ATTR_ELEMENT_CORNER_BYTE ||
+	        desc.element == ATTR_ELEMENT_CORNER_HALF)
+	{
 		int tri = desc.offset + sd->prim*3;
 		float3 f0, f1, f2;
 
@@ -180,6 +227,11 @@ ccl_device float3 triangle_attribute_float3(KernelGlobals *kg, const ShaderData
 			f1 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 1));
 			f2 = float4_to_float3(kernel_tex_fetch(__attributes_float3, tri + 2));
 		}
+		else if(desc.element == ATTR_ELEMENT_CORNER_HALF) {
+			f0 = triangle_half2_decode(kernel_tex_fetch(__attributes_half2, tri + 0));
+			f1 = triangle_half2_decode(kernel_tex_fetch(__attributes_half2, tri + 1));
+			f2 = triangle_half2_decode(kernel_tex_fetch(__attributes_half2, tri + 2));
+		}
 		else {
 			f0 = color_byte_to_float(kernel_tex_fetch(__attributes_uchar4, tri + 0));
 			f1 = color_byte_to_float(kernel_tex_fetch(__attributes_uchar4, tri + 1));
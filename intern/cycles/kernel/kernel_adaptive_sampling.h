@@ -0,0 +1,162 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_ADAPTIVE_SAMPLING_H__
+#define __KERNEL_ADAPTIVE_SAMPLING_H__
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * The auxiliary buffer accumulates only the odd samples of the combined
+ * pass, which gives a second, independent estimate of the pixel with half
+ * the samples. The difference between both estimates is used as the error,
+ * following "A hierarchical automatic stopping condition for Monte Carlo
+ * global illumination" by Dammertz et al. The w component of the auxiliary
+ * buffer is set to 1 once a pixel has converged, after which no more samples
+ * are taken for it. */
+
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg,
+                                                       ccl_global float *buffer)
+{
+	return buffer[kernel_data.film.pass_adaptive_aux_buffer + 3] > 0.0f;
+}
+
+/* Determine if the pixel has converged. Must be called after an even number
+ * of samples, so that both halves got the same amount of samples. */
+ccl_device void kernel_do_adaptive_stopping(KernelGlobals *kg,
+                                            ccl_global float *buffer)
+{
+	ccl_global float *aux = buffer + kernel_data.film.pass_adaptive_aux_buffer;
+	const float num_samples = buffer[kernel_data.film.pass_sample_count];
+
+	if(aux[3] > 0.0f || num_samples == 0.0f) {
+		return;
+	}
+
+	const float inv_num_samples = 1.0f / num_samples;
+	const float3 I = make_float3(buffer[0], buffer[1], buffer[2]) * inv_num_samples;
+	const float3 A = make_float3(aux[0], aux[1], aux[2]) * (2.0f * inv_num_samples);
+
+	const float error_difference = fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z);
+	const float error_normalize = sqrtf(max(I.x + I.y + I.z, 0.0f));
+	const float error = error_difference / (0.0001f + error_normalize);
+
+	if(error < kernel_data.integrator.adaptive_threshold) {
+		aux[3] = 1.0f;
+	}
+}
+
+/* Unconverge the direct neighbors of unconverged pixels in a row, to avoid
+ * stopping on noise that happens to match in both halves. Returns true if
+ * any pixel in the row is not converged. */
+ccl_device bool kernel_do_adaptive_filter_x(KernelGlobals *kg,
+                                            ccl_global float *buffer,
+                                            int y, int start_x, int width,
+                                            int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int pass_aux = kernel_data.film.pass_adaptive_aux_buffer;
+	bool any = false;
+	bool prev = false;
+
+	for(int x = start_x; x < start_x + width; x++) {
+		int index = offset + x + y*stride;
+		ccl_global float *aux = buffer + index*pass_stride + pass_aux;
+
+		if(aux[3] == 0.0f) {
+			any = true;
+			if(x > start_x && !prev) {
+				aux[3 - pass_stride] = 0.0f;
+			}
+			prev = true;
+		}
+		else {
+			if(prev) {
+				aux[3] = 0.0f;
+			}
+			prev = false;
+		}
+	}
+
+	return any;
+}
+
+/* Same as above for a column. */
+ccl_device bool kernel_do_adaptive_filter_y(KernelGlobals *kg,
+                                            ccl_global float *buffer,
+                                            int x, int start_y, int height,
+                                            int offset, int stride)
+{
+	const int pass_stride = kernel_data.film.pass_stride;
+	const int pass_aux = kernel_data.film.pass_adaptive_aux_buffer;
+	bool any = false;
+	bool prev = false;
+
+	for(int y = start_y; y < start_y + height; y++) {
+		int index = offset + x + y*stride;
+		ccl_global float *aux = buffer + index*pass_stride + pass_aux;
+
+		if(aux[3] == 0.0f) {
+			any = true;
+			if(y > start_y && !prev) {
+				aux[3 - stride*pass_stride] = 0.0f;
+			}
+			prev = true;
+		}
+		else {
+			if(prev) {
+				aux[3] = 0.0f;
+			}
+			prev = false;
+		}
+	}
+
+	return any;
+}
+
+/* Scale the passes of a pixel that stopped early, as if it was rendered with
+ * the same number of samples as the rest of the tile. Passes which are only
+ * written for the first sample and the adaptive sampling passes themselves
+ * are left untouched, denoising data is not supported. */
+ccl_device void kernel_adaptive_post_adjust(KernelGlobals *kg,
+                                            ccl_global float *buffer,
+                                            float sample_multiplier)
+{
+	const int flag = kernel_data.film.pass_flag;
+	const int pass_aux = kernel_data.film.pass_adaptive_aux_buffer;
+	const int pass_sample_count = kernel_data.film.pass_sample_count;
+	const int num_floats = (kernel_data.film.pass_denoising_data)?
+	                           kernel_data.film.pass_denoising_data:
+	                           kernel_data.film.pass_stride;
+
+	for(int i = 0; i < num_floats; i++) {
+		if((i >= pass_aux && i < pass_aux + 4) || i == pass_sample_count)
+			continue;
+		if((flag & PASSMASK(DEPTH)) && i == kernel_data.film.pass_depth)
+			continue;
+		if((flag & PASSMASK(OBJECT_ID)) && i == kernel_data.film.pass_object_id)
+			continue;
+		if((flag & PASSMASK(MATERIAL_ID)) && i == kernel_data.film.pass_material_id)
+			continue;
+
+		buffer[i] *= sample_multiplier;
+	}
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __KERNEL_ADAPTIVE_SAMPLING_H__ */
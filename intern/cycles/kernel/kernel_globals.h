@@ -21,6 +21,7 @@
 
 #ifdef __KERNEL_CPU__
 #  include "util/util_vector.h"
+#  include "util/util_texture_cache.h"
 #endif
 
 #ifdef __KERNEL_OPENCL__
@@ -60,6 +61,13 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #  endif
 
+#  ifdef __TEXTURE_CACHE__
+	/* On-demand image texture cache, owned by the device. Lookup statistics
+	 * are gathered per thread. */
+	TextureCache *texture_cache;
+	TextureCacheThreadStats texture_cache_stats;
+#  endif
+
 	/* **** Run-time data ****  */
 
 	/* Heap-allocated storage for transparent shadows intersections. */
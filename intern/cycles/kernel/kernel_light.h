@@ -457,6 +457,197 @@ ccl_device float background_light_pdf(KernelGlobals *kg, float3 P, float3 direct
 }
 #endif
 
+/* Light Tree */
+
+#ifdef __LIGHT_TREE__
+
+/* Estimate of the contribution of all emitters in a light tree node to
+ * shading point P, from their energy, distance and emission directions.
+ * The orientation of the receiving surface is not taken into account, so
+ * the same estimate is available when evaluating MIS for a hit emitter. */
+ccl_device float light_tree_node_importance(KernelGlobals *kg, float3 P, int node)
+{
+	float4 data0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+	float4 data1 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1);
+	float4 data2 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+
+	float3 bbox_min = make_float3(data0.x, data0.y, data0.z);
+	float3 bbox_max = make_float3(data1.x, data1.y, data1.z);
+	float3 axis = make_float3(data2.x, data2.y, data2.z);
+	float energy = data0.w;
+	float theta_o = data1.w;
+	float theta_e = data2.w;
+
+	float3 centroid = 0.5f*(bbox_min + bbox_max);
+	float radius_squared = 0.25f*len_squared(bbox_max - bbox_min);
+	float distance;
+	float3 D = safe_normalize_len(P - centroid, &distance);
+	float distance_squared = distance*distance;
+
+	/* Smallest angle between the emission axis and directions towards P,
+	 * taking into account the spread of normals and the angle subtended by
+	 * the bounding sphere of the node. */
+	float theta = fast_acosf(clamp(dot(axis, D), -1.0f, 1.0f));
+	float theta_u = (distance_squared > radius_squared)?
+	        fast_asinf(sqrtf(radius_squared/distance_squared)):
+	        M_PI_F;
+	float theta_i = max(theta - theta_o - theta_u, 0.0f);
+
+	if(theta_i >= theta_e) {
+		return 0.0f;
+	}
+
+	/* Clamp distance to the bounding sphere, to avoid singularities near
+	 * and inside the node. */
+	return energy*fast_cosf(theta_i)/max(distance_squared, radius_squared);
+}
+
+/* Probability of selecting a node in the light tree for shading point P,
+ * the product of branch probabilities from the root down to the node. */
+ccl_device float light_tree_node_pdf(KernelGlobals *kg, float3 P, int node)
+{
+	float pdf = kernel_data.integrator.light_tree_pdf;
+	int parent = __float_as_int(kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3).y);
+
+	while(parent != -1) {
+		float4 data3 = kernel_tex_fetch(__light_tree_nodes, parent*LIGHT_TREE_NODE_SIZE + 3);
+		int left = parent + 1;
+		int right = __float_as_int(data3.x);
+
+		float left_importance = light_tree_node_importance(kg, P, left);
+		float right_importance = light_tree_node_importance(kg, P, right);
+		float importance = (node == left)? left_importance: right_importance;
+
+		if(importance == 0.0f) {
+			return 0.0f;
+		}
+
+		pdf *= importance/(left_importance + right_importance);
+
+		node = parent;
+		parent = __float_as_int(data3.y);
+	}
+
+	return pdf;
+}
+
+/* Select an emitter for shading point P, either one of the distant and
+ * background lights or an emitter from the tree, traversed by choosing
+ * children proportional to their importance. randu is rescaled for reuse.
+ * Returns the index in the light distribution, or -1 if no emitter in the
+ * tree can contribute. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu)
+{
+	float r = *randu;
+	float tree_pdf = kernel_data.integrator.light_tree_pdf;
+
+	if(r >= tree_pdf) {
+		/* Distant and background lights, selected uniformly. */
+		int num_infinite = kernel_data.integrator.light_tree_num_infinite;
+		int offset = kernel_data.integrator.light_tree_lamp_offset + kernel_data.integrator.num_all_lights;
+
+		r = (r - tree_pdf)/(1.0f - tree_pdf)*num_infinite;
+		int i = min((int)r, num_infinite - 1);
+		*randu = r - i;
+
+		return kernel_tex_fetch(__light_tree_map, offset + i);
+	}
+
+	r /= tree_pdf;
+
+	int node = 0;
+
+	for(;;) {
+		int right = __float_as_int(kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3).x);
+
+		if(right < 0) {
+			*randu = r;
+			return ~right;
+		}
+
+		int left = node + 1;
+		float left_importance = light_tree_node_importance(kg, P, left);
+		float right_importance = light_tree_node_importance(kg, P, right);
+		float total_importance = left_importance + right_importance;
+
+		if(total_importance == 0.0f) {
+			return -1;
+		}
+
+		float left_probability = left_importance/total_importance;
+
+		if(r < left_probability) {
+			r = r/left_probability;
+			node = left;
+		}
+		else {
+			r = (r - left_probability)/(1.0f - left_probability);
+			node = right;
+		}
+	}
+}
+
+ccl_device_inline float light_tree_lamp_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+	int leaf = kernel_tex_fetch(__light_tree_map, kernel_data.integrator.light_tree_lamp_offset + lamp);
+
+	if(leaf == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	return light_tree_node_pdf(kg, P, leaf);
+}
+
+/* Probability per unit area of selecting the triangle, matching the
+ * definition of pdf_triangles. */
+ccl_device_inline float light_tree_triangle_pdf(KernelGlobals *kg, int object, int prim, float3 P)
+{
+	int offset = kernel_tex_fetch(__light_tree_map, object*2 + 0);
+
+	if(offset == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	int prim_offset = kernel_tex_fetch(__light_tree_map, object*2 + 1);
+	int leaf = kernel_tex_fetch(__light_tree_map, offset + prim - prim_offset);
+
+	if(leaf == LIGHT_TREE_NONE) {
+		return 0.0f;
+	}
+
+	float area = kernel_tex_fetch(__light_tree_nodes, leaf*LIGHT_TREE_NODE_SIZE + 3).z;
+
+	return light_tree_node_pdf(kg, P, leaf)/area;
+}
+
+#endif  /* __LIGHT_TREE__ */
+
+/* Probability of selecting the lamp for shading point P. */
+ccl_device_inline float lamp_light_select_pdf(KernelGlobals *kg, int lamp, LightType type, float3 P)
+{
+#ifdef __LIGHT_TREE__
+	/* Distant and background lights are not in the tree, pdf_lights holds
+	 * their probability. */
+	if(kernel_data.integrator.use_light_tree && type != LIGHT_DISTANT && type != LIGHT_BACKGROUND) {
+		return light_tree_lamp_pdf(kg, lamp, P);
+	}
+#endif
+
+	return kernel_data.integrator.pdf_lights;
+}
+
+/* Probability per unit area of selecting the triangle for shading point P. */
+ccl_device_inline float triangle_light_select_pdf(KernelGlobals *kg, int object, int prim, float3 P)
+{
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		return light_tree_triangle_pdf(kg, object, prim, P);
+	}
+#endif
+
+	return kernel_data.integrator.pdf_triangles;
+}
+
 /* Regular Light */
 
 ccl_device float3 disk_light_sample(float3 v, float randu, float randv)
@@ -623,7 +814,7 @@ ccl_device_inline bool lamp_light_sample(KernelGlobals *kg,
 		}
 	}
 
-	ls->pdf *= kernel_data.integrator.pdf_lights;
+	ls->pdf *= lamp_light_select_pdf(kg, lamp, type, P);
 
 	return (ls->pdf > 0.0f);
 }
@@ -760,7 +951,7 @@ ccl_device bool lamp_light_eval(KernelGlobals *kg, int lamp, float3 P, float3 D,
 		return false;
 	}
 
-	ls->pdf *= kernel_data.integrator.pdf_lights;
+	ls->pdf *= lamp_light_select_pdf(kg, lamp, type, P);
 
 	return true;
 }
@@ -797,9 +988,8 @@ ccl_device_inline bool triangle_world_space_vertices(KernelGlobals *kg, int obje
 	return has_motion;
 }
 
-ccl_device_inline float triangle_light_pdf_area(KernelGlobals *kg, const float3 Ng, const float3 I, float t)
+ccl_device_inline float triangle_light_pdf_area(const float3 Ng, const float3 I, float t, float pdf)
 {
-	float pdf = kernel_data.integrator.pdf_triangles;
 	float cos_pi = fabsf(dot(Ng, I));
 
 	if(cos_pi == 0.0f)
@@ -824,10 +1014,12 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
 	const float3 N = cross(e0, e1);
 	const float distance_to_plane = fabsf(dot(N, sd->I * t))/dot(N, N);
 
+	/* sd contains the point on the light source
+	 * calculate Px, the point that we're shading */
+	const float3 Px = sd->P + sd->I * t;
+	const float pdf_area = triangle_light_select_pdf(kg, sd->object, sd->prim, Px);
+
 	if(longest_edge_squared > distance_to_plane*distance_to_plane) {
-		/* sd contains the point on the light source
-		 * calculate Px, the point that we're shading */
-		const float3 Px = sd->P + sd->I * t;
 		const float3 v0_p = V[0] - Px;
 		const float3 v1_p = V[1] - Px;
 		const float3 v2_p = V[2] - Px;
@@ -855,12 +1047,12 @@ ccl_device_forceinline float triangle_light_pdf(KernelGlobals *kg, ShaderData *s
 			else {
 				area = 0.5f * len(N);
 			}
-			const float pdf = area * kernel_data.integrator.pdf_triangles;
+			const float pdf = area * pdf_area;
 			return pdf / solid_angle;
 		}
 	}
 	else {
-		float pdf = triangle_light_pdf_area(kg, sd->Ng, sd->I, t);
+		float pdf = triangle_light_pdf_area(sd->Ng, sd->I, t, pdf_area);
 		if(has_motion) {
 			const float	area = 0.5f * len(N);
 			if(UNLIKELY(area == 0.0f)) {
@@ -910,6 +1102,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg, int prim, i
 	ls->type = LIGHT_TRIANGLE;
 
 	float distance_to_plane = fabsf(dot(N0, V[0] - P)/dot(N0, N0));
+	const float pdf_area = triangle_light_select_pdf(kg, object, prim, P);
 
 	if(longest_edge_squared > distance_to_plane*distance_to_plane) {
 		/* see James Arvo, "Stratified Sampling of Spherical Triangles"
@@ -996,7 +1189,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg, int prim, i
 				triangle_world_space_vertices(kg, object, prim, -1.0f, V);
 				area = triangle_area(V[0], V[1], V[2]);
 			}
-			const float pdf = area * kernel_data.integrator.pdf_triangles;
+			const float pdf = area * pdf_area;
 			ls->pdf = pdf / solid_angle;
 		}
 	}
@@ -1010,7 +1203,7 @@ ccl_device_forceinline void triangle_light_sample(KernelGlobals *kg, int prim, i
 		ls->P = u * V[0] + v * V[1] + t * V[2];
 		/* compute incoming direction, distance and pdf */
 		ls->D = normalize_len(ls->P - P, &ls->t);
-		ls->pdf = triangle_light_pdf_area(kg, ls->Ng, -ls->D, ls->t);
+		ls->pdf = triangle_light_pdf_area(ls->Ng, -ls->D, ls->t, pdf_area);
 		if(has_motion && area != 0.0f) {
 			/* scale the PDF.
 			 * area = the area the sample was taken from
@@ -1079,7 +1272,20 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       LightSample *ls)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, &randu);
+	int index;
+
+#ifdef __LIGHT_TREE__
+	if(kernel_data.integrator.use_light_tree) {
+		index = light_tree_sample(kg, P, &randu);
+		if(index < 0) {
+			return false;
+		}
+	}
+	else
+#endif
+	{
+		index = light_distribution_sample(kg, &randu);
+	}
 
 	/* fetch light data */
 	float4 l = kernel_tex_fetch(__light_distribution, index);
@@ -344,6 +344,19 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg,
 
 	kernel_write_light_passes(kg, buffer, L);
 
+#ifdef __KERNEL_CPU__
+	if(kernel_data.film.pass_adaptive_aux_buffer) {
+		/* Odd samples only, for the adaptive sampling error estimate. */
+		if(sample & 1) {
+			kernel_write_pass_float4(buffer + kernel_data.film.pass_adaptive_aux_buffer,
+			                         make_float4(L_sum.x, L_sum.y, L_sum.z, 0.0f));
+		}
+	}
+	if(kernel_data.film.pass_sample_count) {
+		kernel_write_pass_float(buffer + kernel_data.film.pass_sample_count, 1.0f);
+	}
+#endif  /* __KERNEL_CPU__ */
+
 #ifdef __DENOISING_FEATURES__
 	if(kernel_data.film.pass_denoising_data) {
 #  ifdef __SHADOW_TRICKS__
@@ -31,6 +31,7 @@
 #include "kernel/kernel_shader.h"
 #include "kernel/kernel_light.h"
 #include "kernel/kernel_passes.h"
+#include "kernel/kernel_adaptive_sampling.h"
 
 #ifdef __SUBSURFACE__
 #  include "kernel/kernel_subsurface.h"
@@ -690,6 +691,14 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 
 	buffer += index*pass_stride;
 
+#ifdef __KERNEL_CPU__
+	if(kernel_data.film.pass_adaptive_aux_buffer &&
+	   kernel_adaptive_pixel_converged(kg, buffer))
+	{
+		return;
+	}
+#endif
+
 	/* Initialize random numbers and sample ray. */
 	uint rng_hash;
 	Ray ray;
@@ -582,6 +582,14 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 
 	buffer += index*pass_stride;
 
+#ifdef __KERNEL_CPU__
+	if(kernel_data.film.pass_adaptive_aux_buffer &&
+	   kernel_adaptive_pixel_converged(kg, buffer))
+	{
+		return;
+	}
+#endif
+
 	/* initialize random numbers and ray */
 	uint rng_hash;
 	Ray ray;
@@ -468,6 +468,21 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
 	}
 }
 
+#ifdef __TEXTURE_CACHE__
+/* Lookup through the texture cache, the filter width is used to select mip
+ * levels. Images which are fully loaded into memory use regular lookups. */
+ccl_device float4 kernel_tex_image_interp_filtered(KernelGlobals *kg, int id, float x, float y, float width)
+{
+	float4 r;
+	if(kg->texture_cache != NULL &&
+	   kg->texture_cache->lookup(&kg->texture_cache_stats, id, x, y, width, &r))
+	{
+		return r;
+	}
+	return kernel_tex_image_interp(kg, id, x, y);
+}
+#endif
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg, int id, float x, float y, float z, InterpolationType interp)
 {
 	const TextureInfo& info = kernel_tex_fetch(__texture_info, id);
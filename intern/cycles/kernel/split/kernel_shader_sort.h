@@ -16,6 +16,55 @@
 
 CCL_NAMESPACE_BEGIN
 
+#ifdef __KERNEL_CPU__
+/* Stable merge sort of the first num indices of a block by shader. The CPU
+ * runs a single work item per group, so the whole block is sorted by one
+ * thread instead of the bitonic sort used on OpenCL. Keeping the order of
+ * rays with the same shader keeps neighboring pixels together. */
+ccl_device void kernel_shader_sort_block(const uint *value,
+                                         ushort *index,
+                                         ushort *tmp,
+                                         int num)
+{
+	/* Blocks are often sorted already when only few shaders are visible. */
+	int i = 1;
+	while(i < num && value[index[i - 1]] <= value[index[i]]) {
+		i++;
+	}
+	if(i >= num) {
+		return;
+	}
+
+	ushort *in = index;
+	ushort *out = tmp;
+
+	for(int width = 1; width < num; width <<= 1) {
+		for(int start = 0; start < num; start += 2*width) {
+			int a = start, b = min(start + width, num);
+			const int mid = b, end = min(start + 2*width, num);
+			int o = start;
+
+			while(a < mid && b < end) {
+				out[o++] = (value[in[b]] < value[in[a]])? in[b++]: in[a++];
+			}
+			while(a < mid) {
+				out[o++] = in[a++];
+			}
+			while(b < end) {
+				out[o++] = in[b++];
+			}
+		}
+
+		ushort *swap = in;
+		in = out;
+		out = swap;
+	}
+
+	if(in != index) {
+		memcpy(index, in, sizeof(ushort)*num);
+	}
+}
+#endif  /* __KERNEL_CPU__ */
 
 ccl_device void kernel_shader_sort(KernelGlobals *kg,
                                    ccl_local_param ShaderSortLocals *locals)
@@ -55,7 +104,6 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg,
 	}
 	ccl_barrier(CCL_LOCAL_MEM_FENCE);
 
-	/* skip sorting for cpu split kernel */
 #  ifdef __KERNEL_OPENCL__
 
 	/* bitonic sort */
@@ -78,6 +126,11 @@ ccl_device void kernel_shader_sort(KernelGlobals *kg,
 			}
 		}
 	}
+#  elif defined(__KERNEL_CPU__)
+	kernel_shader_sort_block(local_value,
+	                         local_index,
+	                         &locals->local_index_tmp[0],
+	                         min((int)(qsize - offset), SHADER_SORT_BLOCK_SIZE));
 #  endif /* __KERNEL_OPENCL__ */
 
 	/* copy to destination */
@@ -16,9 +16,13 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, float filter_width, uint srgb, uint use_alpha)
 {
+#ifdef __TEXTURE_CACHE__
+	float4 r = kernel_tex_image_interp_filtered(kg, id, x, y, filter_width);
+#else
 	float4 r = kernel_tex_image_interp(kg, id, x, y);
+#endif
 	const float alpha = r.w;
 
 	if(use_alpha && alpha != 1.0f && alpha != 0.0f) {
@@ -39,6 +43,68 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 	return r;
 }
 
+/* Filter width of image lookups in normalized texture coordinates, used by
+ * the texture cache to select mip levels. Texture coordinates themselves
+ * have no differentials in SVM, so these are estimates. */
+
+ccl_device_inline bool svm_image_use_filter_width(KernelGlobals *kg, int id)
+{
+#if defined(__TEXTURE_CACHE__) && defined(__RAY_DIFFERENTIALS__)
+	return (kg->texture_cache != NULL && kg->texture_cache->has_image(id));
+#else
+	return false;
+#endif
+}
+
+ccl_device float svm_image_texture_filter_width(KernelGlobals *kg, ShaderData *sd, int id)
+{
+#if defined(__TEXTURE_CACHE__) && defined(__RAY_DIFFERENTIALS__)
+	if(!svm_image_use_filter_width(kg, id)) {
+		return 0.0f;
+	}
+
+	/* Use differentials of the default UV map, which is what image textures
+	 * are mapped with when the vector socket is not connected. */
+	const AttributeDescriptor desc = find_attribute(kg, sd, ATTR_STD_UV);
+	if(desc.offset != ATTR_STD_NOT_FOUND) {
+		float3 dx, dy;
+		primitive_attribute_float3(kg, sd, desc, &dx, &dy);
+		return max(len(make_float2(dx.x, dx.y)), len(make_float2(dy.x, dy.y)));
+	}
+#endif
+	return 0.0f;
+}
+
+ccl_device float svm_image_box_filter_width(KernelGlobals *kg, ShaderData *sd, int id)
+{
+#if defined(__TEXTURE_CACHE__) && defined(__RAY_DIFFERENTIALS__)
+	if(!svm_image_use_filter_width(kg, id)) {
+		return 0.0f;
+	}
+
+	/* Box mapping is mostly used with object space coordinates, so use the
+	 * size of the footprint on the surface. */
+	return max(len(sd->dP.dx), len(sd->dP.dy));
+#else
+	return 0.0f;
+#endif
+}
+
+ccl_device float svm_image_environment_filter_width(KernelGlobals *kg, ShaderData *sd, int id)
+{
+#if defined(__TEXTURE_CACHE__) && defined(__RAY_DIFFERENTIALS__)
+	if(!svm_image_use_filter_width(kg, id)) {
+		return 0.0f;
+	}
+
+	/* For background shading dP holds the differential of the direction,
+	 * convert the angle to the 2*pi range covered by the image width. */
+	return max(len(sd->dP.dx), len(sd->dP.dy)) * (0.5f * M_1_PI_F);
+#else
+	return 0.0f;
+#endif
+}
+
 /* Remap coordnate from 0..1 box to -1..-1 */
 ccl_device_inline float3 texco_remap_square(float3 co)
 {
@@ -66,7 +132,8 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 	else {
 		tex_co = make_float2(co.x, co.y);
 	}
-	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, srgb, use_alpha);
+	float filter_width = svm_image_texture_filter_width(kg, sd, id);
+	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, filter_width, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -153,19 +220,20 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
 
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
+	float filter_width = svm_image_box_filter_width(kg, sd, id);
 
 	/* Map so that no textures are flipped, rotation is somewhat arbitrary. */
 	if(weight.x > 0.0f) {
 		float2 uv = make_float2((signed_N.x < 0.0f)? 1.0f - co.y: co.y, co.z);
-		f += weight.x*svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+		f += weight.x*svm_image_texture(kg, id, uv.x, uv.y, filter_width, srgb, use_alpha);
 	}
 	if(weight.y > 0.0f) {
 		float2 uv = make_float2((signed_N.y > 0.0f)? 1.0f - co.x: co.x, co.z);
-		f += weight.y*svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+		f += weight.y*svm_image_texture(kg, id, uv.x, uv.y, filter_width, srgb, use_alpha);
 	}
 	if(weight.z > 0.0f) {
 		float2 uv = make_float2((signed_N.z > 0.0f)? 1.0f - co.y: co.y, co.x);
-		f += weight.z*svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+		f += weight.z*svm_image_texture(kg, id, uv.x, uv.y, filter_width, srgb, use_alpha);
 	}
 
 	if(stack_valid(out_offset))
@@ -193,7 +261,8 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, floa
 		uv = direction_to_mirrorball(co);
 
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	float filter_width = svm_image_environment_filter_width(kg, sd, id);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, filter_width, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
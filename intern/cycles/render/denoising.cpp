@@ -0,0 +1,652 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/denoising.h"
+
+#include "render/buffers.h"
+
+#include "device/device_task.h"
+
+#include "util/util_foreach.h"
+#include "util/util_function.h"
+#include "util/util_image.h"
+#include "util/util_list.h"
+#include "util/util_logging.h"
+#include "util/util_map.h"
+#include "util/util_task.h"
+#include "util/util_thread.h"
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Denoise Image
+ *
+ * A multilayer EXR file, with the render buffers reconstructed from the
+ * stored passes of every render layer that has denoising data. */
+
+static const char *denoising_pass_names[] = {
+	"Normal", "Normal Variance",
+	"Albedo", "Albedo Variance",
+	"Depth", "Depth Variance",
+	"Shadow A", "Shadow B",
+	"Image", "Image Variance",
+};
+
+static const int denoising_pass_offsets[] = {
+	DENOISING_PASS_NORMAL, DENOISING_PASS_NORMAL_VAR,
+	DENOISING_PASS_ALBEDO, DENOISING_PASS_ALBEDO_VAR,
+	DENOISING_PASS_DEPTH, DENOISING_PASS_DEPTH_VAR,
+	DENOISING_PASS_SHADOW_A, DENOISING_PASS_SHADOW_B,
+	DENOISING_PASS_COLOR, DENOISING_PASS_COLOR_VAR,
+};
+
+static const int denoising_pass_components[] = {
+	3, 3,
+	3, 3,
+	1, 1,
+	3, 3,
+	3, 3,
+};
+
+#define NUM_DENOISING_PASSES (sizeof(denoising_pass_offsets)/sizeof(int))
+
+struct DenoiseImageLayer {
+	string name;
+	/* File channel of every float of the denoising data, -1 if missing. */
+	int channels[DENOISING_PASS_SIZE_BASE];
+	/* File channels of the combined pass RGB. */
+	int combined[3];
+
+	RenderBuffers *buffers;
+};
+
+class DenoiseImage {
+public:
+	DenoiseImage();
+	~DenoiseImage();
+
+	bool load(const string& filepath, int samples_override, string& error);
+	bool save(const string& filepath, string& error);
+
+	void free_buffers();
+	bool alloc_buffers(Device *device);
+
+	/* Replace the combined pass of the layer with the denoised result. */
+	void write_result(DenoiseImageLayer& layer);
+
+	DenoiseImageLayer *find_layer(const string& name, int width, int height);
+
+	int width, height, num_channels;
+	int samples;
+	ImageSpec spec;
+	vector<float> pixels;
+	vector<DenoiseImageLayer> layers;
+};
+
+DenoiseImage::DenoiseImage()
+: width(0), height(0), num_channels(0), samples(0)
+{
+}
+
+DenoiseImage::~DenoiseImage()
+{
+	free_buffers();
+}
+
+/* Split a channel name of a multilayer EXR into layer, pass and channel. */
+static bool split_channel_name(const string& name, string& layer, string& pass, string& channel)
+{
+	size_t channel_split = name.rfind('.');
+	if(channel_split == string::npos || channel_split == 0) {
+		return false;
+	}
+	size_t pass_split = name.rfind('.', channel_split - 1);
+	if(pass_split == string::npos) {
+		return false;
+	}
+
+	layer = name.substr(0, pass_split);
+	pass = name.substr(pass_split + 1, channel_split - pass_split - 1);
+	channel = name.substr(channel_split + 1);
+	return true;
+}
+
+bool DenoiseImage::load(const string& filepath, int samples_override, string& error)
+{
+	ImageInput *in = ImageInput::create(filepath);
+	if(!in) {
+		error = "Couldn't find file: " + filepath;
+		return false;
+	}
+
+	if(!in->open(filepath, spec)) {
+		error = "Couldn't open file: " + filepath;
+		delete in;
+		return false;
+	}
+
+	width = spec.width;
+	height = spec.height;
+	num_channels = spec.nchannels;
+
+	samples = samples_override;
+	if(samples == 0) {
+		samples = atoi(spec.get_string_attribute("Cycles Samples").c_str());
+	}
+	if(samples < 1) {
+		error = "Unknown number of samples for file " + filepath + ", specify it explicitly";
+		in->close();
+		delete in;
+		return false;
+	}
+
+	/* Find layers with all denoising passes. */
+	map<string, DenoiseImageLayer> found_layers;
+	for(int i = 0; i < num_channels; i++) {
+		string layer_name, pass, channel;
+		if(!split_channel_name(spec.channelnames[i], layer_name, pass, channel)) {
+			continue;
+		}
+
+		if(found_layers.find(layer_name) == found_layers.end()) {
+			DenoiseImageLayer& layer = found_layers[layer_name];
+			layer.name = layer_name;
+			layer.buffers = NULL;
+			for(int j = 0; j < DENOISING_PASS_SIZE_BASE; j++) {
+				layer.channels[j] = -1;
+			}
+			layer.combined[0] = layer.combined[1] = layer.combined[2] = -1;
+		}
+		DenoiseImageLayer& layer = found_layers[layer_name];
+
+		if(pass == "Combined") {
+			const char *combined_channels = "RGB";
+			for(int j = 0; j < 3; j++) {
+				if(channel.size() == 1 && channel[0] == combined_channels[j]) {
+					layer.combined[j] = i;
+				}
+			}
+			continue;
+		}
+		if(!string_startswith(pass, "Denoising ")) {
+			continue;
+		}
+		pass = pass.substr(10);
+
+		for(size_t j = 0; j < NUM_DENOISING_PASSES; j++) {
+			if(pass != denoising_pass_names[j]) {
+				continue;
+			}
+
+			/* Channels are named XYZ, RGB, XYV or Z, all in order. */
+			const char *names = (denoising_pass_components[j] == 1)? "Z":
+			                    (channel == "R" || channel == "G" || channel == "B")? "RGB":
+			                    (channel == "V")? "XYV": "XYZ";
+			for(int k = 0; k < denoising_pass_components[j]; k++) {
+				if(channel.size() == 1 && channel[0] == names[k]) {
+					layer.channels[denoising_pass_offsets[j] + k] = i;
+				}
+			}
+		}
+	}
+
+	for(map<string, DenoiseImageLayer>::iterator it = found_layers.begin(); it != found_layers.end(); it++) {
+		DenoiseImageLayer& layer = it->second;
+		bool complete = (layer.combined[0] != -1 && layer.combined[1] != -1 && layer.combined[2] != -1);
+		for(int j = 0; j < DENOISING_PASS_SIZE_BASE; j++) {
+			complete = complete && (layer.channels[j] != -1);
+		}
+
+		if(complete) {
+			layers.push_back(layer);
+		}
+		else {
+			VLOG(1) << "Skipping layer " << layer.name << " of " << filepath
+			        << ", it has no denoising data.";
+		}
+	}
+
+	if(layers.empty()) {
+		error = "No layers with denoising data in file " + filepath;
+		in->close();
+		delete in;
+		return false;
+	}
+
+	pixels.resize((size_t)width * height * num_channels);
+	bool ok = in->read_image(TypeDesc::FLOAT, &pixels[0]);
+
+	in->close();
+	delete in;
+
+	if(!ok) {
+		error = "Failed to read pixels of file " + filepath;
+		return false;
+	}
+
+	return true;
+}
+
+bool DenoiseImage::save(const string& filepath, string& error)
+{
+	/* The input file was read completely and closed on load, so the output
+	 * can safely overwrite it. */
+	ImageOutput *out = ImageOutput::create(filepath);
+	if(!out) {
+		error = "Failed to create image output for file " + filepath;
+		return false;
+	}
+
+	bool ok = out->open(filepath, spec) &&
+	          out->write_image(TypeDesc::FLOAT, &pixels[0]);
+	out->close();
+	delete out;
+
+	if(!ok) {
+		error = "Failed to write file " + filepath;
+		return false;
+	}
+
+	return true;
+}
+
+void DenoiseImage::free_buffers()
+{
+	foreach(DenoiseImageLayer& layer, layers) {
+		delete layer.buffers;
+		layer.buffers = NULL;
+	}
+}
+
+/* Reconstruct the render buffers from the passes, undoing the normalization
+ * done when they were written, see RenderBuffers::get_denoising_pass_rect. */
+bool DenoiseImage::alloc_buffers(Device *device)
+{
+	BufferParams params;
+	params.width = params.full_width = width;
+	params.height = params.full_height = height;
+	params.denoising_data_pass = true;
+
+	const int pass_stride = params.get_passes_size();
+	const int denoising_offset = params.get_denoising_offset();
+	const size_t num_pixels = (size_t)width * height;
+	const float s = (float)samples;
+
+	foreach(DenoiseImageLayer& layer, layers) {
+		if(!layer.buffers) {
+			layer.buffers = new RenderBuffers(device);
+			layer.buffers->reset(params);
+		}
+
+		float *buffer = layer.buffers->buffer.data();
+
+		for(size_t i = 0; i < num_pixels; i++, buffer += pass_stride) {
+			const float *in = &pixels[i * num_channels];
+			float *data = buffer + denoising_offset;
+
+			for(int j = 0; j < DENOISING_PASS_SIZE_BASE; j++) {
+				data[j] = in[layer.channels[j]] * s;
+			}
+
+			/* Variance passes store E[x^2] - 1/N * (E[x])^2. */
+			const int variance_offsets[] = {DENOISING_PASS_NORMAL_VAR,
+			                                DENOISING_PASS_ALBEDO_VAR,
+			                                DENOISING_PASS_DEPTH_VAR,
+			                                DENOISING_PASS_COLOR_VAR};
+			const int variance_components[] = {3, 3, 1, 3};
+			for(int j = 0; j < 4; j++) {
+				const int var = variance_offsets[j];
+				const int mean = var - variance_components[j];
+				for(int k = 0; k < variance_components[j]; k++) {
+					data[var + k] += data[mean + k] * data[mean + k] / s;
+				}
+			}
+
+			/* Unfiltered color, kept where the denoiser can't compute a result. */
+			buffer[0] = data[DENOISING_PASS_COLOR + 0];
+			buffer[1] = data[DENOISING_PASS_COLOR + 1];
+			buffer[2] = data[DENOISING_PASS_COLOR + 2];
+			buffer[3] = s;
+		}
+
+		layer.buffers->buffer.copy_to_device();
+	}
+
+	return true;
+}
+
+void DenoiseImage::write_result(DenoiseImageLayer& layer)
+{
+	layer.buffers->copy_from_device();
+
+	const int pass_stride = layer.buffers->params.get_passes_size();
+	const int denoising_offset = layer.buffers->params.get_denoising_offset();
+	const size_t num_pixels = (size_t)width * height;
+	const float inv_samples = 1.0f / samples;
+
+	const float *buffer = layer.buffers->buffer.data();
+	for(size_t i = 0; i < num_pixels; i++, buffer += pass_stride) {
+		float *out = &pixels[i * num_channels];
+		const float *noisy = buffer + denoising_offset + DENOISING_PASS_COLOR;
+
+		/* The combined pass may contain more than the denoised image, for
+		 * example light paths that were excluded from denoising, so only
+		 * replace the noisy part. */
+		for(int j = 0; j < 3; j++) {
+			out[layer.combined[j]] += (buffer[j] - noisy[j]) * inv_samples;
+		}
+	}
+}
+
+DenoiseImageLayer *DenoiseImage::find_layer(const string& name, int width_, int height_)
+{
+	if(width != width_ || height != height_) {
+		return NULL;
+	}
+
+	foreach(DenoiseImageLayer& layer, layers) {
+		if(layer.name == name) {
+			return &layer;
+		}
+	}
+
+	return NULL;
+}
+
+/* Denoise Task
+ *
+ * Denoises one layer of a frame on the device, distributing the tiles over
+ * the device threads like a render session does. */
+
+class DenoiseTask {
+public:
+	DenoiseTask(Denoiser *denoiser,
+	            RenderBuffers *buffers,
+	            const vector<RenderBuffers*>& neighbor_frames,
+	            int samples);
+
+	void run();
+
+protected:
+	bool acquire_tile(Device *device, RenderTile& tile);
+	void map_neighbor_tiles(RenderTile *tiles, Device *tile_device);
+	void unmap_neighbor_tiles(RenderTile *tiles, Device *tile_device);
+	void release_tile(RenderTile& tile);
+	void get_neighbor_frames(RenderTile& tile, vector<device_ptr>& frames);
+	bool get_cancel();
+
+	Denoiser *denoiser;
+	RenderBuffers *buffers;
+	vector<RenderBuffers*> neighbor_frames;
+	int samples;
+
+	thread_mutex tiles_mutex;
+	list<int4> tiles;
+	int num_tiles, num_done;
+};
+
+DenoiseTask::DenoiseTask(Denoiser *denoiser,
+                         RenderBuffers *buffers,
+                         const vector<RenderBuffers*>& neighbor_frames,
+                         int samples)
+: denoiser(denoiser),
+  buffers(buffers),
+  neighbor_frames(neighbor_frames),
+  samples(samples),
+  num_tiles(0),
+  num_done(0)
+{
+}
+
+void DenoiseTask::run()
+{
+	const BufferParams& params = buffers->params;
+	const int2 tile_size = denoiser->tile_size;
+
+	for(int y = 0; y < params.height; y += tile_size.y) {
+		for(int x = 0; x < params.width; x += tile_size.x) {
+			tiles.push_back(make_int4(x, y,
+			                          min(tile_size.x, params.width - x),
+			                          min(tile_size.y, params.height - y)));
+		}
+	}
+	num_tiles = tiles.size();
+
+	DeviceTask task(DeviceTask::RENDER);
+	task.acquire_tile = function_bind(&DenoiseTask::acquire_tile, this, _1, _2);
+	task.release_tile = function_bind(&DenoiseTask::release_tile, this, _1);
+	task.map_neighbor_tiles = function_bind(&DenoiseTask::map_neighbor_tiles, this, _1, _2);
+	task.unmap_neighbor_tiles = function_bind(&DenoiseTask::unmap_neighbor_tiles, this, _1, _2);
+	task.get_neighbor_frames = function_bind(&DenoiseTask::get_neighbor_frames, this, _1, _2);
+	task.get_cancel = function_bind(&DenoiseTask::get_cancel, this);
+	task.need_finish_queue = false;
+	task.integrator_branched = false;
+
+	task.denoising_radius = denoiser->radius;
+	task.denoising_strength = denoiser->strength;
+	task.denoising_feature_strength = denoiser->feature_strength;
+	task.denoising_relative_pca = denoiser->relative_pca;
+	task.pass_stride = buffers->params.get_passes_size();
+	task.pass_denoising_data = buffers->params.get_denoising_offset();
+	task.pass_denoising_clean = 0;
+
+	denoiser->device->task_add(task);
+	denoiser->device->task_wait();
+}
+
+bool DenoiseTask::acquire_tile(Device * /*device*/, RenderTile& rtile)
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+
+	if(tiles.empty()) {
+		return false;
+	}
+
+	int4 rect = tiles.front();
+	tiles.pop_front();
+
+	rtile.task = RenderTile::DENOISE;
+	rtile.x = rect.x;
+	rtile.y = rect.y;
+	rtile.w = rect.z;
+	rtile.h = rect.w;
+	rtile.start_sample = 0;
+	rtile.num_samples = samples;
+	rtile.sample = samples;
+	rtile.resolution = 1;
+	rtile.tile_index = 0;
+	rtile.buffer = buffers->buffer.device_pointer;
+	rtile.buffers = buffers;
+	buffers->params.get_offset_stride(rtile.offset, rtile.stride);
+
+	return true;
+}
+
+/* The whole frame is in one buffer, so all neighbors point to it and only
+ * their extents are needed to clip the filter area to the image. */
+void DenoiseTask::map_neighbor_tiles(RenderTile *tiles, Device * /*tile_device*/)
+{
+	const int width = buffers->params.width;
+	const int height = buffers->params.height;
+	const RenderTile center = tiles[4];
+
+	const int xs[4] = {0, center.x, center.x + center.w, width};
+	const int ys[4] = {0, center.y, center.y + center.h, height};
+
+	for(int dy = 0, i = 0; dy < 3; dy++) {
+		for(int dx = 0; dx < 3; dx++, i++) {
+			if(i == 4) {
+				continue;
+			}
+			tiles[i] = center;
+			tiles[i].x = xs[dx];
+			tiles[i].y = ys[dy];
+			tiles[i].w = xs[dx+1] - xs[dx];
+			tiles[i].h = ys[dy+1] - ys[dy];
+		}
+	}
+}
+
+void DenoiseTask::unmap_neighbor_tiles(RenderTile * /*tiles*/, Device * /*tile_device*/)
+{
+}
+
+void DenoiseTask::release_tile(RenderTile& /*tile*/)
+{
+	thread_scoped_lock tiles_lock(tiles_mutex);
+	num_done++;
+	VLOG(2) << "Denoised " << num_done << " of " << num_tiles << " tiles.";
+}
+
+void DenoiseTask::get_neighbor_frames(RenderTile& /*tile*/, vector<device_ptr>& frames)
+{
+	foreach(RenderBuffers *frame_buffers, neighbor_frames) {
+		frames.push_back(frame_buffers->buffer.device_pointer);
+	}
+}
+
+bool DenoiseTask::get_cancel()
+{
+	return false;
+}
+
+/* Denoiser */
+
+Denoiser::Denoiser(DeviceInfo& device_info)
+{
+	samples_override = 0;
+	tile_size = make_int2(64, 64);
+
+	radius = 8;
+	strength = 0.5f;
+	feature_strength = 0.5f;
+	relative_pca = false;
+	frame_radius = 0;
+
+	TaskScheduler::init();
+	device = Device::create(device_info, stats, true);
+
+	DeviceRequestedFeatures req;
+	req.use_denoising = true;
+	device->load_kernels(req);
+}
+
+Denoiser::~Denoiser()
+{
+	delete device;
+	TaskScheduler::exit();
+}
+
+bool Denoiser::run()
+{
+	assert(input.size() == output.size());
+
+	if(frame_radius > 0 && device->info.type != DEVICE_CPU) {
+		VLOG(1) << "Temporal denoising is only supported on the CPU, using single frames.";
+		frame_radius = 0;
+	}
+
+	const int num_frames = input.size();
+	map<int, DenoiseImage*> images;
+
+	for(int frame = 0; frame < num_frames; frame++) {
+		if(output[frame].empty()) {
+			continue;
+		}
+
+		double start_time = time_dt();
+
+		/* Free frames outside of the temporal window, load the new ones. */
+		const int first = max(frame - frame_radius, 0);
+		const int last = min(frame + frame_radius, num_frames - 1);
+
+		for(map<int, DenoiseImage*>::iterator it = images.begin(); it != images.end();) {
+			if(it->first < first || it->first > last) {
+				delete it->second;
+				images.erase(it++);
+			}
+			else {
+				++it;
+			}
+		}
+
+		for(int i = first; i <= last; i++) {
+			if(images.find(i) != images.end()) {
+				continue;
+			}
+
+			DenoiseImage *image = new DenoiseImage();
+			if(!image->load(input[i], samples_override, error) ||
+			   !image->alloc_buffers(device))
+			{
+				delete image;
+				if(i == frame) {
+					break;
+				}
+				/* Neighboring frames are optional. */
+				VLOG(1) << error;
+				error = "";
+				continue;
+			}
+			images[i] = image;
+		}
+
+		if(images.find(frame) == images.end()) {
+			break;
+		}
+
+		DenoiseImage *image = images[frame];
+
+		foreach(DenoiseImageLayer& layer, image->layers) {
+			vector<RenderBuffers*> neighbor_frames;
+			for(map<int, DenoiseImage*>::iterator it = images.begin(); it != images.end(); it++) {
+				if(it->first == frame) {
+					continue;
+				}
+				DenoiseImageLayer *neighbor = it->second->find_layer(layer.name,
+				                                                     image->width,
+				                                                     image->height);
+				if(neighbor) {
+					neighbor_frames.push_back(neighbor->buffers);
+				}
+			}
+
+			DenoiseTask task(this, layer.buffers, neighbor_frames, image->samples);
+			task.run();
+
+			image->write_result(layer);
+		}
+
+		if(!image->save(output[frame], error)) {
+			break;
+		}
+
+		/* The combined pass was modified, reload the frame when it is needed
+		 * again as a neighbor. */
+		delete image;
+		images.erase(frame);
+
+		VLOG(1) << "Denoised " << input[frame] << " in " << time_dt() - start_time << "s.";
+	}
+
+	for(map<int, DenoiseImage*>::iterator it = images.begin(); it != images.end(); it++) {
+		delete it->second;
+	}
+
+	return error.empty();
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DENOISING_H__
+#define __DENOISING_H__
+
+#include "device/device.h"
+
+#include "util/util_stats.h"
+#include "util/util_string.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Denoiser
+ *
+ * Denoises multilayer EXR files that were rendered with the denoising data
+ * passes stored, outside of a render session. Files are processed in order as
+ * a sequence of frames, so that neighboring frames can be used for temporal
+ * denoising. Only the CPU device supports temporal denoising. */
+
+class Denoiser {
+public:
+	explicit Denoiser(DeviceInfo& device_info);
+	~Denoiser();
+
+	bool run();
+
+	/* Error message after running, in case of failure. */
+	string error;
+
+	/* Sequential list of frame filepaths to denoise. */
+	vector<string> input;
+	/* Sequential list of frame filepaths to write the result to. Empty
+	 * entries are skipped, so that only part of a sequence is written while
+	 * the other frames are still used for temporal denoising. */
+	vector<string> output;
+
+	/* Number of samples the frames were rendered with. Taken from the
+	 * "Cycles Samples" metadata of the files when zero. */
+	int samples_override;
+	/* Size of the tiles the frames are denoised in, distributed over the
+	 * device threads. */
+	int2 tile_size;
+
+	/* Equivalent to the SessionParams of the same name. */
+	int radius;
+	float strength;
+	float feature_strength;
+	bool relative_pca;
+
+	/* Number of frames before and after the current one to use for temporal
+	 * denoising, zero to only use the current frame. */
+	int frame_radius;
+
+protected:
+	friend class DenoiseTask;
+
+	Stats stats;
+	Device *device;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __DENOISING_H__ */
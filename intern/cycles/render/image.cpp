@@ -23,6 +23,7 @@
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_texture.h"
+#include "util/util_texture_cache.h"
 
 #ifdef WITH_OSL
 #include <OSL/oslexec.h>
@@ -30,6 +31,10 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* Height of the strips scanline images are split into by the texture cache,
+ * tiled images use the tile size of the file. */
+#define IMAGE_CACHE_STRIP_HEIGHT 32
+
 /* Some helpers to silence warning in templated function. */
 static bool isfinite(uchar /*value*/)
 {
@@ -343,6 +348,9 @@ int ImageManager::add_image(const string& filename,
 	img->users = 1;
 	img->use_alpha = use_alpha;
 	img->mem = NULL;
+	img->cache_input = NULL;
+	img->cache_cmyk = false;
+	img->cache_levels = 0;
 
 	images[type][slot] = img;
 
@@ -421,6 +429,93 @@ void ImageManager::tag_reload_image(const string& filename,
 	}
 }
 
+/* Expand pixels with the given number of components to RGBA for 4 channel
+ * slots, and make sure we don't pass buggy values to the kernel. Pixels must
+ * have storage for 4 components per pixel in the RGBA case. */
+template<TypeDesc::BASETYPE FileFormat, typename StorageType>
+static void image_convert_pixels(StorageType *pixels,
+                                 const size_t num_pixels,
+                                 const int components,
+                                 const bool is_rgba,
+                                 const bool cmyk,
+                                 const bool use_alpha)
+{
+	const StorageType alpha_one = (FileFormat == TypeDesc::UINT8)? 255 : 1;
+	if(is_rgba) {
+		if(cmyk) {
+			/* CMYK */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+2] = (pixels[i*4+2]*pixels[i*4+3])/255;
+				pixels[i*4+1] = (pixels[i*4+1]*pixels[i*4+3])/255;
+				pixels[i*4+0] = (pixels[i*4+0]*pixels[i*4+3])/255;
+				pixels[i*4+3] = alpha_one;
+			}
+		}
+		else if(components == 2) {
+			/* grayscale + alpha */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = pixels[i*2+1];
+				pixels[i*4+2] = pixels[i*2+0];
+				pixels[i*4+1] = pixels[i*2+0];
+				pixels[i*4+0] = pixels[i*2+0];
+			}
+		}
+		else if(components == 3) {
+			/* RGB */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = alpha_one;
+				pixels[i*4+2] = pixels[i*3+2];
+				pixels[i*4+1] = pixels[i*3+1];
+				pixels[i*4+0] = pixels[i*3+0];
+			}
+		}
+		else if(components == 1) {
+			/* grayscale */
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = alpha_one;
+				pixels[i*4+2] = pixels[i];
+				pixels[i*4+1] = pixels[i];
+				pixels[i*4+0] = pixels[i];
+			}
+		}
+		if(use_alpha == false) {
+			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
+				pixels[i*4+3] = alpha_one;
+			}
+		}
+	}
+	/* Make sure we don't have buggy values. */
+	if(FileFormat == TypeDesc::FLOAT) {
+		/* For RGBA buffers we put all channels to 0 if either of them is not
+		 * finite. This way we avoid possible artifacts caused by fully changed
+		 * hue.
+		 */
+		if(is_rgba) {
+			for(size_t i = 0; i < num_pixels; i += 4) {
+				StorageType *pixel = &pixels[i*4];
+				if(!isfinite(pixel[0]) ||
+				   !isfinite(pixel[1]) ||
+				   !isfinite(pixel[2]) ||
+				   !isfinite(pixel[3]))
+				{
+					pixel[0] = 0;
+					pixel[1] = 0;
+					pixel[2] = 0;
+					pixel[3] = 0;
+				}
+			}
+		}
+		else {
+			for(size_t i = 0; i < num_pixels; ++i) {
+				StorageType *pixel = &pixels[i];
+				if(!isfinite(pixel[0])) {
+					pixel[0] = 0;
+				}
+			}
+		}
+	}
+}
+
 bool ImageManager::file_load_image_generic(Image *img,
                                            ImageInput **in,
                                            int &width,
@@ -491,7 +586,6 @@ bool ImageManager::file_load_image(Image *img,
                                    int texture_limit,
                                    device_vector<DeviceType>& tex_img)
 {
-	const StorageType alpha_one = (FileFormat == TypeDesc::UINT8)? 255 : 1;
 	ImageInput *in = NULL;
 	int width, height, depth, components;
 	if(!file_load_image_generic(img, &in, width, height, depth, components)) {
@@ -576,79 +670,12 @@ bool ImageManager::file_load_image(Image *img,
 	bool is_rgba = (type == IMAGE_DATA_TYPE_FLOAT4 ||
 	                type == IMAGE_DATA_TYPE_HALF4 ||
 	                type == IMAGE_DATA_TYPE_BYTE4);
-	if(is_rgba) {
-		if(cmyk) {
-			/* CMYK */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+2] = (pixels[i*4+2]*pixels[i*4+3])/255;
-				pixels[i*4+1] = (pixels[i*4+1]*pixels[i*4+3])/255;
-				pixels[i*4+0] = (pixels[i*4+0]*pixels[i*4+3])/255;
-				pixels[i*4+3] = alpha_one;
-			}
-		}
-		else if(components == 2) {
-			/* grayscale + alpha */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = pixels[i*2+1];
-				pixels[i*4+2] = pixels[i*2+0];
-				pixels[i*4+1] = pixels[i*2+0];
-				pixels[i*4+0] = pixels[i*2+0];
-			}
-		}
-		else if(components == 3) {
-			/* RGB */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = alpha_one;
-				pixels[i*4+2] = pixels[i*3+2];
-				pixels[i*4+1] = pixels[i*3+1];
-				pixels[i*4+0] = pixels[i*3+0];
-			}
-		}
-		else if(components == 1) {
-			/* grayscale */
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = alpha_one;
-				pixels[i*4+2] = pixels[i];
-				pixels[i*4+1] = pixels[i];
-				pixels[i*4+0] = pixels[i];
-			}
-		}
-		if(img->use_alpha == false) {
-			for(size_t i = num_pixels-1, pixel = 0; pixel < num_pixels; pixel++, i--) {
-				pixels[i*4+3] = alpha_one;
-			}
-		}
-	}
-	/* Make sure we don't have buggy values. */
-	if(FileFormat == TypeDesc::FLOAT) {
-		/* For RGBA buffers we put all channels to 0 if either of them is not
-		 * finite. This way we avoid possible artifacts caused by fully changed
-		 * hue.
-		 */
-		if(is_rgba) {
-			for(size_t i = 0; i < num_pixels; i += 4) {
-				StorageType *pixel = &pixels[i*4];
-				if(!isfinite(pixel[0]) ||
-				   !isfinite(pixel[1]) ||
-				   !isfinite(pixel[2]) ||
-				   !isfinite(pixel[3]))
-				{
-					pixel[0] = 0;
-					pixel[1] = 0;
-					pixel[2] = 0;
-					pixel[3] = 0;
-				}
-			}
-		}
-		else {
-			for(size_t i = 0; i < num_pixels; ++i) {
-				StorageType *pixel = &pixels[i];
-				if(!isfinite(pixel[0])) {
-					pixel[0] = 0;
-				}
-			}
-		}
-	}
+	image_convert_pixels<FileFormat, StorageType>(pixels,
+	                                              num_pixels,
+	                                              components,
+	                                              is_rgba,
+	                                              cmyk,
+	                                              img->use_alpha);
 	/* Scale image down if needed. */
 	if(pixels_storage.size() > 0) {
 		float scale_factor = 1.0f;
@@ -682,6 +709,199 @@ bool ImageManager::file_load_image(Image *img,
 	return true;
 }
 
+template<TypeDesc::BASETYPE FileFormat,
+         typename StorageType>
+bool ImageManager::file_load_tile(Image *img,
+                                  ImageDataType type,
+                                  int level,
+                                  int x, int y,
+                                  int width, int height,
+                                  void *tile_pixels)
+{
+	ImageInput *in = img->cache_input;
+	ImageSpec spec;
+	if(in == NULL || level >= img->cache_levels || !in->seek_subimage(0, level, spec)) {
+		/* Mip level is not stored in the file. */
+		return false;
+	}
+
+	const int components = spec.nchannels;
+	const size_t num_pixels = ((size_t)width) * height;
+	vector<StorageType> pixels(num_pixels * max(components, 4));
+	bool read;
+
+	if(spec.tile_width > 0) {
+		read = in->read_tiles(spec.x + x, spec.x + x + width,
+		                      spec.y + y, spec.y + y + height,
+		                      0, 1,
+		                      FileFormat,
+		                      &pixels[0]);
+	}
+	else if(x == 0 && width == spec.width) {
+		read = in->read_scanlines(spec.y + y, spec.y + y + height, 0,
+		                          FileFormat,
+		                          &pixels[0]);
+	}
+	else {
+		/* Read full scanlines and crop. */
+		vector<StorageType> scanlines(((size_t)spec.width) * height * components);
+		read = in->read_scanlines(spec.y + y, spec.y + y + height, 0,
+		                          FileFormat,
+		                          &scanlines[0]);
+		for(int row = 0; row < height; row++) {
+			memcpy(&pixels[((size_t)row) * width * components],
+			       &scanlines[(((size_t)row) * spec.width + x) * components],
+			       ((size_t)width) * components * sizeof(StorageType));
+		}
+	}
+
+	if(!read) {
+		return false;
+	}
+
+	if(components > 4) {
+		for(size_t i = 0; i < num_pixels; i++) {
+			pixels[i*4+0] = pixels[i*components+0];
+			pixels[i*4+1] = pixels[i*components+1];
+			pixels[i*4+2] = pixels[i*components+2];
+			pixels[i*4+3] = pixels[i*components+3];
+		}
+	}
+
+	bool is_rgba = (type == IMAGE_DATA_TYPE_FLOAT4 ||
+	                type == IMAGE_DATA_TYPE_HALF4 ||
+	                type == IMAGE_DATA_TYPE_BYTE4);
+	image_convert_pixels<FileFormat, StorageType>(&pixels[0],
+	                                              num_pixels,
+	                                              components,
+	                                              is_rgba,
+	                                              img->cache_cmyk,
+	                                              img->use_alpha);
+
+	memcpy(tile_pixels,
+	       &pixels[0],
+	       num_pixels * (is_rgba? 4: 1) * sizeof(StorageType));
+	return true;
+}
+
+bool ImageManager::device_cache_image(TextureCache *cache,
+                                      ImageDataType type,
+                                      int slot)
+{
+	Image *img = images[type][slot];
+
+	/* Only the header is read here, pixels are read on first lookup. */
+	ImageInput *in = NULL;
+	int width, height, depth, components;
+	if(!file_load_image_generic(img, &in, width, height, depth, components)) {
+		return false;
+	}
+
+	if(depth > 1 || width == 0 || height == 0) {
+		/* Volumes and invalid images are loaded as usual. */
+		in->close();
+		delete in;
+		return false;
+	}
+
+	/* Mip levels stored in the file are only read when they have the size,
+	 * channels and tiles the texture cache expects for them. */
+	int num_levels = 1;
+	ImageSpec level_spec = in->spec();
+	const int file_tile_width = level_spec.tile_width;
+	const int file_tile_height = level_spec.tile_height;
+	while(in->seek_subimage(0, num_levels, level_spec)) {
+		if(level_spec.width != max(1, width >> num_levels) ||
+		   level_spec.height != max(1, height >> num_levels) ||
+		   level_spec.depth > 1 ||
+		   level_spec.nchannels != components ||
+		   level_spec.tile_width != file_tile_width ||
+		   level_spec.tile_height != file_tile_height)
+		{
+			VLOG(1) << "Image " << img->filename << " has unexpected mip level "
+			        << num_levels << ", coarser levels will be generated.";
+			break;
+		}
+		num_levels++;
+	}
+	if(!in->seek_subimage(0, 0, level_spec)) {
+		in->close();
+		delete in;
+		return false;
+	}
+
+	const ImageSpec& spec = in->spec();
+	int tile_width, tile_height;
+	if(spec.tile_width > 0 && spec.tile_height > 0 && spec.tile_depth <= 1) {
+		tile_width = spec.tile_width;
+		tile_height = spec.tile_height;
+	}
+	else {
+		tile_width = width;
+		tile_height = IMAGE_CACHE_STRIP_HEIGHT;
+	}
+
+	TextureCache::LoadTileFunc load_tile;
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+		case IMAGE_DATA_TYPE_FLOAT:
+			load_tile = function_bind(&ImageManager::file_load_tile<TypeDesc::FLOAT, float>,
+			                          this, img, type, _1, _2, _3, _4, _5, _6);
+			break;
+		case IMAGE_DATA_TYPE_BYTE4:
+		case IMAGE_DATA_TYPE_BYTE:
+			load_tile = function_bind(&ImageManager::file_load_tile<TypeDesc::UINT8, uchar>,
+			                          this, img, type, _1, _2, _3, _4, _5, _6);
+			break;
+		case IMAGE_DATA_TYPE_HALF4:
+		case IMAGE_DATA_TYPE_HALF:
+			load_tile = function_bind(&ImageManager::file_load_tile<TypeDesc::HALF, half>,
+			                          this, img, type, _1, _2, _3, _4, _5, _6);
+			break;
+		default:
+			in->close();
+			delete in;
+			return false;
+	}
+
+	img->cache_input = in;
+	img->cache_cmyk = strcmp(in->format_name(), "jpeg") == 0 && components == 4;
+	img->cache_levels = num_levels;
+
+	{
+		thread_scoped_lock device_lock(device_mutex);
+		cache->add_image(type_index_to_flattened_slot(slot, type),
+		                 type,
+		                 width, height,
+		                 tile_width, tile_height,
+		                 img->interpolation,
+		                 img->extension,
+		                 load_tile);
+	}
+
+	VLOG(1) << "Image " << img->filename << " will be loaded on demand by the texture cache.";
+
+	return true;
+}
+
+void ImageManager::device_uncache_image(TextureCache *cache,
+                                        ImageDataType type,
+                                        int slot)
+{
+	Image *img = images[type][slot];
+
+	if(img->cache_input) {
+		{
+			thread_scoped_lock device_lock(device_mutex);
+			cache->remove_image(type_index_to_flattened_slot(slot, type));
+		}
+
+		img->cache_input->close();
+		delete img->cache_input;
+		img->cache_input = NULL;
+	}
+}
+
 void ImageManager::device_load_image(Device *device,
                                      Scene *scene,
                                      ImageDataType type,
@@ -712,6 +932,22 @@ void ImageManager::device_load_image(Device *device,
 		img->mem = NULL;
 	}
 
+	TextureCache *cache = device->texture_cache();
+	if(cache) {
+		device_uncache_image(cache, type, slot);
+	}
+
+	/* Load file images on demand if the device supports it, scaling images
+	 * down for the texture limit requires all pixels up front. */
+	if(cache && scene->params.use_texture_cache &&
+	   !img->builtin_data && texture_limit == 0)
+	{
+		if(device_cache_image(cache, type, slot)) {
+			img->need_load = false;
+			return;
+		}
+	}
+
 	/* Create new texture. */
 	if(type == IMAGE_DATA_TYPE_FLOAT4) {
 		device_vector<float4> *tex_img
@@ -861,11 +1097,15 @@ void ImageManager::device_load_image(Device *device,
 	img->need_load = false;
 }
 
-void ImageManager::device_free_image(Device *, ImageDataType type, int slot)
+void ImageManager::device_free_image(Device *device, ImageDataType type, int slot)
 {
 	Image *img = images[type][slot];
 
 	if(img) {
+		if(img->cache_input) {
+			device_uncache_image(device->texture_cache(), type, slot);
+		}
+
 		if(osl_texture_system && !img->builtin_data) {
 #ifdef WITH_OSL
 			ustring filename(images[type][slot]->filename);
@@ -892,6 +1132,11 @@ void ImageManager::device_update(Device *device,
 		return;
 	}
 
+	TextureCache *cache = device->texture_cache();
+	if(cache) {
+		cache->set_memory_budget(((size_t)scene->params.texture_cache_size) * 1024 * 1024);
+	}
+
 	TaskPool pool;
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		for(size_t slot = 0; slot < images[type].size(); slot++) {
@@ -30,6 +30,7 @@ CCL_NAMESPACE_BEGIN
 class Device;
 class Progress;
 class Scene;
+class TextureCache;
 
 class ImageManager {
 public:
@@ -113,6 +114,14 @@ public:
 
 		device_memory *mem;
 
+		/* Open file for images which are loaded on demand by the texture
+		 * cache, NULL otherwise. */
+		ImageInput *cache_input;
+		bool cache_cmyk;
+		/* Number of mip levels in the file which match the levels of the
+		 * texture cache, coarser levels are generated by the cache. */
+		int cache_levels;
+
 		int users;
 	};
 
@@ -143,6 +152,15 @@ private:
 	                     int texture_limit,
 	                     device_vector<DeviceType>& tex_img);
 
+	template<TypeDesc::BASETYPE FileFormat,
+	         typename StorageType>
+	bool file_load_tile(Image *img,
+	                    ImageDataType type,
+	                    int level,
+	                    int x, int y,
+	                    int width, int height,
+	                    void *tile_pixels);
+
 	int max_flattened_slot(ImageDataType type);
 	int type_index_to_flattened_slot(int slot, ImageDataType type);
 	int flattened_slot_to_type_index(int flat_slot, ImageDataType *type);
@@ -153,6 +171,12 @@ private:
 	                       ImageDataType type,
 	                       int slot,
 	                       Progress *progess);
+	bool device_cache_image(TextureCache *cache,
+	                        ImageDataType type,
+	                        int slot);
+	void device_uncache_image(TextureCache *cache,
+	                          ImageDataType type,
+	                          int slot);
 	void device_free_image(Device *device,
 	                       ImageDataType type,
 	                       int slot);
@@ -65,9 +65,15 @@ public:
 	int volume_samples;
 	int start_sample;
 
+	bool use_adaptive_sampling;
+	float adaptive_threshold;
+	int adaptive_min_samples;
+	int adaptive_step;
+
 	bool sample_all_lights_direct;
 	bool sample_all_lights_indirect;
 	float light_sampling_threshold;
+	bool use_light_tree;
 
 	enum Method {
 		BRANCHED_PATH = 0,
@@ -19,6 +19,7 @@
 #include "render/integrator.h"
 #include "render/film.h"
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/scene.h"
@@ -474,6 +475,232 @@ void LightManager::device_update_distribution(Device *, DeviceScene *dscene, Sce
 	}
 }
 
+static float light_tree_emission_estimate(Shader *shader)
+{
+	float3 emission;
+	if(shader->is_constant_emission(&emission)) {
+		return average(fabs(emission));
+	}
+	/* Textured emission is not estimated. */
+	return 1.0f;
+}
+
+void LightManager::device_update_light_tree(Device *, DeviceScene *dscene, Scene *scene, Progress& progress)
+{
+	KernelIntegrator *kintegrator = &dscene->data.integrator;
+	Integrator *integrator = scene->integrator;
+
+	kintegrator->use_light_tree = false;
+	kintegrator->light_tree_pdf = 0.0f;
+	kintegrator->light_tree_lamp_offset = 0;
+	kintegrator->light_tree_num_infinite = 0;
+
+	/* Sampling all lights in the branched path integrator relies on the
+	 * layout of the light distribution. */
+	bool sample_all_lights = (integrator->method == Integrator::BRANCHED_PATH &&
+	                          (integrator->sample_all_lights_direct ||
+	                           integrator->sample_all_lights_indirect));
+
+	if(!integrator->use_light_tree || sample_all_lights || !kintegrator->use_direct_light) {
+		return;
+	}
+
+	progress.set_status("Updating Lights", "Building light tree");
+
+	/* The map stores for every object the offset of its triangles in the
+	 * map and its first triangle, followed by the leaf node of every lamp,
+	 * the distribution index of distant and background lights and finally
+	 * the leaf node of every triangle of emissive objects. */
+	size_t num_lights = kintegrator->num_all_lights;
+	size_t num_infinite = 0;
+	size_t num_map_triangles = 0;
+
+	foreach(Light *light, scene->lights) {
+		if(light->is_enabled && (light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND)) {
+			num_infinite++;
+		}
+	}
+
+	foreach(Object *object, scene->objects) {
+		if(object_usable_as_light(object)) {
+			num_map_triangles += object->mesh->num_triangles();
+		}
+	}
+
+	size_t lamp_offset = 2*scene->objects.size();
+	size_t infinite_offset = lamp_offset + num_lights;
+	size_t triangle_offset = infinite_offset + num_infinite;
+	size_t map_size = triangle_offset + num_map_triangles;
+
+	uint *map = dscene->light_tree_map.alloc(map_size);
+	for(size_t i = 0; i < map_size; i++) {
+		map[i] = LIGHT_TREE_NONE;
+	}
+
+	/* Emissive triangles, in the same order as the light distribution. */
+	vector<LightTreeEmitter> emitters;
+	size_t distribution_index = 0;
+	size_t map_offset = triangle_offset;
+	int object_id = 0;
+
+	foreach(Object *object, scene->objects) {
+		if(progress.get_cancel()) return;
+
+		if(!object_usable_as_light(object)) {
+			object_id++;
+			continue;
+		}
+
+		Mesh *mesh = object->mesh;
+		bool transform_applied = mesh->transform_applied;
+		Transform tfm = object->tfm;
+
+		map[object_id*2 + 0] = map_offset;
+		map[object_id*2 + 1] = mesh->tri_offset;
+
+		size_t mesh_num_triangles = mesh->num_triangles();
+		for(size_t i = 0; i < mesh_num_triangles; i++) {
+			int shader_index = mesh->shader[i];
+			Shader *shader = (shader_index < mesh->used_shaders.size())
+			                         ? mesh->used_shaders[shader_index]
+			                         : scene->default_surface;
+
+			if(!(shader->use_mis && shader->has_surface_emission)) {
+				continue;
+			}
+
+			size_t index = distribution_index++;
+
+			Mesh::Triangle t = mesh->get_triangle(i);
+			if(!t.valid(&mesh->verts[0])) {
+				continue;
+			}
+			float3 p1 = mesh->verts[t.v[0]];
+			float3 p2 = mesh->verts[t.v[1]];
+			float3 p3 = mesh->verts[t.v[2]];
+
+			if(!transform_applied) {
+				p1 = transform_point(&tfm, p1);
+				p2 = transform_point(&tfm, p2);
+				p3 = transform_point(&tfm, p3);
+			}
+
+			float area = triangle_area(p1, p2, p3);
+			float energy = area * light_tree_emission_estimate(shader);
+
+			if(energy == 0.0f) {
+				continue;
+			}
+
+			/* Emission is two sided. */
+			LightTreeEmitter emitter;
+			emitter.bbox = BoundBox(p1);
+			emitter.bbox.grow(p2);
+			emitter.bbox.grow(p3);
+			emitter.cone = LightTreeCone(safe_normalize(cross(p2 - p1, p3 - p1)), M_PI_F, M_PI_2_F);
+			emitter.energy = energy;
+			emitter.area = area;
+			emitter.distribution_index = index;
+			emitter.map_index = map_offset + i;
+			emitters.push_back(emitter);
+		}
+
+		map_offset += mesh_num_triangles;
+		object_id++;
+	}
+
+	/* Lamps. Energies are relative to triangles, matching how the kernel
+	 * scales lamp emission. */
+	int light_index = 0;
+	num_infinite = 0;
+
+	foreach(Light *light, scene->lights) {
+		if(!light->is_enabled)
+			continue;
+
+		size_t index = distribution_index + light_index;
+
+		if(light->type == LIGHT_DISTANT || light->type == LIGHT_BACKGROUND) {
+			map[infinite_offset + num_infinite] = index;
+			num_infinite++;
+			light_index++;
+			continue;
+		}
+
+		Shader *shader = (light->shader) ? light->shader : scene->default_light;
+		float estimate = light_tree_emission_estimate(shader);
+
+		LightTreeEmitter emitter;
+		emitter.bbox = BoundBox::empty;
+		emitter.area = 0.0f;
+		emitter.distribution_index = index;
+		emitter.map_index = lamp_offset + light_index;
+
+		if(light->type == LIGHT_AREA) {
+			float3 axisu = light->axisu*(light->sizeu*light->size);
+			float3 axisv = light->axisv*(light->sizev*light->size);
+
+			emitter.bbox.grow(light->co - 0.5f*axisu - 0.5f*axisv);
+			emitter.bbox.grow(light->co + 0.5f*axisu - 0.5f*axisv);
+			emitter.bbox.grow(light->co - 0.5f*axisu + 0.5f*axisv);
+			emitter.bbox.grow(light->co + 0.5f*axisu + 0.5f*axisv);
+			emitter.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, M_PI_2_F);
+			emitter.energy = 0.25f * estimate;
+		}
+		else {
+			emitter.bbox.grow(light->co, light->size);
+			if(light->type == LIGHT_SPOT) {
+				emitter.cone = LightTreeCone(safe_normalize(light->dir), 0.0f, 0.5f*light->spot_angle);
+			}
+			else {
+				emitter.cone = LightTreeCone(make_float3(0.0f, 0.0f, 1.0f), M_PI_F, M_PI_2_F);
+			}
+			emitter.energy = 0.25f * M_1_PI_F * estimate;
+		}
+
+		if(emitter.energy > 0.0f) {
+			emitters.push_back(emitter);
+		}
+
+		light_index++;
+	}
+
+	if(emitters.size() == 0 && num_infinite == 0) {
+		dscene->light_tree_map.free();
+		return;
+	}
+
+	LightTree tree(emitters);
+
+	if(tree.num_nodes()) {
+		float4 *nodes = dscene->light_tree_nodes.alloc(tree.num_nodes()*LIGHT_TREE_NODE_SIZE);
+		tree.pack(nodes, map);
+		dscene->light_tree_nodes.copy_to_device();
+	}
+
+	dscene->light_tree_map.copy_to_device();
+
+	/* Split samples evenly between the tree and distant and background
+	 * lights, the same way the distribution does for lamps and triangles. */
+	if(emitters.size() == 0) {
+		kintegrator->light_tree_pdf = 0.0f;
+	}
+	else if(num_infinite == 0) {
+		kintegrator->light_tree_pdf = 1.0f;
+	}
+	else {
+		kintegrator->light_tree_pdf = 0.5f;
+	}
+
+	kintegrator->use_light_tree = true;
+	kintegrator->light_tree_lamp_offset = lamp_offset;
+	kintegrator->light_tree_num_infinite = num_infinite;
+	kintegrator->pdf_lights = (num_infinite)? (1.0f - kintegrator->light_tree_pdf)/num_infinite: 0.0f;
+
+	VLOG(1) << "Light tree with " << tree.num_nodes() << " nodes, "
+	        << num_infinite << " distant and background lights.";
+}
+
 static void background_cdf(int start,
                            int end,
                            int res,
@@ -828,6 +1055,9 @@ void LightManager::device_update(Device *device, DeviceScene *dscene, Scene *sce
 	device_update_distribution(device, dscene, scene, progress);
 	if(progress.get_cancel()) return;
 
+	device_update_light_tree(device, dscene, scene, progress);
+	if(progress.get_cancel()) return;
+
 	device_update_background(device, dscene, scene, progress);
 	if(progress.get_cancel()) return;
 
@@ -845,6 +1075,8 @@ void LightManager::device_free(Device *, DeviceScene *dscene)
 	dscene->light_data.free();
 	dscene->light_background_marginal_cdf.free();
 	dscene->light_background_conditional_cdf.free();
+	dscene->light_tree_nodes.free();
+	dscene->light_tree_map.free();
 }
 
 void LightManager::tag_update(Scene * /*scene*/)
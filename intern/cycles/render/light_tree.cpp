@@ -0,0 +1,270 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+#define LIGHT_TREE_NUM_BUCKETS 12
+
+/* Cone */
+
+float LightTreeCone::measure() const
+{
+	const float theta_w = min(theta_o + theta_e, M_PI_F);
+	const float cos_o = cosf(theta_o);
+	const float sin_o = sinf(theta_o);
+
+	return M_2PI_F * (1.0f - cos_o) +
+	       M_PI_2_F * (2.0f * theta_w * sin_o - cosf(theta_o - 2.0f * theta_w) -
+	                   2.0f * theta_o * sin_o + cos_o);
+}
+
+LightTreeCone merge(const LightTreeCone& cone_a, const LightTreeCone& cone_b)
+{
+	/* Let a be the cone with the widest spread. */
+	const bool swapped = (cone_a.theta_o < cone_b.theta_o);
+	const LightTreeCone& a = (swapped)? cone_b: cone_a;
+	const LightTreeCone& b = (swapped)? cone_a: cone_b;
+
+	const float theta_e = max(a.theta_e, b.theta_e);
+	const float theta_d = safe_acosf(dot(a.axis, b.axis));
+
+	/* b is contained in a. */
+	if(min(theta_d + b.theta_o, M_PI_F) <= a.theta_o) {
+		return LightTreeCone(a.axis, a.theta_o, theta_e);
+	}
+
+	const float theta_o = 0.5f * (a.theta_o + theta_d + b.theta_o);
+	if(theta_o >= M_PI_F) {
+		return LightTreeCone(a.axis, M_PI_F, theta_e);
+	}
+
+	/* Rotate the axis of a towards b, to the middle of the merged cone. */
+	float3 ortho = b.axis - a.axis * dot(a.axis, b.axis);
+	float ortho_len;
+	ortho = safe_normalize_len(ortho, &ortho_len);
+	if(ortho_len < 1e-6f) {
+		/* Opposite axes. */
+		return LightTreeCone(a.axis, M_PI_F, theta_e);
+	}
+
+	const float theta_r = theta_o - a.theta_o;
+	const float3 axis = normalize(a.axis * cosf(theta_r) + ortho * sinf(theta_r));
+
+	return LightTreeCone(axis, theta_o, theta_e);
+}
+
+/* Tree */
+
+LightTree::LightTree(const vector<LightTreeEmitter>& emitters_)
+: emitters(emitters_)
+{
+	if(emitters.size() == 0) {
+		return;
+	}
+
+	nodes.reserve(2 * emitters.size() - 1);
+	recursive_build(-1, 0, emitters.size());
+}
+
+int LightTree::recursive_build(int parent, int start, int end)
+{
+	Node node;
+	node.bbox = BoundBox::empty;
+	node.cone = emitters[start].cone;
+	node.energy = 0.0f;
+	node.parent = parent;
+	node.right_child = -1;
+	node.emitter = -1;
+
+	BoundBox centroid_bbox = BoundBox::empty;
+
+	for(int i = start; i < end; i++) {
+		const LightTreeEmitter& emitter = emitters[i];
+
+		node.bbox.grow(emitter.bbox);
+		node.cone = merge(node.cone, emitter.cone);
+		node.energy += emitter.energy;
+		centroid_bbox.grow(emitter.bbox.center());
+	}
+
+	const int index = nodes.size();
+
+	if(end - start == 1) {
+		node.emitter = start;
+		nodes.push_back(node);
+		return index;
+	}
+
+	nodes.push_back(node);
+
+	const int middle = split(start, end, centroid_bbox);
+
+	/* Left child is stored right after its parent. */
+	recursive_build(index, start, middle);
+	const int right_child = recursive_build(index, middle, end);
+
+	nodes[index].right_child = right_child;
+
+	return index;
+}
+
+int LightTree::split(int start, int end, const BoundBox& centroid_bbox)
+{
+	/* Binned split minimizing the surface area orientation heuristic: the
+	 * energy times bounding box area times cone measure of both children. */
+	struct Bucket {
+		BoundBox bbox;
+		LightTreeCone cone;
+		float energy;
+		int count;
+	};
+
+	const float3 extent = centroid_bbox.size();
+	const float max_extent = max3(extent);
+
+	float best_cost = FLT_MAX;
+	int best_axis = -1;
+	int best_bucket = 0;
+
+	for(int axis = 0; axis < 3; axis++) {
+		if(extent[axis] == 0.0f) {
+			continue;
+		}
+
+		const float inv_extent = 1.0f / extent[axis];
+		Bucket buckets[LIGHT_TREE_NUM_BUCKETS];
+
+		for(int b = 0; b < LIGHT_TREE_NUM_BUCKETS; b++) {
+			buckets[b].bbox = BoundBox::empty;
+			buckets[b].energy = 0.0f;
+			buckets[b].count = 0;
+		}
+
+		for(int i = start; i < end; i++) {
+			const LightTreeEmitter& emitter = emitters[i];
+			const float3 centroid = emitter.bbox.center();
+			int b = (int)(LIGHT_TREE_NUM_BUCKETS * (centroid[axis] - centroid_bbox.min[axis]) * inv_extent);
+			b = min(b, LIGHT_TREE_NUM_BUCKETS - 1);
+
+			Bucket& bucket = buckets[b];
+			bucket.cone = (bucket.count == 0)? emitter.cone: merge(bucket.cone, emitter.cone);
+			bucket.bbox.grow(emitter.bbox);
+			bucket.energy += emitter.energy;
+			bucket.count++;
+		}
+
+		/* Sweep from the right to get the cost of the right side of every split. */
+		float right_cost[LIGHT_TREE_NUM_BUCKETS];
+		Bucket right = buckets[LIGHT_TREE_NUM_BUCKETS - 1];
+
+		for(int b = LIGHT_TREE_NUM_BUCKETS - 1; b > 0; b--) {
+			if(b != LIGHT_TREE_NUM_BUCKETS - 1 && buckets[b].count != 0) {
+				right.cone = (right.count == 0)? buckets[b].cone: merge(right.cone, buckets[b].cone);
+				right.bbox.grow(buckets[b].bbox);
+				right.energy += buckets[b].energy;
+				right.count += buckets[b].count;
+			}
+			right_cost[b] = (right.count == 0)?
+			        FLT_MAX:
+			        right.energy * right.bbox.safe_area() * right.cone.measure();
+		}
+
+		/* Penalize splitting along short axes. */
+		const float regularization = max_extent * inv_extent;
+		Bucket left = buckets[0];
+
+		for(int b = 1; b < LIGHT_TREE_NUM_BUCKETS; b++) {
+			if(left.count != 0 && right_cost[b] != FLT_MAX) {
+				const float left_cost = left.energy * left.bbox.safe_area() * left.cone.measure();
+				const float cost = regularization * (left_cost + right_cost[b]);
+
+				if(cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_bucket = b;
+				}
+			}
+
+			if(buckets[b].count != 0) {
+				left.cone = (left.count == 0)? buckets[b].cone: merge(left.cone, buckets[b].cone);
+				left.bbox.grow(buckets[b].bbox);
+				left.energy += buckets[b].energy;
+				left.count += buckets[b].count;
+			}
+		}
+	}
+
+	if(best_axis == -1) {
+		/* All centroids coincide, split in the middle. */
+		return (start + end) / 2;
+	}
+
+	/* Partition emitters in buckets left of the split. */
+	const float inv_extent = 1.0f / extent[best_axis];
+	int middle = start;
+	int last = end;
+
+	while(middle < last) {
+		const float3 centroid = emitters[middle].bbox.center();
+		int b = (int)(LIGHT_TREE_NUM_BUCKETS * (centroid[best_axis] - centroid_bbox.min[best_axis]) * inv_extent);
+		b = min(b, LIGHT_TREE_NUM_BUCKETS - 1);
+
+		if(b < best_bucket) {
+			middle++;
+		}
+		else {
+			swap(emitters[middle], emitters[--last]);
+		}
+	}
+
+	if(middle == start || middle == end) {
+		return (start + end) / 2;
+	}
+
+	return middle;
+}
+
+void LightTree::pack(float4 *knodes, uint *map) const
+{
+	for(size_t i = 0; i < nodes.size(); i++) {
+		const Node& node = nodes[i];
+		float4 *knode = knodes + i*LIGHT_TREE_NODE_SIZE;
+		int child = node.right_child;
+		float area = 0.0f;
+
+		if(node.right_child == -1) {
+			/* Leaf nodes store the emitter as negative index. */
+			const LightTreeEmitter& emitter = emitters[node.emitter];
+			child = ~emitter.distribution_index;
+			area = emitter.area;
+			map[emitter.map_index] = i;
+		}
+
+		knode[0] = make_float4(node.bbox.min.x, node.bbox.min.y, node.bbox.min.z, node.energy);
+		knode[1] = make_float4(node.bbox.max.x, node.bbox.max.y, node.bbox.max.z, node.cone.theta_o);
+		knode[2] = make_float4(node.cone.axis.x, node.cone.axis.y, node.cone.axis.z, node.cone.theta_e);
+		knode[3] = make_float4(__int_as_float(child), __int_as_float(node.parent), area, 0.0f);
+	}
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Bounding volume hierarchy over lamps and emissive triangles, used to
+ * select lights proportional to their estimated contribution to a shading
+ * point rather than to their area only. Besides a bounding box and total
+ * energy, every node stores a cone bounding the emission directions.
+ *
+ * Based on "Importance Sampling of Many Lights with Adaptive Tree Splitting"
+ * by Alejandro Conty Estevez and Christopher Kulla. */
+
+/* Emission direction bounds. Normals of all emitters lie within theta_o of
+ * the axis, and light is emitted within theta_e around the normals. */
+struct LightTreeCone {
+	float3 axis;
+	float theta_o;
+	float theta_e;
+
+	LightTreeCone()
+	: axis(make_float3(0.0f, 0.0f, 1.0f)), theta_o(0.0f), theta_e(0.0f) {}
+	LightTreeCone(const float3& axis, float theta_o, float theta_e)
+	: axis(axis), theta_o(theta_o), theta_e(theta_e) {}
+
+	/* Measure of the bounded directions, used by the split heuristic. */
+	float measure() const;
+};
+
+LightTreeCone merge(const LightTreeCone& a, const LightTreeCone& b);
+
+struct LightTreeEmitter {
+	BoundBox bbox;
+	LightTreeCone cone;
+	float energy;
+	/* Triangle area, to convert selection probabilities to area densities. */
+	float area;
+	/* Index of the emitter in the light distribution. */
+	int distribution_index;
+	/* Location in the light tree map which receives the leaf node index. */
+	int map_index;
+};
+
+class LightTree {
+public:
+	explicit LightTree(const vector<LightTreeEmitter>& emitters);
+
+	size_t num_nodes() const { return nodes.size(); }
+
+	/* Pack nodes in the kernel layout, LIGHT_TREE_NODE_SIZE float4 per node,
+	 * and store the leaf node of every emitter in the map. */
+	void pack(float4 *knodes, uint *map) const;
+
+protected:
+	struct Node {
+		BoundBox bbox;
+		LightTreeCone cone;
+		float energy;
+		int parent;
+		/* The left child directly follows its parent, -1 for leaf nodes. */
+		int right_child;
+		/* Emitter index for leaf nodes. */
+		int emitter;
+	};
+
+	int recursive_build(int parent, int start, int end);
+	int split(int start, int end, const BoundBox& centroid_bbox);
+
+	vector<LightTreeEmitter> emitters;
+	vector<Node> nodes;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
@@ -16,6 +16,7 @@
 
 #include "bvh/bvh.h"
 #include "bvh/bvh_build.h"
+#include "bvh/bvh_cache.h"
 
 #include "render/camera.h"
 #include "render/curves.h"
@@ -34,9 +35,11 @@
 #include "subd/subd_patch_table.h"
 
 #include "util/util_foreach.h"
+#include "util/util_half.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -381,6 +384,49 @@ void Mesh::Curve::cardinal_keys_for_step(const float3 *curve_keys,
 	}
 }
 
+/* Mesh BVH Statistics */
+
+MeshBVHStats::MeshBVHStats()
+: num_builds(0),
+  build_time(0.0),
+  num_refits(0),
+  refit_time(0.0),
+  num_rejected_refits(0),
+  rejected_refit_time(0.0)
+{
+}
+
+void MeshBVHStats::add_build(double time)
+{
+	thread_scoped_lock lock(mutex);
+	num_builds++;
+	build_time += time;
+}
+
+void MeshBVHStats::add_refit(double time, bool rejected)
+{
+	thread_scoped_lock lock(mutex);
+	if(rejected) {
+		num_rejected_refits++;
+		rejected_refit_time += time;
+	}
+	else {
+		num_refits++;
+		refit_time += time;
+	}
+}
+
+string MeshBVHStats::full_report() const
+{
+	string report = "";
+	report += string_printf("Builds: %d in %fs\n", num_builds, build_time);
+	report += string_printf("Refits: %d in %fs\n", num_refits, refit_time);
+	report += string_printf("Rejected refits: %d in %fs\n",
+	                        num_rejected_refits,
+	                        rejected_refit_time);
+	return report;
+}
+
 /* SubdFace */
 
 float3 Mesh::SubdFace::normal(const Mesh *mesh) const
@@ -872,7 +918,60 @@ void Mesh::add_undisplaced()
 	}
 }
 
-void Mesh::pack_normals(Scene *scene, uint *tri_shader, float4 *vnormal)
+/* Compact mesh storage, decoded in geom_triangle.h. */
+
+static uint mesh_normal_encode(float3 N)
+{
+	const float sum = fabsf(N.x) + fabsf(N.y) + fabsf(N.z);
+	if(sum == 0.0f) {
+		return mesh_normal_encode(make_float3(0.0f, 0.0f, 1.0f));
+	}
+
+	/* project onto octahedron and fold lower hemisphere over */
+	float u = N.x / sum;
+	float v = N.y / sum;
+	if(N.z < 0.0f) {
+		const float fu = (1.0f - fabsf(v)) * ((u >= 0.0f)? 1.0f: -1.0f);
+		const float fv = (1.0f - fabsf(u)) * ((v >= 0.0f)? 1.0f: -1.0f);
+		u = fu;
+		v = fv;
+	}
+
+	const uint x = (uint)(clamp(u*0.5f + 0.5f, 0.0f, 1.0f)*65535.0f + 0.5f);
+	const uint y = (uint)(clamp(v*0.5f + 0.5f, 0.0f, 1.0f)*65535.0f + 0.5f);
+	return x | (y << 16);
+}
+
+static uint mesh_half2_encode(float3 f)
+{
+	return (uint)float_to_half(f.x) | ((uint)float_to_half(f.y) << 16);
+}
+
+/* UV maps only use two components, store them as half floats. */
+static bool mesh_attribute_use_half2(bool use_compact_mesh,
+                                     Attribute *mattr,
+                                     AttributePrimitive prim)
+{
+	if(!use_compact_mesh ||
+	   prim != ATTR_PRIM_TRIANGLE ||
+	   mattr->element != ATTR_ELEMENT_CORNER ||
+	   mattr->type != TypeDesc::TypePoint)
+	{
+		return false;
+	}
+
+	const float3 *data = mattr->data_float3();
+	const size_t size = mattr->buffer.size() / sizeof(float3);
+	for(size_t i = 0; i < size; i++) {
+		if(data[i].z != 0.0f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Mesh::pack_normals(Scene *scene, uint *tri_shader, float4 *vnormal, uint *vnormal_compact)
 {
 	Attribute *attr_vN = attributes.find(ATTR_STD_VERTEX_NORMAL);
 	if(attr_vN == NULL) {
@@ -912,7 +1011,10 @@ void Mesh::pack_normals(Scene *scene, uint *tri_shader, float4 *vnormal)
 		if(do_transform)
 			vNi = safe_normalize(transform_direction(&ntfm, vNi));
 
-		vnormal[i] = make_float4(vNi.x, vNi.y, vNi.z, 0.0f);
+		if(vnormal_compact)
+			vnormal_compact[i] = mesh_normal_encode(vNi);
+		else
+			vnormal[i] = make_float4(vNi.x, vNi.y, vNi.z, 0.0f);
 	}
 }
 
@@ -1027,6 +1129,7 @@ void Mesh::compute_bvh(Device *device,
                        DeviceScene *dscene,
                        SceneParams *params,
                        Progress *progress,
+                       MeshBVHStats *stats,
                        int n,
                        int total)
 {
@@ -1048,17 +1151,44 @@ void Mesh::compute_bvh(Device *device,
 		vector<Object*> objects;
 		objects.push_back(&object);
 
-		if(bvh && !need_update_rebuild) {
+		/* Final renders only refit when asked for, and check that the
+		 * quality of the refitted BVH did not degrade too much. */
+		const bool is_static = (params->bvh_type == SceneParams::BVH_STATIC);
+		const bool use_sah_check = is_static && params->use_bvh_refit;
+		bool need_build = true;
+
+		if(bvh && !need_update_rebuild && (!is_static || params->use_bvh_refit)) {
 			progress->set_status(msg, "Refitting BVH");
+			double refit_start_time = time_dt();
 			bvh->objects = objects;
 			bvh->refit(*progress);
+			need_build = false;
+
+			if(use_sah_check && !progress->get_cancel()) {
+				const float sah_cost = bvh->compute_sah_cost();
+				if(bvh->build_sah_cost == 0.0f) {
+					bvh->build_sah_cost = sah_cost;
+				}
+				else if(sah_cost > bvh->build_sah_cost * params->bvh_refit_threshold) {
+					VLOG(2) << "Refitted BVH of mesh " << name << " has SAH cost "
+					        << sah_cost << ", built with " << bvh->build_sah_cost
+					        << ", rebuilding.";
+					need_build = true;
+				}
+			}
+
+			stats->add_refit(time_dt() - refit_start_time, need_build);
 		}
-		else {
+
+		if(need_build) {
 			progress->set_status(msg, "Building BVH");
+			double build_start_time = time_dt();
 
 			BVHParams bparams;
 			bparams.use_spatial_split = params->use_bvh_spatial_split;
-			bparams.use_qbvh = params->use_qbvh && device->info.has_qbvh;
+			bparams.use_obvh = dscene->data.bvh.use_obvh;
+			bparams.use_qbvh = params->use_qbvh && device->info.has_qbvh &&
+			                   !bparams.use_obvh;
 			bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
 			                              params->use_bvh_unaligned_nodes;
 			bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
@@ -1066,7 +1196,33 @@ void Mesh::compute_bvh(Device *device,
 
 			delete bvh;
 			bvh = BVH::create(bparams, objects);
-			MEM_GUARDED_CALL(progress, bvh->build, *progress);
+
+			if(params->use_bvh_cache) {
+				BVHCache& bvh_cache = BVHCache::get();
+				string key = BVHCache::key(this, bparams);
+
+				if(bvh_cache.lookup(key, params->bvh_cache_path, bvh->pack)) {
+					VLOG(2) << "Using cached BVH for mesh " << name << ".";
+				}
+				else {
+					MEM_GUARDED_CALL(progress, bvh->build, *progress);
+					if(!progress->get_cancel()) {
+						bvh_cache.insert(key,
+						                 params->bvh_cache_path,
+						                 params->bvh_cache_disk_size,
+						                 bvh->pack);
+					}
+				}
+			}
+			else {
+				MEM_GUARDED_CALL(progress, bvh->build, *progress);
+			}
+
+			if(use_sah_check && !progress->get_cancel()) {
+				bvh->build_sah_cost = bvh->compute_sah_cost();
+			}
+
+			stats->add_build(time_dt() - build_start_time);
 		}
 	}
 
@@ -1131,10 +1287,12 @@ MeshManager::MeshManager()
 {
 	need_update = true;
 	need_flags_update = true;
+	bvh = NULL;
 }
 
 MeshManager::~MeshManager()
 {
+	delete bvh;
 }
 
 void MeshManager::update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes)
@@ -1360,9 +1518,11 @@ void MeshManager::update_svm_attributes(Device *, DeviceScene *dscene, Scene *sc
 static void update_attribute_element_size(Mesh *mesh,
                                           Attribute *mattr,
                                           AttributePrimitive prim,
+                                          bool use_compact_mesh,
                                           size_t *attr_float_size,
                                           size_t *attr_float3_size,
-                                          size_t *attr_uchar4_size)
+                                          size_t *attr_uchar4_size,
+                                          size_t *attr_half2_size)
 {
 	if(mattr) {
 		size_t size = mattr->element_size(mesh, prim);
@@ -1373,6 +1533,9 @@ static void update_attribute_element_size(Mesh *mesh,
 		else if(mattr->element == ATTR_ELEMENT_CORNER_BYTE) {
 			*attr_uchar4_size += size;
 		}
+		else if(mesh_attribute_use_half2(use_compact_mesh, mattr, prim)) {
+			*attr_half2_size += size;
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			*attr_float_size += size;
 		}
@@ -1392,8 +1555,11 @@ static void update_attribute_element_offset(Mesh *mesh,
                                             size_t& attr_float3_offset,
                                             device_vector<uchar4>& attr_uchar4,
                                             size_t& attr_uchar4_offset,
+                                            device_vector<uint>& attr_half2,
+                                            size_t& attr_half2_offset,
                                             Attribute *mattr,
                                             AttributePrimitive prim,
+                                            bool use_compact_mesh,
                                             TypeDesc& type,
                                             AttributeDescriptor& desc)
 {
@@ -1424,6 +1590,17 @@ static void update_attribute_element_offset(Mesh *mesh,
 			}
 			attr_uchar4_offset += size;
 		}
+		else if(mesh_attribute_use_half2(use_compact_mesh, mattr, prim)) {
+			float3 *data = mattr->data_float3();
+			offset = attr_half2_offset;
+			element = ATTR_ELEMENT_CORNER_HALF;
+
+			assert(attr_half2.size() >= offset + size);
+			for(size_t k = 0; k < size; k++) {
+				attr_half2[offset+k] = mesh_half2_encode(data[k]);
+			}
+			attr_half2_offset += size;
+		}
 		else if(mattr->type == TypeDesc::TypeFloat) {
 			float *data = mattr->data_float();
 			offset = attr_float_offset;
@@ -1471,7 +1648,10 @@ static void update_attribute_element_offset(Mesh *mesh,
 			else
 				offset -= mesh->face_offset;
 		}
-		else if(element == ATTR_ELEMENT_CORNER || element == ATTR_ELEMENT_CORNER_BYTE) {
+		else if(element == ATTR_ELEMENT_CORNER ||
+		        element == ATTR_ELEMENT_CORNER_BYTE ||
+		        element == ATTR_ELEMENT_CORNER_HALF)
+		{
 			if(prim == ATTR_PRIM_TRIANGLE)
 				offset -= 3*mesh->tri_offset;
 			else
@@ -1520,6 +1700,8 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	size_t attr_float_size = 0;
 	size_t attr_float3_size = 0;
 	size_t attr_uchar4_size = 0;
+	size_t attr_half2_size = 0;
+	const bool use_compact_mesh = scene->params.use_compact_mesh;
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
 		Mesh *mesh = scene->meshes[i];
 		AttributeRequestSet& attributes = mesh_attributes[i];
@@ -1531,31 +1713,39 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			update_attribute_element_size(mesh,
 			                              triangle_mattr,
 			                              ATTR_PRIM_TRIANGLE,
+			                              use_compact_mesh,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half2_size);
 			update_attribute_element_size(mesh,
 			                              curve_mattr,
 			                              ATTR_PRIM_CURVE,
+			                              use_compact_mesh,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half2_size);
 			update_attribute_element_size(mesh,
 			                              subd_mattr,
 			                              ATTR_PRIM_SUBD,
+			                              use_compact_mesh,
 			                              &attr_float_size,
 			                              &attr_float3_size,
-			                              &attr_uchar4_size);
+			                              &attr_uchar4_size,
+			                              &attr_half2_size);
 		}
 	}
 
 	dscene->attributes_float.alloc(attr_float_size);
 	dscene->attributes_float3.alloc(attr_float3_size);
 	dscene->attributes_uchar4.alloc(attr_uchar4_size);
+	dscene->attributes_half2.alloc(attr_half2_size);
 
 	size_t attr_float_offset = 0;
 	size_t attr_float3_offset = 0;
 	size_t attr_uchar4_offset = 0;
+	size_t attr_half2_offset = 0;
 
 	/* Fill in attributes. */
 	for(size_t i = 0; i < scene->meshes.size(); i++) {
@@ -1573,8 +1763,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_half2, attr_half2_offset,
 			                                triangle_mattr,
 			                                ATTR_PRIM_TRIANGLE,
+			                                use_compact_mesh,
 			                                req.triangle_type,
 			                                req.triangle_desc);
 
@@ -1582,8 +1774,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_half2, attr_half2_offset,
 			                                curve_mattr,
 			                                ATTR_PRIM_CURVE,
+			                                use_compact_mesh,
 			                                req.curve_type,
 			                                req.curve_desc);
 
@@ -1591,8 +1785,10 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 			                                dscene->attributes_float, attr_float_offset,
 			                                dscene->attributes_float3, attr_float3_offset,
 			                                dscene->attributes_uchar4, attr_uchar4_offset,
+			                                dscene->attributes_half2, attr_half2_offset,
 			                                subd_mattr,
 			                                ATTR_PRIM_SUBD,
+			                                use_compact_mesh,
 			                                req.subd_type,
 			                                req.subd_desc);
 
@@ -1620,6 +1816,13 @@ void MeshManager::device_update_attributes(Device *device, DeviceScene *dscene,
 	if(dscene->attributes_uchar4.size()) {
 		dscene->attributes_uchar4.copy_to_device();
 	}
+	if(dscene->attributes_half2.size()) {
+		dscene->attributes_half2.copy_to_device();
+
+		VLOG(1) << "Compact mesh storage saved "
+		        << string_human_readable_size(attr_half2_size * (sizeof(float4) - sizeof(uint)))
+		        << " of UV memory.";
+	}
 
 	if(progress.get_cancel()) return;
 
@@ -1733,8 +1936,15 @@ void MeshManager::device_update_mesh(Device *,
 		/* normals */
 		progress.set_status("Updating Mesh", "Computing normals");
 
+		const bool use_compact_mesh = scene->params.use_compact_mesh;
 		uint *tri_shader = dscene->tri_shader.alloc(tri_size);
-		float4 *vnormal = dscene->tri_vnormal.alloc(vert_size);
+		float4 *vnormal = NULL;
+		uint *vnormal_compact = NULL;
+		if(use_compact_mesh)
+			vnormal_compact = dscene->tri_vnormal_compact.alloc(vert_size);
+		else
+			vnormal = dscene->tri_vnormal.alloc(vert_size);
+		dscene->data.bvh.use_compact_mesh = use_compact_mesh;
 		uint4 *tri_vindex = dscene->tri_vindex.alloc(tri_size);
 		uint *tri_patch = dscene->tri_patch.alloc(tri_size);
 		float2 *tri_patch_uv = dscene->tri_patch_uv.alloc(vert_size);
@@ -1742,7 +1952,8 @@ void MeshManager::device_update_mesh(Device *,
 		foreach(Mesh *mesh, scene->meshes) {
 			mesh->pack_normals(scene,
 			                   &tri_shader[mesh->tri_offset],
-			                   &vnormal[mesh->vert_offset]);
+			                   (vnormal)? &vnormal[mesh->vert_offset]: NULL,
+			                   (vnormal_compact)? &vnormal_compact[mesh->vert_offset]: NULL);
 			mesh->pack_verts(tri_prim_index,
 			                 &tri_vindex[mesh->tri_offset],
 			                 &tri_patch[mesh->tri_offset],
@@ -1756,7 +1967,16 @@ void MeshManager::device_update_mesh(Device *,
 		progress.set_status("Updating Mesh", "Copying Mesh to device");
 
 		dscene->tri_shader.copy_to_device();
-		dscene->tri_vnormal.copy_to_device();
+		if(use_compact_mesh) {
+			dscene->tri_vnormal_compact.copy_to_device();
+
+			VLOG(1) << "Compact mesh storage saved "
+			        << string_human_readable_size(vert_size * (sizeof(float4) - sizeof(uint)))
+			        << " of vertex normal memory.";
+		}
+		else {
+			dscene->tri_vnormal.copy_to_device();
+		}
 		dscene->tri_vindex.copy_to_device();
 		dscene->tri_patch.copy_to_device();
 		dscene->tri_patch_uv.copy_to_device();
@@ -1810,28 +2030,153 @@ void MeshManager::device_update_mesh(Device *,
 	}
 }
 
-void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
+/* Copy the packed BVH array to the device, moving it when the BVH is not
+ * kept for refitting. */
+template<typename T>
+static void device_update_bvh_array(device_vector<T>& dvector, array<T>& data, bool keep)
+{
+	if(data.size() == 0) {
+		return;
+	}
+	if(keep) {
+		T *mem = dvector.alloc(data.size());
+		memcpy(mem, data.data(), sizeof(T) * data.size());
+	}
+	else {
+		dvector.steal_data(data);
+	}
+	dvector.copy_to_device();
+}
+
+/* The top level BVH can only be refitted when the objects have the same
+ * meshes and primitives. */
+static void device_update_bvh_layout(const vector<Object*>& objects, vector<size_t>& layout)
+{
+	layout.clear();
+	foreach(Object *object, objects) {
+		const Mesh *mesh = object->mesh;
+		layout.push_back((size_t)mesh);
+		layout.push_back(object->is_traceable());
+		layout.push_back(mesh->has_motion_blur()? mesh->motion_steps: 0);
+		layout.push_back(mesh->num_triangles());
+		layout.push_back(mesh->num_curves());
+		layout.push_back(mesh->curve_keys.size());
+	}
+}
+
+void MeshManager::device_update_bvh(Device *device,
+                                    DeviceScene *dscene,
+                                    Scene *scene,
+                                    bool need_rebuild,
+                                    Progress& progress)
 {
 	/* bvh build */
 	progress.set_status("Updating Scene BVH", "Building");
 
 	BVHParams bparams;
 	bparams.top_level = true;
-	bparams.use_qbvh = scene->params.use_qbvh && device->info.has_qbvh;
+	bparams.use_obvh = dscene->data.bvh.use_obvh;
+	bparams.use_qbvh = scene->params.use_qbvh && device->info.has_qbvh &&
+	                   !bparams.use_obvh;
 	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
 	bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
 	                              scene->params.use_bvh_unaligned_nodes;
 	bparams.num_motion_triangle_steps = scene->params.num_bvh_time_steps;
 	bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
 
-	VLOG(1) << (bparams.use_qbvh ? "Using QBVH optimization structure"
-	                             : "Using regular BVH optimization structure");
+	VLOG(1) << (bparams.use_obvh ? "Using OBVH optimization structure"
+	            : bparams.use_qbvh ? "Using QBVH optimization structure"
+	                               : "Using regular BVH optimization structure");
+
+	/* Final renders refit the top level BVH like the mesh BVHs, when asked for.
+	 * Only meshes packed into it directly are refitted, so scenes with meshes
+	 * that have a BVH of their own, like instanced meshes, build it again.
+	 * Their BVHs are merged into the top level one, which refitting and the
+	 * SAH cost don't handle. */
+	bool has_instances = false;
+	foreach(Object *object, scene->objects) {
+		if(object->mesh->need_build_bvh()) {
+			has_instances = true;
+			break;
+		}
+	}
+
+	const bool keep_bvh = (scene->params.bvh_type == SceneParams::BVH_STATIC &&
+	                       scene->params.use_bvh_refit &&
+	                       !has_instances);
+	vector<size_t> layout;
+	if(keep_bvh) {
+		device_update_bvh_layout(scene->objects, layout);
+	}
+
+	const bool can_refit = (keep_bvh &&
+	                        bvh != NULL &&
+	                        !need_rebuild &&
+	                        bvh->objects == scene->objects &&
+	                        bvh_layout == layout &&
+	                        bvh->params.use_qbvh == bparams.use_qbvh &&
+	                        bvh->params.use_obvh == bparams.use_obvh &&
+	                        bvh->params.use_spatial_split == bparams.use_spatial_split &&
+	                        bvh->params.use_unaligned_nodes == bparams.use_unaligned_nodes &&
+	                        bvh->params.num_motion_triangle_steps == bparams.num_motion_triangle_steps &&
+	                        bvh->params.num_motion_curve_steps == bparams.num_motion_curve_steps);
+
+	bool need_build = true;
+
+	if(can_refit) {
+		progress.set_substatus("Refitting");
+		double refit_start_time = time_dt();
+		bvh->refit(progress);
+		need_build = false;
+
+		if(!progress.get_cancel()) {
+			const float sah_cost = bvh->compute_sah_cost();
+			if(sah_cost > bvh->build_sah_cost * scene->params.bvh_refit_threshold) {
+				VLOG(2) << "Refitted scene BVH has SAH cost " << sah_cost
+				        << ", built with " << bvh->build_sah_cost << ", rebuilding.";
+				need_build = true;
+			}
+		}
+
+		VLOG(1) << "Scene BVH " << (need_build? "refit rejected": "refitted")
+		        << " in " << time_dt() - refit_start_time << " seconds.";
+	}
 
-	BVH *bvh = BVH::create(bparams, scene->objects);
-	bvh->build(progress);
+	if(need_build) {
+		delete bvh;
+		bvh = BVH::create(bparams, scene->objects);
+
+		if(scene->params.use_bvh_cache) {
+			/* Final renders pack all meshes without instancing into the top level
+			 * BVH, so for static scenes this is where most of the time goes. */
+			BVHCache& bvh_cache = BVHCache::get();
+			string key = BVHCache::key(scene->objects, bparams);
+
+			if(bvh_cache.lookup(key, scene->params.bvh_cache_path, bvh->pack)) {
+				VLOG(1) << "Using cached scene BVH.";
+			}
+			else {
+				bvh->build(progress);
+				if(!progress.get_cancel()) {
+					bvh_cache.insert(key,
+					                 scene->params.bvh_cache_path,
+					                 scene->params.bvh_cache_disk_size,
+					                 bvh->pack);
+				}
+			}
+		}
+		else {
+			bvh->build(progress);
+		}
+
+		if(keep_bvh && !progress.get_cancel()) {
+			bvh->build_sah_cost = bvh->compute_sah_cost();
+		}
+	}
 
 	if(progress.get_cancel()) {
 		delete bvh;
+		bvh = NULL;
 		return;
 	}
 
@@ -1840,52 +2185,28 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 
 	PackedBVH& pack = bvh->pack;
 
-	if(pack.nodes.size()) {
-		dscene->bvh_nodes.steal_data(pack.nodes);
-		dscene->bvh_nodes.copy_to_device();
-	}
-	if(pack.leaf_nodes.size()) {
-		dscene->bvh_leaf_nodes.steal_data(pack.leaf_nodes);
-		dscene->bvh_leaf_nodes.copy_to_device();
-	}
-	if(pack.object_node.size()) {
-		dscene->object_node.steal_data(pack.object_node);
-		dscene->object_node.copy_to_device();
-	}
-	if(pack.prim_tri_index.size()) {
-		dscene->prim_tri_index.steal_data(pack.prim_tri_index);
-		dscene->prim_tri_index.copy_to_device();
-	}
-	if(pack.prim_tri_verts.size()) {
-		dscene->prim_tri_verts.steal_data(pack.prim_tri_verts);
-		dscene->prim_tri_verts.copy_to_device();
-	}
-	if(pack.prim_type.size()) {
-		dscene->prim_type.steal_data(pack.prim_type);
-		dscene->prim_type.copy_to_device();
-	}
-	if(pack.prim_visibility.size()) {
-		dscene->prim_visibility.steal_data(pack.prim_visibility);
-		dscene->prim_visibility.copy_to_device();
-	}
-	if(pack.prim_index.size()) {
-		dscene->prim_index.steal_data(pack.prim_index);
-		dscene->prim_index.copy_to_device();
-	}
-	if(pack.prim_object.size()) {
-		dscene->prim_object.steal_data(pack.prim_object);
-		dscene->prim_object.copy_to_device();
-	}
-	if(pack.prim_time.size()) {
-		dscene->prim_time.steal_data(pack.prim_time);
-		dscene->prim_time.copy_to_device();
-	}
+	device_update_bvh_array(dscene->bvh_nodes, pack.nodes, keep_bvh);
+	device_update_bvh_array(dscene->bvh_leaf_nodes, pack.leaf_nodes, keep_bvh);
+	device_update_bvh_array(dscene->object_node, pack.object_node, keep_bvh);
+	device_update_bvh_array(dscene->prim_tri_index, pack.prim_tri_index, keep_bvh);
+	device_update_bvh_array(dscene->prim_tri_verts, pack.prim_tri_verts, keep_bvh);
+	device_update_bvh_array(dscene->prim_type, pack.prim_type, keep_bvh);
+	device_update_bvh_array(dscene->prim_visibility, pack.prim_visibility, keep_bvh);
+	device_update_bvh_array(dscene->prim_index, pack.prim_index, keep_bvh);
+	device_update_bvh_array(dscene->prim_object, pack.prim_object, keep_bvh);
+	device_update_bvh_array(dscene->prim_time, pack.prim_time, keep_bvh);
 
 	dscene->data.bvh.root = pack.root_index;
 	dscene->data.bvh.use_qbvh = bparams.use_qbvh;
 	dscene->data.bvh.use_bvh_steps = (scene->params.num_bvh_time_steps != 0);
 
-	delete bvh;
+	if(keep_bvh) {
+		bvh_layout.swap(layout);
+	}
+	else {
+		delete bvh;
+		bvh = NULL;
+	}
 }
 
 void MeshManager::device_update_flags(Device * /*device*/,
@@ -2075,7 +2396,23 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	/* OSL traces rays from services built without OBVH traversal, so the
+	 * 8-wide layout is only used for SVM shading. Decided here so mesh and
+	 * top level BVHs use the same layout. */
+	dscene->data.bvh.use_obvh = (scene->params.use_qbvh &&
+	                             device->info.has_obvh &&
+	                             !scene->shader_manager->use_osl());
+
+	/* The top level BVH is built again when the topology of a mesh changed. */
+	bool need_rebuild_bvh = false;
+	foreach(Mesh *mesh, scene->meshes) {
+		if(mesh->need_update && mesh->need_update_rebuild) {
+			need_rebuild_bvh = true;
+		}
+	}
+
 	TaskPool pool;
+	MeshBVHStats bvh_stats;
 
 	i = 0;
 	foreach(Mesh *mesh, scene->meshes) {
@@ -2086,6 +2423,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 			                        dscene,
 			                        &scene->params,
 			                        &progress,
+			                        &bvh_stats,
 			                        i,
 			                        num_bvh));
 			if(mesh->need_build_bvh()) {
@@ -2098,6 +2436,8 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	pool.wait_work(&summary);
 	VLOG(2) << "Objects BVH build pool statistics:\n"
 	        << summary.full_report();
+	VLOG(1) << "Objects BVH update statistics:\n"
+	        << bvh_stats.full_report();
 
 	foreach(Shader *shader, scene->shaders) {
 		shader->need_update_attributes = false;
@@ -2118,7 +2458,12 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	if(progress.get_cancel()) return;
 
-	device_update_bvh(device, dscene, scene, progress);
+	/* Free cached BVHs of meshes which were not used in this update. */
+	if(scene->params.use_bvh_cache) {
+		BVHCache::get().prune();
+	}
+
+	device_update_bvh(device, dscene, scene, need_rebuild_bvh, progress);
 	if(progress.get_cancel()) return;
 
 	device_update_mesh(device, dscene, scene, false, progress);
@@ -2151,6 +2496,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->prim_time.free();
 	dscene->tri_shader.free();
 	dscene->tri_vnormal.free();
+	dscene->tri_vnormal_compact.free();
 	dscene->tri_vindex.free();
 	dscene->tri_patch.free();
 	dscene->tri_patch_uv.free();
@@ -2161,6 +2507,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float.free();
 	dscene->attributes_float3.free();
 	dscene->attributes_uchar4.free();
+	dscene->attributes_half2.free();
 
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
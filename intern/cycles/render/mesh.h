@@ -26,6 +26,7 @@
 #include "util/util_list.h"
 #include "util/util_map.h"
 #include "util/util_param.h"
+#include "util/util_thread.h"
 #include "util/util_transform.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
@@ -45,6 +46,30 @@ struct SubdParams;
 class DiagSplit;
 struct PackedPatchTable;
 
+/* Mesh BVH Statistics
+ *
+ * Number and time of BVH builds and refits in a single update, gathered
+ * from the threads building the mesh BVHs. */
+
+struct MeshBVHStats {
+	MeshBVHStats();
+
+	void add_build(double time);
+	void add_refit(double time, bool rejected);
+
+	string full_report() const;
+
+	thread_mutex mutex;
+
+	int num_builds;
+	double build_time;
+	int num_refits;
+	double refit_time;
+	/* Refits which degraded the BVH too much and were followed by a build. */
+	int num_rejected_refits;
+	double rejected_refit_time;
+};
+
 /* Mesh */
 
 class Mesh : public Node {
@@ -278,7 +303,7 @@ public:
 	void add_vertex_normals();
 	void add_undisplaced();
 
-	void pack_normals(Scene *scene, uint *shader, float4 *vnormal);
+	void pack_normals(Scene *scene, uint *shader, float4 *vnormal, uint *vnormal_compact);
 	void pack_verts(const vector<uint>& tri_prim_index,
 	                uint4 *tri_vindex,
 	                uint *tri_patch,
@@ -292,6 +317,7 @@ public:
 	                 DeviceScene *dscene,
 	                 SceneParams *params,
 	                 Progress *progress,
+	                 MeshBVHStats *stats,
 	                 int n,
 	                 int total);
 
@@ -365,8 +391,14 @@ protected:
 	void device_update_bvh(Device *device,
 	                       DeviceScene *dscene,
 	                       Scene *scene,
+	                       bool need_rebuild,
 	                       Progress& progress);
 
+	/* Top level BVH of the previous update, kept for refitting in final
+	 * renders, and the meshes and primitive counts of its objects. */
+	BVH *bvh;
+	vector<size_t> bvh_layout;
+
 	void device_update_displacement_images(Device *device,
 	                                       Scene *scene,
 	                                       Progress& progress);
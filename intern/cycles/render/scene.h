@@ -74,6 +74,7 @@ public:
 	/* mesh */
 	device_vector<uint> tri_shader;
 	device_vector<float4> tri_vnormal;
+	device_vector<uint> tri_vnormal_compact;
 	device_vector<uint4> tri_vindex;
 	device_vector<uint> tri_patch;
 	device_vector<float2> tri_patch_uv;
@@ -92,12 +93,15 @@ public:
 	device_vector<float> attributes_float;
 	device_vector<float4> attributes_float3;
 	device_vector<uchar4> attributes_uchar4;
+	device_vector<uint> attributes_half2;
 
 	/* lights */
 	device_vector<float4> light_distribution;
 	device_vector<float4> light_data;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<float4> light_tree_nodes;
+	device_vector<uint> light_tree_map;
 
 	/* particles */
 	device_vector<float4> particles;
@@ -133,8 +137,25 @@ public:
 	bool use_bvh_unaligned_nodes;
 	int num_bvh_time_steps;
 	bool use_qbvh;
+	/* Refit the BVH of deforming meshes in final renders, rebuilding it when
+	 * its SAH cost grew by more than the threshold factor since it was built. */
+	bool use_bvh_refit;
+	float bvh_refit_threshold;
 	bool persistent_data;
 	int texture_limit;
+	/* Load image textures on demand on the CPU, with a memory budget in
+	 * megabytes, 0 means unlimited. */
+	bool use_texture_cache;
+	int texture_cache_size;
+	/* Reuse BVHs with unchanged geometry between scene updates, and
+	 * optionally store them in a directory to share between processes,
+	 * limited to a size in bytes, 0 means unlimited. */
+	bool use_bvh_cache;
+	string bvh_cache_path;
+	size_t bvh_cache_disk_size;
+	/* Store vertex normals octahedral encoded and UVs as half floats on the
+	 * device, trading precision for memory. */
+	bool use_compact_mesh;
 
 	SceneParams()
 	{
@@ -144,8 +165,15 @@ public:
 		use_bvh_unaligned_nodes = true;
 		num_bvh_time_steps = 0;
 		use_qbvh = true;
+		use_bvh_refit = true;
+		bvh_refit_threshold = 1.5f;
 		persistent_data = false;
 		texture_limit = 0;
+		use_texture_cache = false;
+		texture_cache_size = 0;
+		use_bvh_cache = false;
+		bvh_cache_disk_size = 0;
+		use_compact_mesh = false;
 	}
 
 	bool modified(const SceneParams& params)
@@ -155,8 +183,16 @@ public:
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
 		&& use_qbvh == params.use_qbvh
+		&& use_bvh_refit == params.use_bvh_refit
+		&& bvh_refit_threshold == params.bvh_refit_threshold
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& use_texture_cache == params.use_texture_cache
+		&& texture_cache_size == params.texture_cache_size
+		&& use_bvh_cache == params.use_bvh_cache
+		&& bvh_cache_path == params.bvh_cache_path
+		&& bvh_cache_disk_size == params.bvh_cache_disk_size
+		&& use_compact_mesh == params.use_compact_mesh); }
 };
 
 /* Scene */
@@ -20,6 +20,7 @@
 #include "render/buffers.h"
 #include "render/camera.h"
 #include "device/device.h"
+#include "render/film.h"
 #include "render/graph.h"
 #include "render/integrator.h"
 #include "render/mesh.h"
@@ -103,14 +104,7 @@ Session::~Session()
 
 	if(!params.output_path.empty()) {
 		/* tonemap and write out image if requested */
-		delete display;
-
-		display = new DisplayBuffer(device, false);
-		display->reset(buffers->params);
-		tonemap(params.samples);
-
-		progress.set_status("Writing Image", params.output_path);
-		display->write(params.output_path);
+		write_image(params.output_path, params.samples);
 	}
 
 	/* clean up */
@@ -677,7 +671,8 @@ DeviceRequestedFeatures Session::get_requested_device_features()
 	BakeManager *bake_manager = scene->bake_manager;
 	requested_features.use_baking = bake_manager->get_baking();
 	requested_features.use_integrator_branched = (scene->integrator->method == Integrator::BRANCHED_PATH);
-	requested_features.use_denoising = params.use_denoising;
+	/* Denoising data may also be stored for denoising outside of the session. */
+	requested_features.use_denoising = params.use_denoising || scene->film->denoising_data_pass;
 
 	return requested_features;
 }
@@ -735,6 +730,11 @@ void Session::run()
 			run_cpu();
 	}
 
+	if(stats.texture_cache.hits + stats.texture_cache.misses > 0) {
+		VLOG(1) << "Texture cache statistics:\n"
+		        << stats.texture_cache.full_report();
+	}
+
 	/* progress update */
 	if(progress.get_cancel())
 		progress.set_status("Cancel", progress.get_cancel_message());
@@ -809,6 +809,18 @@ void Session::set_pause(bool pause_)
 		pause_cond.notify_all();
 }
 
+void Session::write_image(const string& filepath, int samples)
+{
+	delete display;
+
+	display = new DisplayBuffer(device, false);
+	display->reset(buffers->params);
+	tonemap(samples);
+
+	progress.set_status("Writing Image", filepath);
+	display->write(filepath);
+}
+
 void Session::wait()
 {
 	session_thread->join();
@@ -149,6 +149,8 @@ public:
 	void start();
 	bool draw(BufferParams& params, DeviceDrawParams& draw_params);
 	void wait();
+	/* Tonemap the render buffers and write them to an image file. */
+	void write_image(const string& filepath, int samples);
 
 	bool ready_to_reset();
 	void reset(BufferParams& params, int samples);
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_texture_cache.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Float image where every pixel stores its own coordinates, level 0 only. */
+struct GradientImage {
+	int width, height;
+	int num_loads;
+
+	bool load_tile(int level, int x, int y, int w, int h, void *pixels)
+	{
+		if(level != 0) {
+			return false;
+		}
+		for(int j = 0; j < h; j++) {
+			for(int i = 0; i < w; i++) {
+				/* Rows are top to bottom. */
+				((float*)pixels)[j*w + i] = (float)(x + i) + 1000.0f * (height - 1 - (y + j));
+			}
+		}
+		num_loads++;
+		return true;
+	}
+};
+
+float pixel_center(int i, int size)
+{
+	return ((float)i + 0.5f) / (float)size;
+}
+
+}  // namespace
+
+TEST(util_texture_cache, lookup_level_zero) {
+	Stats stats;
+	TextureCache cache(stats);
+	GradientImage image = {64, 32, 0};
+
+	cache.add_image(0, IMAGE_DATA_TYPE_FLOAT, image.width, image.height, 16, 16,
+	                INTERPOLATION_CLOSEST, EXTENSION_REPEAT,
+	                function_bind(&GradientImage::load_tile, &image, _1, _2, _3, _4, _5, _6));
+	EXPECT_TRUE(cache.has_image(0));
+	EXPECT_FALSE(cache.has_image(1));
+
+	TextureCacheThreadStats thread_stats;
+	float4 r;
+	EXPECT_TRUE(cache.lookup(&thread_stats, 0,
+	                         pixel_center(5, image.width),
+	                         pixel_center(7, image.height),
+	                         0.0f, &r));
+	EXPECT_EQ(r.x, 5.0f + 1000.0f * 7.0f);
+	EXPECT_EQ(image.num_loads, 1);
+
+	/* Same tile again is a hit. */
+	EXPECT_TRUE(cache.lookup(&thread_stats, 0,
+	                         pixel_center(6, image.width),
+	                         pixel_center(7, image.height),
+	                         0.0f, &r));
+	EXPECT_EQ(r.x, 6.0f + 1000.0f * 7.0f);
+	EXPECT_EQ(image.num_loads, 1);
+	EXPECT_EQ(thread_stats.misses, 1);
+	EXPECT_EQ(thread_stats.hits, 1);
+
+	cache.flush_thread_stats(&thread_stats);
+	EXPECT_EQ(stats.texture_cache.hits, 1);
+	EXPECT_EQ(stats.texture_cache.misses, 1);
+	EXPECT_EQ(stats.texture_cache.tiles_loaded, 1);
+
+	EXPECT_FALSE(cache.lookup(&thread_stats, 1, 0.5f, 0.5f, 0.0f, &r));
+}
+
+TEST(util_texture_cache, generated_mip_levels) {
+	Stats stats;
+	TextureCache cache(stats);
+	GradientImage image = {4, 4, 0};
+
+	cache.add_image(0, IMAGE_DATA_TYPE_FLOAT, image.width, image.height, 2, 2,
+	                INTERPOLATION_LINEAR, EXTENSION_EXTEND,
+	                function_bind(&GradientImage::load_tile, &image, _1, _2, _3, _4, _5, _6));
+
+	/* Footprint of the whole image selects the 1x1 level, which is the
+	 * average of all pixels. */
+	float4 r;
+	EXPECT_TRUE(cache.lookup(NULL, 0, 0.5f, 0.5f, 1.0f, &r));
+	EXPECT_NEAR(r.x, 1.5f + 1000.0f * 1.5f, 1e-2f);
+	EXPECT_EQ(stats.texture_cache.tiles_generated, 2);
+	EXPECT_EQ(stats.texture_cache.tiles_loaded, 4);
+}
+
+TEST(util_texture_cache, odd_size_mip_levels) {
+	Stats stats;
+	TextureCache cache(stats);
+	GradientImage image = {5, 3, 0};
+
+	cache.add_image(0, IMAGE_DATA_TYPE_FLOAT, image.width, image.height, 2, 2,
+	                INTERPOLATION_LINEAR, EXTENSION_EXTEND,
+	                function_bind(&GradientImage::load_tile, &image, _1, _2, _3, _4, _5, _6));
+
+	/* Levels are 5x3, 2x1 and 1x1 like in mipmapped files, the last column
+	 * and row of level 0 are not part of the coarser levels. */
+	float4 r;
+	EXPECT_TRUE(cache.lookup(NULL, 0, 0.5f, 0.5f, 1.0f, &r));
+	EXPECT_NEAR(r.x, 1.5f + 1000.0f * 1.5f, 1e-2f);
+	EXPECT_EQ(stats.texture_cache.tiles_generated, 2);
+}
+
+TEST(util_texture_cache, eviction) {
+	Stats stats;
+	TextureCache cache(stats);
+	GradientImage image = {256, 256, 0};
+
+	/* Budget of two 16x16 float tiles. */
+	cache.set_memory_budget(2 * 16 * 16 * sizeof(float));
+	cache.add_image(0, IMAGE_DATA_TYPE_FLOAT, image.width, image.height, 16, 16,
+	                INTERPOLATION_CLOSEST, EXTENSION_REPEAT,
+	                function_bind(&GradientImage::load_tile, &image, _1, _2, _3, _4, _5, _6));
+
+	float4 r;
+	for(int i = 0; i < image.width; i += 16) {
+		EXPECT_TRUE(cache.lookup(NULL, 0,
+		                         pixel_center(i, image.width),
+		                         pixel_center(0, image.height),
+		                         0.0f, &r));
+		EXPECT_EQ(r.x, (float)i);
+		EXPECT_LE(cache.memory_used(), cache.memory_budget());
+	}
+	EXPECT_EQ(image.num_loads, 16);
+	EXPECT_GT(stats.texture_cache.tiles_evicted, 0);
+
+	cache.remove_image(0);
+	EXPECT_EQ(cache.memory_used(), 0);
+}
+
+CCL_NAMESPACE_END
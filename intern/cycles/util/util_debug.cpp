@@ -30,7 +30,8 @@ DebugFlags::CPU::CPU()
     sse3(true),
     sse2(true),
     qbvh(true),
-    split_kernel(false)
+    split_kernel(false),
+    split_kernel_paths(1024)
 {
 	reset();
 }
@@ -57,6 +58,7 @@ void DebugFlags::CPU::reset()
 
 	qbvh = true;
 	split_kernel = false;
+	split_kernel_paths = 1024;
 }
 
 DebugFlags::CUDA::CUDA()
@@ -145,7 +147,8 @@ std::ostream& operator <<(std::ostream &os,
 	   << "  SSE3   : " << string_from_bool(debug_flags.cpu.sse3)  << "\n"
 	   << "  SSE2   : " << string_from_bool(debug_flags.cpu.sse2)  << "\n"
 	   << "  QBVH   : " << string_from_bool(debug_flags.cpu.qbvh)  << "\n"
-	   << "  Split  : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n";
+	   << "  Split  : " << string_from_bool(debug_flags.cpu.split_kernel) << "\n"
+	   << "  Paths  : " << debug_flags.cpu.split_kernel_paths << "\n";
 
 	os << "CUDA flags:\n"
 	   << " Adaptive Compile: " << string_from_bool(debug_flags.cuda.adaptive_compile) << "\n";
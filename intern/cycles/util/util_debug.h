@@ -52,6 +52,10 @@ public:
 
 		/* Whether split kernel is used */
 		bool split_kernel;
+
+		/* Number of paths traced together by the split kernel of each thread.
+		 * Rays of these paths are sorted by shader before shading. */
+		int split_kernel_paths;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "util/util_algorithm.h"
 #include "util/util_debug.h"
 #include "util/util_md5.h"
 #include "util/util_path.h"
@@ -987,5 +988,42 @@ void path_cache_clear_except(const string& name, const set<string>& except)
 
 }
 
+void path_cache_trim(const string& dir, const string& suffix, size_t max_size)
+{
+	if(!path_exists(dir)) {
+		return;
+	}
+
+	/* Modification time and path of the files. */
+	vector<pair<uint64_t, string> > files;
+	size_t total_size = 0;
+
+	directory_iterator it(dir), it_end;
+	for(; it != it_end; ++it) {
+		const string filepath = it->path();
+		if(!string_endswith(filepath, suffix.c_str())) {
+			continue;
+		}
+		const size_t size = path_file_size(filepath);
+		if(size != (size_t)-1) {
+			files.push_back(pair<uint64_t, string>(path_modified_time(filepath),
+			                                       filepath));
+			total_size += size;
+		}
+	}
+
+	if(total_size <= max_size) {
+		return;
+	}
+
+	sort(files.begin(), files.end());
+	for(size_t i = 0; i < files.size() && total_size > max_size; i++) {
+		const size_t size = path_file_size(files[i].second);
+		if(size != (size_t)-1 && path_remove(files[i].second)) {
+			total_size -= (size < total_size)? size: total_size;
+		}
+	}
+}
+
 CCL_NAMESPACE_END
 
@@ -72,6 +72,9 @@ string path_source_replace_includes(const string& source,
 
 /* cache utility */
 void path_cache_clear_except(const string& name, const set<string>& except);
+/* Remove the least recently modified files in dir whose name ends with
+ * suffix, until the total size of those files is at most max_size. */
+void path_cache_trim(const string& dir, const string& suffix, size_t max_size);
 
 CCL_NAMESPACE_END
 
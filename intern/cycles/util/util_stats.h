@@ -18,9 +18,58 @@
 #define __UTIL_STATS_H__
 
 #include "util/util_atomic.h"
+#include "util/util_string.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Statistics of the on-demand texture cache, see util_texture_cache.h. */
+
+class TextureCacheStats {
+public:
+	TextureCacheStats()
+	: hits(0), misses(0),
+	  tiles_loaded(0), tiles_generated(0), tiles_evicted(0),
+	  bytes_loaded(0) {}
+
+	void add_lookups(size_t num_hits, size_t num_misses) {
+		atomic_add_and_fetch_z(&hits, num_hits);
+		atomic_add_and_fetch_z(&misses, num_misses);
+	}
+
+	void tile_loaded(size_t size) {
+		atomic_add_and_fetch_z(&tiles_loaded, 1);
+		atomic_add_and_fetch_z(&bytes_loaded, size);
+	}
+
+	void tile_generated() {
+		atomic_add_and_fetch_z(&tiles_generated, 1);
+	}
+
+	void tile_evicted() {
+		atomic_add_and_fetch_z(&tiles_evicted, 1);
+	}
+
+	string full_report() const {
+		const size_t lookups = hits + misses;
+		const double hit_rate = (lookups > 0)? (double)hits / lookups: 0.0;
+		return string_printf("  Lookups: %zu (%.2f%% hits, %zu misses)\n"
+		                     "  Tiles read: %zu, %s\n"
+		                     "  Tiles generated from finer mip levels: %zu\n"
+		                     "  Tiles evicted: %zu",
+		                     lookups, hit_rate * 100.0, misses,
+		                     tiles_loaded, string_human_readable_size(bytes_loaded).c_str(),
+		                     tiles_generated,
+		                     tiles_evicted);
+	}
+
+	size_t hits;
+	size_t misses;
+	size_t tiles_loaded;
+	size_t tiles_generated;
+	size_t tiles_evicted;
+	size_t bytes_loaded;
+};
+
 class Stats {
 public:
 	enum static_init_t { static_init = 0 };
@@ -40,6 +89,8 @@ public:
 
 	size_t mem_used;
 	size_t mem_peak;
+
+	TextureCacheStats texture_cache;
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,602 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_texture_cache.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_aligned_malloc.h"
+#include "util/util_foreach.h"
+#include "util/util_half.h"
+#include "util/util_logging.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Pixel access helpers. */
+
+static size_t texture_cache_pixel_size(ImageDataType type)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4: return sizeof(float4);
+		case IMAGE_DATA_TYPE_BYTE4: return sizeof(uchar4);
+		case IMAGE_DATA_TYPE_HALF4: return sizeof(half4);
+		case IMAGE_DATA_TYPE_FLOAT: return sizeof(float);
+		case IMAGE_DATA_TYPE_BYTE: return sizeof(uchar);
+		case IMAGE_DATA_TYPE_HALF: return sizeof(half);
+		default: break;
+	}
+	assert(0);
+	return 0;
+}
+
+static ccl_always_inline float4 texture_cache_read(ImageDataType type,
+                                                   const void *pixels,
+                                                   size_t index)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+			return ((const float4*)pixels)[index];
+		case IMAGE_DATA_TYPE_BYTE4: {
+			const uchar4 r = ((const uchar4*)pixels)[index];
+			const float f = 1.0f/255.0f;
+			return make_float4(r.x*f, r.y*f, r.z*f, r.w*f);
+		}
+		case IMAGE_DATA_TYPE_HALF4:
+			return half4_to_float4(((const half4*)pixels)[index]);
+		case IMAGE_DATA_TYPE_FLOAT: {
+			const float f = ((const float*)pixels)[index];
+			return make_float4(f, f, f, 1.0f);
+		}
+		case IMAGE_DATA_TYPE_BYTE: {
+			const float f = ((const uchar*)pixels)[index]*(1.0f/255.0f);
+			return make_float4(f, f, f, 1.0f);
+		}
+		case IMAGE_DATA_TYPE_HALF: {
+			const float f = half_to_float(((const half*)pixels)[index]);
+			return make_float4(f, f, f, 1.0f);
+		}
+		default:
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+}
+
+static uchar texture_cache_float_to_byte(float f)
+{
+	return (uchar)(saturate(f)*255.0f + 0.5f);
+}
+
+static void texture_cache_write(ImageDataType type,
+                                void *pixels,
+                                size_t index,
+                                float4 f)
+{
+	switch(type) {
+		case IMAGE_DATA_TYPE_FLOAT4:
+			((float4*)pixels)[index] = f;
+			break;
+		case IMAGE_DATA_TYPE_BYTE4:
+			((uchar4*)pixels)[index] = make_uchar4(texture_cache_float_to_byte(f.x),
+			                                       texture_cache_float_to_byte(f.y),
+			                                       texture_cache_float_to_byte(f.z),
+			                                       texture_cache_float_to_byte(f.w));
+			break;
+		case IMAGE_DATA_TYPE_HALF4: {
+			half4 h;
+			h.x = float_to_half(f.x);
+			h.y = float_to_half(f.y);
+			h.z = float_to_half(f.z);
+			h.w = float_to_half(f.w);
+			((half4*)pixels)[index] = h;
+			break;
+		}
+		case IMAGE_DATA_TYPE_FLOAT:
+			((float*)pixels)[index] = f.x;
+			break;
+		case IMAGE_DATA_TYPE_BYTE:
+			((uchar*)pixels)[index] = texture_cache_float_to_byte(f.x);
+			break;
+		case IMAGE_DATA_TYPE_HALF:
+			((half*)pixels)[index] = float_to_half(f.x);
+			break;
+		default:
+			break;
+	}
+}
+
+static ccl_always_inline int texture_cache_wrap(int x, int width, ExtensionType extension)
+{
+	if(extension == EXTENSION_REPEAT) {
+		x %= width;
+		return (x < 0)? x + width: x;
+	}
+	return clamp(x, 0, width - 1);
+}
+
+static ccl_always_inline float texture_cache_frac(float x, int *ix)
+{
+	int i = float_to_int(x) - ((x < 0.0f)? 1: 0);
+	*ix = i;
+	return x - (float)i;
+}
+
+/* Texture Cache */
+
+TextureCache::TextureCache(Stats& stats)
+: stats_(stats),
+  memory_budget_(0),
+  memory_used_(0),
+  clock_(0)
+{
+}
+
+TextureCache::~TextureCache()
+{
+	for(size_t slot = 0; slot < images_.size(); slot++) {
+		remove_image(slot);
+	}
+}
+
+void TextureCache::set_memory_budget(size_t budget)
+{
+	thread_scoped_lock lock(resident_mutex_);
+	memory_budget_ = budget;
+	if(memory_budget_ > 0 && memory_used_ > memory_budget_) {
+		evict_tiles();
+	}
+}
+
+void TextureCache::add_image(int flat_slot,
+                             ImageDataType type,
+                             int width, int height,
+                             int tile_width, int tile_height,
+                             InterpolationType interpolation,
+                             ExtensionType extension,
+                             const LoadTileFunc& load_tile)
+{
+	assert(width > 0 && height > 0);
+	assert(tile_width > 0 && tile_height > 0);
+
+	remove_image(flat_slot);
+	if((size_t)flat_slot >= images_.size()) {
+		images_.resize(flat_slot + 1, NULL);
+	}
+
+	Image *image = new Image();
+	image->type = type;
+	image->pixel_size = texture_cache_pixel_size(type);
+	image->tile_width = tile_width;
+	image->tile_height = tile_height;
+	image->interpolation = interpolation;
+	image->extension = extension;
+	image->load_tile = load_tile;
+
+	/* Build the full mip chain with the level sizes of mipmapped image files,
+	 * tiles of all levels have the same size so a tile of a generated level
+	 * always covers at most 2x2 tiles of the level below it. */
+	int level_width = width, level_height = height;
+	while(true) {
+		Level level;
+		level.width = level_width;
+		level.height = level_height;
+		level.tiles_x = divide_up(level_width, tile_width);
+		level.tiles_y = divide_up(level_height, tile_height);
+		level.generate = false;
+		level.tiles.resize(level.tiles_x * level.tiles_y);
+		image->levels.push_back(level);
+
+		if(level_width == 1 && level_height == 1) {
+			break;
+		}
+		level_width = max(level_width / 2, 1);
+		level_height = max(level_height / 2, 1);
+	}
+
+	images_[flat_slot] = image;
+
+	VLOG(2) << "Texture cache: added image in slot " << flat_slot
+	        << " (" << width << "x" << height << ", "
+	        << image->levels.size() << " mip levels, "
+	        << tile_width << "x" << tile_height << " tiles).";
+}
+
+void TextureCache::remove_image(int flat_slot)
+{
+	if((size_t)flat_slot >= images_.size() || images_[flat_slot] == NULL) {
+		return;
+	}
+
+	Image *image = images_[flat_slot];
+	free_image_tiles(image);
+	delete image;
+	images_[flat_slot] = NULL;
+}
+
+bool TextureCache::has_image(int flat_slot) const
+{
+	return (size_t)flat_slot < images_.size() && images_[flat_slot] != NULL;
+}
+
+void TextureCache::free_image_tiles(Image *image)
+{
+	thread_scoped_lock lock(resident_mutex_);
+
+	size_t num_kept = 0;
+	for(size_t i = 0; i < resident_tiles_.size(); i++) {
+		ResidentTile& resident = resident_tiles_[i];
+		if(resident.image == image) {
+			assert(resident.tile->users == 0);
+			util_aligned_free(resident.tile->pixels);
+			resident.tile->pixels = NULL;
+			memory_used_ -= resident.size;
+		}
+		else {
+			resident_tiles_[num_kept++] = resident;
+		}
+	}
+	resident_tiles_.resize(num_kept);
+}
+
+void TextureCache::evict_tiles()
+{
+	/* Evict somewhat below the budget, so we don't end up sorting the
+	 * resident tiles on every single load. */
+	const size_t target = memory_budget_ - memory_budget_ / 8;
+
+	for(size_t i = 0; i < resident_tiles_.size(); i++) {
+		ResidentTile& resident = resident_tiles_[i];
+		thread_scoped_spin_lock lock(resident.image->tile_lock);
+		resident.last_used = resident.tile->last_used;
+	}
+	sort(resident_tiles_.begin(), resident_tiles_.end());
+
+	size_t num_kept = 0;
+	for(size_t i = 0; i < resident_tiles_.size(); i++) {
+		ResidentTile& resident = resident_tiles_[i];
+		void *pixels = NULL;
+
+		if(memory_used_ > target) {
+			thread_scoped_spin_lock lock(resident.image->tile_lock);
+			if(resident.tile->users == 0) {
+				pixels = resident.tile->pixels;
+				resident.tile->pixels = NULL;
+			}
+		}
+
+		if(pixels != NULL) {
+			util_aligned_free(pixels);
+			memory_used_ -= resident.size;
+			stats_.texture_cache.tile_evicted();
+		}
+		else {
+			resident_tiles_[num_kept++] = resident;
+		}
+	}
+	resident_tiles_.resize(num_kept);
+}
+
+TextureCache::Tile *TextureCache::acquire_tile(TextureCacheThreadStats *thread_stats,
+                                               Image *image,
+                                               int level,
+                                               int tile_x, int tile_y)
+{
+	Level& l = image->levels[level];
+	Tile *tile = &l.tiles[tile_y * l.tiles_x + tile_x];
+
+	{
+		thread_scoped_spin_lock lock(image->tile_lock);
+		if(tile->pixels != NULL) {
+			/* The clock only advances on loads, so this is an approximation
+			 * of LRU where lookups only read the clock. */
+			tile->users++;
+			tile->last_used = atomic_fetch_and_add_z(&clock_, 0);
+			if(thread_stats) {
+				thread_stats->hits++;
+			}
+			return tile;
+		}
+	}
+
+	if(thread_stats) {
+		thread_stats->misses++;
+	}
+
+	/* Load outside of the lock, other threads can keep reading resident
+	 * tiles of this image meanwhile. */
+	void *pixels = load_tile(image, level, tile_x, tile_y);
+	bool inserted = false;
+
+	{
+		thread_scoped_spin_lock lock(image->tile_lock);
+		if(tile->pixels == NULL) {
+			tile->pixels = pixels;
+			inserted = true;
+		}
+		tile->users++;
+		tile->last_used = atomic_add_and_fetch_z(&clock_, 1);
+	}
+
+	if(!inserted) {
+		/* Another thread loaded the same tile meanwhile. */
+		util_aligned_free(pixels);
+		return tile;
+	}
+
+	const int x = tile_x * image->tile_width;
+	const int y = tile_y * image->tile_height;
+	const size_t size = min(image->tile_width, l.width - x) *
+	                    min(image->tile_height, l.height - y) *
+	                    image->pixel_size;
+
+	thread_scoped_lock lock(resident_mutex_);
+	ResidentTile resident = {image, tile, size, 0};
+	resident_tiles_.push_back(resident);
+	memory_used_ += size;
+	if(memory_budget_ > 0 && memory_used_ > memory_budget_) {
+		evict_tiles();
+	}
+
+	return tile;
+}
+
+void TextureCache::release_tile(Image *image, Tile *tile)
+{
+	thread_scoped_spin_lock lock(image->tile_lock);
+	assert(tile->users > 0);
+	tile->users--;
+}
+
+void *TextureCache::load_tile(Image *image, int level, int tile_x, int tile_y)
+{
+	Level& l = image->levels[level];
+	const int x = tile_x * image->tile_width;
+	const int y = tile_y * image->tile_height;
+	const int width = min(image->tile_width, l.width - x);
+	const int height = min(image->tile_height, l.height - y);
+	const size_t size = width * height * image->pixel_size;
+	void *pixels = NULL;
+
+	bool loaded = false, generate;
+	{
+		/* The generate flag is shared by all threads loading tiles of this
+		 * level, so it is only accessed together with the loader. */
+		thread_scoped_lock lock(image->load_mutex);
+		if(!l.generate) {
+			pixels = util_aligned_malloc(size, 16);
+			loaded = image->load_tile(level, x, y, width, height, pixels);
+			if(!loaded && level > 0) {
+				/* Level is not stored in the file. */
+				util_aligned_free(pixels);
+				l.generate = true;
+			}
+		}
+		generate = l.generate;
+	}
+
+	if(generate) {
+		return generate_tile(image, level, tile_x, tile_y);
+	}
+
+	if(loaded) {
+		stats_.texture_cache.tile_loaded(size);
+		return pixels;
+	}
+
+	/* File became unreadable since it was added, use the same color as
+	 * images which failed to load up front. */
+	VLOG(1) << "Texture cache: failed to read tile, using missing texture color.";
+	const float4 missing = make_float4(TEX_IMAGE_MISSING_R,
+	                                   TEX_IMAGE_MISSING_G,
+	                                   TEX_IMAGE_MISSING_B,
+	                                   TEX_IMAGE_MISSING_A);
+	for(size_t i = 0; i < (size_t)(width * height); i++) {
+		texture_cache_write(image->type, pixels, i, missing);
+	}
+	return pixels;
+}
+
+void *TextureCache::generate_tile(Image *image, int level, int tile_x, int tile_y)
+{
+	assert(level > 0);
+
+	const Level& l = image->levels[level];
+	const Level& src = image->levels[level - 1];
+	const int tile_width = image->tile_width;
+	const int tile_height = image->tile_height;
+
+	const int x = tile_x * tile_width;
+	const int y = tile_y * tile_height;
+	const int width = min(tile_width, l.width - x);
+	const int height = min(tile_height, l.height - y);
+	void *pixels = util_aligned_malloc(width * height * image->pixel_size, 16);
+
+	/* Box filter over the 2x2 tiles of the level below covering this tile.
+	 * Lookups done for generating are not counted in the statistics. */
+	Tile *src_tiles[2][2] = {{NULL, NULL}, {NULL, NULL}};
+	int src_widths[2] = {0, 0};
+	for(int j = 0; j < 2; j++) {
+		for(int i = 0; i < 2; i++) {
+			const int src_tile_x = tile_x * 2 + i;
+			const int src_tile_y = tile_y * 2 + j;
+			if(src_tile_x < src.tiles_x && src_tile_y < src.tiles_y) {
+				src_tiles[j][i] = acquire_tile(NULL, image, level - 1, src_tile_x, src_tile_y);
+				src_widths[i] = min(tile_width, src.width - src_tile_x * tile_width);
+			}
+		}
+	}
+
+	for(int py = 0; py < height; py++) {
+		for(int px = 0; px < width; px++) {
+			float4 sum = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+			for(int j = 0; j < 2; j++) {
+				for(int i = 0; i < 2; i++) {
+					const int sx = min((x + px) * 2 + i, src.width - 1);
+					const int sy = min((y + py) * 2 + j, src.height - 1);
+					const int ti = sx / tile_width - tile_x * 2;
+					const int tj = sy / tile_height - tile_y * 2;
+					const size_t index = (sy % tile_height) * src_widths[ti] +
+					                     (sx % tile_width);
+					sum += texture_cache_read(image->type,
+					                          src_tiles[tj][ti]->pixels,
+					                          index);
+				}
+			}
+			texture_cache_write(image->type, pixels, py * width + px, sum * 0.25f);
+		}
+	}
+
+	for(int j = 0; j < 2; j++) {
+		for(int i = 0; i < 2; i++) {
+			if(src_tiles[j][i] != NULL) {
+				release_tile(image, src_tiles[j][i]);
+			}
+		}
+	}
+
+	stats_.texture_cache.tile_generated();
+	return pixels;
+}
+
+float4 TextureCache::fetch(TextureCacheThreadStats *thread_stats,
+                           Image *image,
+                           int level,
+                           int x, int y)
+{
+	const Level& l = image->levels[level];
+	const int tile_x = x / image->tile_width;
+	const int tile_y = y / image->tile_height;
+	const int width = min(image->tile_width, l.width - tile_x * image->tile_width);
+
+	Tile *tile = acquire_tile(thread_stats, image, level, tile_x, tile_y);
+	const size_t index = (y % image->tile_height) * width + (x % image->tile_width);
+	const float4 r = texture_cache_read(image->type, tile->pixels, index);
+	release_tile(image, tile);
+
+	return r;
+}
+
+float4 TextureCache::sample_level(TextureCacheThreadStats *thread_stats,
+                                  Image *image,
+                                  int level,
+                                  float x, float y)
+{
+	const Level& l = image->levels[level];
+	const int width = l.width;
+	const int height = l.height;
+	int ix, iy;
+
+	if(image->interpolation == INTERPOLATION_CLOSEST) {
+		texture_cache_frac(x*(float)width, &ix);
+		texture_cache_frac(y*(float)height, &iy);
+		ix = texture_cache_wrap(ix, width, image->extension);
+		iy = texture_cache_wrap(iy, height, image->extension);
+		return fetch(thread_stats, image, level, ix, iy);
+	}
+
+	/* Bilinear, cubic interpolation is not supported by the cache. */
+	const float tx = texture_cache_frac(x*(float)width - 0.5f, &ix);
+	const float ty = texture_cache_frac(y*(float)height - 0.5f, &iy);
+	const int nix = texture_cache_wrap(ix + 1, width, image->extension);
+	const int niy = texture_cache_wrap(iy + 1, height, image->extension);
+	ix = texture_cache_wrap(ix, width, image->extension);
+	iy = texture_cache_wrap(iy, height, image->extension);
+
+	const int tile_width = image->tile_width;
+	const int tile_height = image->tile_height;
+	float4 p00, p10, p01, p11;
+
+	if(ix / tile_width == nix / tile_width && iy / tile_height == niy / tile_height) {
+		/* Common case, all pixels are in the same tile. */
+		const int tile_x = ix / tile_width;
+		const int tile_y = iy / tile_height;
+		const int row = min(tile_width, width - tile_x * tile_width);
+		const int x0 = ix % tile_width, x1 = nix % tile_width;
+		const int y0 = iy % tile_height, y1 = niy % tile_height;
+
+		Tile *tile = acquire_tile(thread_stats, image, level, tile_x, tile_y);
+		p00 = texture_cache_read(image->type, tile->pixels, y0 * row + x0);
+		p10 = texture_cache_read(image->type, tile->pixels, y0 * row + x1);
+		p01 = texture_cache_read(image->type, tile->pixels, y1 * row + x0);
+		p11 = texture_cache_read(image->type, tile->pixels, y1 * row + x1);
+		release_tile(image, tile);
+	}
+	else {
+		p00 = fetch(thread_stats, image, level, ix, iy);
+		p10 = fetch(thread_stats, image, level, nix, iy);
+		p01 = fetch(thread_stats, image, level, ix, niy);
+		p11 = fetch(thread_stats, image, level, nix, niy);
+	}
+
+	return (1.0f - ty)*((1.0f - tx)*p00 + tx*p10) +
+	       ty*((1.0f - tx)*p01 + tx*p11);
+}
+
+bool TextureCache::lookup(TextureCacheThreadStats *thread_stats,
+                          int flat_slot,
+                          float x, float y,
+                          float filter_width,
+                          float4 *result)
+{
+	if(flat_slot < 0 || (size_t)flat_slot >= images_.size() || images_[flat_slot] == NULL) {
+		return false;
+	}
+
+	Image *image = images_[flat_slot];
+
+	/* Tiles are stored top to bottom. */
+	y = 1.0f - y;
+
+	if(image->extension == EXTENSION_CLIP) {
+		if(x < 0.0f || y < 0.0f || x > 1.0f || y > 1.0f) {
+			*result = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+			return true;
+		}
+	}
+
+	/* Select mip levels from the filter footprint in pixels of level 0,
+	 * closest interpolation always uses full resolution. */
+	const int num_levels = image->levels.size();
+	float lod = 0.0f;
+	if(image->interpolation != INTERPOLATION_CLOSEST && filter_width > 0.0f) {
+		const Level& base = image->levels[0];
+		lod = log2f(filter_width * (float)max(base.width, base.height));
+		lod = (lod > 0.0f)? min(lod, (float)(num_levels - 1)): 0.0f;
+	}
+
+	const int level = (int)lod;
+	const float t = lod - (float)level;
+
+	float4 r = sample_level(thread_stats, image, level, x, y);
+	if(t > 0.0f && level + 1 < num_levels) {
+		/* Trilinear filtering between mip levels. */
+		r = (1.0f - t)*r + t*sample_level(thread_stats, image, level + 1, x, y);
+	}
+
+	*result = r;
+	return true;
+}
+
+void TextureCache::flush_thread_stats(TextureCacheThreadStats *thread_stats)
+{
+	if(thread_stats->hits == 0 && thread_stats->misses == 0) {
+		return;
+	}
+
+	stats_.texture_cache.add_lookups(thread_stats->hits, thread_stats->misses);
+	thread_stats->hits = 0;
+	thread_stats->misses = 0;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+#include "util/util_function.h"
+#include "util/util_stats.h"
+#include "util/util_texture.h"
+#include "util/util_thread.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Texture Cache
+ *
+ * On-demand storage of image textures for CPU rendering. Every mip level of
+ * an image is split into tiles, which are only loaded on first lookup. Once
+ * the memory budget is exceeded the least recently used tiles are evicted,
+ * and loaded again if they are needed later on.
+ *
+ * Level sizes are max(1, size >> level). Only level 0 has to be provided by
+ * the loader, coarser mip levels which are not stored in the file are
+ * generated from the level below. */
+
+/* Lookup counters are accumulated per render thread to avoid contention,
+ * and flushed into the device statistics once the thread is done. */
+struct TextureCacheThreadStats {
+	TextureCacheThreadStats() : hits(0), misses(0) {}
+
+	size_t hits;
+	size_t misses;
+};
+
+class TextureCache {
+public:
+	/* Read a region of a mip level into pixels, stored in the image data
+	 * type. Regions and rows are top to bottom as in image files, so tiled
+	 * files can be read tile by tile. Returning false for level 0 means the
+	 * image could not be read, for other levels the cache will fall back to
+	 * generating the level. */
+	typedef function<bool(int level,
+	                      int x, int y,
+	                      int width, int height,
+	                      void *pixels)> LoadTileFunc;
+
+	explicit TextureCache(Stats& stats);
+	~TextureCache();
+
+	void set_memory_budget(size_t budget);
+	size_t memory_budget() const { return memory_budget_; }
+	size_t memory_used() const { return memory_used_; }
+
+	/* Images are indexed by their flattened slot, same as the kernel
+	 * texture info. Not thread safe with respect to lookups. */
+	void add_image(int flat_slot,
+	               ImageDataType type,
+	               int width, int height,
+	               int tile_width, int tile_height,
+	               InterpolationType interpolation,
+	               ExtensionType extension,
+	               const LoadTileFunc& load_tile);
+	void remove_image(int flat_slot);
+	bool has_image(int flat_slot) const;
+
+	/* Filtered lookup at normalized coordinates, with y pointing up same as
+	 * regular image textures. The filter width is the footprint of the lookup
+	 * in normalized coordinates, and is used to select mip levels. Returns
+	 * false if the slot is not in the cache. */
+	bool lookup(TextureCacheThreadStats *thread_stats,
+	            int flat_slot,
+	            float x, float y,
+	            float filter_width,
+	            float4 *result);
+
+	void flush_thread_stats(TextureCacheThreadStats *thread_stats);
+
+protected:
+	struct Tile {
+		Tile() : pixels(NULL), users(0), last_used(0) {}
+
+		/* NULL when the tile is not resident. */
+		void *pixels;
+		/* Number of lookups currently reading from the tile, tiles which
+		 * are in use are never evicted. */
+		int users;
+		/* Value of the cache clock at the last lookup. */
+		size_t last_used;
+	};
+
+	struct Level {
+		int width, height;
+		int tiles_x, tiles_y;
+		/* Set once the loader failed to provide this level, guarded by the
+		 * load_mutex of the image. */
+		bool generate;
+		vector<Tile> tiles;
+	};
+
+	struct Image {
+		ImageDataType type;
+		size_t pixel_size;
+		int tile_width, tile_height;
+		InterpolationType interpolation;
+		ExtensionType extension;
+		LoadTileFunc load_tile;
+		vector<Level> levels;
+
+		/* Guards tile pixel pointers and users. */
+		thread_spin_lock tile_lock;
+		/* Loaders are not required to be thread safe. */
+		thread_mutex load_mutex;
+	};
+
+	struct ResidentTile {
+		Image *image;
+		Tile *tile;
+		size_t size;
+		/* Copy of the tile's last_used for sorting, which is done without
+		 * holding the tile locks. */
+		size_t last_used;
+
+		bool operator<(const ResidentTile& other) const {
+			return last_used < other.last_used;
+		}
+	};
+
+	Tile *acquire_tile(TextureCacheThreadStats *thread_stats,
+	                   Image *image,
+	                   int level,
+	                   int tile_x, int tile_y);
+	void release_tile(Image *image, Tile *tile);
+
+	void *load_tile(Image *image, int level, int tile_x, int tile_y);
+	void *generate_tile(Image *image, int level, int tile_x, int tile_y);
+	void evict_tiles();
+	void free_image_tiles(Image *image);
+
+	float4 fetch(TextureCacheThreadStats *thread_stats,
+	             Image *image,
+	             int level,
+	             int x, int y);
+	float4 sample_level(TextureCacheThreadStats *thread_stats,
+	                    Image *image,
+	                    int level,
+	                    float x, float y);
+
+	Stats& stats_;
+	vector<Image*> images_;
+
+	size_t memory_budget_;
+	size_t memory_used_;
+	size_t clock_;
+
+	/* Guards the resident tiles list. */
+	thread_mutex resident_mutex_;
+	vector<ResidentTile> resident_tiles_;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_CACHE_H__ */
@@ -427,6 +427,11 @@ class NODE_PT_quality(bpy.types.Panel):
         col.prop(tree, "use_opencl")
         col.prop(tree, "use_groupnode_buffer")
         col.prop(tree, "use_two_pass")
+        col.prop(tree, "use_row_execution")
+        col.prop(tree, "use_result_cache")
+        sub = col.column()
+        sub.active = tree.use_result_cache
+        sub.prop(tree, "result_cache_limit")
         col.prop(tree, "use_viewer_border")
 
 
@@ -48,7 +48,7 @@ bool BKE_blendfile_read_from_memory(
         struct bContext *C, const void *filebuf, int filelength,
         struct ReportList *reports, int skip_flag, bool update_defaults);
 bool BKE_blendfile_read_from_memfile(
-        struct bContext *C, struct MemFile *memfile,
+        struct bContext *C, struct MemFile *memfile, struct MemFile *memfile_main,
         struct ReportList *reports, int skip_flag);
 void BKE_blendfile_read_make_empty(struct bContext *C);
 
@@ -128,10 +128,15 @@ enum {
 	G_DEBUG_DEPSGRAPH_NO_THREADS = (1 << 11),  /* single threaded depsgraph */
 	G_DEBUG_GPU =        (1 << 12), /* gpu debug */
 	G_DEBUG_IO = (1 << 13),   /* IO Debugging (for Collada, ...)*/
+	G_DEBUG_COMPOSITOR = (1 << 14), /* compositor time and memory profiling */
+	G_DEBUG_DEPSGRAPH_PROFILE = (1 << 15), /* depsgraph evaluation time profiling */
+	G_DEBUG_DEPSGRAPH_VALIDATE = (1 << 16), /* compare incremental depsgraph updates with a full rebuild */
 };
 
 #define G_DEBUG_ALL  (G_DEBUG | G_DEBUG_FFMPEG | G_DEBUG_PYTHON | G_DEBUG_EVENTS | G_DEBUG_WM | G_DEBUG_JOBS | \
-                      G_DEBUG_FREESTYLE | G_DEBUG_DEPSGRAPH | G_DEBUG_GPU_MEM | G_DEBUG_IO)
+                      G_DEBUG_FREESTYLE | G_DEBUG_DEPSGRAPH | G_DEBUG_GPU_MEM | G_DEBUG_IO | \
+                      G_DEBUG_COMPOSITOR | G_DEBUG_DEPSGRAPH_PROFILE | \
+                      G_DEBUG_DEPSGRAPH_VALIDATE)
 
 
 /* G.fileflags */
@@ -214,6 +214,11 @@ int  BKE_image_user_frame_get(const struct ImageUser *iuser, int cfra, int field
 void BKE_image_user_file_path(struct ImageUser *iuser, struct Image *ima, char *path); 
 void BKE_image_update_frame(const struct Main *bmain, int cfra);
 
+/* decode files of image sequences ahead of time, while processing another frame */
+struct ImagePrefetch *BKE_image_prefetch_add(struct Image *ima, const struct ImageUser *iuser, int cfra);
+void BKE_image_prefetch_load(struct ImagePrefetch *prefetch);
+void BKE_image_prefetch_free(void);
+
 /* sets index offset for multilayer files */
 struct RenderPass *BKE_image_multilayer_index(struct RenderResult *rr, struct ImageUser *iuser);
 
@@ -102,6 +102,7 @@ typedef struct SeqRenderData {
 	float motion_blur_shutter;
 	bool skip_cache;
 	bool is_proxy_render;
+	bool is_prefetch_render;
 	int view_id;
 
 	/* special case for OpenGL render */
@@ -187,10 +188,27 @@ struct SeqEffectHandle {
  * ********************************************************************** */
 
 struct ImBuf *BKE_sequencer_give_ibuf(const SeqRenderData *context, float cfra, int chanshown);
-struct ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown);
+struct ImBuf *BKE_sequencer_give_ibuf_cached(const SeqRenderData *context, float cfra, int chanshown);
 struct ImBuf *BKE_sequencer_give_ibuf_direct(const SeqRenderData *context, float cfra, struct Sequence *seq);
 struct ImBuf *BKE_sequencer_give_ibuf_seqbase(const SeqRenderData *context, float cfra, int chan_shown, struct ListBase *seqbasep);
-void BKE_sequencer_give_ibuf_prefetch_request(const SeqRenderData *context, float cfra, int chan_shown);
+
+/* **********************************************************************
+ * seqprefetch.c
+ *
+ * Rendering of frames ahead of the playhead during playback
+ * ********************************************************************** */
+
+/* for playback: returns the frame like BKE_sequencer_give_ibuf, and renders the
+ * frames after it in the background */
+struct ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown);
+
+void BKE_sequencer_prefetch_start(const SeqRenderData *context, float cfra, int chanshown);
+/* waits for the frame being rendered, needed before strips are changed or freed */
+void BKE_sequencer_prefetch_stop(void);
+/* held while rendering a frame, for renders that can run next to the prefetching */
+void BKE_sequencer_prefetch_render_lock(void);
+void BKE_sequencer_prefetch_render_unlock(void);
+void BKE_sequencer_prefetch_cache_put(const struct ImBuf *ibuf);
 
 /* **********************************************************************
  * sequencer.c
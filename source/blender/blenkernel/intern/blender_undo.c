@@ -40,7 +40,10 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "DNA_material_types.h"
+#include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_world_types.h"
 
 #include "BLI_fileops.h"
 #include "BLI_listbase.h"
@@ -59,7 +62,12 @@
 #include "BKE_depsgraph.h"
 #include "BKE_global.h"
 #include "BKE_image.h"
+#include "BKE_library.h"
+#include "BKE_library_query.h"
 #include "BKE_main.h"
+#include "BKE_object.h"
+#include "GPU_material.h"
+
 #include "RE_pipeline.h"
 
 #include "BLO_undofile.h"
@@ -78,7 +86,6 @@ typedef struct UndoElem {
 	char str[FILE_MAX];
 	char name[BKE_UNDO_STR_MAX];
 	MemFile memfile;
-	uintptr_t undosize;
 } UndoElem;
 
 static ListBase undobase = {NULL, NULL};
@@ -94,10 +101,119 @@ void BKE_undo_callback_wm_kill_jobs_set(void (*callback)(struct bContext *C))
 	undo_wm_job_kill_callback = callback;
 }
 
+/**
+ * Only the current step and its neighbors are likely to be read or compared against soon,
+ * data only used by other steps is compressed in the background.
+ */
+static void undo_memfiles_compress_cold(void)
+{
+	UndoElem *uel;
+
+	if (UNDO_DISK) {
+		return;
+	}
+
+	for (uel = undobase.first; uel; uel = uel->next) {
+		const bool is_hot = (curundo && ELEM(uel, curundo, curundo->prev, curundo->next));
+		BLO_memfile_set_cold(&uel->memfile, !is_hot);
+	}
+
+	BLO_memfile_compress_cold();
+}
+
+/**
+ * Data-blocks kept from the previous state still have their evaluated data,
+ * only the data-blocks that were read again need to be updated.
+ *
+ * \return false when the scene needs a full update.
+ */
+static int undo_find_read_id_cb(void *user_data, ID *UNUSED(id_self), ID **id_pointer, int UNUSED(cb_flag))
+{
+	ID *id = *id_pointer;
+
+	if (id && !(id->tag & LIB_TAG_UNDO_OLD_ID_REUSED)) {
+		*((bool *)user_data) = true;
+		return IDWALK_RET_STOP_ITER;
+	}
+
+	return IDWALK_RET_NOP;
+}
+
+/* free runtime data of a kept ID that refers to data that was read again */
+static void undo_free_reused_id_caches(Main *bmain, ID *id)
+{
+	switch (GS(id->name)) {
+		case ID_MA:
+			/* GPU materials are looked up by scene, which is always read again */
+			GPU_material_free(&((Material *)id)->gpumaterial);
+			break;
+		case ID_WO:
+			GPU_material_free(&((World *)id)->gpumaterial);
+			break;
+		case ID_OB:
+		{
+			Object *ob = (Object *)id;
+			bool uses_read_id = false;
+
+			/* GPU lamps store the scene and the lamp data */
+			GPU_lamp_free(ob);
+
+			/* derived data is built from the object data and the IDs used by modifiers */
+			BKE_library_foreach_ID_link(bmain, id, undo_find_read_id_cb, &uses_read_id, IDWALK_READONLY);
+			if (uses_read_id) {
+				BKE_object_free_derived_caches(ob);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+static bool undo_update_read_ids(Main *bmain)
+{
+	ListBase *lbarray[MAX_LIBARRAY];
+	ID *id;
+	int a;
+	bool is_partial = false;
+
+	a = set_listbasepointers(bmain, lbarray);
+	while (a--) {
+		for (id = lbarray[a]->first; id; id = id->next) {
+			if (id->tag & LIB_TAG_UNDO_OLD_ID_REUSED) {
+				undo_free_reused_id_caches(bmain, id);
+			}
+		}
+	}
+
+	a = set_listbasepointers(bmain, lbarray);
+	while (a--) {
+		for (id = lbarray[a]->first; id; id = id->next) {
+			if (id->tag & LIB_TAG_UNDO_OLD_ID_REUSED) {
+				id->tag &= ~LIB_TAG_UNDO_OLD_ID_REUSED;
+				is_partial = true;
+			}
+			else if (id->lib == NULL && !ELEM(GS(id->name), ID_WM, ID_SCR)) {
+				DAG_id_tag_update_ex(bmain, id, (GS(id->name) == ID_OB) ? OB_RECALC_ALL : 0);
+			}
+		}
+	}
+
+	if (is_partial) {
+		DAG_relations_tag_update(bmain);
+	}
+
+	return is_partial;
+}
+
 static int read_undosave(bContext *C, UndoElem *uel)
 {
 	char mainstr[sizeof(G.main->name)];
 	int success = 0, fileflags;
+	Scene *scene = CTX_data_scene(C);
+	const int cfra = scene->r.cfra;
+	const unsigned int lay = scene->lay;
+	bool is_partial = false;
 
 	/* This is needed so undoing/redoing doesn't crash with threaded previews going */
 	undo_wm_job_kill_callback(C);
@@ -107,18 +223,30 @@ static int read_undosave(bContext *C, UndoElem *uel)
 	fileflags = G.fileflags;
 	G.fileflags |= G_FILE_NO_UI;
 
-	if (UNDO_DISK)
+	if (UNDO_DISK) {
 		success = (BKE_blendfile_read(C, uel->str, NULL, 0) != BKE_BLENDFILE_READ_FAIL);
-	else
-		success = BKE_blendfile_read_from_memfile(C, &uel->memfile, NULL, 0);
+	}
+	else {
+		/* the current state, data-blocks that are unchanged in the step are not read again */
+		MemFile mainfile = {{NULL}};
+
+		BLO_write_file_mem(CTX_data_main(C), &uel->memfile, &mainfile, G.fileflags);
+		success = BKE_blendfile_read_from_memfile(C, &uel->memfile, &mainfile, NULL, 0);
+		BLO_memfile_free(&mainfile);
+	}
 
 	/* restore */
 	BLI_strncpy(G.main->name, mainstr, sizeof(G.main->name)); /* restore */
 	G.fileflags = fileflags;
 
 	if (success) {
-		/* important not to update time here, else non keyed tranforms are lost */
-		DAG_on_visible_update(G.main, false);
+		scene = CTX_data_scene(C);
+		is_partial = undo_update_read_ids(G.main) && scene->r.cfra == cfra && scene->lay == lay;
+
+		if (!is_partial) {
+			/* important not to update time here, else non keyed tranforms are lost */
+			DAG_on_visible_update(G.main, false);
+		}
 	}
 
 	return success;
@@ -127,7 +255,7 @@ static int read_undosave(bContext *C, UndoElem *uel)
 /* name can be a dynamic string */
 void BKE_undo_write(bContext *C, const char *name)
 {
-	uintptr_t maxmem, totmem, memused;
+	uintptr_t maxmem;
 	int nr /*, success */ /* UNUSED */;
 	UndoElem *uel;
 
@@ -164,8 +292,7 @@ void BKE_undo_write(bContext *C, const char *name)
 		while (undobase.first != uel) {
 			UndoElem *first = undobase.first;
 			BLI_remlink(&undobase, first);
-			/* the merge is because of compression */
-			BLO_memfile_merge(&first->memfile, &first->next->memfile);
+			BLO_memfile_free(&first->memfile);
 			MEM_freeN(first);
 		}
 	}
@@ -194,33 +321,25 @@ void BKE_undo_write(bContext *C, const char *name)
 
 		if (curundo->prev) prevfile = &(curundo->prev->memfile);
 
-		memused = MEM_get_memory_in_use();
 		/* success = */ /* UNUSED */ BLO_write_file_mem(CTX_data_main(C), prevfile, &curundo->memfile, G.fileflags);
-		curundo->undosize = MEM_get_memory_in_use() - memused;
+
+		undo_memfiles_compress_cold();
 	}
 
-	if (U.undomemory != 0) {
+	if (U.undomemory != 0 && !UNDO_DISK) {
 		/* limit to maximum memory (afterwards, we can't know in advance) */
-		totmem = 0;
 		maxmem = ((uintptr_t)U.undomemory) * 1024 * 1024;
 
-		/* keep at least two (original + other) */
-		uel = undobase.last;
-		while (uel && uel->prev) {
-			totmem += uel->undosize;
-			if (totmem > maxmem) break;
-			uel = uel->prev;
-		}
-
-		if (uel) {
-			if (uel->prev && uel->prev->prev)
-				uel = uel->prev;
+		if (BLO_memfile_mem_in_use() > maxmem) {
+			/* data of cold steps may fit once compressed */
+			BLO_memfile_compress_wait();
 
-			while (undobase.first != uel) {
+			/* keep at least two (original + other), data shared with the steps that are
+			 * kept is only freed with them */
+			while (BLO_memfile_mem_in_use() > maxmem && curundo->prev && undobase.first != curundo->prev) {
 				UndoElem *first = undobase.first;
 				BLI_remlink(&undobase, first);
-				/* the merge is because of compression */
-				BLO_memfile_merge(&first->memfile, &first->next->memfile);
+				BLO_memfile_free(&first->memfile);
 				MEM_freeN(first);
 			}
 		}
@@ -257,6 +376,8 @@ void BKE_undo_step(bContext *C, int step)
 			if (G.debug & G_DEBUG) printf("redo %s\n", curundo->name);
 		}
 	}
+
+	undo_memfiles_compress_cold();
 }
 
 void BKE_undo_reset(void)
@@ -370,7 +491,7 @@ bool BKE_undo_save_file(const char *filename)
 	}
 
 	for (chunk = uel->memfile.chunks.first; chunk; chunk = chunk->next) {
-		if (write(file, chunk->buf, chunk->size) != chunk->size) {
+		if (write(file, BLO_memfile_chunk_data(chunk), chunk->size) != chunk->size) {
 			break;
 		}
 	}
@@ -389,7 +510,7 @@ bool BKE_undo_save_file(const char *filename)
 Main *BKE_undo_get_main(Scene **r_scene)
 {
 	Main *mainp = NULL;
-	BlendFileData *bfd = BLO_read_from_memfile(G.main, G.main->name, &curundo->memfile, NULL, BLO_READ_SKIP_NONE);
+	BlendFileData *bfd = BLO_read_from_memfile(G.main, G.main->name, &curundo->memfile, NULL, NULL, BLO_READ_SKIP_NONE);
 
 	if (bfd) {
 		mainp = bfd->main;
@@ -401,14 +401,18 @@ bool BKE_blendfile_read_from_memory(
 	return (bfd != NULL);
 }
 
-/* memfile is the undo buffer */
+/**
+ * \param memfile: The undo buffer.
+ * \param memfile_main: Optional undo buffer written from the current main, the data-blocks
+ * that are identical in both are kept instead of being read again.
+ */
 bool BKE_blendfile_read_from_memfile(
-        bContext *C, struct MemFile *memfile,
+        bContext *C, struct MemFile *memfile, struct MemFile *memfile_main,
         ReportList *reports, int skip_flags)
 {
 	BlendFileData *bfd;
 
-	bfd = BLO_read_from_memfile(CTX_data_main(C), G.main->name, memfile, reports, skip_flags);
+	bfd = BLO_read_from_memfile(CTX_data_main(C), G.main->name, memfile, memfile_main, reports, skip_flags);
 	if (bfd) {
 		/* remove the unused screens and wm */
 		while (bfd->main->wm.first)
@@ -100,9 +100,24 @@
 
 static SpinLock image_spin;
 
+/* files of image sequences decoded ahead of time, see BKE_image_prefetch_add */
+typedef struct ImagePrefetch {
+	struct ImagePrefetch *next, *prev;
+	char name[FILE_MAX];
+	char colorspace[64];
+	char colorspace_loaded[64];
+	int flag;
+	struct ImBuf *ibuf;
+	bool loaded;
+} ImagePrefetch;
+
+static ListBase image_prefetch = {NULL, NULL};
+static ThreadMutex image_prefetch_mutex = BLI_MUTEX_INITIALIZER;
+static ThreadCondition image_prefetch_cond;
+
 /* prototypes */
 static int image_num_files(struct Image *ima);
-static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock);
+static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock, ImagePrefetch *prefetch);
 static void image_update_views_format(Image *ima, ImageUser *iuser);
 static void image_add_view(Image *ima, const char *viewname, const char *filepath);
 
@@ -177,10 +192,13 @@ static struct ImBuf *imagecache_get(Image *image, int index)
 void BKE_images_init(void)
 {
 	BLI_spin_init(&image_spin);
+	BLI_condition_init(&image_prefetch_cond);
 }
 
 void BKE_images_exit(void)
 {
+	BKE_image_prefetch_free();
+	BLI_condition_end(&image_prefetch_cond);
 	BLI_spin_end(&image_spin);
 }
 
@@ -3134,7 +3152,150 @@ static int image_num_files(Image *ima)
 	}
 }
 
-static ImBuf *load_sequence_single(Image *ima, ImageUser *iuser, int frame, const int view_id, bool *r_assign)
+/* ******** Prefetching of image sequences ************* */
+
+/* Register the file of an image sequence for the given scene frame, to be decoded with
+ * BKE_image_prefetch_load while another frame is being processed. The file path is
+ * determined here, so only the decoding needs to run in another thread. Returns NULL when
+ * the image is not a sequence or the file is already registered. */
+ImagePrefetch *BKE_image_prefetch_add(Image *ima, const ImageUser *iuser, int cfra)
+{
+	ImagePrefetch *prefetch, *existing;
+	ImageUser iuser_t = *iuser;
+
+	/* multi-view sequences load multiple files per frame, which are not prefetched */
+	if (ima->source != IMA_SRC_SEQUENCE || BKE_image_is_multiview(ima)) {
+		return NULL;
+	}
+
+	prefetch = MEM_callocN(sizeof(ImagePrefetch), "ImagePrefetch");
+
+	BKE_image_user_frame_calc(&iuser_t, cfra, 0);
+	iuser_t.view = 0;
+	BKE_image_user_file_path(&iuser_t, ima, prefetch->name);
+
+	prefetch->flag = IB_rect | IB_multilayer | imbuf_alpha_flags_for_image(ima);
+	BLI_strncpy(prefetch->colorspace, ima->colorspace_settings.name, sizeof(prefetch->colorspace));
+
+	BLI_mutex_lock(&image_prefetch_mutex);
+	for (existing = image_prefetch.first; existing; existing = existing->next) {
+		if (STREQ(existing->name, prefetch->name) &&
+		    STREQ(existing->colorspace, prefetch->colorspace) &&
+		    existing->flag == prefetch->flag)
+		{
+			break;
+		}
+	}
+	if (existing) {
+		MEM_freeN(prefetch);
+		prefetch = NULL;
+	}
+	else {
+		BLI_addtail(&image_prefetch, prefetch);
+	}
+	BLI_mutex_unlock(&image_prefetch_mutex);
+
+	return prefetch;
+}
+
+/* Decode a registered file, thread safe. */
+void BKE_image_prefetch_load(ImagePrefetch *prefetch)
+{
+	char colorspace[64];
+	ImBuf *ibuf;
+
+	BLI_strncpy(colorspace, prefetch->colorspace, sizeof(colorspace));
+	ibuf = IMB_loadiffname(prefetch->name, prefetch->flag, colorspace);
+
+	BLI_mutex_lock(&image_prefetch_mutex);
+	prefetch->ibuf = ibuf;
+	BLI_strncpy(prefetch->colorspace_loaded, colorspace, sizeof(prefetch->colorspace_loaded));
+	prefetch->loaded = true;
+	BLI_condition_notify_all(&image_prefetch_cond);
+	BLI_mutex_unlock(&image_prefetch_mutex);
+}
+
+/* Free prefetched files that were not used, all of them must have been loaded. */
+void BKE_image_prefetch_free(void)
+{
+	ImagePrefetch *prefetch;
+
+	BLI_mutex_lock(&image_prefetch_mutex);
+	for (prefetch = image_prefetch.first; prefetch; prefetch = prefetch->next) {
+		BLI_assert(prefetch->loaded);
+		if (prefetch->ibuf) {
+			IMB_freeImBuf(prefetch->ibuf);
+		}
+	}
+	BLI_freelistN(&image_prefetch);
+	BLI_mutex_unlock(&image_prefetch_mutex);
+}
+
+/* Take the prefetched file of the frame shown by the image user, waiting for it when it is
+ * still being decoded. Called before the image spin lock is taken, the file is used by
+ * load_sequence_single when the frame is not cached, and freed with image_prefetch_release.
+ * Returns NULL when the file was not prefetched. */
+static ImagePrefetch *image_prefetch_take(Image *ima, ImageUser *iuser)
+{
+	ImagePrefetch *prefetch;
+	ImageUser iuser_t = {0};
+	char name[FILE_MAX];
+	int flag;
+	bool is_empty;
+
+	if (ima == NULL || ima->source != IMA_SRC_SEQUENCE || BKE_image_is_multiview(ima)) {
+		return NULL;
+	}
+
+	BLI_mutex_lock(&image_prefetch_mutex);
+	is_empty = BLI_listbase_is_empty(&image_prefetch);
+	BLI_mutex_unlock(&image_prefetch_mutex);
+
+	if (is_empty) {
+		return NULL;
+	}
+
+	/* same file as load_sequence_single loads */
+	if (iuser) {
+		iuser_t = *iuser;
+	}
+	iuser_t.view = 0;
+	BKE_image_user_file_path(&iuser_t, ima, name);
+	flag = IB_rect | IB_multilayer | imbuf_alpha_flags_for_image(ima);
+
+	BLI_mutex_lock(&image_prefetch_mutex);
+	for (prefetch = image_prefetch.first; prefetch; prefetch = prefetch->next) {
+		if (STREQ(prefetch->name, name) &&
+		    STREQ(prefetch->colorspace, ima->colorspace_settings.name) &&
+		    prefetch->flag == flag)
+		{
+			break;
+		}
+	}
+	if (prefetch) {
+		while (!prefetch->loaded) {
+			BLI_condition_wait(&image_prefetch_cond, &image_prefetch_mutex);
+		}
+		BLI_remlink(&image_prefetch, prefetch);
+	}
+	BLI_mutex_unlock(&image_prefetch_mutex);
+
+	return prefetch;
+}
+
+/* Free a taken prefetched file, along with its ImBuf when it was not used. */
+static void image_prefetch_release(ImagePrefetch *prefetch)
+{
+	if (prefetch) {
+		if (prefetch->ibuf) {
+			IMB_freeImBuf(prefetch->ibuf);
+		}
+		MEM_freeN(prefetch);
+	}
+}
+
+static ImBuf *load_sequence_single(Image *ima, ImageUser *iuser, int frame, const int view_id,
+                                   ImagePrefetch *prefetch, bool *r_assign)
 {
 	struct ImBuf *ibuf;
 	char name[FILE_MAX];
@@ -3160,8 +3321,18 @@ static ImBuf *load_sequence_single(Image *ima, ImageUser *iuser, int frame, cons
 	flag = IB_rect | IB_multilayer;
 	flag |= imbuf_alpha_flags_for_image(ima);
 
-	/* read ibuf */
-	ibuf = IMB_loadiffname(name, flag, ima->colorspace_settings.name);
+	/* read ibuf, unless it was decoded ahead of time */
+	if (prefetch && STREQ(prefetch->name, name) && prefetch->flag == flag) {
+		ibuf = prefetch->ibuf;
+		prefetch->ibuf = NULL;
+		if (ibuf) {
+			BLI_strncpy(ima->colorspace_settings.name, prefetch->colorspace_loaded,
+			            sizeof(ima->colorspace_settings.name));
+		}
+	}
+	else {
+		ibuf = IMB_loadiffname(name, flag, ima->colorspace_settings.name);
+	}
 
 #if 0
 	if (ibuf) {
@@ -3197,7 +3368,7 @@ static ImBuf *load_sequence_single(Image *ima, ImageUser *iuser, int frame, cons
 	return ibuf;
 }
 
-static ImBuf *image_load_sequence_file(Image *ima, ImageUser *iuser, int frame)
+static ImBuf *image_load_sequence_file(Image *ima, ImageUser *iuser, int frame, ImagePrefetch *prefetch)
 {
 	struct ImBuf *ibuf = NULL;
 	const bool is_multiview = BKE_image_is_multiview(ima);
@@ -3205,7 +3376,7 @@ static ImBuf *image_load_sequence_file(Image *ima, ImageUser *iuser, int frame)
 	bool assign = false;
 
 	if (!is_multiview) {
-		ibuf = load_sequence_single(ima, iuser, frame, 0, &assign);
+		ibuf = load_sequence_single(ima, iuser, frame, 0, prefetch, &assign);
 		if (assign) {
 			image_assign_ibuf(ima, ibuf, 0, frame);
 		}
@@ -3218,7 +3389,7 @@ static ImBuf *image_load_sequence_file(Image *ima, ImageUser *iuser, int frame)
 		ibuf_arr = MEM_mallocN(sizeof(ImBuf *) * totviews, "Image Views Imbufs");
 
 		for (i = 0; i < totfiles; i++)
-			ibuf_arr[i] = load_sequence_single(ima, iuser, frame, i, &assign);
+			ibuf_arr[i] = load_sequence_single(ima, iuser, frame, i, NULL, &assign);
 
 		if (BKE_image_is_stereo(ima) && ima->views_format == R_IMF_VIEWS_STEREO_3D)
 			IMB_ImBufFromStereo3d(ima->stereo3d_format, ibuf_arr[0], &ibuf_arr[0], &ibuf_arr[1]);
@@ -3246,7 +3417,7 @@ static ImBuf *image_load_sequence_file(Image *ima, ImageUser *iuser, int frame)
 	return ibuf;
 }
 
-static ImBuf *image_load_sequence_multilayer(Image *ima, ImageUser *iuser, int frame)
+static ImBuf *image_load_sequence_multilayer(Image *ima, ImageUser *iuser, int frame, ImagePrefetch *prefetch)
 {
 	struct ImBuf *ibuf = NULL;
 
@@ -3264,7 +3435,7 @@ static ImBuf *image_load_sequence_multilayer(Image *ima, ImageUser *iuser, int f
 			ima->rr = NULL;
 		}
 
-		ibuf = image_load_sequence_file(ima, iuser, frame);
+		ibuf = image_load_sequence_file(ima, iuser, frame, prefetch);
 
 		if (ibuf) { /* actually an error */
 			ima->type = IMA_TYPE_IMAGE;
@@ -3935,9 +4106,10 @@ BLI_INLINE bool image_quick_test(Image *ima, ImageUser *iuser)
 
 /* Checks optional ImageUser and verifies/creates ImBuf.
  *
- * not thread-safe, so callee should worry about thread locks
+ * not thread-safe, so callee should worry about thread locks,
+ * prefetch is the file taken with image_prefetch_take, or NULL
  */
-static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock)
+static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock, ImagePrefetch *prefetch)
 {
 	ImBuf *ibuf = NULL;
 	int frame = 0, index = 0;
@@ -3960,12 +4132,12 @@ static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock)
 		else if (ima->source == IMA_SRC_SEQUENCE) {
 			if (ima->type == IMA_TYPE_IMAGE) {
 				/* regular files, ibufs in flipbook, allows saving */
-				ibuf = image_load_sequence_file(ima, iuser, frame);
+				ibuf = image_load_sequence_file(ima, iuser, frame, prefetch);
 			}
 			/* no else; on load the ima type can change */
 			if (ima->type == IMA_TYPE_MULTILAYER) {
 				/* only 1 layer/pass stored in imbufs, no exrhandle anim storage, no saving */
-				ibuf = image_load_sequence_multilayer(ima, iuser, frame);
+				ibuf = image_load_sequence_multilayer(ima, iuser, frame, prefetch);
 			}
 		}
 		else if (ima->source == IMA_SRC_FILE) {
@@ -4035,14 +4207,17 @@ static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock)
  */
 ImBuf *BKE_image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock)
 {
+	ImagePrefetch *prefetch = image_prefetch_take(ima, iuser);
 	ImBuf *ibuf;
 
 	BLI_spin_lock(&image_spin);
 
-	ibuf = image_acquire_ibuf(ima, iuser, r_lock);
+	ibuf = image_acquire_ibuf(ima, iuser, r_lock, prefetch);
 
 	BLI_spin_unlock(&image_spin);
 
+	image_prefetch_release(prefetch);
+
 	return ibuf;
 }
 
@@ -4080,7 +4255,7 @@ bool BKE_image_has_ibuf(Image *ima, ImageUser *iuser)
 	ibuf = image_get_cached_ibuf(ima, iuser, NULL, NULL);
 
 	if (!ibuf)
-		ibuf = image_acquire_ibuf(ima, iuser, NULL);
+		ibuf = image_acquire_ibuf(ima, iuser, NULL, NULL);
 
 	BLI_spin_unlock(&image_spin);
 
@@ -4148,6 +4323,7 @@ BLI_INLINE ImBuf *image_pool_find_entry(ImagePool *pool, Image *image, int frame
 
 ImBuf *BKE_image_pool_acquire_ibuf(Image *ima, ImageUser *iuser, ImagePool *pool)
 {
+	ImagePrefetch *prefetch;
 	ImBuf *ibuf;
 	int index, frame;
 	bool found;
@@ -4166,6 +4342,8 @@ ImBuf *BKE_image_pool_acquire_ibuf(Image *ima, ImageUser *iuser, ImagePool *pool
 	if (found)
 		return ibuf;
 
+	prefetch = image_prefetch_take(ima, iuser);
+
 	BLI_spin_lock(&image_spin);
 
 	ibuf = image_pool_find_entry(pool, ima, frame, index, &found);
@@ -4176,7 +4354,7 @@ ImBuf *BKE_image_pool_acquire_ibuf(Image *ima, ImageUser *iuser, ImagePool *pool
 	if (!found) {
 		ImagePoolEntry *entry;
 
-		ibuf = image_acquire_ibuf(ima, iuser, NULL);
+		ibuf = image_acquire_ibuf(ima, iuser, NULL, prefetch);
 
 		entry = BLI_mempool_alloc(pool->memory_pool);
 		entry->image = ima;
@@ -4189,6 +4367,8 @@ ImBuf *BKE_image_pool_acquire_ibuf(Image *ima, ImageUser *iuser, ImagePool *pool
 
 	BLI_spin_unlock(&image_spin);
 
+	image_prefetch_release(prefetch);
+
 	return ibuf;
 }
 
@@ -40,6 +40,7 @@
 #include "IMB_imbuf_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_threads.h"
 
 #include "BKE_sequencer.h"
 #include "BKE_scene.h"
@@ -67,6 +68,8 @@ typedef struct SeqPreprocessCache {
 } SeqPreprocessCache;
 
 static struct MovieCache *moviecache = NULL;
+/* the cache is filled by the prefetch task while the editor reads it */
+static ThreadMutex moviecache_lock = BLI_MUTEX_INITIALIZER;
 static struct SeqPreprocessCache *preprocess_cache = NULL;
 
 static void preprocessed_cache_destruct(void);
@@ -123,6 +126,8 @@ static bool seqcache_hashcmp(const void *a_, const void *b_)
 
 void BKE_sequencer_cache_destruct(void)
 {
+	BKE_sequencer_prefetch_stop();
+
 	if (moviecache)
 		IMB_moviecache_free(moviecache);
 
@@ -131,6 +136,8 @@ void BKE_sequencer_cache_destruct(void)
 
 void BKE_sequencer_cache_cleanup(void)
 {
+	BKE_sequencer_prefetch_stop();
+
 	if (moviecache) {
 		IMB_moviecache_free(moviecache);
 		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
@@ -149,6 +156,8 @@ static bool seqcache_key_check_seq(ImBuf *UNUSED(ibuf), void *userkey, void *use
 
 void BKE_sequencer_cache_cleanup_sequence(Sequence *seq)
 {
+	BKE_sequencer_prefetch_stop();
+
 	if (moviecache)
 		IMB_moviecache_cleanup(moviecache, seqcache_key_check_seq, seq);
 }
@@ -157,13 +166,18 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *se
 {
 	if (moviecache && seq) {
 		SeqCacheKey key;
+		ImBuf *ibuf;
 
 		key.seq = seq;
 		key.context = *context;
 		key.cfra = cfra - seq->start;
 		key.type = type;
 
-		return IMB_moviecache_get(moviecache, &key);
+		BLI_mutex_lock(&moviecache_lock);
+		ibuf = IMB_moviecache_get(moviecache, &key);
+		BLI_mutex_unlock(&moviecache_lock);
+
+		return ibuf;
 	}
 
 	return NULL;
@@ -177,16 +191,24 @@ void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float
 		return;
 	}
 
-	if (!moviecache) {
-		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
-	}
-
 	key.seq = seq;
 	key.context = *context;
 	key.cfra = cfra - seq->start;
 	key.type = type;
 
+	BLI_mutex_lock(&moviecache_lock);
+
+	if (!moviecache) {
+		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
+	}
+
 	IMB_moviecache_put(moviecache, &key, i);
+
+	BLI_mutex_unlock(&moviecache_lock);
+
+	if (context->is_prefetch_render) {
+		BKE_sequencer_prefetch_cache_put(i);
+	}
 }
 
 void BKE_sequencer_preprocessed_cache_cleanup(void)
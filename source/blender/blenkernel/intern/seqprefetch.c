@@ -0,0 +1,355 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenkernel/intern/seqprefetch.c
+ *  \ingroup bke
+ *
+ * Rendering of the frames after the playhead into the sequencer cache during playback.
+ *
+ * A background task renders up to U.prefetchframes frames ahead of the frame shown by
+ * the editor, wrapping around the playback range like playback does, so that showing
+ * the next frame is a cache lookup. Frames ahead may use a share of the memory cache
+ * limit, so that they do not push each other out of the cache before they are shown.
+ *
+ * Renders of the prefetch task and of the editor are serialized, since strips keep
+ * their movie readers open between frames. Prefetching is stopped before the strips
+ * are changed or freed, see the cache invalidation functions.
+ */
+
+#include <stddef.h>
+
+#include "MEM_guardedalloc.h"
+#include "MEM_CacheLimiterC-Api.h"
+
+#include "DNA_anim_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_sequence_types.h"
+#include "DNA_userdef_types.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+#include "BKE_global.h"
+#include "BKE_sequencer.h"
+
+typedef struct SeqPrefetch {
+	TaskPool *pool;
+	ThreadCondition cond;
+	bool stop;
+
+	SeqRenderData context;
+	int chanshown;
+	int start_frame, end_frame;
+
+	int cfra;            /* frame shown by the editor */
+	int num_ahead;       /* number of frames after cfra that are rendered */
+	int max_ahead;
+
+	/* cache memory used by the frames ahead, frame_size is a ring of max_ahead sizes
+	 * starting at head for the frame after cfra */
+	size_t *frame_size;
+	int head;
+	size_t size_ahead;
+	size_t max_size;
+} SeqPrefetch;
+
+/* only started and stopped from the main thread */
+static SeqPrefetch *prefetch = NULL;
+
+/* protects the state of prefetch shared with the task */
+static ThreadMutex prefetch_mutex = BLI_MUTEX_INITIALIZER;
+
+/* held while rendering a frame, by the task or by the editor */
+static ThreadMutex render_mutex = BLI_MUTEX_INITIALIZER;
+static size_t render_cache_size = 0;
+
+static bool seq_prefetch_seqbase_is_supported(ListBase *seqbase)
+{
+	Sequence *seq;
+
+	for (seq = seqbase->first; seq; seq = seq->next) {
+		/* scene strips evaluate and render other scenes, which only works on the main thread */
+		if (seq->type == SEQ_TYPE_SCENE) {
+			return false;
+		}
+		if (seq->type == SEQ_TYPE_META && !seq_prefetch_seqbase_is_supported(&seq->seqbase)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Animated strip settings are evaluated for the frame shown, frames ahead would be rendered
+ * with wrong values. The effect fader is evaluated by the renderer itself. */
+static bool seq_prefetch_fcurves_animate_strips(ListBase *fcurves)
+{
+	FCurve *fcu;
+
+	for (fcu = fcurves->first; fcu; fcu = fcu->next) {
+		if (fcu->rna_path &&
+		    STRPREFIX(fcu->rna_path, "sequence_editor.") &&
+		    !BLI_str_endswith(fcu->rna_path, ".effect_fader"))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool seq_prefetch_is_supported(Scene *scene)
+{
+	Editing *ed = scene->ed;
+	AnimData *adt = scene->adt;
+
+	if (ed == NULL || !seq_prefetch_seqbase_is_supported(&ed->seqbase)) {
+		return false;
+	}
+
+	if (adt) {
+		if (!BLI_listbase_is_empty(&adt->nla_tracks) ||
+		    (adt->action && seq_prefetch_fcurves_animate_strips(&adt->action->curves)) ||
+		    seq_prefetch_fcurves_animate_strips(&adt->drivers))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* frame at offset frames after the frame shown */
+static int seq_prefetch_frame(const SeqPrefetch *pf, int offset)
+{
+	const int len = pf->end_frame - pf->start_frame + 1;
+	return pf->start_frame + mod_i(pf->cfra - pf->start_frame + offset, len);
+}
+
+static void seq_prefetch_task(TaskPool *__restrict pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	SeqPrefetch *pf = BLI_task_pool_userdata(pool);
+
+	BLI_mutex_lock(&prefetch_mutex);
+
+	while (!pf->stop) {
+		SeqRenderData context;
+		ImBuf *ibuf;
+		size_t size;
+		int frame;
+
+		if (pf->num_ahead >= pf->max_ahead || (pf->max_size && pf->size_ahead >= pf->max_size)) {
+			/* woken up when the playhead moves */
+			BLI_condition_wait(&pf->cond, &prefetch_mutex);
+			continue;
+		}
+
+		frame = seq_prefetch_frame(pf, pf->num_ahead + 1);
+		context = pf->context;
+		BLI_mutex_unlock(&prefetch_mutex);
+
+		BLI_mutex_lock(&render_mutex);
+		render_cache_size = 0;
+		ibuf = BKE_sequencer_give_ibuf(&context, frame, pf->chanshown);
+		size = render_cache_size;
+		BLI_mutex_unlock(&render_mutex);
+
+		if (ibuf) {
+			IMB_freeImBuf(ibuf);
+		}
+
+		BLI_mutex_lock(&prefetch_mutex);
+
+		/* the playhead may have moved past the frame in the meantime */
+		if (seq_prefetch_frame(pf, pf->num_ahead + 1) == frame) {
+			pf->frame_size[(pf->head + pf->num_ahead) % pf->max_ahead] = size;
+			pf->size_ahead += size;
+			pf->num_ahead++;
+		}
+	}
+
+	BLI_mutex_unlock(&prefetch_mutex);
+}
+
+static bool seq_prefetch_matches(const SeqPrefetch *pf, const SeqRenderData *context, int chanshown,
+                                 int max_ahead, size_t max_size)
+{
+	const Scene *scene = context->scene;
+
+	return (pf->context.bmain == context->bmain &&
+	        pf->context.scene == context->scene &&
+	        pf->context.rectx == context->rectx &&
+	        pf->context.recty == context->recty &&
+	        pf->context.preview_render_size == context->preview_render_size &&
+	        pf->context.view_id == context->view_id &&
+	        pf->chanshown == chanshown &&
+	        pf->start_frame == PSFRA &&
+	        pf->end_frame == PEFRA &&
+	        pf->max_ahead == max_ahead &&
+	        pf->max_size == max_size);
+}
+
+/* move the playhead to cfra, frames ahead that are passed are no longer counted */
+static void seq_prefetch_advance(SeqPrefetch *pf, int cfra)
+{
+	const int len = pf->end_frame - pf->start_frame + 1;
+	const int step = mod_i(cfra - pf->cfra, len);
+	int i;
+
+	if (step == 0) {
+		return;
+	}
+
+	if (step > pf->num_ahead) {
+		pf->num_ahead = 0;
+		pf->size_ahead = 0;
+	}
+	else {
+		for (i = 0; i < step; i++) {
+			pf->size_ahead -= pf->frame_size[(pf->head + i) % pf->max_ahead];
+		}
+		pf->head = (pf->head + step) % pf->max_ahead;
+		pf->num_ahead -= step;
+	}
+
+	pf->cfra = cfra;
+	BLI_condition_notify_one(&pf->cond);
+}
+
+void BKE_sequencer_prefetch_start(const SeqRenderData *context, float cfra, int chanshown)
+{
+	Scene *scene = context->scene;
+	const size_t limit = MEM_CacheLimiter_get_maximum();
+	size_t max_size;
+	int max_ahead;
+
+	BLI_assert(BLI_thread_is_main());
+
+	/* prefetching would compete with the render for the movie readers of the strips */
+	if (U.prefetchframes <= 0 || G.is_rendering || !seq_prefetch_is_supported(scene)) {
+		BKE_sequencer_prefetch_stop();
+		return;
+	}
+
+	max_ahead = min_ii(U.prefetchframes, PEFRA - PSFRA);
+	max_size = (MEM_CacheLimiter_is_disabled()) ? 0 : limit / 100 * CLAMPIS(U.seq_prefetch_share, 1, 100);
+
+	if (max_ahead <= 0) {
+		BKE_sequencer_prefetch_stop();
+		return;
+	}
+
+	if (prefetch && !seq_prefetch_matches(prefetch, context, chanshown, max_ahead, max_size)) {
+		BKE_sequencer_prefetch_stop();
+	}
+
+	if (prefetch) {
+		BLI_mutex_lock(&prefetch_mutex);
+		seq_prefetch_advance(prefetch, (int)cfra);
+		BLI_mutex_unlock(&prefetch_mutex);
+	}
+	else {
+		SeqPrefetch *pf = MEM_callocN(sizeof(SeqPrefetch), "sequencer prefetch");
+
+		pf->context = *context;
+		pf->context.is_prefetch_render = true;
+		pf->chanshown = chanshown;
+		pf->start_frame = PSFRA;
+		pf->end_frame = PEFRA;
+		pf->cfra = (int)cfra;
+		pf->max_ahead = max_ahead;
+		pf->max_size = max_size;
+		pf->frame_size = MEM_callocN(sizeof(size_t) * max_ahead, "sequencer prefetch frame sizes");
+		BLI_condition_init(&pf->cond);
+
+		pf->pool = BLI_task_pool_create_background(BLI_task_scheduler_get(), pf);
+		BLI_task_pool_push(pf->pool, seq_prefetch_task, NULL, false, TASK_PRIORITY_LOW);
+
+		prefetch = pf;
+	}
+}
+
+void BKE_sequencer_prefetch_stop(void)
+{
+	SeqPrefetch *pf = prefetch;
+
+	if (pf == NULL) {
+		return;
+	}
+
+	BLI_mutex_lock(&prefetch_mutex);
+	pf->stop = true;
+	BLI_condition_notify_all(&pf->cond);
+	BLI_mutex_unlock(&prefetch_mutex);
+
+	/* waits for the frame being rendered */
+	BLI_task_pool_work_and_wait(pf->pool);
+	BLI_task_pool_free(pf->pool);
+
+	BLI_condition_end(&pf->cond);
+	MEM_freeN(pf->frame_size);
+	MEM_freeN(pf);
+
+	prefetch = NULL;
+}
+
+void BKE_sequencer_prefetch_cache_put(const ImBuf *ibuf)
+{
+	/* only called by the task, while holding render_mutex */
+	if (ibuf->rect) {
+		render_cache_size += sizeof(unsigned int) * ibuf->x * ibuf->y;
+	}
+	if (ibuf->rect_float) {
+		render_cache_size += sizeof(float) * ibuf->channels * ibuf->x * ibuf->y;
+	}
+}
+
+void BKE_sequencer_prefetch_render_lock(void)
+{
+	BLI_mutex_lock(&render_mutex);
+}
+
+void BKE_sequencer_prefetch_render_unlock(void)
+{
+	BLI_mutex_unlock(&render_mutex);
+}
+
+ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown)
+{
+	/* the frame was most likely rendered ahead, in that case the task can keep rendering */
+	ImBuf *ibuf = BKE_sequencer_give_ibuf_cached(context, cfra, chanshown);
+
+	if (ibuf == NULL) {
+		BKE_sequencer_prefetch_render_lock();
+		ibuf = BKE_sequencer_give_ibuf(context, cfra, chanshown);
+		BKE_sequencer_prefetch_render_unlock();
+	}
+
+	BKE_sequencer_prefetch_start(context, cfra, chanshown);
+
+	return ibuf;
+}
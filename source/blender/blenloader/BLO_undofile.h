@@ -33,17 +33,24 @@
  *  \ingroup blenloader
  */
 
+struct GSet;
+
+/* data shared by identical chunks of all memfiles, see undofile.c */
+typedef struct MemFileBuf MemFileBuf;
+
 typedef struct {
 	void *next, *prev;
 	
-	char *buf;
-	unsigned int ident, size;
+	MemFileBuf *data;
+	unsigned int size;
+	bool is_id_start;  /* the data of each ID starts a new chunk */
 	
 } MemFileChunk;
 
 typedef struct MemFile {
 	ListBase chunks;
-	unsigned int size;
+	unsigned int size;  /* size of the data that is not shared with other memfiles */
+	bool is_cold;
 } MemFile;
 
 /* actually only used writefile.c */
@@ -51,7 +58,13 @@ extern void memfile_chunk_add(MemFile *compare, MemFile *current, const char *bu
 
 /* exports */
 extern void BLO_memfile_free(MemFile *memfile);
-extern void BLO_memfile_merge(MemFile *first, MemFile *second);
+extern void BLO_memfile_set_cold(MemFile *memfile, bool is_cold);
+extern const char *BLO_memfile_chunk_data(const MemFileChunk *chunk);
+extern struct GSet *BLO_memfile_identical_ids(const MemFile *memfile, const MemFile *compare);
+
+extern void BLO_memfile_compress_cold(void);
+extern void BLO_memfile_compress_wait(void);
+extern size_t BLO_memfile_mem_in_use(void);
 
 #endif
 
@@ -367,9 +367,11 @@ BlendFileData *BLO_read_from_memory(
  *
  * \param oldmain old main, from which we will keep libraries and other datablocks that should not have changed.
  * \param filename current file, only for retrieving library data.
+ * \param oldmain_memfile memfile written from oldmain, local datablocks written identically to it in memfile
+ * are kept from oldmain instead of being read again (tagged with LIB_TAG_UNDO_OLD_ID_REUSED). May be NULL.
  */
 BlendFileData *BLO_read_from_memfile(
-        Main *oldmain, const char *filename, MemFile *memfile,
+        Main *oldmain, const char *filename, MemFile *memfile, MemFile *oldmain_memfile,
         ReportList *reports, eBLOReadSkip skip_flags)
 {
 	BlendFileData *bfd = NULL;
@@ -389,6 +391,11 @@ BlendFileData *BLO_read_from_memfile(
 		blo_split_main(&old_mainlist, oldmain);
 		/* add the library pointers in oldmap lookup */
 		blo_add_library_pointer_map(&old_mainlist, fd);
+
+		/* find the unchanged local datablocks */
+		if (oldmain_memfile) {
+			blo_make_undo_reuse_map(fd, oldmain, oldmain_memfile);
+		}
 		
 		/* makes lookup of existing images in old main */
 		blo_make_image_pointer_map(fd, oldmain);
@@ -45,6 +45,7 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap munmap
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
@@ -108,6 +109,9 @@
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_threads.h"
+#include "BLI_task.h"
+
+#include "PIL_time.h"
 #include "BLI_mempool.h"
 
 #include "BLT_translation.h"
@@ -216,6 +220,15 @@
 /* use GHash for BHead name-based lookups (speeds up linking) */
 #define USE_GHASH_BHEAD
 
+/* Read uncompressed files through a memory mapping. Blocks of files in memory
+ * (mapped, or decompressed in parallel) are used in place instead of copying them
+ * into separately allocated BHeadN's when the file needs no endian or pointer
+ * size conversion. Headers in memory are only 4 byte aligned, which all
+ * 64 bit platforms we support handle in hardware. */
+#ifndef WIN32
+#  define USE_MMAP
+#endif
+
 /* Use GHash for restoring pointers by name */
 #define USE_GHASH_RESTORE_POINTER
 
@@ -228,15 +241,40 @@ typedef struct OldNew {
 } OldNew;
 
 typedef struct OldNewMap {
+	/* entries in insertion order, also kept when shadowed by a later entry with the same address */
 	OldNew *entries;
-	int nentries, entriessize;
-	bool sorted;
+	int nentries;
+	/* open addressing hash of old addresses, indices into entries, -1 for empty slots */
+	int *map;
+	/* entries can hold 2^capacity_exp items, the map has twice as many slots */
+	int capacity_exp;
+	/* data is mostly linked in the order it was written, the entry after the last hit is tried
+	 * before the map, unless an address was inserted twice and that entry may be shadowed */
 	int lasthit;
+	bool has_shadowed;
 } OldNewMap;
 
+#define OLDNEWMAP_DEFAULT_CAPACITY_EXP 10
+#define OLDNEWMAP_ENTRIES_CAPACITY(onm) (1 << (onm)->capacity_exp)
+#define OLDNEWMAP_MAP_CAPACITY(onm) (1 << ((onm)->capacity_exp + 1))
+#define OLDNEWMAP_PERTURB_SHIFT 5
+
+/* Probe the slots of the map for an address, based on the probing of Python's dicts,
+ * which mixes in all bits of the hash so aligned addresses don't collide. */
+#define OLDNEWMAP_ITER_SLOTS(onm, addr, slot, index) \
+	unsigned int _perturb = BLI_ghashutil_ptrhash(addr); \
+	const unsigned int _mask = (unsigned int)OLDNEWMAP_MAP_CAPACITY(onm) - 1; \
+	unsigned int slot = _perturb & _mask; \
+	int index = (onm)->map[slot]; \
+	for (;; \
+	     slot = _mask & ((5 * slot) + 1 + _perturb), \
+	     _perturb >>= OLDNEWMAP_PERTURB_SHIFT, \
+	     index = (onm)->map[slot])
+
 
 /* local prototypes */
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
+static void read_struct_prepare_free(FileData *fd);
 static void direct_link_modifiers(FileData *fd, ListBase *lb);
 static void convert_tface_mt(FileData *fd, Main *main);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
@@ -274,31 +312,56 @@ static const char *library_parent_filepath(Library *lib)
 	return lib->parent ? lib->parent->filepath : "<direct>";
 }
 
-static OldNewMap *oldnewmap_new(void) 
+static void oldnewmap_map_insert(OldNewMap *onm, int index)
 {
-	OldNewMap *onm= MEM_callocN(sizeof(*onm), "OldNewMap");
-	
-	onm->entriessize = 1024;
-	onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
-	
-	return onm;
+	const void *addr = onm->entries[index].old;
+
+	OLDNEWMAP_ITER_SLOTS(onm, addr, slot, slot_index) {
+		if (slot_index == -1) {
+			onm->map[slot] = index;
+			return;
+		}
+		if (onm->entries[slot_index].old == addr) {
+			/* a later entry with the same address shadows the earlier one */
+			onm->map[slot] = index;
+			onm->has_shadowed = true;
+			return;
+		}
+	}
 }
 
-static int verg_oldnewmap(const void *v1, const void *v2)
+static void oldnewmap_alloc(OldNewMap *onm, int capacity_exp)
 {
-	const struct OldNew *x1=v1, *x2=v2;
-	
-	if (x1->old > x2->old) return 1;
-	else if (x1->old < x2->old) return -1;
-	return 0;
+	onm->capacity_exp = capacity_exp;
+	onm->entries = MEM_mallocN(sizeof(*onm->entries) * OLDNEWMAP_ENTRIES_CAPACITY(onm), "OldNewMap.entries");
+	onm->map = MEM_mallocN(sizeof(*onm->map) * OLDNEWMAP_MAP_CAPACITY(onm), "OldNewMap.map");
+	memset(onm->map, 0xff, sizeof(*onm->map) * OLDNEWMAP_MAP_CAPACITY(onm));
 }
 
+static void oldnewmap_grow(OldNewMap *onm)
+{
+	int i;
+
+	onm->capacity_exp++;
+	onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * OLDNEWMAP_ENTRIES_CAPACITY(onm));
+
+	MEM_freeN(onm->map);
+	onm->map = MEM_mallocN(sizeof(*onm->map) * OLDNEWMAP_MAP_CAPACITY(onm), "OldNewMap.map");
+	memset(onm->map, 0xff, sizeof(*onm->map) * OLDNEWMAP_MAP_CAPACITY(onm));
 
-static void oldnewmap_sort(FileData *fd) 
+	for (i = 0; i < onm->nentries; i++) {
+		oldnewmap_map_insert(onm, i);
+	}
+}
+
+static OldNewMap *oldnewmap_new(void) 
 {
-	BLI_assert(fd->libmap->sorted == false);
-	qsort(fd->libmap->entries, fd->libmap->nentries, sizeof(OldNew), verg_oldnewmap);
-	fd->libmap->sorted = 1;
+	OldNewMap *onm= MEM_callocN(sizeof(*onm), "OldNewMap");
+	
+	oldnewmap_alloc(onm, OLDNEWMAP_DEFAULT_CAPACITY_EXP);
+	onm->lasthit = -1;
+	
+	return onm;
 }
 
 /* nr is zero for data, and ID code for libdata */
@@ -308,15 +371,16 @@ static void oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void *newaddr,
 	
 	if (oldaddr==NULL || newaddr==NULL) return;
 	
-	if (UNLIKELY(onm->nentries == onm->entriessize)) {
-		onm->entriessize *= 2;
-		onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * onm->entriessize);
+	if (UNLIKELY(onm->nentries == OLDNEWMAP_ENTRIES_CAPACITY(onm))) {
+		oldnewmap_grow(onm);
 	}
 
-	entry = &onm->entries[onm->nentries++];
+	entry = &onm->entries[onm->nentries];
 	entry->old = oldaddr;
 	entry->newp = newaddr;
 	entry->nr = nr;
+
+	oldnewmap_map_insert(onm, onm->nentries++);
 }
 
 void blo_do_versions_oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void *newaddr, int nr)
@@ -324,54 +388,14 @@ void blo_do_versions_oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void
 	oldnewmap_insert(onm, oldaddr, newaddr, nr);
 }
 
-/**
- * Do a full search (no state).
- *
- * \param lasthit: Use as a reference position to avoid a full search
- * from either end of the array, giving more efficient lookups.
- *
- * \note This would seem an ideal case for hash or btree lookups.
- * However the data is written in-order, using the \a lasthit will normally avoid calling this function.
- * Creating a btree/hash structure adds overhead for the common-case to optimize the corner-case
- * (since most entries will never be retrieved).
- * So just keep full lookups as a fall-back.
- */
-static int oldnewmap_lookup_entry_full(const OldNewMap *onm, const void *addr, int lasthit)
+/* Index of the last entry inserted with the address, -1 when there is none. */
+static int oldnewmap_lookup_index(const OldNewMap *onm, const void *addr)
 {
-	const int nentries = onm->nentries;
-	const OldNew *entries = onm->entries;
-	int i;
-
-	/* search relative to lasthit where possible */
-	if (lasthit >= 0 && lasthit < nentries) {
-
-		/* search forwards */
-		i = lasthit;
-		while (++i != nentries) {
-			if (entries[i].old == addr) {
-				return i;
-			}
-		}
-
-		/* search backwards */
-		i = lasthit + 1;
-		while (i--) {
-			if (entries[i].old == addr) {
-				return i;
-			}
+	OLDNEWMAP_ITER_SLOTS(onm, addr, slot, index) {
+		if (index == -1 || onm->entries[index].old == addr) {
+			return index;
 		}
 	}
-	else {
-		/* search backwards (full) */
-		i = nentries;
-		while (i--) {
-			if (entries[i].old == addr) {
-				return i;
-			}
-		}
-	}
-
-	return -1;
 }
 
 static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool increase_users)
@@ -380,20 +404,20 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool inc
 	
 	if (addr == NULL) return NULL;
 	
-	if (onm->lasthit < onm->nentries-1) {
-		OldNew *entry = &onm->entries[++onm->lasthit];
+	if (!onm->has_shadowed && onm->lasthit < onm->nentries - 1) {
+		OldNew *entry = &onm->entries[onm->lasthit + 1];
 		
 		if (entry->old == addr) {
+			onm->lasthit++;
 			if (increase_users)
 				entry->nr++;
 			return entry->newp;
 		}
 	}
 	
-	i = oldnewmap_lookup_entry_full(onm, addr, onm->lasthit);
+	i = oldnewmap_lookup_index(onm, addr);
 	if (i != -1) {
 		OldNew *entry = &onm->entries[i];
-		BLI_assert(entry->old == addr);
 		onm->lasthit = i;
 		if (increase_users)
 			entry->nr++;
@@ -406,32 +430,17 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool inc
 /* for libdata, nr has ID code, no increment */
 static void *oldnewmap_liblookup(OldNewMap *onm, const void *addr, const void *lib)
 {
+	int i;
+
 	if (addr == NULL) {
 		return NULL;
 	}
 
-	/* lasthit works fine for non-libdata, linking there is done in same sequence as writing */
-	if (onm->sorted) {
-		const OldNew entry_s = {.old = addr};
-		OldNew *entry = bsearch(&entry_s, onm->entries, onm->nentries, sizeof(OldNew), verg_oldnewmap);
-		if (entry) {
-			ID *id = entry->newp;
-
-			if (id && (!lib || id->lib)) {
-				return id;
-			}
-		}
-	}
-	else {
-		/* note, this can be a bottle neck when loading some files */
-		const int i = oldnewmap_lookup_entry_full(onm, addr, -1);
-		if (i != -1) {
-			OldNew *entry = &onm->entries[i];
-			ID *id = entry->newp;
-			BLI_assert(entry->old == addr);
-			if (id && (!lib || id->lib)) {
-				return id;
-			}
+	i = oldnewmap_lookup_index(onm, addr);
+	if (i != -1) {
+		ID *id = onm->entries[i].newp;
+		if (id && (!lib || id->lib)) {
+			return id;
 		}
 	}
 
@@ -453,13 +462,24 @@ static void oldnewmap_free_unused(OldNewMap *onm)
 
 static void oldnewmap_clear(OldNewMap *onm) 
 {
+	/* the data map is cleared after every ID, shrink it again after large ones */
+	if (onm->capacity_exp > OLDNEWMAP_DEFAULT_CAPACITY_EXP) {
+		MEM_freeN(onm->entries);
+		MEM_freeN(onm->map);
+		oldnewmap_alloc(onm, OLDNEWMAP_DEFAULT_CAPACITY_EXP);
+	}
+	else {
+		memset(onm->map, 0xff, sizeof(*onm->map) * OLDNEWMAP_MAP_CAPACITY(onm));
+	}
 	onm->nentries = 0;
-	onm->lasthit = 0;
+	onm->lasthit = -1;
+	onm->has_shadowed = false;
 }
 
 static void oldnewmap_free(OldNewMap *onm) 
 {
 	MEM_freeN(onm->entries);
+	MEM_freeN(onm->map);
 	MEM_freeN(onm);
 }
 
@@ -818,11 +838,88 @@ static BHeadN *get_bhead(FileData *fd)
 	return(new_bhead);
 }
 
+/* Block header at offset in the mapping, NULL at the end of the file. */
+static BHead *mmap_bhead_at(FileData *fd, size_t offset)
+{
+	BHead *bhead;
+
+	if (offset > fd->mmap_size || fd->mmap_size - offset < sizeof(BHead)) {
+		return NULL;
+	}
+
+	bhead = (BHead *)(fd->mmap_buffer + offset);
+
+	/* make sure people are not trying to pass bad blend files */
+	if (bhead->len < 0 || (size_t)bhead->len > fd->mmap_size - offset - sizeof(BHead)) {
+		return NULL;
+	}
+
+	return bhead;
+}
+
+static void mmap_bhead_add(FileData *fd, BHead *bhead)
+{
+	if (fd->mmap_bheads_len == fd->mmap_bheads_alloc) {
+		fd->mmap_bheads_alloc = (fd->mmap_bheads_alloc) ? fd->mmap_bheads_alloc * 2 : 1024;
+		fd->mmap_bheads = MEM_reallocN(fd->mmap_bheads, sizeof(*fd->mmap_bheads) * fd->mmap_bheads_alloc);
+	}
+	fd->mmap_bheads[fd->mmap_bheads_len++] = bhead;
+}
+
+static BHead *mmap_firstbhead(FileData *fd)
+{
+	if (fd->mmap_bheads_len == 0) {
+		BHead *bhead = mmap_bhead_at(fd, SIZEOFBLENDERHEADER);
+		if (bhead) {
+			mmap_bhead_add(fd, bhead);
+		}
+		return bhead;
+	}
+
+	return fd->mmap_bheads[0];
+}
+
+static BHead *mmap_nextbhead(FileData *fd, BHead *thisblock)
+{
+	const size_t offset = (size_t)((char *)(thisblock + 1) - fd->mmap_buffer) + (size_t)thisblock->len;
+	BHead *bhead = mmap_bhead_at(fd, offset);
+
+	/* blocks are visited in file order, remember them for mmap_prevbhead */
+	if (bhead && fd->mmap_bheads[fd->mmap_bheads_len - 1] == thisblock) {
+		mmap_bhead_add(fd, bhead);
+	}
+
+	return bhead;
+}
+
+static BHead *mmap_prevbhead(FileData *fd, BHead *thisblock)
+{
+	/* headers are stored in increasing address order */
+	unsigned int low = 0, high = fd->mmap_bheads_len;
+
+	while (low < high) {
+		const unsigned int mid = (low + high) / 2;
+		if (fd->mmap_bheads[mid] < thisblock) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	BLI_assert(low < fd->mmap_bheads_len && fd->mmap_bheads[low] == thisblock);
+	return (low > 0) ? fd->mmap_bheads[low - 1] : NULL;
+}
+
 BHead *blo_firstbhead(FileData *fd)
 {
 	BHeadN *new_bhead;
 	BHead *bhead = NULL;
 	
+	if (fd->flags & FD_FLAGS_MMAP_BHEAD) {
+		return mmap_firstbhead(fd);
+	}
+
 	/* Rewind the file
 	 * Read in a new block if necessary
 	 */
@@ -838,10 +935,16 @@ BHead *blo_firstbhead(FileData *fd)
 	return(bhead);
 }
 
-BHead *blo_prevbhead(FileData *UNUSED(fd), BHead *thisblock)
+BHead *blo_prevbhead(FileData *fd, BHead *thisblock)
 {
-	BHeadN *bheadn = (BHeadN *)POINTER_OFFSET(thisblock, -offsetof(BHeadN, bhead));
-	BHeadN *prev = bheadn->prev;
+	BHeadN *bheadn, *prev;
+
+	if (fd->flags & FD_FLAGS_MMAP_BHEAD) {
+		return mmap_prevbhead(fd, thisblock);
+	}
+
+	bheadn = (BHeadN *)POINTER_OFFSET(thisblock, -offsetof(BHeadN, bhead));
+	prev = bheadn->prev;
 	
 	return (prev) ? &prev->bhead : NULL;
 }
@@ -851,6 +954,10 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	BHeadN *new_bhead = NULL;
 	BHead *bhead = NULL;
 	
+	if (fd->flags & FD_FLAGS_MMAP_BHEAD) {
+		return (thisblock) ? mmap_nextbhead(fd, thisblock) : NULL;
+	}
+
 	if (thisblock) {
 		/* bhead is actually a sub part of BHeadN
 		 * We calculate the BHeadN pointer from the BHead pointer below */
@@ -914,6 +1021,11 @@ static void decode_blender_header(FileData *fd)
 			memcpy(num, header + 9, 3);
 			num[3] = 0;
 			fd->fileversion = atoi(num);
+
+			/* blocks stored the way we need them can be used directly from the mapping */
+			if (fd->mmap_buffer && !(fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS))) {
+				fd->flags |= FD_FLAGS_MMAP_BHEAD;
+			}
 		}
 	}
 }
@@ -1024,6 +1136,17 @@ static int fd_read_from_memory(FileData *filedata, void *buffer, unsigned int si
 	return (readsize);
 }
 
+static int fd_read_from_mmap(FileData *filedata, void *buffer, unsigned int size)
+{
+	/* don't read more bytes then there are available in the mapping */
+	const size_t readsize = MIN2((size_t)size, filedata->mmap_size - filedata->mmap_seek);
+
+	memcpy(buffer, filedata->mmap_buffer + filedata->mmap_seek, readsize);
+	filedata->mmap_seek += readsize;
+
+	return (int)readsize;
+}
+
 static int fd_read_from_memfile(FileData *filedata, void *buffer, unsigned int size)
 {
 	static unsigned int seek = (1<<30);	/* the current position */
@@ -1071,7 +1194,7 @@ static int fd_read_from_memfile(FileData *filedata, void *buffer, unsigned int s
 			if (chunkoffset+readsize > chunk->size)
 				readsize= chunk->size-chunkoffset;
 			
-			memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
+			memcpy(POINTER_OFFSET(buffer, totread), BLO_memfile_chunk_data(chunk) + chunkoffset, readsize);
 			totread += readsize;
 			filedata->seek += readsize;
 			seek += readsize;
@@ -1122,29 +1245,273 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 	return fd;
 }
 
-/* cannot be called with relative paths anymore! */
-/* on each new library added, it now checks for the current FileData and expands relativeness */
-FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
+#ifdef USE_MMAP
+/* Map the whole file, reading falls back to fd_read_from_file when this fails. */
+static void blo_filedata_mmap(FileData *fd)
+{
+	const off_t file_size = lseek(fd->filedes, 0, SEEK_END);
+	const size_t size = (size_t)file_size;
+	void *buffer;
+
+	lseek(fd->filedes, 0, SEEK_SET);
+
+	/* files too large for the address space are read in blocks */
+	if (file_size <= 0 || (off_t)size != file_size) {
+		return;
+	}
+
+	/* private and writable, so the few places patching block headers while reading
+	 * (old screen identifiers) only copy the pages they write to */
+	buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd->filedes, 0);
+	if (buffer == MAP_FAILED) {
+		return;
+	}
+
+	fd->mmap_buffer = buffer;
+	fd->mmap_size = size;
+	fd->mmap_seek = 0;
+	fd->read = fd_read_from_mmap;
+
+	/* the mapping keeps its own reference to the file */
+	close(fd->filedes);
+	fd->filedes = -1;
+}
+#endif
+
+/* Compressed blocks, see BLEN_GZIP_BLOCK_SIZE */
+typedef struct GzipBlock {
+	const unsigned char *in;
+	size_t in_len;
+	char *out;
+	unsigned int out_len;
+	unsigned int crc;
+	bool ok;
+} GzipBlock;
+
+static unsigned int gzip_block_uint32(const unsigned char *p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/* Size of the gzip member at the start of data, 0 when it is not a block written by us. */
+static size_t gzip_block_member_len(const unsigned char *data, size_t data_len)
+{
+	size_t member_len;
+
+	if (data_len < BLEN_GZIP_HEADER_SIZE + BLEN_GZIP_TRAILER_SIZE) {
+		return 0;
+	}
+
+	/* deflate with only an extra field, holding a single 4 byte 'BL' subfield */
+	if (data[0] != 0x1f || data[1] != 0x8b || data[2] != Z_DEFLATED || data[3] != 0x04 ||
+	    data[10] != 8 || data[11] != 0 ||
+	    data[12] != BLEN_GZIP_EXTRA_SI1 || data[13] != BLEN_GZIP_EXTRA_SI2 ||
+	    data[14] != 4 || data[15] != 0)
+	{
+		return 0;
+	}
+
+	member_len = gzip_block_uint32(data + 16);
+	if (member_len < BLEN_GZIP_HEADER_SIZE + BLEN_GZIP_TRAILER_SIZE || member_len > data_len) {
+		return 0;
+	}
+
+	return member_len;
+}
+
+static void gzip_block_decompress(TaskPool *__restrict UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	GzipBlock *block = taskdata;
+	z_stream strm = {NULL};
+
+	if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+		return;
+	}
+
+	strm.next_in = (Bytef *)block->in;
+	strm.avail_in = (uInt)block->in_len;
+	strm.next_out = (Bytef *)block->out;
+	strm.avail_out = block->out_len;
+
+	block->ok = (inflate(&strm, Z_FINISH) == Z_STREAM_END &&
+	             strm.total_out == block->out_len &&
+	             crc32(0, (const Bytef *)block->out, block->out_len) == block->crc);
+
+	inflateEnd(&strm);
+}
+
+/**
+ * Decompress a file written as independently compressed blocks on all threads.
+ * \return the decompressed file, or NULL when the file has another layout, then it's read as a gzip stream.
+ */
+static char *blo_gzip_blocks_decompress(int file, size_t *r_size)
+{
+	const off_t file_size = lseek(file, 0, SEEK_END);
+	const size_t in_len = (size_t)file_size;
+	unsigned char header[BLEN_GZIP_HEADER_SIZE];
+	unsigned char *in;
+	char *out = NULL;
+	GzipBlock *blocks;
+	size_t offset, out_len = 0;
+	int i, blocks_len = 0;
+	bool ok = true;
+
+	lseek(file, 0, SEEK_SET);
+	if (file_size <= 0 || (off_t)in_len != file_size ||
+	    read(file, header, sizeof(header)) != sizeof(header) ||
+	    gzip_block_member_len(header, in_len) == 0)
+	{
+		return NULL;
+	}
+
+	in = MEM_mallocN(in_len, __func__);
+	lseek(file, 0, SEEK_SET);
+	for (offset = 0; offset < in_len; ) {
+		const unsigned int chunk = (unsigned int)MIN2(in_len - offset, (size_t)(1 << 30));
+		const int readsize = read(file, in + offset, chunk);
+		if (readsize <= 0) {
+			MEM_freeN(in);
+			return NULL;
+		}
+		offset += (size_t)readsize;
+	}
+
+	/* the index, every member header has the offset of the next one */
+	for (offset = 0; offset < in_len; blocks_len++) {
+		const size_t member_len = gzip_block_member_len(in + offset, in_len - offset);
+		/* deflate can't compress more than about 1:1032 */
+		if (member_len == 0 || gzip_block_uint32(in + offset + member_len - 4) / 1032 > member_len) {
+			MEM_freeN(in);
+			return NULL;
+		}
+		out_len += gzip_block_uint32(in + offset + member_len - 4);
+		offset += member_len;
+	}
+
+	out = MEM_mallocN(MAX2(out_len, 1), "blo_gzip_blocks_decompress out");
+	if (out == NULL) {
+		MEM_freeN(in);
+		return NULL;
+	}
+	blocks = MEM_callocN(sizeof(*blocks) * blocks_len, __func__);
+
+	{
+		TaskScheduler *scheduler = BLI_task_scheduler_get();
+		TaskPool *pool = BLI_task_pool_create(scheduler, NULL);
+		size_t out_offset = 0;
+
+		for (i = 0, offset = 0; i < blocks_len; i++) {
+			const size_t member_len = gzip_block_member_len(in + offset, in_len - offset);
+			GzipBlock *block = &blocks[i];
+
+			block->in = in + offset + BLEN_GZIP_HEADER_SIZE;
+			block->in_len = member_len - BLEN_GZIP_HEADER_SIZE - BLEN_GZIP_TRAILER_SIZE;
+			block->crc = gzip_block_uint32(in + offset + member_len - 8);
+			block->out_len = gzip_block_uint32(in + offset + member_len - 4);
+			block->out = out + out_offset;
+
+			BLI_task_pool_push(pool, gzip_block_decompress, block, false, TASK_PRIORITY_HIGH);
+
+			offset += member_len;
+			out_offset += block->out_len;
+		}
+
+		BLI_task_pool_work_and_wait(pool);
+		BLI_task_pool_free(pool);
+	}
+
+	for (i = 0; i < blocks_len; i++) {
+		ok &= blocks[i].ok;
+	}
+
+	MEM_freeN(blocks);
+	MEM_freeN(in);
+
+	if (!ok) {
+		MEM_freeN(out);
+		return NULL;
+	}
+
+	*r_size = out_len;
+	return out;
+}
+
+/**
+ * Open a file for reading, only gzip compressed files are read through zlib.
+ * Uncompressed files are memory mapped when possible, else read directly.
+ * Compressed files written in blocks are decompressed in parallel when \a use_blocks is set,
+ * that inflates the whole file up front, so it's only worth it when the whole file is read.
+ */
+static FileData *blo_filedata_from_file_open(const char *filepath, const bool use_blocks, ReportList *reports)
 {
-	gzFile gzfile;
+	FileData *fd;
+	unsigned char magic[2];
+	int file;
+
 	errno = 0;
-	gzfile = BLI_gzopen(filepath, "rb");
-	
-	if (gzfile == (gzFile)Z_NULL) {
+	file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file == -1) {
 		BKE_reportf(reports, RPT_WARNING, "Unable to open '%s': %s",
 		            filepath, errno ? strerror(errno) : TIP_("unknown error reading file"));
 		return NULL;
 	}
+
+	if (read(file, magic, sizeof(magic)) == sizeof(magic) && magic[0] == 0x1f && magic[1] == 0x8b) {
+		gzFile gzfile;
+		size_t size;
+		char *buffer = (use_blocks) ? blo_gzip_blocks_decompress(file, &size) : NULL;
+
+		close(file);
+
+		if (buffer) {
+			fd = filedata_new();
+			fd->mmap_buffer = buffer;
+			fd->mmap_size = size;
+			fd->read = fd_read_from_mmap;
+			fd->flags |= FD_FLAGS_MMAP_DECOMPRESSED;
+		}
+		else {
+			errno = 0;
+			gzfile = BLI_gzopen(filepath, "rb");
+			if (gzfile == (gzFile)Z_NULL) {
+				BKE_reportf(reports, RPT_WARNING, "Unable to open '%s': %s",
+				            filepath, errno ? strerror(errno) : TIP_("unknown error reading file"));
+				return NULL;
+			}
+
+			fd = filedata_new();
+			fd->gzfiledes = gzfile;
+			fd->read = fd_read_gzip_from_file;
+		}
+	}
 	else {
-		FileData *fd = filedata_new();
-		fd->gzfiledes = gzfile;
-		fd->read = fd_read_gzip_from_file;
-		
-		/* needed for library_append and read_libraries */
-		BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
-		
-		return blo_decode_and_check(fd, reports);
+		lseek(file, 0, SEEK_SET);
+
+		fd = filedata_new();
+		fd->filedes = file;
+		fd->read = fd_read_from_file;
+#ifdef USE_MMAP
+		blo_filedata_mmap(fd);
+#endif
 	}
+
+	/* needed for library_append and read_libraries */
+	BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+	return fd;
+}
+
+/* cannot be called with relative paths anymore! */
+/* on each new library added, it now checks for the current FileData and expands relativeness */
+FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
+{
+	FileData *fd = blo_filedata_from_file_open(filepath, true, reports);
+
+	if (fd == NULL) {
+		return NULL;
+	}
+
+	return blo_decode_and_check(fd, reports);
 }
 
 /**
@@ -1153,15 +1520,10 @@ FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
  */
 static FileData *blo_openblenderfile_minimal(const char *filepath)
 {
-	gzFile gzfile;
-	errno = 0;
-	gzfile = BLI_gzopen(filepath, "rb");
-
-	if (gzfile != (gzFile)Z_NULL) {
-		FileData *fd = filedata_new();
-		fd->gzfiledes = gzfile;
-		fd->read = fd_read_gzip_from_file;
+	/* only the first blocks are read, stream them instead of decompressing the whole file */
+	FileData *fd = blo_filedata_from_file_open(filepath, false, NULL);
 
+	if (fd != NULL) {
 		decode_blender_header(fd);
 
 		if (fd->flags & FD_FLAGS_FILE_OK) {
@@ -1277,6 +1639,23 @@ void blo_freefiledata(FileData *fd)
 				printf("close gzip stream error\n");
 			}
 		}
+
+		if (fd->mmap_buffer) {
+			if (fd->flags & FD_FLAGS_MMAP_DECOMPRESSED) {
+				MEM_freeN(fd->mmap_buffer);
+			}
+#ifdef USE_MMAP
+			else {
+				munmap(fd->mmap_buffer, fd->mmap_size);
+			}
+#endif
+			fd->mmap_buffer = NULL;
+		}
+		if (fd->mmap_bheads) {
+			MEM_freeN(fd->mmap_bheads);
+		}
+
+		read_struct_prepare_free(fd);
 		
 		if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
 			MEM_freeN((void *)fd->buffer);
@@ -1314,6 +1693,13 @@ void blo_freefiledata(FileData *fd)
 		}
 #endif
 
+		if (fd->undo_identical_ids) {
+			BLI_gset_free(fd->undo_identical_ids, NULL);
+		}
+		if (fd->undo_old_ids) {
+			BLI_gset_free(fd->undo_old_ids, NULL);
+		}
+
 		MEM_freeN(fd);
 	}
 }
@@ -1439,31 +1825,6 @@ static void *newdataadr(FileData *fd, const void *adr)		/* only direct databocks
 	return oldnewmap_lookup_and_inc(fd->datamap, adr, true);
 }
 
-/* This is a special version of newdataadr() which allows us to keep lasthit of
- * map unchanged. In certain cases this makes file loading time significantly
- * faster.
- *
- * Use this function in cases like restoring pointer from one list element to
- * another list element, but keep lasthit value so we can continue restoring
- * pointers efficiently.
- *
- * Example of this could be found in direct_link_fcurves() which restores the
- * fcurve group pointer and keeps lasthit optimal for linking all further
- * fcurves.
- */
-static void *newdataadr_ex(FileData *fd, const void *adr, bool increase_lasthit)		/* only direct databocks */
-{
-	if (increase_lasthit) {
-		return newdataadr(fd, adr);
-	}
-	else {
-		int lasthit = fd->datamap->lasthit;
-		void *newadr = newdataadr(fd, adr);
-		fd->datamap->lasthit = lasthit;
-		return newadr;
-	}
-}
-
 static void *newdataadr_no_us(FileData *fd, const void *adr)		/* only direct databocks */
 {
 	return oldnewmap_lookup_and_inc(fd->datamap, adr, false);
@@ -1541,9 +1902,6 @@ static void change_idid_adr_fd(FileData *fd, const void *old, void *new)
 {
 	int i;
 	
-	/* use a binary search if we have a sorted libmap, for now it's not needed. */
-	BLI_assert(fd->libmap->sorted == false);
-
 	for (i = 0; i < fd->libmap->nentries; i++) {
 		OldNew *entry = &fd->libmap->entries[i];
 		
@@ -1854,6 +2212,32 @@ void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd)
 	fd->old_mainlist = old_mainlist;
 }
 
+/**
+ * Undo file support: IDs of the memfile that are written identically in the memfile of the old
+ * main, are kept as they are instead of being read again (see: read_libblock_undo_reuse).
+ * \param oldmain_memfile: Memfile written from the old main just before reading.
+ */
+void blo_make_undo_reuse_map(FileData *fd, Main *oldmain, MemFile *oldmain_memfile)
+{
+	ListBase *lbarray[MAX_LIBARRAY];
+	int i;
+
+	fd->undo_identical_ids = BLO_memfile_identical_ids(fd->memfile, oldmain_memfile);
+	if (fd->undo_identical_ids == NULL) {
+		return;
+	}
+
+	fd->undo_old_ids = BLI_gset_ptr_new(__func__);
+
+	i = set_listbasepointers(oldmain, lbarray);
+	while (i--) {
+		ID *id;
+		for (id = lbarray[i]->first; id; id = id->next) {
+			BLI_gset_insert(fd->undo_old_ids, id);
+		}
+	}
+}
+
 
 /* ********** END OLD POINTERS ****************** */
 /* ********** READ FILE ****************** */
@@ -1874,7 +2258,7 @@ static void switch_endian_structs(const struct SDNA *filesdna, BHead *bhead)
 	}
 }
 
-static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
+static void *read_struct_data(const FileData *fd, BHead *bh, const char *blockname)
 {
 	void *temp = NULL;
 	
@@ -1898,6 +2282,115 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 	return temp;
 }
 
+static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
+{
+	if (fd->bhead_structs) {
+		void **struct_p = BLI_ghash_lookup_p(fd->bhead_structs, bh);
+		if (struct_p) {
+			void *temp = *struct_p;
+			BLI_ghash_remove(fd->bhead_structs, bh, NULL, NULL);
+			return temp;
+		}
+	}
+
+	return read_struct_data(fd, bh, blockname);
+}
+
+typedef struct ReadStructPrepareData {
+	const FileData *fd;
+	BHead **bheads;
+	void **structs;
+} ReadStructPrepareData;
+
+static void read_struct_prepare_cb(void *userdata, const int index)
+{
+	ReadStructPrepareData *data = userdata;
+	data->structs[index] = read_struct_data(data->fd, data->bheads[index], "read_struct");
+}
+
+static bool read_struct_needs_conversion(const FileData *fd, const BHead *bhead)
+{
+	switch (bhead->code) {
+		/* blocks that are not read with read_struct, or more than once */
+		case DNA1:
+		case TEST:
+		case REND:
+		case GLOB:
+		case USER:
+		case ENDB:
+			return false;
+		default:
+			return (bhead->len && (fd->compflags[bhead->SDNAnr] == SDNA_CMP_NOT_EQUAL ||
+			                       (bhead->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN))));
+	}
+}
+
+/**
+ * Endian switching and reconstruction of structs that changed since the file was saved
+ * don't depend on other blocks. Do them for all blocks on all threads, before IDs are
+ * read and linked one after the other, read_struct() then only takes the result.
+ */
+static void read_struct_prepare(FileData *fd)
+{
+	ReadStructPrepareData data;
+	BHead *bhead;
+	int i, tot = 0;
+	bool need_conversion = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
+
+	for (i = 0; i < fd->filesdna->nr_structs && !need_conversion; i++) {
+		need_conversion = (fd->compflags[i] == SDNA_CMP_NOT_EQUAL);
+	}
+	if (!need_conversion) {
+		return;
+	}
+
+	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
+		if (read_struct_needs_conversion(fd, bhead)) {
+			tot++;
+		}
+	}
+	if (tot == 0) {
+		return;
+	}
+
+	data.fd = fd;
+	data.bheads = MEM_mallocN(sizeof(*data.bheads) * tot, __func__);
+	data.structs = MEM_mallocN(sizeof(*data.structs) * tot, __func__);
+
+	i = 0;
+	for (bhead = blo_firstbhead(fd); bhead; bhead = blo_nextbhead(fd, bhead)) {
+		if (read_struct_needs_conversion(fd, bhead)) {
+			data.bheads[i++] = bhead;
+		}
+	}
+
+	BLI_task_parallel_range(0, tot, &data, read_struct_prepare_cb, tot > 64);
+
+	fd->bhead_structs = BLI_ghash_ptr_new_ex(__func__, tot);
+	for (i = 0; i < tot; i++) {
+		BLI_ghash_insert(fd->bhead_structs, data.bheads[i], data.structs[i]);
+	}
+
+	MEM_freeN(data.bheads);
+	MEM_freeN(data.structs);
+}
+
+static void read_struct_prepare_free_cb(void *val)
+{
+	if (val) {
+		MEM_freeN(val);
+	}
+}
+
+/* structs of blocks that were skipped while reading */
+static void read_struct_prepare_free(FileData *fd)
+{
+	if (fd->bhead_structs) {
+		BLI_ghash_free(fd->bhead_structs, NULL, read_struct_prepare_free_cb);
+		fd->bhead_structs = NULL;
+	}
+}
+
 typedef void (*link_list_cb)(FileData *fd, void *data);
 
 static void link_list_ex(FileData *fd, ListBase *lb, link_list_cb callback)		/* only direct data */
@@ -2500,7 +2993,7 @@ static void direct_link_fcurves(FileData *fd, ListBase *list)
 		fcu->rna_path = newdataadr(fd, fcu->rna_path);
 		
 		/* group */
-		fcu->grp = newdataadr_ex(fd, fcu->grp, false);
+		fcu->grp = newdataadr(fd, fcu->grp);
 		
 		/* clear disabled flag - allows disabled drivers to be tried again ([#32155]),
 		 * but also means that another method for "reviving disabled F-Curves" exists
@@ -4471,6 +4964,12 @@ static void lib_link_mesh(FileData *fd, Main *main)
 				G.main = gmain;
 			}
 
+			/* tessfaces of a kept mesh may be used by the derived mesh of its objects */
+			if (me->id.tag & LIB_TAG_UNDO_OLD_ID_REUSED) {
+				me->id.tag &= ~LIB_TAG_NEED_LINK;
+				continue;
+			}
+
 			/*
 			 * Re-tessellate, even if the polys were just created from tessfaces, this
 			 * is important because it:
@@ -8106,6 +8605,82 @@ static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *a
 	return bhead;
 }
 
+/* IDs with runtime data that depends on other IDs, or that is always rebuilt when linking */
+static bool read_libblock_undo_can_reuse(const ID *id)
+{
+	switch (GS(id->name)) {
+		case ID_WM:
+		case ID_SCR:
+		case ID_LI:
+		case ID_SCE:  /* depsgraph and sound handles */
+		case ID_SO:   /* sound handle, loaded when linking */
+			return false;
+		case ID_OB:
+		{
+			const Object *ob = (const Object *)id;
+			/* sculpt session uses the mesh data, logic bricks link to those of other objects */
+			return (ob->sculpt == NULL &&
+			        BLI_listbase_is_empty(&ob->sensors) &&
+			        BLI_listbase_is_empty(&ob->controllers) &&
+			        BLI_listbase_is_empty(&ob->actuators));
+		}
+		default:
+			return true;
+	}
+}
+
+/**
+ * Undo case: an ID that was written identically from the old main (see: blo_make_undo_reuse_map)
+ * is moved from the old main as it is, with its direct data and runtime data, instead of being
+ * read again. Its pointers to other IDs are still the old addresses, which are linked like for
+ * IDs that are read.
+ *
+ * \return false when the ID has to be read.
+ */
+static bool read_libblock_undo_reuse(FileData *fd, Main *main, BHead **r_bhead, const short tag, ID **r_id)
+{
+	BHead *bhead = *r_bhead;
+	ID *id = (ID *)bhead->old;
+	const ID *id_file = (const ID *)(bhead + 1);
+	Main *oldmain = fd->old_mainlist->first;
+
+	if (!BLI_gset_haskey(fd->undo_identical_ids, bhead->old) ||
+	    !BLI_gset_haskey(fd->undo_old_ids, id))
+	{
+		return false;
+	}
+
+	/* written from the old main, but check anyway */
+	if (GS(id->name) != bhead->code || !STREQ(id->name, id_file->name) || id->lib != NULL ||
+	    !read_libblock_undo_can_reuse(id))
+	{
+		return false;
+	}
+
+	BLI_remlink(which_libbase(oldmain, GS(id->name)), id);
+	BLI_addtail(which_libbase(main, GS(id->name)), id);
+	BLI_gset_remove(fd->undo_old_ids, id, NULL);
+
+	oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
+
+	/* same as for a read ID, users are counted again when linking */
+	id->tag = tag | LIB_TAG_NEED_LINK | LIB_TAG_UNDO_OLD_ID_REUSED;
+	id->us = ID_FAKE_USERS(id);
+	id->newid = NULL;
+
+	if (r_id) {
+		*r_id = id;
+	}
+
+	/* skip the direct data */
+	do {
+		bhead = blo_nextbhead(fd, bhead);
+	} while (bhead && bhead->code == DATA);
+
+	*r_bhead = bhead;
+	return true;
+}
+
 static BHead *read_libblock(FileData *fd, Main *main, BHead *bhead, const short tag, ID **r_id)
 {
 	/* this routine reads a libblock and its direct data. Use link functions to connect it all
@@ -8182,6 +8757,10 @@ static BHead *read_libblock(FileData *fd, Main *main, BHead *bhead, const short
 		}
 	}
 
+	if (fd->undo_identical_ids && read_libblock_undo_reuse(fd, main, &bhead, tag, r_id)) {
+		return bhead;
+	}
+
 	/* read libblock */
 	id = read_struct(fd, bhead, "lib block");
 
@@ -8487,8 +9066,6 @@ static void do_versions_after_linking(Main *main)
 
 static void lib_link_all(FileData *fd, Main *main)
 {
-	oldnewmap_sort(fd);
-	
 	/* No load UI for undo memfiles */
 	if (fd->memfile == NULL) {
 		lib_link_windowmanager(fd, main);
@@ -8605,11 +9182,22 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 	return bhead;
 }
 
+/* Print the time since the previous phase of reading a file, with --debug-io */
+static void read_file_phase_end(const char *phase, double *r_time)
+{
+	if (G.debug & G_DEBUG_IO) {
+		const double time = PIL_check_seconds_timer();
+		printf("read file: %-22s %8.3f sec\n", phase, time - *r_time);
+		*r_time = time;
+	}
+}
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
 	BHead *bhead = blo_firstbhead(fd);
 	BlendFileData *bfd;
 	ListBase mainlist = {NULL, NULL};
+	double time = PIL_check_seconds_timer();
 	
 	bfd = MEM_callocN(sizeof(BlendFileData), "blendfiledata");
 	bfd->main = BKE_main_new();
@@ -8639,6 +9227,12 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		}
 	}
 
+	/* undo files are always written with the current DNA */
+	if (fd->memfile == NULL && !(fd->skip_flags & BLO_READ_SKIP_DATA)) {
+		read_struct_prepare(fd);
+		read_file_phase_end("reconstruct structs", &time);
+	}
+
 	while (bhead) {
 		switch (bhead->code) {
 		case DATA:
@@ -8687,17 +9281,23 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		}
 	}
 	
+	read_struct_prepare_free(fd);
+	read_file_phase_end("read data-blocks", &time);
+	
 	/* do before read_libraries, but skip undo case */
 	if (fd->memfile == NULL) {
 		do_versions(fd, NULL, bfd->main);
 		do_versions_userdef(fd, bfd);
+		read_file_phase_end("versioning", &time);
 	}
 	
 	read_libraries(fd, &mainlist);
+	read_file_phase_end("read libraries", &time);
 	
 	blo_join_main(&mainlist);
 	
 	lib_link_all(fd, bfd->main);
+	read_file_phase_end("link data-blocks", &time);
 
 	/* Skip in undo case. */
 	if (fd->memfile == NULL) {
@@ -8708,6 +9308,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 			do_versions_after_linking(mainvar);
 		}
 		blo_join_main(&mainlist);
+		read_file_phase_end("versioning after linking", &time);
 	}
 
 	BKE_main_id_tag_all(bfd->main, LIB_TAG_NEW, false);
@@ -8716,6 +9317,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 	fix_relpaths_library(fd->relabase, bfd->main); /* make all relative paths, relative to the open blend file */
 	
 	link_global(fd, bfd);	/* as last */
+	read_file_phase_end("finish", &time);
 	
 	fd->mainlist = NULL;  /* Safety, this is local variable, shall not be used afterward. */
 
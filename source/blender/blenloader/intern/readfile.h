@@ -62,6 +62,15 @@ typedef struct FileData {
 	int filedes;
 	gzFile gzfiledes;
 
+	// variables needed for reading from a memory mapped file,
+	// or a compressed file decompressed into memory (see FD_FLAGS_MMAP_DECOMPRESSED)
+	char *mmap_buffer;
+	size_t mmap_size;
+	size_t mmap_seek;
+	// block headers used in place in the mapping, in file order (see FD_FLAGS_MMAP_BHEAD)
+	struct BHead **mmap_bheads;
+	unsigned int mmap_bheads_len, mmap_bheads_alloc;
+
 	// now only in use for library appending
 	char relabase[FILE_MAX];
 	
@@ -96,10 +105,18 @@ typedef struct FileData {
 
 	/* see: USE_GHASH_BHEAD */
 	struct GHash *bhead_idname_hash;
+
+	/* structs reconstructed on all threads before reading, by BHead (see: read_struct_prepare) */
+	struct GHash *bhead_structs;
 	
 	ListBase *mainlist;
 	ListBase *old_mainlist;  /* Used for undo. */
 
+	/* undo: old addresses of IDs that can be kept from the old main, and the IDs of the old main
+	 * (see: blo_make_undo_reuse_map) */
+	struct GSet *undo_identical_ids;
+	struct GSet *undo_old_ids;
+
 	/* ick ick, used to return
 	 * data through streamglue.
 	 */
@@ -120,10 +137,25 @@ enum {
 	FD_FLAGS_FILE_OK               = 1 << 3,
 	FD_FLAGS_NOT_MY_BUFFER         = 1 << 4,
 	FD_FLAGS_NOT_MY_LIBMAP         = 1 << 5,  /* XXX Unused in practice (checked once but never set). */
+	FD_FLAGS_MMAP_BHEAD            = 1 << 6,  /* Block headers and data are used in place in the mapping. */
+	FD_FLAGS_MMAP_DECOMPRESSED     = 1 << 7,  /* mmap_buffer is guarded memory holding the decompressed file. */
 };
 
 #define SIZEOFBLENDERHEADER 12
 
+/* Compressed files (see: G_FILE_COMPRESS) are written as a series of gzip members,
+ * each holding a block of the file compressed independently of the others, so blocks
+ * can be compressed and decompressed in parallel. zlib reads the members as a single
+ * stream, so these files still load as plain gzip files.
+ *
+ * The header of each member has an extra subfield 'BL' with the size of the whole
+ * member, which acts as an index to find the blocks without decompressing them. */
+#define BLEN_GZIP_BLOCK_SIZE    (1 << 20)
+#define BLEN_GZIP_HEADER_SIZE   20  /* gzip header with the 'BL' subfield */
+#define BLEN_GZIP_TRAILER_SIZE  8   /* crc32 and size of the uncompressed block */
+#define BLEN_GZIP_EXTRA_SI1     'B'
+#define BLEN_GZIP_EXTRA_SI2     'L'
+
 /***/
 struct Main;
 void blo_join_main(ListBase *mainlist);
@@ -145,6 +177,7 @@ void blo_end_sound_pointer_map(FileData *fd, Main *oldmain);
 void blo_make_packed_pointer_map(FileData *fd, Main *oldmain);
 void blo_end_packed_pointer_map(FileData *fd, Main *oldmain);
 void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd);
+void blo_make_undo_reuse_map(FileData *fd, Main *oldmain, struct MemFile *oldmain_memfile);
 
 void blo_freefiledata(FileData *fd);
 
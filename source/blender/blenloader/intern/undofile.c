@@ -35,88 +35,412 @@
 #include <stdio.h>
 #include <math.h>
 
+#include "zlib.h"
+
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
+#include "DNA_sdna_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BLO_undofile.h"
 
+/* **************** shared storage of chunk data *************** */
+
+/**
+ * Chunk data is shared by all undo steps: identical data is stored once, found by its hash,
+ * and reference counted by the chunks using it. So data that is unchanged but written at
+ * another offset than in the previous step (after adding a data-block for example) is not
+ * duplicated.
+ *
+ * Data only used by cold memfiles (see #BLO_memfile_set_cold) is compressed by tasks in
+ * the background. Buffers are only accessed from the main thread after the tasks finished.
+ */
+struct MemFileBuf {
+	char *buf;              /* raw data, NULL once compressed */
+	char *cbuf;             /* zlib stream of the data, when compressed */
+	unsigned int size, csize;
+	unsigned int hash;
+	unsigned int users;     /* chunks using the data, 0 for lookup keys */
+	unsigned int hot_users; /* chunks of memfiles that are not cold */
+	bool no_compress;       /* compression did not reduce the size */
+};
+
+/* don't bother compressing small buffers */
+#define MEMFILE_COMPRESS_MIN_SIZE 256
+
+static struct {
+	GHash *bufs;
+	/* raw or compressed size of all buffers */
+	size_t mem_in_use;
+
+	/* buffers that are being compressed */
+	TaskPool *compress_pool;
+	struct MemFileBuf **compress_bufs;
+	unsigned int compress_bufs_len;
+
+	/* last compressed buffer that was decompressed for reading */
+	const struct MemFileBuf *scratch_buf;
+	char *scratch;
+	unsigned int scratch_alloc;
+} memfile_store = {NULL};
+
+static const char *memfile_buf_data(const MemFileBuf *mbuf)
+{
+	uLongf size;
+
+	if (mbuf->buf) {
+		return mbuf->buf;
+	}
+
+	if (memfile_store.scratch_buf == mbuf) {
+		return memfile_store.scratch;
+	}
+
+	if (memfile_store.scratch_alloc < mbuf->size) {
+		MEM_SAFE_FREE(memfile_store.scratch);
+		memfile_store.scratch = MEM_mallocN(mbuf->size, "MemFileBuf scratch");
+		memfile_store.scratch_alloc = mbuf->size;
+	}
+
+	size = mbuf->size;
+	if (uncompress((Bytef *)memfile_store.scratch, &size, (const Bytef *)mbuf->cbuf, mbuf->csize) != Z_OK ||
+	    size != mbuf->size)
+	{
+		/* should never happen, the data was compressed by us */
+		printf("%s: failed to decompress undo data\n", __func__);
+		memset(memfile_store.scratch, 0, mbuf->size);
+	}
+
+	memfile_store.scratch_buf = mbuf;
+	return memfile_store.scratch;
+}
+
+static unsigned int memfile_buf_hash(const void *key)
+{
+	return ((const MemFileBuf *)key)->hash;
+}
+
+/* note that data of stored buffers is unique, only lookup keys have to be compared by content,
+ * so at most one of the buffers compared is decompressed into the scratch buffer */
+static bool memfile_buf_cmp(const void *a, const void *b)
+{
+	const MemFileBuf *mbuf_a = a, *mbuf_b = b;
+
+	if (mbuf_a == mbuf_b) {
+		return false;
+	}
+	if (mbuf_a->hash != mbuf_b->hash || mbuf_a->size != mbuf_b->size) {
+		return true;
+	}
+	if (mbuf_a->users && mbuf_b->users) {
+		return true;
+	}
+	return (memcmp(memfile_buf_data(mbuf_a), memfile_buf_data(mbuf_b), mbuf_a->size) != 0);
+}
+
+static void memfile_buf_compress_task(TaskPool *__restrict UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	MemFileBuf *mbuf = taskdata;
+	uLongf csize = compressBound(mbuf->size);
+	char *cbuf = MEM_mallocN(csize, "MemFileBuf compressed");
+
+	if (compress2((Bytef *)cbuf, &csize, (const Bytef *)mbuf->buf, mbuf->size, 1) == Z_OK &&
+	    csize < mbuf->size - mbuf->size / 8)
+	{
+		mbuf->cbuf = MEM_reallocN(cbuf, csize);
+		mbuf->csize = (unsigned int)csize;
+		MEM_freeN(mbuf->buf);
+		mbuf->buf = NULL;
+	}
+	else {
+		MEM_freeN(cbuf);
+		mbuf->no_compress = true;
+	}
+}
+
+void BLO_memfile_compress_wait(void)
+{
+	unsigned int i;
+
+	if (memfile_store.compress_pool == NULL) {
+		return;
+	}
+
+	BLI_task_pool_work_and_wait(memfile_store.compress_pool);
+	BLI_task_pool_free(memfile_store.compress_pool);
+	memfile_store.compress_pool = NULL;
+
+	for (i = 0; i < memfile_store.compress_bufs_len; i++) {
+		const MemFileBuf *mbuf = memfile_store.compress_bufs[i];
+		if (mbuf->cbuf) {
+			memfile_store.mem_in_use -= mbuf->size - mbuf->csize;
+		}
+	}
+
+	MEM_freeN(memfile_store.compress_bufs);
+	memfile_store.compress_bufs = NULL;
+	memfile_store.compress_bufs_len = 0;
+}
+
+void BLO_memfile_compress_cold(void)
+{
+	GHashIterator gh_iter;
+	unsigned int len = 0;
+
+	BLO_memfile_compress_wait();
+
+	if (memfile_store.bufs == NULL) {
+		return;
+	}
+
+	GHASH_ITER (gh_iter, memfile_store.bufs) {
+		MemFileBuf *mbuf = BLI_ghashIterator_getKey(&gh_iter);
+		if (mbuf->buf && mbuf->hot_users == 0 && !mbuf->no_compress && mbuf->size >= MEMFILE_COMPRESS_MIN_SIZE) {
+			if (memfile_store.compress_pool == NULL) {
+				memfile_store.compress_pool = BLI_task_pool_create(BLI_task_scheduler_get(), NULL);
+				memfile_store.compress_bufs = MEM_mallocN(
+				        sizeof(*memfile_store.compress_bufs) * BLI_ghash_size(memfile_store.bufs), __func__);
+			}
+			memfile_store.compress_bufs[len++] = mbuf;
+			BLI_task_pool_push(memfile_store.compress_pool, memfile_buf_compress_task, mbuf, false, TASK_PRIORITY_LOW);
+		}
+	}
+
+	memfile_store.compress_bufs_len = len;
+}
+
+size_t BLO_memfile_mem_in_use(void)
+{
+	return memfile_store.mem_in_use;
+}
+
+static MemFileBuf *memfile_buf_add(const char *buf, unsigned int size, bool *r_is_new)
+{
+	MemFileBuf key, *mbuf;
+
+	key.buf = (char *)buf;
+	key.cbuf = NULL;
+	key.size = size;
+	key.hash = BLI_hash_mm2((const unsigned char *)buf, size, 0);
+	key.users = 0;
+
+	if (memfile_store.bufs == NULL) {
+		memfile_store.bufs = BLI_ghash_new(memfile_buf_hash, memfile_buf_cmp, __func__);
+	}
+
+	mbuf = BLI_ghash_lookup(memfile_store.bufs, &key);
+	*r_is_new = (mbuf == NULL);
+
+	if (mbuf == NULL) {
+		mbuf = MEM_callocN(sizeof(MemFileBuf), "MemFileBuf");
+		mbuf->buf = MEM_mallocN(size, "Chunk buffer");
+		memcpy(mbuf->buf, buf, size);
+		mbuf->size = size;
+		mbuf->hash = key.hash;
+		mbuf->users = 1;
+		BLI_ghash_insert(memfile_store.bufs, mbuf, mbuf);
+		memfile_store.mem_in_use += size;
+		return mbuf;
+	}
+
+	mbuf->users++;
+	return mbuf;
+}
+
+static void memfile_buf_release(MemFileBuf *mbuf, bool hot)
+{
+	if (hot) {
+		mbuf->hot_users--;
+	}
+	if (--mbuf->users > 0) {
+		return;
+	}
+
+	BLI_ghash_remove(memfile_store.bufs, mbuf, NULL, NULL);
+
+	if (memfile_store.scratch_buf == mbuf) {
+		memfile_store.scratch_buf = NULL;
+	}
+
+	if (mbuf->buf) {
+		memfile_store.mem_in_use -= mbuf->size;
+		MEM_freeN(mbuf->buf);
+	}
+	else {
+		memfile_store.mem_in_use -= mbuf->csize;
+		MEM_freeN(mbuf->cbuf);
+	}
+	MEM_freeN(mbuf);
+
+	/* last undo step freed */
+	if (BLI_ghash_size(memfile_store.bufs) == 0) {
+		BLI_ghash_free(memfile_store.bufs, NULL, NULL);
+		memfile_store.bufs = NULL;
+		MEM_SAFE_FREE(memfile_store.scratch);
+		memfile_store.scratch_alloc = 0;
+	}
+}
+
 /* **************** support for memory-write, for undo buffers *************** */
 
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
 	MemFileChunk *chunk;
-	
+
+	BLO_memfile_compress_wait();
+
 	while ((chunk = BLI_pophead(&memfile->chunks))) {
-		if (chunk->ident == 0)
-			MEM_freeN(chunk->buf);
+		memfile_buf_release(chunk->data, !memfile->is_cold);
 		MEM_freeN(chunk);
 	}
 	memfile->size = 0;
+	memfile->is_cold = false;
 }
 
-/* to keep list of memfiles consistent, 'first' is always first in list */
-/* result is that 'first' is being freed */
-void BLO_memfile_merge(MemFile *first, MemFile *second)
+/* cold memfiles are not expected to be read soon, their data can be compressed */
+void BLO_memfile_set_cold(MemFile *memfile, bool is_cold)
 {
-	MemFileChunk *fc, *sc;
-	
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->ident) {
-				sc->ident = 0;
-				fc->ident = 1;
-			}
+	MemFileChunk *chunk;
+
+	if (memfile->is_cold == is_cold) {
+		return;
+	}
+
+	BLO_memfile_compress_wait();
+
+	for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+		if (is_cold) {
+			chunk->data->hot_users--;
+		}
+		else {
+			chunk->data->hot_users++;
 		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
 	}
-	
-	BLO_memfile_free(first);
+	memfile->is_cold = is_cold;
+}
+
+/**
+ * Data of the chunk, only valid until the data of another chunk is requested.
+ */
+const char *BLO_memfile_chunk_data(const MemFileChunk *chunk)
+{
+	BLO_memfile_compress_wait();
+
+	return memfile_buf_data(chunk->data);
 }
 
 void memfile_chunk_add(MemFile *compare, MemFile *current, const char *buf, unsigned int size)
 {
 	static MemFileChunk *compchunk = NULL;
 	MemFileChunk *curchunk;
+	bool is_new = false;
 	
 	/* this function inits when compare != NULL or when current == NULL  */
 	if (compare) {
+		BLO_memfile_compress_wait();
 		compchunk = compare->chunks.first;
 		return;
 	}
 	if (current == NULL) {
+		BLO_memfile_compress_wait();
 		compchunk = NULL;
 		return;
 	}
 	
 	curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
 	curchunk->size = size;
-	curchunk->buf = NULL;
-	curchunk->ident = 0;
+	curchunk->data = NULL;
+	curchunk->is_id_start = false;
 	BLI_addtail(&current->chunks, curchunk);
 	
-	/* we compare compchunk with buf */
+	/* we compare compchunk with buf first, which is cheaper than hashing */
 	if (compchunk) {
-		if (compchunk->size == curchunk->size) {
-			if (memcmp(compchunk->buf, buf, size) == 0) {
-				curchunk->buf = compchunk->buf;
-				curchunk->ident = 1;
+		if (compchunk->size == curchunk->size && compchunk->data->buf) {
+			if (memcmp(compchunk->data->buf, buf, size) == 0) {
+				curchunk->data = compchunk->data;
+				curchunk->data->users++;
 			}
 		}
 		compchunk = compchunk->next;
 	}
 	
-	/* not equal... */
-	if (curchunk->buf == NULL) {
-		curchunk->buf = MEM_mallocN(size, "Chunk buffer");
-		memcpy(curchunk->buf, buf, size);
-		current->size += size;
+	/* not equal, share the data with any other step */
+	if (curchunk->data == NULL) {
+		curchunk->data = memfile_buf_add(buf, size, &is_new);
+		if (is_new) {
+			current->size += size;
+		}
+	}
+
+	if (!current->is_cold) {
+		curchunk->data->hot_users++;
 	}
 }
 
+/**
+ * Find the IDs of memfile that were written identically in compare. The data of an ID is
+ * identical when the chunks from its first chunk up to the first chunk of the next ID use
+ * the same data in both memfiles.
+ *
+ * \return the old addresses of those IDs, or NULL when there are none.
+ */
+GSet *BLO_memfile_identical_ids(const MemFile *memfile, const MemFile *compare)
+{
+	GHash *id_chunks;
+	GSet *ids = NULL;
+	const MemFileChunk *chunk;
+
+	BLO_memfile_compress_wait();
+
+	/* first chunks of compare by their data, which is unique as it starts with the BHead of the ID */
+	id_chunks = BLI_ghash_ptr_new(__func__);
+	for (chunk = compare->chunks.first; chunk; chunk = chunk->next) {
+		if (chunk->is_id_start) {
+			BLI_ghash_insert(id_chunks, chunk->data, (void *)chunk);
+		}
+	}
+
+	for (chunk = memfile->chunks.first; chunk; chunk = chunk->next) {
+		const MemFileChunk *chunk_cmp, *chunk_iter;
+		const BHead *bhead;
+
+		if (!chunk->is_id_start || chunk->size < sizeof(BHead)) {
+			continue;
+		}
+
+		chunk_cmp = BLI_ghash_lookup(id_chunks, chunk->data);
+		if (chunk_cmp == NULL) {
+			continue;
+		}
+
+		for (chunk_iter = chunk->next, chunk_cmp = chunk_cmp->next;
+		     chunk_iter && !chunk_iter->is_id_start && chunk_cmp && !chunk_cmp->is_id_start;
+		     chunk_iter = chunk_iter->next, chunk_cmp = chunk_cmp->next)
+		{
+			if (chunk_iter->data != chunk_cmp->data) {
+				break;
+			}
+		}
+
+		if ((chunk_iter == NULL || chunk_iter->is_id_start) &&
+		    (chunk_cmp == NULL || chunk_cmp->is_id_start))
+		{
+			bhead = (const BHead *)memfile_buf_data(chunk->data);
+			if (ids == NULL) {
+				ids = BLI_gset_ptr_new(__func__);
+			}
+			BLI_gset_add(ids, (void *)bhead->old);
+		}
+	}
+
+	BLI_ghash_free(id_chunks, NULL, NULL);
+
+	return ids;
+}
@@ -1703,6 +1703,14 @@ void blo_do_versions_270(FileData *fd, Library *UNUSED(lib), Main *main)
 				}
 			}
 		}
+
+		if (!DNA_struct_elem_find(fd->filesdna, "bNodeTree", "int", "cache_limit")) {
+			FOREACH_NODETREE(main, ntree, id) {
+				if (ntree->type == NTREE_COMPOSIT) {
+					ntree->cache_limit = 256;
+				}
+			} FOREACH_NODETREE_END
+		}
 	}
 }
 
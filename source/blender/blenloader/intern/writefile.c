@@ -154,6 +154,8 @@
 #include "BLI_blenlib.h"
 #include "BLI_linklist.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BKE_action.h"
 #include "BKE_blender_version.h"
@@ -203,6 +205,7 @@
 typedef enum {
 	WW_WRAP_NONE = 1,
 	WW_WRAP_ZLIB,
+	WW_WRAP_ZLIB_BLOCKS,
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -216,6 +219,7 @@ struct WriteWrap {
 	union {
 		int file_handle;
 		gzFile gz_handle;
+		struct WriteWrapBlocks *blocks_handle;
 	} _user_data;
 };
 
@@ -275,6 +279,192 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+/* zlib blocks, compressed on all threads, see: BLEN_GZIP_BLOCK_SIZE */
+#define FILE_HANDLE(ww) \
+	(ww)->_user_data.blocks_handle
+
+typedef struct WriteWrapBlock {
+	char *data;  /* uncompressed block, freed after compression */
+	size_t data_len;
+	unsigned char *member;  /* gzip member holding the compressed block */
+	size_t member_len;
+} WriteWrapBlock;
+
+typedef struct WriteWrapBlocks {
+	int file_handle;
+	TaskPool *pool;
+	/* blocks being compressed, written in this order once all of them are done */
+	WriteWrapBlock *blocks;
+	int blocks_len, blocks_max;
+	/* block being filled */
+	char *buf;
+	size_t buf_len;
+	bool error;
+} WriteWrapBlocks;
+
+static void ww_block_uint32(unsigned char *p, unsigned int value)
+{
+	p[0] = (unsigned char)(value & 0xff);
+	p[1] = (unsigned char)((value >> 8) & 0xff);
+	p[2] = (unsigned char)((value >> 16) & 0xff);
+	p[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+static void ww_block_compress(TaskPool *__restrict UNUSED(pool), void *taskdata, int UNUSED(threadid))
+{
+	WriteWrapBlock *block = taskdata;
+	z_stream strm = {NULL};
+	unsigned char *header;
+	size_t bound;
+
+	/* same compression level as the "wb1" gzip stream */
+	if (deflateInit2(&strm, 1, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+		bound = deflateBound(&strm, block->data_len);
+		block->member = MEM_mallocN(BLEN_GZIP_HEADER_SIZE + bound + BLEN_GZIP_TRAILER_SIZE, __func__);
+
+		strm.next_in = (Bytef *)block->data;
+		strm.avail_in = (uInt)block->data_len;
+		strm.next_out = block->member + BLEN_GZIP_HEADER_SIZE;
+		strm.avail_out = (uInt)bound;
+
+		if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+			block->member_len = BLEN_GZIP_HEADER_SIZE + strm.total_out + BLEN_GZIP_TRAILER_SIZE;
+
+			/* gzip header with an extra field, unknown OS */
+			header = block->member;
+			memset(header, 0, BLEN_GZIP_HEADER_SIZE);
+			header[0] = 0x1f;
+			header[1] = 0x8b;
+			header[2] = Z_DEFLATED;
+			header[3] = 0x04;  /* FEXTRA */
+			header[9] = 0xff;
+			header[10] = 8;  /* XLEN */
+			header[12] = BLEN_GZIP_EXTRA_SI1;
+			header[13] = BLEN_GZIP_EXTRA_SI2;
+			header[14] = 4;
+			ww_block_uint32(header + 16, (unsigned int)block->member_len);
+
+			ww_block_uint32(block->member + block->member_len - 8,
+			                (unsigned int)crc32(0, (const Bytef *)block->data, (uInt)block->data_len));
+			ww_block_uint32(block->member + block->member_len - 4, (unsigned int)block->data_len);
+		}
+
+		deflateEnd(&strm);
+	}
+
+	MEM_freeN(block->data);
+	block->data = NULL;
+}
+
+/* wait for the blocks being compressed and write them */
+static void ww_blocks_flush(WriteWrapBlocks *handle)
+{
+	int i;
+
+	BLI_task_pool_work_and_wait(handle->pool);
+
+	for (i = 0; i < handle->blocks_len; i++) {
+		WriteWrapBlock *block = &handle->blocks[i];
+
+		if (block->member_len == 0 ||
+		    write(handle->file_handle, block->member, block->member_len) != block->member_len)
+		{
+			handle->error = true;
+		}
+
+		if (block->member) {
+			MEM_freeN(block->member);
+		}
+		memset(block, 0, sizeof(*block));
+	}
+
+	handle->blocks_len = 0;
+}
+
+static void ww_blocks_push(WriteWrapBlocks *handle)
+{
+	WriteWrapBlock *block;
+
+	if (handle->buf_len == 0) {
+		return;
+	}
+
+	block = &handle->blocks[handle->blocks_len++];
+	block->data = handle->buf;
+	block->data_len = handle->buf_len;
+	BLI_task_pool_push(handle->pool, ww_block_compress, block, false, TASK_PRIORITY_HIGH);
+
+	handle->buf = MEM_mallocN(BLEN_GZIP_BLOCK_SIZE, __func__);
+	handle->buf_len = 0;
+
+	/* bound memory usage, writing out blocks while more are compressed would need ordering */
+	if (handle->blocks_len == handle->blocks_max) {
+		ww_blocks_flush(handle);
+	}
+}
+
+static bool ww_open_zlib_blocks(WriteWrap *ww, const char *filepath)
+{
+	TaskScheduler *scheduler;
+	WriteWrapBlocks *handle;
+	int file;
+
+	file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+	if (file == -1) {
+		return false;
+	}
+
+	scheduler = BLI_task_scheduler_get();
+	handle = MEM_callocN(sizeof(*handle), __func__);
+	handle->file_handle = file;
+	handle->pool = BLI_task_pool_create(scheduler, NULL);
+	handle->blocks_max = 2 * BLI_task_scheduler_num_threads(scheduler);
+	handle->blocks = MEM_callocN(sizeof(*handle->blocks) * handle->blocks_max, __func__);
+	handle->buf = MEM_mallocN(BLEN_GZIP_BLOCK_SIZE, __func__);
+
+	FILE_HANDLE(ww) = handle;
+	return true;
+}
+static bool ww_close_zlib_blocks(WriteWrap *ww)
+{
+	WriteWrapBlocks *handle = FILE_HANDLE(ww);
+	bool ok;
+
+	ww_blocks_push(handle);
+	ww_blocks_flush(handle);
+
+	ok = !handle->error && (close(handle->file_handle) != -1);
+
+	BLI_task_pool_free(handle->pool);
+	MEM_freeN(handle->blocks);
+	MEM_freeN(handle->buf);
+	MEM_freeN(handle);
+
+	return ok;
+}
+static size_t ww_write_zlib_blocks(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+	WriteWrapBlocks *handle = FILE_HANDLE(ww);
+	size_t written = 0;
+
+	while (written < buf_len) {
+		const size_t len = MIN2(buf_len - written, BLEN_GZIP_BLOCK_SIZE - handle->buf_len);
+
+		memcpy(handle->buf + handle->buf_len, buf + written, len);
+		handle->buf_len += len;
+		written += len;
+
+		if (handle->buf_len == BLEN_GZIP_BLOCK_SIZE) {
+			ww_blocks_push(handle);
+		}
+	}
+
+	/* errors of blocks written so far, the last blocks are checked on close */
+	return (handle->error) ? 0 : buf_len;
+}
+#undef FILE_HANDLE
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -289,6 +479,13 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 			r_ww->write = ww_write_zlib;
 			break;
 		}
+		case WW_WRAP_ZLIB_BLOCKS:
+		{
+			r_ww->open  = ww_open_zlib_blocks;
+			r_ww->close = ww_close_zlib_blocks;
+			r_ww->write = ww_write_zlib_blocks;
+			break;
+		}
 		default:
 		{
 			r_ww->open  = ww_open_none;
@@ -311,6 +508,8 @@ typedef struct {
 
 	int tot, count;
 	bool error;
+	/* the next chunk added to current starts the data of an ID */
+	bool is_id_start;
 
 	/* Wrap writing, so we can use zlib or
 	 * other compression types later, see: G_FILE_COMPRESS
@@ -348,6 +547,11 @@ static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
 	/* memory based save */
 	if (wd->current) {
 		memfile_chunk_add(NULL, wd->current, mem, memlen);
+
+		if (wd->is_id_start) {
+			((MemFileChunk *)wd->current->chunks.last)->is_id_start = true;
+			wd->is_id_start = false;
+		}
 	}
 	else {
 		if (wd->ww->write(wd->ww, mem, memlen) != memlen) {
@@ -376,6 +580,19 @@ static void mywrite_flush(WriteData *wd)
 	}
 }
 
+/**
+ * Start the data of an ID in a new chunk for undo, so the chunks of an ID that did not change
+ * are identical to those of other steps, and can be found when reading the memfile,
+ * see #BLO_memfile_identical_ids.
+ */
+static void mywrite_id_begin(WriteData *wd)
+{
+	if (wd->current) {
+		mywrite_flush(wd);
+		wd->is_id_start = true;
+	}
+}
+
 /**
  * Low level WRITE(2) wrapper that buffers data
  * \param adr Pointer to new chunk of data
@@ -3840,6 +4057,8 @@ static bool write_file_handle(
 			/* We should never attempt to write non-regular IDs (i.e. all kind of temp/runtime ones). */
 			BLI_assert((id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
 
+			mywrite_id_begin(wd);
+
 			switch ((ID_Type)GS(id->name)) {
 				case ID_WM:
 					write_windowmanager(wd, (wmWindowManager *)id);
@@ -3954,11 +4173,14 @@ static bool write_file_handle(
 		mywrite_flush(wd);
 	}
 
+	/* Ends the data of the last ID. */
+	mywrite_id_begin(wd);
+
 	/* Special handling, operating over split Mains... */
 	write_libraries(wd,  mainvar->next);
 
 	/* So changes above don't cause a 'DNA1' to be detected as changed on undo. */
-	mywrite_flush(wd);
+	mywrite_id_begin(wd);
 
 	if (write_flags & G_FILE_USERPREFS) {
 		write_userdef(wd);
@@ -4052,7 +4274,7 @@ bool BLO_write_file(
 	BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
 	if (write_flags & G_FILE_COMPRESS) {
-		ww_type = WW_WRAP_ZLIB;
+		ww_type = WW_WRAP_ZLIB_BLOCKS;
 	}
 	else {
 		ww_type = WW_WRAP_NONE;
@@ -4101,9 +4323,12 @@ bool BLO_write_file(
 	}
 
 	/* actual file writing */
-	const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
+	bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
 
-	ww.close(&ww);
+	/* compressed data may only be written on close */
+	if (ww.close(&ww) == false) {
+		err = true;
+	}
 
 	if (UNLIKELY(path_list_backup)) {
 		BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
@@ -331,6 +331,25 @@ void COM_deinitialize(void);
  */
 // void COM_clearCaches(void); // NOT YET WRITTEN
 
+/**
+ * @brief Start rendering the frames of an animation up to efra.
+ * While a frame is composited, image sequences of the next frame are decoded
+ * and output files of the previous frame are written in the background.
+ */
+void COM_sequence_begin(int efra, int frame_step);
+
+/**
+ * @brief Wait for all output files of the animation to be written.
+ */
+void COM_sequence_end(void);
+
+/**
+ * @brief Time in milliseconds spent on a node in the last execution,
+ * only measured when profiling is enabled with --debug-compositor.
+ * @return -1 when no time was measured for the node
+ */
+float COM_profile_node_time(const struct bNode *node);
+
 #ifdef __cplusplus
 }
 #endif
@@ -111,4 +111,10 @@ typedef enum OrderOfChunks {
 
 #define COM_BLUR_BOKEH_PIXELS 512
 
+/**
+ * @brief maximum number of pixels calculated at once in row execution mode.
+ * Every operation in a chain keeps its input rows on the stack, so this is kept small.
+ */
+#define COM_ROW_SIZE 64
+
 #endif  /* __COM_DEFINES_H__ */
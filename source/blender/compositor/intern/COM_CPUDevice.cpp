@@ -21,6 +21,9 @@
  */
 
 #include "COM_CPUDevice.h"
+#include "COM_Profiler.h"
+
+#include "PIL_time.h"
 
 CPUDevice::CPUDevice(int thread_id)
   : Device(),
@@ -36,8 +39,14 @@ void CPUDevice::execute(WorkPackage *work)
 
 	executionGroup->determineChunkRect(&rect, chunkNumber);
 
+	const double start_time = Profiler::is_enabled() ? PIL_check_seconds_timer() : 0.0;
+
 	executionGroup->getOutputOperation()->executeRegion(&rect, chunkNumber);
 
+	if (Profiler::is_enabled()) {
+		Profiler::chunk_executed(executionGroup, &rect, PIL_check_seconds_timer() - start_time);
+	}
+
 	executionGroup->finalizeChunkExecution(chunkNumber, NULL);
 }
 
@@ -82,6 +82,16 @@ private:
 	 */
 	bool m_fastCalculation;
 
+	/**
+	 * @brief Calculate pixel-wise operations a row at a time
+	 */
+	bool m_rowExecution;
+
+	/**
+	 * @brief Reuse results of previous executions
+	 */
+	bool m_resultCache;
+
 	/* @brief color management settings */
 	const ColorManagedViewSettings *m_viewSettings;
 	const ColorManagedDisplaySettings *m_displaySettings;
@@ -199,6 +209,10 @@ public:
 	
 	void setFastCalculation(bool fastCalculation) {this->m_fastCalculation = fastCalculation;}
 	bool isFastCalculation() const { return this->m_fastCalculation; }
+	void setRowExecution(bool rowExecution) { this->m_rowExecution = rowExecution; }
+	bool isRowExecution() const { return this->m_rowExecution; }
+	void setResultCache(bool resultCache) { this->m_resultCache = resultCache; }
+	bool isResultCacheEnabled() const { return this->m_resultCache; }
 	bool isGroupnodeBufferEnabled() const { return (this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0; }
 };
 
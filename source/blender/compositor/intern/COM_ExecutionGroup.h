@@ -399,6 +399,16 @@ public:
 
 	void setChunksize(int chunksize) { this->m_chunkSize = chunksize; }
 
+	/**
+	 * @brief mark all chunks as executed, when the result was restored from the ResultCache
+	 */
+	void setChunksExecuted();
+
+	/**
+	 * @brief have all chunks of this ExecutionGroup been executed
+	 */
+	bool isExecuted() const;
+
 	/**
 	 * @brief get the Render priority of this ExecutionGroup
 	 * @see ExecutionSystem.execute
@@ -413,8 +423,9 @@ public:
 
 	void setRenderBorder(float xmin, float xmax, float ymin, float ymax);
 
-	/* allow the DebugInfo class to look at internals */
+	/* allow the DebugInfo and Profiler classes to look at internals */
 	friend class DebugInfo;
+	friend class Profiler;
 
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionGroup")
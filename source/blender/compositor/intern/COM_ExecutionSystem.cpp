@@ -36,6 +36,9 @@ extern "C" {
 #include "COM_ExecutionGroup.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+#include "COM_ResultCache.h"
+#include "COM_Profiler.h"
 #include "COM_Debug.h"
 
 #ifdef WITH_CXX_GUARDEDALLOC
@@ -51,6 +54,8 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, Scene *scene, bNodeTree *editin
 	this->m_context.setbNodeTree(editingtree);
 	this->m_context.setPreviewHash(editingtree->previews);
 	this->m_context.setFastCalculation(fastcalculation);
+	this->m_context.setRowExecution((editingtree->flag & NTREE_COM_ROW_EXECUTION) != 0);
+	this->m_context.setResultCache(!rendering && (editingtree->flag & NTREE_COM_RESULT_CACHE));
 	/* initialize the CompositorContext */
 	if (rendering) {
 		this->m_context.setQuality((CompositorQuality)editingtree->render_quality);
@@ -65,6 +70,8 @@ ExecutionSystem::ExecutionSystem(RenderData *rd, Scene *scene, bNodeTree *editin
 	this->m_context.setViewSettings(viewSettings);
 	this->m_context.setDisplaySettings(displaySettings);
 
+	Profiler::convert_started();
+
 	{
 		NodeOperationBuilder builder(&m_context, editingtree);
 		builder.convertToOperations(this);
@@ -132,6 +139,7 @@ void ExecutionSystem::execute()
 	editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing | Initializing execution"));
 
 	DebugInfo::execute_started(this);
+	Profiler::execute_started(this);
 	
 	unsigned int order = 0;
 	for (vector<NodeOperation *>::iterator iter = this->m_operations.begin(); iter != this->m_operations.end(); ++iter) {
@@ -148,8 +156,10 @@ void ExecutionSystem::execute()
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		if (operation->isWriteBufferOperation()) {
-			operation->setbNodeTree(this->m_context.getbNodeTree());
-			operation->initExecution();
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			writeOperation->setbNodeTree(this->m_context.getbNodeTree());
+			writeOperation->setUseRowExecution(this->m_context.isRowExecution());
+			writeOperation->initExecution();
 		}
 	}
 	// Connect read buffers to their write buffers
@@ -165,6 +175,7 @@ void ExecutionSystem::execute()
 		NodeOperation *operation = this->m_operations[index];
 		if (!operation->isWriteBufferOperation()) {
 			operation->setbNodeTree(this->m_context.getbNodeTree());
+			operation->setUseRowExecution(this->m_context.isRowExecution());
 			operation->initExecution();
 		}
 	}
@@ -174,6 +185,11 @@ void ExecutionSystem::execute()
 		executionGroup->initExecution();
 	}
 
+	ResultKeys resultKeys;
+	if (this->m_context.isResultCacheEnabled()) {
+		restoreCachedResults(resultKeys);
+	}
+
 	WorkScheduler::start(this->m_context);
 
 	executeGroups(COM_PRIORITY_HIGH);
@@ -185,6 +201,10 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	if (this->m_context.isResultCacheEnabled() && !editingtree->test_break(editingtree->tbh)) {
+		storeCachedResults(resultKeys);
+	}
+
 	editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing | De-initializing execution"));
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
@@ -194,6 +214,51 @@ void ExecutionSystem::execute()
 		ExecutionGroup *executionGroup = this->m_groups[index];
 		executionGroup->deinitExecution();
 	}
+
+	Profiler::execute_finished(this);
+}
+
+void ExecutionSystem::restoreCachedResults(ResultKeys &resultKeys)
+{
+	const uint64_t contextKey = ResultCache::contextKey(this->m_context);
+	ResultCache::OperationKeys operationKeys;
+	unsigned int index;
+
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (!operation->isWriteBufferOperation()) {
+			continue;
+		}
+
+		WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+		MemoryProxy *memoryProxy = writeOperation->getMemoryProxy();
+		ExecutionGroup *group = memoryProxy->getExecutor();
+		if (group == NULL || writeOperation->isSingleValue()) {
+			continue;
+		}
+
+		const uint64_t key = ResultCache::operationKey(writeOperation, contextKey, operationKeys);
+		if (ResultCache::restore(key, memoryProxy->getBuffer())) {
+			group->setChunksExecuted();
+		}
+		else {
+			resultKeys[writeOperation] = key;
+		}
+	}
+}
+
+void ExecutionSystem::storeCachedResults(const ResultKeys &resultKeys)
+{
+	for (ResultKeys::const_iterator it = resultKeys.begin(); it != resultKeys.end(); ++it) {
+		MemoryProxy *memoryProxy = it->first->getMemoryProxy();
+
+		/* results of a viewer border or an interrupted fast calculation are incomplete */
+		if (memoryProxy->getExecutor()->isExecuted()) {
+			ResultCache::store(it->second, memoryProxy->getBuffer(), memoryProxy->getDataType());
+		}
+	}
+
+	ResultCache::limit((size_t)this->m_context.getbNodeTree()->cache_limit * 1024 * 1024);
 }
 
 void ExecutionSystem::executeGroups(CompositorPriority priority)
@@ -25,6 +25,8 @@ class ExecutionGroup;
 #ifndef _COM_ExecutionSystem_h
 #define _COM_ExecutionSystem_h
 
+#include <map>
+
 #include "DNA_color_types.h"
 #include "DNA_node_types.h"
 #include "COM_Node.h"
@@ -114,6 +116,7 @@ class ExecutionSystem {
 public:
 	typedef std::vector<NodeOperation*> Operations;
 	typedef std::vector<ExecutionGroup*> Groups;
+	typedef std::map<WriteBufferOperation*, uint64_t> ResultKeys;
 	
 private:
 	/**
@@ -177,8 +180,20 @@ public:
 private:
 	void executeGroups(CompositorPriority priority);
 
-	/* allow the DebugInfo class to look at internals */
+	/**
+	 * @brief fill write buffers from the ResultCache and skip the groups calculating them
+	 * @param resultKeys keys of the write buffers that have to be calculated
+	 */
+	void restoreCachedResults(ResultKeys &resultKeys);
+
+	/**
+	 * @brief store the calculated write buffers in the ResultCache
+	 */
+	void storeCachedResults(const ResultKeys &resultKeys);
+
+	/* allow the DebugInfo and Profiler classes to look at internals */
 	friend class DebugInfo;
+	friend class Profiler;
 
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionSystem")
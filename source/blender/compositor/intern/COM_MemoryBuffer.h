@@ -127,7 +127,7 @@ public:
 	 */
 	unsigned int getChunkNumber() { return this->m_chunkNumber; }
 
-	unsigned int get_num_channels() { return this->m_num_channels; }
+	unsigned int get_num_channels() const { return this->m_num_channels; }
 
 	/**
 	 * @brief get the data of this MemoryBuffer
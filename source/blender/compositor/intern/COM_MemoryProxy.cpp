@@ -21,6 +21,8 @@
  */
 
 #include "COM_MemoryProxy.h"
+#include "COM_Profiler.h"
+#include "COM_WriteBufferOperation.h"
 
 
 MemoryProxy::MemoryProxy(DataType datatype)
@@ -39,6 +41,7 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
 	result.ymax = height;
 
 	this->m_buffer = new MemoryBuffer(this, 1, &result);
+	Profiler::buffer_allocated(this->m_writeBufferOperation, this->m_buffer);
 }
 
 void MemoryProxy::free()
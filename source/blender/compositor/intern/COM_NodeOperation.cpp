@@ -41,6 +41,8 @@ NodeOperation::NodeOperation()
 	this->m_isResolutionSet = false;
 	this->m_openCL = false;
 	this->m_btree = NULL;
+	this->m_parameterHash = 0;
+	this->m_useRowExecution = false;
 }
 
 NodeOperation::~NodeOperation()
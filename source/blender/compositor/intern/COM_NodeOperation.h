@@ -30,6 +30,7 @@
 extern "C" {
 #include "BLI_math_color.h"
 #include "BLI_math_vector.h"
+#include "BLI_sys_types.h"
 #include "BLI_threads.h"
 }
 
@@ -125,6 +126,18 @@ private:
 	 * @brief set to truth when resolution for this operation is set
 	 */
 	bool m_isResolutionSet;
+
+	/**
+	 * @brief hash of the node settings this operation was created from
+	 * @see ResultCache
+	 */
+	uint64_t m_parameterHash;
+
+	/**
+	 * @brief calculate rows of pixels with readRow instead of single pixels
+	 * @see CompositorContext.isRowExecution
+	 */
+	bool m_useRowExecution;
 	
 public:
 	virtual ~NodeOperation();
@@ -166,6 +179,10 @@ public:
 	virtual int isSingleThreaded() { return false; }
 
 	void setbNodeTree(const bNodeTree *tree) { this->m_btree = tree; }
+	void setParameterHash(uint64_t hash) { this->m_parameterHash = hash; }
+	uint64_t getParameterHash() const { return this->m_parameterHash; }
+	void setUseRowExecution(bool useRowExecution) { this->m_useRowExecution = useRowExecution; }
+	bool isRowExecution() const { return this->m_useRowExecution; }
 	virtual void initExecution();
 	
 	/**
@@ -245,6 +262,14 @@ public:
 
 	virtual bool isSetOperation() const { return false; }
 
+	/**
+	 * @brief does this operation implement executeRow with its own loop
+	 *
+	 * In row execution mode the output of these operations is stored in a full-frame buffer,
+	 * so every such node is calculated over the whole image at once.
+	 */
+	virtual bool isRowOperation() const { return false; }
+
 	/**
 	 * @brief is this operation of type ReadBufferOperation
 	 * @return [true:false]
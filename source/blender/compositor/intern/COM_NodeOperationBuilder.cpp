@@ -28,6 +28,8 @@ extern "C" {
 #include "COM_Debug.h"
 #include "COM_ExecutionSystem.h"
 #include "COM_Node.h"
+#include "COM_Profiler.h"
+#include "COM_ResultCache.h"
 #include "COM_SocketProxyNode.h"
 
 #include "COM_NodeOperation.h"
@@ -45,6 +47,8 @@ extern "C" {
 NodeOperationBuilder::NodeOperationBuilder(const CompositorContext *context, bNodeTree *b_nodetree) :
     m_context(context),
     m_current_node(NULL),
+    m_current_node_key(0),
+    m_current_node_operations(0),
     m_active_viewer(NULL)
 {
 	m_graph.from_bNodeTree(*context, b_nodetree);
@@ -63,6 +67,9 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 		Node *node = (Node *)m_graph.nodes()[index];
 		
 		m_current_node = node;
+		m_current_node_operations = 0;
+		if (m_context->isResultCacheEnabled())
+			m_current_node_key = ResultCache::nodeKey(node->getbNode());
 		
 		DebugInfo::node_to_operations(node);
 		node->convertToOperations(converter, *m_context);
@@ -112,6 +119,10 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	/* surround complex ops with read/write buffer */
 	add_complex_operation_buffers();
 	
+	/* store results of row ops in full-frame buffers */
+	if (m_context->isRowExecution())
+		add_row_operation_buffers();
+	
 	/* links not available from here on */
 	/* XXX make m_links a local variable to avoid confusion! */
 	m_links.clear();
@@ -130,6 +141,16 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
+	if (m_current_node && m_context->isResultCacheEnabled()) {
+		/* operations of a node are always added in the same order */
+		ResultHash hash;
+		hash.addKey(m_current_node_key);
+		hash.addInt(m_current_node_operations++);
+		operation->setParameterHash(hash.end());
+	}
+	
+	Profiler::operation_added(operation, m_current_node ? m_current_node->getbNode() : NULL);
+	
 	m_operations.push_back(operation);
 }
 
@@ -313,6 +334,13 @@ void NodeOperationBuilder::add_operation_input_constants()
 	}
 }
 
+static uint64_t constant_value_key(const void *value, size_t size)
+{
+	ResultHash hash;
+	hash.add(value, size);
+	return hash.end();
+}
+
 void NodeOperationBuilder::add_input_constant_value(NodeOperationInput *input, NodeInput *node_input)
 {
 	switch (input->getDataType()) {
@@ -325,6 +353,7 @@ void NodeOperationBuilder::add_input_constant_value(NodeOperationInput *input, N
 			
 			SetValueOperation *op = new SetValueOperation();
 			op->setValue(value);
+			op->setParameterHash(constant_value_key(&value, sizeof(value)));
 			addOperation(op);
 			addLink(op->getOutputSocket(), input);
 			break;
@@ -338,6 +367,7 @@ void NodeOperationBuilder::add_input_constant_value(NodeOperationInput *input, N
 			
 			SetColorOperation *op = new SetColorOperation();
 			op->setChannels(value);
+			op->setParameterHash(constant_value_key(value, sizeof(value)));
 			addOperation(op);
 			addLink(op->getOutputSocket(), input);
 			break;
@@ -351,6 +381,7 @@ void NodeOperationBuilder::add_input_constant_value(NodeOperationInput *input, N
 			
 			SetVectorOperation *op = new SetVectorOperation();
 			op->setVector(value);
+			op->setParameterHash(constant_value_key(value, sizeof(value)));
 			addOperation(op);
 			addLink(op->getOutputSocket(), input);
 			break;
@@ -568,6 +599,27 @@ void NodeOperationBuilder::add_complex_operation_buffers()
 	}
 }
 
+void NodeOperationBuilder::add_row_operation_buffers()
+{
+	/* note: row ops are cached first, since adding operations invalidates iterators */
+	Operations row_ops;
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
+		NodeOperation *op = *it;
+		/* constant results are left to per pixel reads, they have no resolution to buffer */
+		if (op->isRowOperation() && op->getWidth() > 0 && op->getHeight() > 0)
+			row_ops.push_back(op);
+	}
+	
+	for (Operations::const_iterator it = row_ops.begin(); it != row_ops.end(); ++it) {
+		NodeOperation *op = *it;
+		
+		DebugInfo::operation_read_write_buffer(op);
+		
+		for (int index = 0; index < op->getNumberOfOutputSockets(); index++)
+			add_output_buffers(op, op->getOutputSocket(index));
+	}
+}
+
 typedef std::set<NodeOperation*> Tags;
 
 static void find_reachable_operations_recursive(Tags &reachable, NodeOperation *op)
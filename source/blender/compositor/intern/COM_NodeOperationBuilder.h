@@ -87,6 +87,9 @@ private:
 	OutputSocketMap m_output_map;
 	
 	Node *m_current_node;
+	/** Hash of the current node settings and number of operations added for it, for the result cache */
+	uint64_t m_current_node_key;
+	int m_current_node_operations;
 	
 	/** Operation that will be writing to the viewer image
 	 *  Only one operation can occupy this place at a time,
@@ -146,6 +149,7 @@ protected:
 	WriteBufferOperation *find_attached_write_buffer_operation(NodeOperationOutput *output) const;
 	/** Add read/write buffer operations around complex operations */
 	void add_complex_operation_buffers();
+	void add_row_operation_buffers();
 	void add_input_buffers(NodeOperation *operation, NodeOperationInput *input);
 	void add_output_buffers(NodeOperation *operation, NodeOperationOutput *output);
 	
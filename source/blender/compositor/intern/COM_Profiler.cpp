@@ -0,0 +1,330 @@
+/*
+ * Copyright 2017, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <typeinfo>
+#include <map>
+
+#include "COM_Profiler.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_ExecutionSystem.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_NodeOperation.h"
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_path_util.h"
+#  include "BLI_rect.h"
+#  include "BLI_string.h"
+#  include "BLI_threads.h"
+#  include "DNA_node_types.h"
+#  include "BKE_appdir.h"
+#  include "BKE_global.h"
+}
+
+#include "PIL_time.h"
+
+typedef struct ProfileOperation {
+	const bNode *bnode;
+	double time;
+	unsigned int chunks;
+	size_t pixels;
+	size_t bytes;
+} ProfileOperation;
+
+typedef struct ProfileGroup {
+	double time;
+	unsigned int chunks;
+	size_t pixels;
+} ProfileGroup;
+
+typedef std::map<const NodeOperation *, ProfileOperation> ProfileOperations;
+typedef std::map<const ExecutionGroup *, ProfileGroup> ProfileGroups;
+typedef std::map<const bNode *, float> ProfileNodeTimes;
+
+bool Profiler::m_enabled = false;
+int Profiler::m_file_index = 0;
+
+static ThreadMutex g_mutex = BLI_MUTEX_INITIALIZER;
+static ProfileOperations g_operations;
+static ProfileGroups g_groups;
+static double g_start_time = 0.0;
+
+/* buffer memory is relative to the start of the execution, buffers of the result cache
+ * that were allocated before are not included */
+static long long g_resident_bytes = 0;
+static long long g_peak_bytes = 0;
+static int g_resident_buffers = 0;
+static int g_peak_buffers = 0;
+
+/* times of the last execution, read by the node editor when drawing */
+static ThreadMutex g_node_times_mutex = BLI_MUTEX_INITIALIZER;
+static ProfileNodeTimes g_node_times;
+
+static size_t profile_buffer_size(const MemoryBuffer *buffer)
+{
+	return sizeof(float) * buffer->getWidth() * buffer->getHeight() * buffer->get_num_channels();
+}
+
+static const bNode *profile_original_node(const bNode *bnode)
+{
+	return (bnode && bnode->original) ? bnode->original : bnode;
+}
+
+static void profile_write_string(FILE *fp, const char *str)
+{
+	fputc('"', fp);
+	for (const char *c = str; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(fp, "\\%c", *c);
+		}
+		else if ((unsigned char)*c < 0x20) {
+			fprintf(fp, "\\u%04x", (unsigned char)*c);
+		}
+		else {
+			fputc(*c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+void Profiler::convert_started()
+{
+	m_enabled = (G.debug & G_DEBUG_COMPOSITOR) != 0;
+
+	BLI_mutex_lock(&g_mutex);
+	g_operations.clear();
+	g_groups.clear();
+	g_resident_bytes = 0;
+	g_peak_bytes = 0;
+	g_resident_buffers = 0;
+	g_peak_buffers = 0;
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void Profiler::operation_added(const NodeOperation *operation, const bNode *bnode)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	ProfileOperation &profile = g_operations[operation];
+	profile.bnode = bnode;
+	profile.time = 0.0;
+	profile.chunks = 0;
+	profile.pixels = 0;
+	profile.bytes = 0;
+}
+
+void Profiler::execute_started(const ExecutionSystem * /*system*/)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	g_start_time = PIL_check_seconds_timer();
+}
+
+void Profiler::chunk_executed(const ExecutionGroup *group, const rcti *rect, double time)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	BLI_mutex_lock(&g_mutex);
+	ProfileGroup &profile = g_groups[group];
+	profile.time += time;
+	profile.chunks++;
+	profile.pixels += (size_t)BLI_rcti_size_x(rect) * BLI_rcti_size_y(rect);
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void Profiler::buffer_allocated(const NodeOperation *operation, const MemoryBuffer *buffer)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	BLI_mutex_lock(&g_mutex);
+	ProfileOperations::iterator it = g_operations.find(operation);
+	if (it != g_operations.end()) {
+		it->second.bytes += profile_buffer_size(buffer);
+	}
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void Profiler::buffer_created(const MemoryBuffer *buffer)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	BLI_mutex_lock(&g_mutex);
+	g_resident_bytes += profile_buffer_size(buffer);
+	g_resident_buffers++;
+	if (g_resident_bytes > g_peak_bytes) {
+		g_peak_bytes = g_resident_bytes;
+	}
+	if (g_resident_buffers > g_peak_buffers) {
+		g_peak_buffers = g_resident_buffers;
+	}
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void Profiler::buffer_freed(const MemoryBuffer *buffer)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	BLI_mutex_lock(&g_mutex);
+	g_resident_bytes -= profile_buffer_size(buffer);
+	g_resident_buffers--;
+	BLI_mutex_unlock(&g_mutex);
+}
+
+void Profiler::execute_finished(const ExecutionSystem *system)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	const double total_time = PIL_check_seconds_timer() - g_start_time;
+	std::map<const NodeOperation *, int> indices;
+	ProfileNodeTimes node_times;
+	unsigned int index;
+
+	BLI_mutex_lock(&g_mutex);
+
+	for (index = 0; index < system->m_operations.size(); index++) {
+		indices[system->m_operations[index]] = index;
+	}
+
+	/* attribute group statistics to the operations */
+	for (index = 0; index < system->m_groups.size(); index++) {
+		const ExecutionGroup *group = system->m_groups[index];
+		ProfileGroups::const_iterator group_it = g_groups.find(group);
+		if (group_it == g_groups.end()) {
+			continue;
+		}
+		const ProfileGroup &group_profile = group_it->second;
+
+		const NodeOperation *timed_operation = group->getOutputOperation();
+		for (unsigned int i = 0; i < group->m_operations.size(); i++) {
+			const NodeOperation *operation = group->m_operations[i];
+			if (operation->isComplex()) {
+				timed_operation = operation;
+				break;
+			}
+		}
+
+		for (unsigned int i = 0; i < group->m_operations.size(); i++) {
+			ProfileOperation &profile = g_operations[group->m_operations[i]];
+			profile.chunks += group_profile.chunks;
+			profile.pixels += group_profile.pixels;
+		}
+		g_operations[timed_operation].time += group_profile.time;
+	}
+
+	for (index = 0; index < system->m_operations.size(); index++) {
+		const ProfileOperation &profile = g_operations[system->m_operations[index]];
+		if (profile.bnode) {
+			node_times[profile_original_node(profile.bnode)] += (float)(profile.time * 1000.0);
+		}
+	}
+
+	char basename[FILE_MAX];
+	char filename[FILE_MAX];
+	BLI_snprintf(basename, sizeof(basename), "compositor_profile_%d.json", m_file_index);
+	BLI_join_dirfile(filename, sizeof(filename), BKE_tempdir_session(), basename);
+	++m_file_index;
+
+	FILE *fp = BLI_fopen(filename, "wb");
+	if (fp) {
+		fprintf(fp, "{\n");
+		fprintf(fp, "\t\"time\": %f,\n", total_time);
+		fprintf(fp, "\t\"peak_buffer_bytes\": %lld,\n", g_peak_bytes);
+		fprintf(fp, "\t\"peak_buffers\": %d,\n", g_peak_buffers);
+
+		fprintf(fp, "\t\"operations\": [\n");
+		for (index = 0; index < system->m_operations.size(); index++) {
+			const NodeOperation *operation = system->m_operations[index];
+			const ProfileOperation &profile = g_operations[operation];
+
+			fprintf(fp, "\t\t{\"index\": %u, \"type\": ", index);
+			profile_write_string(fp, typeid(*operation).name());
+			fprintf(fp, ", \"node\": ");
+			if (profile.bnode) {
+				profile_write_string(fp, profile.bnode->name);
+			}
+			else {
+				fprintf(fp, "null");
+			}
+			fprintf(fp, ", \"complex\": %s, \"width\": %u, \"height\": %u, "
+			        "\"time\": %f, \"chunks\": %u, \"pixels\": %zu, \"buffer_bytes\": %zu}%s\n",
+			        operation->isComplex() ? "true" : "false",
+			        operation->getWidth(), operation->getHeight(),
+			        profile.time, profile.chunks, profile.pixels, profile.bytes,
+			        (index + 1 < system->m_operations.size()) ? "," : "");
+		}
+		fprintf(fp, "\t],\n");
+
+		fprintf(fp, "\t\"groups\": [\n");
+		for (index = 0; index < system->m_groups.size(); index++) {
+			const ExecutionGroup *group = system->m_groups[index];
+			ProfileGroups::const_iterator group_it = g_groups.find(group);
+			const ProfileGroup empty = {0.0, 0, 0};
+			const ProfileGroup &profile = (group_it != g_groups.end()) ? group_it->second : empty;
+
+			fprintf(fp, "\t\t{\"index\": %u, \"output\": %d, \"complex\": %s, "
+			        "\"time\": %f, \"chunks\": %u, \"pixels\": %zu, \"operations\": [",
+			        index, indices[group->getOutputOperation()],
+			        group->isComplex() ? "true" : "false",
+			        profile.time, profile.chunks, profile.pixels);
+			for (unsigned int i = 0; i < group->m_operations.size(); i++) {
+				fprintf(fp, "%s%d", (i > 0) ? ", " : "", indices[group->m_operations[i]]);
+			}
+			fprintf(fp, "]}%s\n", (index + 1 < system->m_groups.size()) ? "," : "");
+		}
+		fprintf(fp, "\t]\n");
+		fprintf(fp, "}\n");
+		fclose(fp);
+
+		printf("Compositor profile written to %s\n", filename);
+	}
+
+	BLI_mutex_unlock(&g_mutex);
+
+	BLI_mutex_lock(&g_node_times_mutex);
+	g_node_times.swap(node_times);
+	BLI_mutex_unlock(&g_node_times_mutex);
+}
+
+float Profiler::node_time(const bNode *bnode)
+{
+	float time = -1.0f;
+
+	BLI_mutex_lock(&g_node_times_mutex);
+	ProfileNodeTimes::const_iterator it = g_node_times.find(profile_original_node(bnode));
+	if (it != g_node_times.end()) {
+		time = it->second;
+	}
+	BLI_mutex_unlock(&g_node_times_mutex);
+
+	return time;
+}
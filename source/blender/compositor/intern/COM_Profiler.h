@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_Profiler_h_
+#define _COM_Profiler_h_
+
+#include <stddef.h>
+
+#include "COM_defines.h"
+
+class ExecutionGroup;
+class ExecutionSystem;
+class MemoryBuffer;
+class NodeOperation;
+struct bNode;
+struct rcti;
+
+/**
+ * @brief collects time and memory statistics of an execution of the compositor
+ *
+ * Enabled at runtime with the --debug-compositor command line argument. After every
+ * execution the statistics are written as JSON to compositor_profile_<n>.json in the
+ * session temp directory, next to the graphviz files written by DebugInfo.
+ *
+ * Operations of an execution group are pulled pixel by pixel by the output operation
+ * of the group, so their time can not be measured separately. The time of the chunks
+ * of a group is attributed to the complex operation reading the input buffers of the
+ * group when it has one, otherwise to the output operation. Chunks and pixels are
+ * counted for all operations of the group.
+ * @ingroup Execution
+ */
+class Profiler {
+public:
+	static bool is_enabled() { return m_enabled; }
+
+	/** @brief reset statistics before the node tree is converted to operations */
+	static void convert_started();
+	static void operation_added(const NodeOperation *operation, const bNode *bnode);
+
+	static void execute_started(const ExecutionSystem *system);
+	/** @brief write the statistics of the execution to a JSON file */
+	static void execute_finished(const ExecutionSystem *system);
+
+	/** @brief called by devices after executing a chunk, thread safe */
+	static void chunk_executed(const ExecutionGroup *group, const rcti *rect, double time);
+
+	/** @brief buffer holding the result of an operation, that lives until the end of the execution */
+	static void buffer_allocated(const NodeOperation *operation, const MemoryBuffer *buffer);
+	static void buffer_created(const MemoryBuffer *buffer);
+	static void buffer_freed(const MemoryBuffer *buffer);
+
+	/**
+	 * @brief time in milliseconds attributed to a node in the last execution
+	 * @return -1 when no time was measured for the node
+	 */
+	static float node_time(const bNode *bnode);
+
+private:
+	static bool m_enabled;
+	static int m_file_index;
+};
+
+#endif /* _COM_Profiler_h_ */
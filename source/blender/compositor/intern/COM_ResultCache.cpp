@@ -0,0 +1,290 @@
+/*
+ * Copyright 2017, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <typeinfo>
+
+#include "COM_ResultCache.h"
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_NodeOperation.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+
+extern "C" {
+#  include "DNA_color_types.h"
+#  include "DNA_image_types.h"
+#  include "DNA_node_types.h"
+#  include "DNA_scene_types.h"
+#  include "BKE_image.h"
+#  include "BKE_node.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+/* ******** Result Hash ******** */
+
+ResultHash::ResultHash()
+{
+	BLI_hash_mm2a_init(&this->m_hash[0], 0);
+	BLI_hash_mm2a_init(&this->m_hash[1], 0x9e3779b9);
+}
+
+void ResultHash::add(const void *data, size_t size)
+{
+	BLI_hash_mm2a_add(&this->m_hash[0], (const unsigned char *)data, size);
+	BLI_hash_mm2a_add(&this->m_hash[1], (const unsigned char *)data, size);
+}
+
+void ResultHash::addInt(int value)
+{
+	BLI_hash_mm2a_add_int(&this->m_hash[0], value);
+	BLI_hash_mm2a_add_int(&this->m_hash[1], value);
+}
+
+void ResultHash::addKey(uint64_t key)
+{
+	add(&key, sizeof(key));
+}
+
+void ResultHash::addString(const char *str)
+{
+	if (str) {
+		add(str, strlen(str) + 1);
+	}
+	else {
+		addInt(0);
+	}
+}
+
+uint64_t ResultHash::end()
+{
+	const uint64_t hash0 = BLI_hash_mm2a_end(&this->m_hash[0]);
+	const uint64_t hash1 = BLI_hash_mm2a_end(&this->m_hash[1]);
+	return (hash0 << 32) | hash1;
+}
+
+/* ******** Result Cache ******** */
+
+typedef struct ResultCacheEntry {
+	MemoryBuffer *buffer;
+	size_t size;
+	unsigned int lastUsed;
+} ResultCacheEntry;
+
+typedef std::map<uint64_t, ResultCacheEntry> ResultCacheEntries;
+typedef std::map<bNode *, unsigned int> ResultCacheNodeVersions;
+
+static ResultCacheEntries g_entries;
+static ResultCacheNodeVersions g_nodeVersions;
+static size_t g_size = 0;
+static unsigned int g_usage = 0;
+
+/* nodes reading data that is changed without tagging the node for an update */
+static bool result_cache_node_is_volatile(const bNode *bnode)
+{
+	switch (bnode->type) {
+		case CMP_NODE_TEXTURE:
+		case CMP_NODE_MASK:
+			return true;
+		case CMP_NODE_IMAGE:
+		{
+			/* render result and viewer images */
+			const Image *image = (const Image *)bnode->id;
+			return (image && image->source == IMA_SRC_VIEWER);
+		}
+		default:
+			return false;
+	}
+}
+
+uint64_t ResultCache::nodeKey(bNode *bnode)
+{
+	ResultHash hash;
+
+	if (bnode == NULL) {
+		return hash.end();
+	}
+
+	hash.addString(bnode->idname);
+	hash.addInt(bnode->type);
+	hash.addInt(bnode->flag & NODE_MUTED);
+	hash.addInt(bnode->custom1);
+	hash.addInt(bnode->custom2);
+	hash.add(&bnode->custom3, sizeof(bnode->custom3));
+	hash.add(&bnode->custom4, sizeof(bnode->custom4));
+	hash.add(&bnode->id, sizeof(bnode->id));
+
+	/* storage is hashed including its pointers, which change for every localized tree,
+	 * so results of nodes with nested storage (curves for example) are never reused */
+	if (bnode->storage) {
+		hash.add(bnode->storage, MEM_allocN_len(bnode->storage));
+	}
+
+	for (bNodeSocket *sock = (bNodeSocket *)bnode->inputs.first; sock; sock = sock->next) {
+		if (sock->default_value) {
+			hash.add(sock->default_value, MEM_allocN_len(sock->default_value));
+		}
+		else {
+			hash.addInt(0);
+		}
+	}
+
+	/* nodes are tagged for execution when the data they read changes, after a render or
+	 * when an image or movie clip is edited, which gives their results a new version */
+	bNode *original = (bnode->original) ? bnode->original : bnode;
+	unsigned int &version = g_nodeVersions[original];
+	if (bnode->need_exec || result_cache_node_is_volatile(bnode)) {
+		version++;
+	}
+	hash.addInt(version);
+
+	return hash.end();
+}
+
+uint64_t ResultCache::contextKey(const CompositorContext &context)
+{
+	ResultHash hash;
+	const RenderData *rd = context.getRenderData();
+	const ColorManagedViewSettings *viewSettings = context.getViewSettings();
+	const ColorManagedDisplaySettings *displaySettings = context.getDisplaySettings();
+	const Scene *scene = context.getScene();
+
+	hash.add(&scene, sizeof(scene));
+	hash.addInt(rd->xsch);
+	hash.addInt(rd->ysch);
+	hash.addInt(rd->size);
+	hash.addInt(rd->cfra);
+	hash.add(&rd->subframe, sizeof(rd->subframe));
+	hash.addInt(context.getQuality());
+	hash.addInt(context.isFastCalculation());
+	hash.addString(context.getViewName());
+
+	if (viewSettings) {
+		hash.addString(viewSettings->view_transform);
+		hash.addString(viewSettings->look);
+		hash.add(&viewSettings->exposure, sizeof(viewSettings->exposure));
+		hash.add(&viewSettings->gamma, sizeof(viewSettings->gamma));
+	}
+	if (displaySettings) {
+		hash.addString(displaySettings->display_device);
+	}
+
+	return hash.end();
+}
+
+uint64_t ResultCache::operationKey(NodeOperation *operation, uint64_t contextKey, OperationKeys &keys)
+{
+	OperationKeys::const_iterator it = keys.find(operation);
+	if (it != keys.end()) {
+		return it->second;
+	}
+
+	ResultHash hash;
+	hash.addKey(contextKey);
+	hash.addString(typeid(*operation).name());
+	hash.addKey(operation->getParameterHash());
+	hash.addInt(operation->getWidth());
+	hash.addInt(operation->getHeight());
+
+	for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+		NodeOperationInput *input = operation->getInputSocket(index);
+		if (input->isConnected()) {
+			hash.addKey(operationKey(&input->getLink()->getOperation(), contextKey, keys));
+		}
+		else {
+			hash.addInt(0);
+		}
+	}
+
+	/* results read from a buffer depend on everything written to it */
+	if (operation->isReadBufferOperation()) {
+		ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+		WriteBufferOperation *writeOperation = readOperation->getMemoryProxy()->getWriteBufferOperation();
+		hash.addKey(operationKey(writeOperation, contextKey, keys));
+	}
+
+	const uint64_t key = hash.end();
+	keys[operation] = key;
+	return key;
+}
+
+bool ResultCache::restore(uint64_t key, MemoryBuffer *buffer)
+{
+	ResultCacheEntries::iterator it = g_entries.find(key);
+	if (it == g_entries.end()) {
+		return false;
+	}
+
+	ResultCacheEntry &entry = it->second;
+	if (!BLI_rcti_compare(entry.buffer->getRect(), buffer->getRect()) ||
+	    entry.buffer->get_num_channels() != buffer->get_num_channels())
+	{
+		return false;
+	}
+
+	buffer->copyContentFrom(entry.buffer);
+	buffer->setCreatedState();
+	entry.lastUsed = ++g_usage;
+	return true;
+}
+
+void ResultCache::store(uint64_t key, MemoryBuffer *buffer, DataType datatype)
+{
+	ResultCacheEntries::iterator it = g_entries.find(key);
+	if (it != g_entries.end()) {
+		g_size -= it->second.size;
+		delete it->second.buffer;
+		g_entries.erase(it);
+	}
+
+	ResultCacheEntry entry;
+	entry.buffer = new MemoryBuffer(datatype, buffer->getRect());
+	entry.buffer->copyContentFrom(buffer);
+	entry.size = sizeof(float) * entry.buffer->getWidth() * entry.buffer->getHeight() * entry.buffer->get_num_channels();
+	entry.lastUsed = ++g_usage;
+
+	g_entries[key] = entry;
+	g_size += entry.size;
+}
+
+void ResultCache::limit(size_t limit)
+{
+	while (g_size > limit && !g_entries.empty()) {
+		ResultCacheEntries::iterator oldest = g_entries.begin();
+		for (ResultCacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+			if (it->second.lastUsed < oldest->second.lastUsed) {
+				oldest = it;
+			}
+		}
+
+		g_size -= oldest->second.size;
+		delete oldest->second.buffer;
+		g_entries.erase(oldest);
+	}
+}
+
+void ResultCache::clear()
+{
+	for (ResultCacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+		delete it->second.buffer;
+	}
+	g_entries.clear();
+	g_nodeVersions.clear();
+	g_size = 0;
+}
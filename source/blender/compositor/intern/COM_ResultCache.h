@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_ResultCache_h_
+#define _COM_ResultCache_h_
+
+#include <map>
+
+extern "C" {
+#  include "BLI_hash_mm2a.h"
+#  include "BLI_sys_types.h"
+}
+
+#include "COM_defines.h"
+
+class CompositorContext;
+class MemoryBuffer;
+class NodeOperation;
+struct bNode;
+
+/**
+ * @brief incremental hash of everything an operation result depends on
+ * Two murmur hashes with a different seed are combined into a 64 bit key,
+ * so that unrelated results are very unlikely to share a key.
+ * @ingroup Execution
+ */
+class ResultHash {
+private:
+	BLI_HashMurmur2A m_hash[2];
+
+public:
+	ResultHash();
+
+	void add(const void *data, size_t size);
+	void addInt(int value);
+	void addKey(uint64_t key);
+	void addString(const char *str);
+
+	uint64_t end();
+};
+
+/**
+ * @brief keeps the results of write buffer operations between executions of the compositor
+ *
+ * Every write buffer operation gets a key, that is the hash of the parameters of the operations
+ * it is calculated from, including those of all operations upstream. When the key of a write
+ * buffer matches a cached result, the buffer is filled from the cache and the execution group
+ * calculating it is skipped.
+ *
+ * Parameters are hashed per node, data outside of the node tree (render results, images,
+ * movie clips) is handled by giving a node a new version every time it is tagged for
+ * execution by an update.
+ *
+ * The cache is only used while editing, it is not thread safe and relies on COM_execute
+ * running one execution system at a time.
+ * @ingroup Execution
+ */
+class ResultCache {
+public:
+	typedef std::map<NodeOperation *, uint64_t> OperationKeys;
+
+	/**
+	 * @brief hash the settings of a node and its unconnected inputs
+	 */
+	static uint64_t nodeKey(bNode *bnode);
+
+	/**
+	 * @brief hash the settings of the context that operations depend on
+	 */
+	static uint64_t contextKey(const CompositorContext &context);
+
+	/**
+	 * @brief determine the key of the result of an operation
+	 * @param keys keys of operations that are already determined, to share them between write buffers
+	 */
+	static uint64_t operationKey(NodeOperation *operation, uint64_t contextKey, OperationKeys &keys);
+
+	/**
+	 * @brief fill a buffer with the cached result for key
+	 * @return true when a cached result of the same size was found
+	 */
+	static bool restore(uint64_t key, MemoryBuffer *buffer);
+
+	/**
+	 * @brief store a copy of a buffer as the result for key
+	 */
+	static void store(uint64_t key, MemoryBuffer *buffer, DataType datatype);
+
+	/**
+	 * @brief free least recently used results until at most limit bytes are used
+	 */
+	static void limit(size_t limit);
+
+	/**
+	 * @brief free all cached results
+	 */
+	static void clear();
+};
+
+#endif /* _COM_ResultCache_h_ */
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2017, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "COM_SequencePipeline.h"
+
+extern "C" {
+#  include "BLI_task.h"
+#  include "BLI_utildefines.h"
+#  include "DNA_image_types.h"
+#  include "DNA_node_types.h"
+#  include "BKE_image.h"
+#  include "BKE_node.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+typedef struct SequenceWrite {
+	SequencePipeline::WriteFunc func;
+	void *data;
+} SequenceWrite;
+
+static bool g_active = false;
+static int g_lastFrame = 0;
+static int g_frameStep = 1;
+
+static TaskPool *g_prefetchPool = NULL;
+static int g_prefetchFrame = 0;
+
+static TaskPool *g_writePool = NULL;
+static int g_writeFrame = 0;
+
+static void sequence_prefetch_run(TaskPool *__restrict /*pool*/, void *taskdata, int /*threadid*/)
+{
+	BKE_image_prefetch_load((ImagePrefetch *)taskdata);
+}
+
+static void sequence_write_run(TaskPool *__restrict /*pool*/, void *taskdata, int /*threadid*/)
+{
+	SequenceWrite *write = (SequenceWrite *)taskdata;
+	write->func(write->data);
+	MEM_freeN(write->data);
+}
+
+static void sequence_prefetch_tree(bNodeTree *ntree, int frame)
+{
+	for (bNode *node = (bNode *)ntree->nodes.first; node; node = node->next) {
+		if (node->flag & NODE_MUTED) {
+			continue;
+		}
+
+		if (node->type == CMP_NODE_IMAGE && node->id && node->storage) {
+			ImagePrefetch *prefetch = BKE_image_prefetch_add((Image *)node->id, (ImageUser *)node->storage, frame);
+			if (prefetch) {
+				BLI_task_pool_push(g_prefetchPool, sequence_prefetch_run, prefetch, false, TASK_PRIORITY_LOW);
+			}
+		}
+		else if (node->type == NODE_GROUP && node->id) {
+			sequence_prefetch_tree((bNodeTree *)node->id, frame);
+		}
+	}
+}
+
+void SequencePipeline::begin(int lastFrame, int frameStep)
+{
+	if (g_active) {
+		end();
+	}
+
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	g_prefetchPool = BLI_task_pool_create(scheduler, NULL);
+	g_writePool = BLI_task_pool_create(scheduler, NULL);
+	g_lastFrame = lastFrame;
+	g_frameStep = (frameStep > 0) ? frameStep : 1;
+	g_prefetchFrame = 0;
+	g_writeFrame = 0;
+	g_active = true;
+}
+
+void SequencePipeline::end()
+{
+	if (!g_active) {
+		return;
+	}
+
+	BLI_task_pool_work_and_wait(g_prefetchPool);
+	BLI_task_pool_free(g_prefetchPool);
+	g_prefetchPool = NULL;
+	BKE_image_prefetch_free();
+
+	BLI_task_pool_work_and_wait(g_writePool);
+	BLI_task_pool_free(g_writePool);
+	g_writePool = NULL;
+
+	g_active = false;
+}
+
+bool SequencePipeline::isActive()
+{
+	return g_active;
+}
+
+void SequencePipeline::prefetchNextFrame(bNodeTree *ntree, int frame)
+{
+	const int nextFrame = frame + g_frameStep;
+
+	/* the tree is executed once per view, the next frame only needs to be prefetched once */
+	if (!g_active || nextFrame > g_lastFrame || nextFrame == g_prefetchFrame) {
+		return;
+	}
+
+	/* images of the current frame are acquired by now, what is left was not used */
+	BLI_task_pool_work_and_wait(g_prefetchPool);
+	BKE_image_prefetch_free();
+
+	g_prefetchFrame = nextFrame;
+	sequence_prefetch_tree(ntree, nextFrame);
+}
+
+void SequencePipeline::write(int frame, WriteFunc func, void *data)
+{
+	BLI_assert(g_active);
+
+	/* bound the memory used by output buffers to a single frame */
+	if (frame != g_writeFrame) {
+		BLI_task_pool_work_and_wait(g_writePool);
+		g_writeFrame = frame;
+	}
+
+	SequenceWrite *write = (SequenceWrite *)MEM_mallocN(sizeof(SequenceWrite), "SequenceWrite");
+	write->func = func;
+	write->data = data;
+	BLI_task_pool_push(g_writePool, sequence_write_run, write, true, TASK_PRIORITY_LOW);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _COM_SequencePipeline_h_
+#define _COM_SequencePipeline_h_
+
+struct bNodeTree;
+
+/**
+ * @brief pipelines the input and output of the compositor when rendering an animation
+ *
+ * While a frame is being composited, the files of image sequences used by the next frame
+ * are decoded in the background, and the output files of the previous frame are written.
+ * The work is done by the task scheduler, next to the threads of the WorkScheduler.
+ *
+ * Writes of a frame are waited for before the output files of the next frame are queued,
+ * so that at most one frame of output buffers is kept in memory.
+ * @ingroup Execution
+ */
+class SequencePipeline {
+public:
+	typedef void (*WriteFunc)(void *data);
+
+	/**
+	 * @brief start rendering the frames up to lastFrame
+	 */
+	static void begin(int lastFrame, int frameStep);
+
+	/**
+	 * @brief wait for all output files to be written and free unused prefetched images
+	 */
+	static void end();
+
+	static bool isActive();
+
+	/**
+	 * @brief decode the image sequences used by the tree for the frame after frame
+	 * Called after the images of the current frame are acquired.
+	 */
+	static void prefetchNextFrame(bNodeTree *ntree, int frame);
+
+	/**
+	 * @brief run func in the background to write an output file of frame
+	 * The pipeline takes ownership of data, which is freed with MEM_freeN after writing.
+	 */
+	static void write(int frame, WriteFunc func, void *data);
+};
+
+#endif /* _COM_SequencePipeline_h_ */
@@ -21,6 +21,7 @@
  */
 
 #include "COM_SingleThreadedOperation.h"
+#include "COM_Profiler.h"
 
 SingleThreadedOperation::SingleThreadedOperation() : NodeOperation()
 {
@@ -54,6 +55,7 @@ void *SingleThreadedOperation::initializeTileData(rcti *rect)
 	if (this->m_cachedInstance == NULL) {
 		//
 		this->m_cachedInstance = createMemoryBuffer(rect);
+		Profiler::buffer_allocated(this, this->m_cachedInstance);
 	}
 	unlockMutex();
 	return this->m_cachedInstance;
@@ -95,6 +95,21 @@ protected:
 	                                  float /*x*/, float /*y*/,
 	                                  float /*dx*/[2], float /*dy*/[2]) {}
 
+	/**
+	 * @brief calculate a row of pixels
+	 * @note this method is called for non-complex when row execution is enabled,
+	 * operations can override it with a loop that does not go through a virtual call per pixel.
+	 * @param output is a float[width * 4] array to store the result, 4 floats per pixel
+	 * @param x the x-coordinate of the first pixel to calculate in image space
+	 * @param y the y-coordinate of the row to calculate in image space
+	 * @param width number of pixels to calculate, at most COM_ROW_SIZE
+	 */
+	virtual void executeRow(float *output, int x, int y, int width) {
+		for (int i = 0; i < width; i++) {
+			executePixelSampled(output + i * 4, x + i, y, COM_PS_NEAREST);
+		}
+	}
+
 public:
 	inline void readSampled(float result[4], float x, float y, PixelSampler sampler) {
 		executePixelSampled(result, x, y, sampler);
@@ -105,6 +120,9 @@ public:
 	inline void readFiltered(float result[4], float x, float y, float dx[2], float dy[2]) {
 		executePixelFiltered(result, x, y, dx, dy);
 	}
+	inline void readRow(float *result, int x, int y, int width) {
+		executeRow(result, x, y, width);
+	}
 
 	virtual void *initializeTileData(rcti * /*rect*/) { return 0; }
 	virtual void deinitializeTileData(rcti * /*rect*/, void * /*data*/) {}
@@ -32,6 +32,9 @@ extern "C" {
 
 #include "COM_compositor.h"
 #include "COM_ExecutionSystem.h"
+#include "COM_Profiler.h"
+#include "COM_ResultCache.h"
+#include "COM_SequencePipeline.h"
 #include "COM_WorkScheduler.h"
 #include "clew.h"
 #include "COM_MovieDistortionOperation.h"
@@ -88,6 +91,11 @@ void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rende
 	editingtree->progress(editingtree->prh, 0.0);
 	editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing"));
 
+	/* free results of previous executions when the cache got disabled */
+	if (!(editingtree->flag & NTREE_COM_RESULT_CACHE)) {
+		ResultCache::clear();
+	}
+
 	bool twopass = (editingtree->flag & NTREE_TWO_PASS) > 0 && !rendering;
 	/* initialize execution system */
 	if (twopass) {
@@ -105,6 +113,12 @@ void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rende
 
 	ExecutionSystem *system = new ExecutionSystem(rd, scene, editingtree, rendering, false,
 	                                              viewSettings, displaySettings, viewName);
+
+	/* images of this frame are acquired when determining the resolution */
+	if (rendering && SequencePipeline::isActive()) {
+		SequencePipeline::prefetchNextFrame(editingtree, rd->cfra);
+	}
+
 	system->execute();
 	delete system;
 
@@ -116,8 +130,25 @@ void COM_deinitialize()
 	if (is_compositorMutex_init) {
 		BLI_mutex_lock(&s_compositorMutex);
 		WorkScheduler::deinitialize();
+		ResultCache::clear();
+		SequencePipeline::end();
 		is_compositorMutex_init = false;
 		BLI_mutex_unlock(&s_compositorMutex);
 		BLI_mutex_end(&s_compositorMutex);
 	}
 }
+
+void COM_sequence_begin(int efra, int frame_step)
+{
+	SequencePipeline::begin(efra, frame_step);
+}
+
+void COM_sequence_end(void)
+{
+	SequencePipeline::end();
+}
+
+float COM_profile_node_time(const bNode *node)
+{
+	return Profiler::node_time(node);
+}
@@ -33,6 +33,10 @@
 #include "COM_SetValueOperation.h"
 #include "COM_GammaCorrectOperation.h"
 
+/* radius from which a gaussian blur is calculated with the recursive filter of the fast
+ * gaussian blur, which has a fixed cost per pixel instead of one growing with the radius */
+#define BLUR_RECURSIVE_GAUSS_RADIUS 64.0f
+
 BlurNode::BlurNode(bNode *editorNode) : Node(editorNode)
 {
 	/* pass */
@@ -51,10 +55,21 @@ void BlurNode::convertToOperations(NodeConverter &converter, const CompositorCon
 	CompositorQuality quality = context.getQuality();
 	NodeOperation *input_operation = NULL, *output_operation = NULL;
 
-	if (data->filtertype == R_FILTER_FAST_GAUSS) {
+	const bool use_recursive_gauss = (data->filtertype == R_FILTER_GAUSS &&
+	                                  !data->bokeh &&
+	                                  !connectedSizeSocket &&
+	                                  !(editorNode->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) &&
+	                                  size * max_ii(data->sizex, data->sizey) >= BLUR_RECURSIVE_GAUSS_RADIUS);
+
+	if (data->filtertype == R_FILTER_FAST_GAUSS || use_recursive_gauss) {
 		FastGaussianBlurOperation *operationfgb = new FastGaussianBlurOperation();
 		operationfgb->setData(data);
 		operationfgb->setExtendBounds(extend_bounds);
+		if (use_recursive_gauss) {
+			/* the gaussian filter is cut off at three times sigma */
+			operationfgb->setSigmaScale(1.0f / 3.0f);
+			operationfgb->setSize(size);
+		}
 		converter.addOperation(operationfgb);
 		
 		converter.mapInputSocket(getInputSocket(1), operationfgb->getInputSocket(1));
@@ -187,6 +187,39 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 	}
 #endif
 
+	if (this->isRowExecution()) {
+		float image[COM_ROW_SIZE * 4], alpha[COM_ROW_SIZE * 4], depth[COM_ROW_SIZE * 4];
+
+		for (y = y1; y < y2 && (!breaked); y++) {
+			for (x = x1; x < x2; x += COM_ROW_SIZE) {
+				const int width = min_ii(COM_ROW_SIZE, x2 - x);
+				int input_x = x + dx, input_y = y + dy;
+
+				this->m_imageInput->readRow(image, input_x, input_y, width);
+				if (this->m_useAlphaInput) {
+					this->m_alphaInput->readRow(alpha, input_x, input_y, width);
+				}
+				this->m_depthInput->readRow(depth, input_x, input_y, width);
+
+				for (int i = 0; i < width; i++) {
+					copy_v4_v4(buffer + offset4, image + i * 4);
+					if (this->m_useAlphaInput) {
+						buffer[offset4 + 3] = alpha[i * 4];
+					}
+					zbuffer[offset] = depth[i * 4];
+					offset4 += COM_NUM_CHANNELS_COLOR;
+					offset++;
+				}
+			}
+			if (isBreaked()) {
+				breaked = true;
+			}
+			offset += add;
+			offset4 += add * COM_NUM_CHANNELS_COLOR;
+		}
+		return;
+	}
+
 	for (y = y1; y < y2 && (!breaked); y++) {
 		for (x = x1; x < x2 && (!breaked); x++) {
 			int input_x = x + dx, input_y = y + dy;
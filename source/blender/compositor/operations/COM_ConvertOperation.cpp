@@ -58,6 +58,17 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4], float x,
 	output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeRow(float *output, int x, int y, int width)
+{
+	float input[COM_ROW_SIZE * 4];
+	this->m_inputOperation->readRow(input, x, y, width);
+	for (int i = 0; i < width; i++) {
+		float *out = output + i * 4;
+		out[0] = out[1] = out[2] = input[i * 4];
+		out[3] = 1.0f;
+	}
+}
+
 
 /* ******** Color to Value ******** */
 
@@ -74,6 +85,16 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4], float x,
 	output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeRow(float *output, int x, int y, int width)
+{
+	float input[COM_ROW_SIZE * 4];
+	this->m_inputOperation->readRow(input, x, y, width);
+	for (int i = 0; i < width; i++) {
+		const float *color = input + i * 4;
+		output[i * 4] = (color[0] + color[1] + color[2]) / 3.0f;
+	}
+}
+
 
 /* ******** Color to BW ******** */
 
@@ -90,6 +111,15 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4], float x, fl
 	output[0] = IMB_colormanagement_get_luminance(inputColor);
 }
 
+void ConvertColorToBWOperation::executeRow(float *output, int x, int y, int width)
+{
+	float input[COM_ROW_SIZE * 4];
+	this->m_inputOperation->readRow(input, x, y, width);
+	for (int i = 0; i < width; i++) {
+		output[i * 4] = IMB_colormanagement_get_luminance(input + i * 4);
+	}
+}
+
 
 /* ******** Color to Vector ******** */
 
@@ -114,6 +144,11 @@ ConvertValueToVectorOperation::ConvertValueToVectorOperation() : ConvertBaseOper
 	this->addOutputSocket(COM_DT_VECTOR);
 }
 
+void ConvertColorToVectorOperation::executeRow(float *output, int x, int y, int width)
+{
+	this->m_inputOperation->readRow(output, x, y, width);
+}
+
 void ConvertValueToVectorOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float value;
@@ -121,6 +156,16 @@ void ConvertValueToVectorOperation::executePixelSampled(float output[4], float x
 	output[0] = output[1] = output[2] = value;
 }
 
+void ConvertValueToVectorOperation::executeRow(float *output, int x, int y, int width)
+{
+	float input[COM_ROW_SIZE * 4];
+	this->m_inputOperation->readRow(input, x, y, width);
+	for (int i = 0; i < width; i++) {
+		float *out = output + i * 4;
+		out[0] = out[1] = out[2] = input[i * 4];
+	}
+}
+
 
 /* ******** Vector to Color ******** */
 
@@ -136,6 +181,14 @@ void ConvertVectorToColorOperation::executePixelSampled(float output[4], float x
 	output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::executeRow(float *output, int x, int y, int width)
+{
+	this->m_inputOperation->readRow(output, x, y, width);
+	for (int i = 0; i < width; i++) {
+		output[i * 4 + 3] = 1.0f;
+	}
+}
+
 
 /* ******** Vector to Value ******** */
 
@@ -152,6 +205,16 @@ void ConvertVectorToValueOperation::executePixelSampled(float output[4], float x
 	output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::executeRow(float *output, int x, int y, int width)
+{
+	float input[COM_ROW_SIZE * 4];
+	this->m_inputOperation->readRow(input, x, y, width);
+	for (int i = 0; i < width; i++) {
+		const float *vector = input + i * 4;
+		output[i * 4] = (vector[0] + vector[1] + vector[2]) / 3.0f;
+	}
+}
+
 
 /* ******** RGB to YCC ******** */
 
@@ -30,16 +30,28 @@ class FastGaussianBlurOperation : public BlurBaseOperation {
 private:
 	float m_sx;
 	float m_sy;
+	float m_sigmaScale;
 	MemoryBuffer *m_iirgaus;
 public:
 	FastGaussianBlurOperation();
 	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
 	void executePixel(float output[4], int x, int y, void *data);
 	
+	/**
+	 * @brief recursive gaussian blur of one channel of a buffer, the cost is independent of sigma
+	 * Lines are filtered in parallel using the task scheduler.
+	 * @param xy 1 to blur horizontally, 2 vertically, 3 in both directions
+	 */
 	static void IIR_gauss(MemoryBuffer *src, float sigma, unsigned int channel, unsigned int xy);
 	void *initializeTileData(rcti *rect);
 	void deinitExecution();
 	void initExecution();
+
+	/**
+	 * @brief factor from the blur size to sigma, 0.5 by default
+	 * Use 1/3 to match the radius of the gaussian filter of the other blur operations.
+	 */
+	void setSigmaScale(float scale) { this->m_sigmaScale = scale; }
 };
 
 enum {
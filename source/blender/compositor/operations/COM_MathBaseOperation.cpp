@@ -72,6 +72,12 @@ void MathBaseOperation::clampIfNeeded(float *color)
 	}
 }
 
+void MathBaseOperation::readInputRows(float *inputValue1, float *inputValue2, int x, int y, int width)
+{
+	this->m_inputValue1Operation->readRow(inputValue1, x, y, width);
+	this->m_inputValue2Operation->readRow(inputValue2, x, y, width);
+}
+
 void MathAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -85,6 +91,22 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
 	clampIfNeeded(output);
 }
 
+void MathAddOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputValue1[COM_ROW_SIZE * 4];
+	float inputValue2[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue1, inputValue2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		float *out = output + i * 4;
+
+		out[0] = inputValue1[i * 4] + inputValue2[i * 4];
+
+		clampIfNeeded(out);
+	}
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -98,6 +120,22 @@ void MathSubtractOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+void MathSubtractOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputValue1[COM_ROW_SIZE * 4];
+	float inputValue2[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue1, inputValue2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		float *out = output + i * 4;
+
+		out[0] = inputValue1[i * 4] - inputValue2[i * 4];
+
+		clampIfNeeded(out);
+	}
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -111,6 +149,22 @@ void MathMultiplyOperation::executePixelSampled(float output[4], float x, float
 	clampIfNeeded(output);
 }
 
+void MathMultiplyOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputValue1[COM_ROW_SIZE * 4];
+	float inputValue2[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue1, inputValue2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		float *out = output + i * 4;
+
+		out[0] = inputValue1[i * 4] * inputValue2[i * 4];
+
+		clampIfNeeded(out);
+	}
+}
+
 void MathDivideOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -127,6 +181,25 @@ void MathDivideOperation::executePixelSampled(float output[4], float x, float y,
 	clampIfNeeded(output);
 }
 
+void MathDivideOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputValue1[COM_ROW_SIZE * 4];
+	float inputValue2[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue1, inputValue2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		float *out = output + i * 4;
+
+		if (inputValue2[i * 4] == 0) /* We don't want to divide by zero. */
+			out[0] = 0.0;
+		else
+			out[0] = inputValue1[i * 4] / inputValue2[i * 4];
+
+		clampIfNeeded(out);
+	}
+}
+
 void MathSineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
 	float inputValue1[4];
@@ -69,6 +69,13 @@ void MixBaseOperation::executePixelSampled(float output[4], float x, float y, Pi
 	output[3] = inputColor1[3];
 }
 
+void MixBaseOperation::readInputRows(float *inputValue, float *inputColor1, float *inputColor2, int x, int y, int width)
+{
+	this->m_inputValueOperation->readRow(inputValue, x, y, width);
+	this->m_inputColor1Operation->readRow(inputColor1, x, y, width);
+	this->m_inputColor2Operation->readRow(inputColor2, x, y, width);
+}
+
 void MixBaseOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
 {
 	NodeOperationInput *socket;
@@ -129,6 +136,32 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
 	clampIfNeeded(output);
 }
 
+void MixAddOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputColor1[COM_ROW_SIZE * 4];
+	float inputColor2[COM_ROW_SIZE * 4];
+	float inputValue[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue, inputColor1, inputColor2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		const float *color1 = inputColor1 + i * 4;
+		const float *color2 = inputColor2 + i * 4;
+		float *out = output + i * 4;
+
+		float value = inputValue[i * 4];
+		if (this->useValueAlphaMultiply()) {
+			value *= color2[3];
+		}
+		out[0] = color1[0] + value * color2[0];
+		out[1] = color1[1] + value * color2[1];
+		out[2] = color1[2] + value * color2[2];
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+	}
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
@@ -160,6 +193,33 @@ void MixBlendOperation::executePixelSampled(float output[4], float x, float y, P
 	clampIfNeeded(output);
 }
 
+void MixBlendOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputColor1[COM_ROW_SIZE * 4];
+	float inputColor2[COM_ROW_SIZE * 4];
+	float inputValue[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue, inputColor1, inputColor2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		const float *color1 = inputColor1 + i * 4;
+		const float *color2 = inputColor2 + i * 4;
+		float *out = output + i * 4;
+
+		float value = inputValue[i * 4];
+		if (this->useValueAlphaMultiply()) {
+			value *= color2[3];
+		}
+		float valuem = 1.0f - value;
+		out[0] = valuem * (color1[0]) + value * (color2[0]);
+		out[1] = valuem * (color1[1]) + value * (color2[1]);
+		out[2] = valuem * (color1[2]) + value * (color2[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+	}
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixBurnOperation::MixBurnOperation() : MixBaseOperation()
@@ -623,6 +683,33 @@ void MixMultiplyOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputColor1[COM_ROW_SIZE * 4];
+	float inputColor2[COM_ROW_SIZE * 4];
+	float inputValue[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue, inputColor1, inputColor2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		const float *color1 = inputColor1 + i * 4;
+		const float *color2 = inputColor2 + i * 4;
+		float *out = output + i * 4;
+
+		float value = inputValue[i * 4];
+		if (this->useValueAlphaMultiply()) {
+			value *= color2[3];
+		}
+		float valuem = 1.0f - value;
+		out[0] = color1[0] * (valuem + value * color2[0]);
+		out[1] = color1[1] * (valuem + value * color2[1]);
+		out[2] = color1[2] * (valuem + value * color2[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+	}
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -806,6 +893,32 @@ void MixSubtractOperation::executePixelSampled(float output[4], float x, float y
 	clampIfNeeded(output);
 }
 
+void MixSubtractOperation::executeRow(float *output, int x, int y, int width)
+{
+	float inputColor1[COM_ROW_SIZE * 4];
+	float inputColor2[COM_ROW_SIZE * 4];
+	float inputValue[COM_ROW_SIZE * 4];
+
+	readInputRows(inputValue, inputColor1, inputColor2, x, y, width);
+
+	for (int i = 0; i < width; i++) {
+		const float *color1 = inputColor1 + i * 4;
+		const float *color2 = inputColor2 + i * 4;
+		float *out = output + i * 4;
+
+		float value = inputValue[i * 4];
+		if (this->useValueAlphaMultiply()) {
+			value *= color2[3];
+		}
+		out[0] = color1[0] - value * (color2[0]);
+		out[1] = color1[1] - value * (color2[1]);
+		out[2] = color1[2] - value * (color2[2]);
+		out[3] = color1[3];
+
+		clampIfNeeded(out);
+	}
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
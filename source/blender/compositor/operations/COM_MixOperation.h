@@ -50,6 +50,11 @@ protected:
 			CLAMP(color[3], 0.0f, 1.0f);
 		}
 	}
+
+	/**
+	 * Read a row of all inputs, used by the row kernels of the mix operations
+	 */
+	void readInputRows(float *inputValue, float *inputColor1, float *inputColor2, int x, int y, int width);
 	
 public:
 	/**
@@ -84,12 +89,16 @@ class MixAddOperation : public MixBaseOperation {
 public:
 	MixAddOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width);
+	bool isRowOperation() const { return true; }
 };
 
 class MixBlendOperation : public MixBaseOperation {
 public:
 	MixBlendOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width);
+	bool isRowOperation() const { return true; }
 };
 
 class MixBurnOperation : public MixBaseOperation {
@@ -156,6 +165,8 @@ class MixMultiplyOperation : public MixBaseOperation {
 public:
 	MixMultiplyOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width);
+	bool isRowOperation() const { return true; }
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -186,6 +197,8 @@ class MixSubtractOperation : public MixBaseOperation {
 public:
 	MixSubtractOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int width);
+	bool isRowOperation() const { return true; }
 };
 
 class MixValueOperation : public MixBaseOperation {
@@ -22,6 +22,7 @@
  */
 
 #include "COM_OutputFileOperation.h"
+#include "COM_SequencePipeline.h"
 #include <string.h>
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
@@ -116,7 +117,8 @@ static float *init_buffer(unsigned int width, unsigned int height, DataType data
 }
 
 static void write_buffer_rect(rcti *rect, const bNodeTree *tree,
-                              SocketReader *reader, float *buffer, unsigned int width, DataType datatype)
+                              SocketReader *reader, float *buffer, unsigned int width, DataType datatype,
+                              bool use_rows)
 {
 	float color[4];
 	int i, size = get_datatype_size(datatype);
@@ -131,6 +133,27 @@ static void write_buffer_rect(rcti *rect, const bNodeTree *tree,
 	int y;
 	bool breaked = false;
 
+	if (use_rows) {
+		float row[COM_ROW_SIZE * 4];
+
+		for (y = y1; y < y2 && (!breaked); y++) {
+			for (x = x1; x < x2; x += COM_ROW_SIZE) {
+				const int row_width = min_ii(COM_ROW_SIZE, x2 - x);
+				reader->readRow(row, x, y, row_width);
+
+				for (int j = 0; j < row_width; j++) {
+					for (i = 0; i < size; ++i)
+						buffer[offset + i] = row[j * 4 + i];
+					offset += size;
+				}
+			}
+			if (tree->test_break && tree->test_break(tree->tbh))
+				breaked = true;
+			offset += (width - (x2 - x1)) * size;
+		}
+		return;
+	}
+
 	for (y = y1; y < y2 && (!breaked); y++) {
 		for (x = x1; x < x2 && (!breaked); x++) {
 			reader->readSampled(color, x, y, COM_PS_NEAREST);
@@ -147,6 +170,24 @@ static void write_buffer_rect(rcti *rect, const bNodeTree *tree,
 }
 
 
+typedef struct OutputSingleLayerWrite {
+	ImBuf *ibuf;
+	char filename[FILE_MAX];
+	ImageFormatData format;
+} OutputSingleLayerWrite;
+
+static void output_single_layer_write(void *data)
+{
+	OutputSingleLayerWrite *write = (OutputSingleLayerWrite *)data;
+
+	if (0 == BKE_imbuf_write(write->ibuf, write->filename, &write->format))
+		printf("Cannot save Node File Output to %s\n", write->filename);
+	else
+		printf("Saved: %s\n", write->filename);
+	
+	IMB_freeImBuf(write->ibuf);
+}
+
 OutputSingleLayerOperation::OutputSingleLayerOperation(
         const RenderData *rd, const bNodeTree *tree, DataType datatype, ImageFormatData *format, const char *path,
         const ColorManagedViewSettings *viewSettings, const ColorManagedDisplaySettings *displaySettings, const char *viewName)
@@ -176,7 +217,8 @@ void OutputSingleLayerOperation::initExecution()
 
 void OutputSingleLayerOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 {
-	write_buffer_rect(rect, this->m_tree, this->m_imageInput, this->m_outputBuffer, this->getWidth(), this->m_datatype);
+	write_buffer_rect(rect, this->m_tree, this->m_imageInput, this->m_outputBuffer, this->getWidth(), this->m_datatype,
+	                  this->isRowExecution());
 }
 
 void OutputSingleLayerOperation::deinitExecution()
@@ -186,7 +228,7 @@ void OutputSingleLayerOperation::deinitExecution()
 		int size = get_datatype_size(this->m_datatype);
 		ImBuf *ibuf = IMB_allocImBuf(this->getWidth(), this->getHeight(), this->m_format->planes, 0);
 		Main *bmain = G.main; /* TODO, have this passed along */
-		char filename[FILE_MAX];
+		OutputSingleLayerWrite *write = (OutputSingleLayerWrite *)MEM_mallocN(sizeof(OutputSingleLayerWrite), __func__);
 		const char *suffix;
 		
 		ibuf->channels = size;
@@ -200,15 +242,20 @@ void OutputSingleLayerOperation::deinitExecution()
 		suffix = BKE_scene_multiview_view_suffix_get(this->m_rd, this->m_viewName);
 
 		BKE_image_path_from_imformat(
-		        filename, this->m_path, bmain->name, this->m_rd->cfra, this->m_format,
+		        write->filename, this->m_path, bmain->name, this->m_rd->cfra, this->m_format,
 		        (this->m_rd->scemode & R_EXTENSION) != 0, true, suffix);
 
-		if (0 == BKE_imbuf_write(ibuf, filename, this->m_format))
-			printf("Cannot save Node File Output to %s\n", filename);
-		else
-			printf("Saved: %s\n", filename);
-		
-		IMB_freeImBuf(ibuf);
+		write->ibuf = ibuf;
+		write->format = *this->m_format;
+
+		/* when rendering an animation the file is written while the next frame is composited */
+		if (SequencePipeline::isActive()) {
+			SequencePipeline::write(this->m_rd->cfra, output_single_layer_write, write);
+		}
+		else {
+			output_single_layer_write(write);
+			MEM_freeN(write);
+		}
 	}
 	this->m_outputBuffer = NULL;
 	this->m_imageInput = NULL;
@@ -227,6 +274,39 @@ OutputOpenExrLayer::OutputOpenExrLayer(const char *name_, DataType datatype_, bo
 	this->imageInput = 0;
 }
 
+typedef struct OutputMultiLayerWrite {
+	void *exrhandle;
+	char filename[FILE_MAX];
+	unsigned int width, height;
+	char exr_codec;
+	/* layer buffers, freed after writing */
+	float **buffers;
+	unsigned int num_buffers;
+} OutputMultiLayerWrite;
+
+static void output_multi_layer_write(void *data)
+{
+	OutputMultiLayerWrite *write = (OutputMultiLayerWrite *)data;
+
+	/* when the filename has no permissions, this can fail */
+	if (IMB_exr_begin_write(write->exrhandle, write->filename, write->width, write->height, write->exr_codec, NULL)) {
+		IMB_exr_write_channels(write->exrhandle);
+	}
+	else {
+		/* TODO, get the error from openexr's exception */
+		/* XXX nice way to do report? */
+		printf("Error Writing Render Result, see console\n");
+	}
+	
+	IMB_exr_close(write->exrhandle);
+	for (unsigned int i = 0; i < write->num_buffers; ++i) {
+		if (write->buffers[i]) {
+			MEM_freeN(write->buffers[i]);
+		}
+	}
+	MEM_freeN(write->buffers);
+}
+
 OutputOpenExrMultiLayerOperation::OutputOpenExrMultiLayerOperation(
         const RenderData *rd, const bNodeTree *tree, const char *path,
         char exr_codec, bool exr_half_float, const char *viewName)
@@ -262,7 +342,8 @@ void OutputOpenExrMultiLayerOperation::executeRegion(rcti *rect, unsigned int /*
 	for (unsigned int i = 0; i < this->m_layers.size(); ++i) {
 		OutputOpenExrLayer &layer = this->m_layers[i];
 		if (layer.imageInput)
-			write_buffer_rect(rect, this->m_tree, layer.imageInput, layer.outputBuffer, this->getWidth(), layer.datatype);
+			write_buffer_rect(rect, this->m_tree, layer.imageInput, layer.outputBuffer, this->getWidth(), layer.datatype,
+			                  this->isRowExecution());
 	}
 }
 
@@ -272,15 +353,15 @@ void OutputOpenExrMultiLayerOperation::deinitExecution()
 	unsigned int height = this->getHeight();
 	if (width != 0 && height != 0) {
 		Main *bmain = G.main; /* TODO, have this passed along */
-		char filename[FILE_MAX];
+		OutputMultiLayerWrite *write = (OutputMultiLayerWrite *)MEM_mallocN(sizeof(OutputMultiLayerWrite), __func__);
 		const char *suffix;
 		void *exrhandle = IMB_exr_get_handle();
 
 		suffix = BKE_scene_multiview_view_suffix_get(this->m_rd, this->m_viewName);
 		BKE_image_path_from_imtype(
-		        filename, this->m_path, bmain->name, this->m_rd->cfra, R_IMF_IMTYPE_MULTILAYER,
+		        write->filename, this->m_path, bmain->name, this->m_rd->cfra, R_IMF_IMTYPE_MULTILAYER,
 		        (this->m_rd->scemode & R_EXTENSION) != 0, true, suffix);
-		BLI_make_existing_file(filename);
+		BLI_make_existing_file(write->filename);
 
 		for (unsigned int i = 0; i < this->m_layers.size(); ++i) {
 			OutputOpenExrLayer &layer = this->m_layers[i];
@@ -291,25 +372,28 @@ void OutputOpenExrMultiLayerOperation::deinitExecution()
 			                 this->m_exr_half_float, this->m_layers[i].outputBuffer);
 		}
 		
-		/* when the filename has no permissions, this can fail */
-		if (IMB_exr_begin_write(exrhandle, filename, width, height, this->m_exr_codec, NULL)) {
-			IMB_exr_write_channels(exrhandle);
-		}
-		else {
-			/* TODO, get the error from openexr's exception */
-			/* XXX nice way to do report? */
-			printf("Error Writing Render Result, see console\n");
-		}
-		
-		IMB_exr_close(exrhandle);
+		write->exrhandle = exrhandle;
+		write->width = width;
+		write->height = height;
+		write->exr_codec = this->m_exr_codec;
+		write->num_buffers = this->m_layers.size();
+		write->buffers = (float **)MEM_mallocN(sizeof(float *) * write->num_buffers, __func__);
+
+		/* the buffers are owned by the write from here on */
 		for (unsigned int i = 0; i < this->m_layers.size(); ++i) {
-			if (this->m_layers[i].outputBuffer) {
-				MEM_freeN(this->m_layers[i].outputBuffer);
-				this->m_layers[i].outputBuffer = NULL;
-			}
-			
+			write->buffers[i] = this->m_layers[i].outputBuffer;
+			this->m_layers[i].outputBuffer = NULL;
 			this->m_layers[i].imageInput = NULL;
 		}
+
+		/* when rendering an animation the file is written while the next frame is composited */
+		if (SequencePipeline::isActive()) {
+			SequencePipeline::write(this->m_rd->cfra, output_multi_layer_write, write);
+		}
+		else {
+			output_multi_layer_write(write);
+			MEM_freeN(write);
+		}
 	}
 }
 
@@ -93,20 +93,52 @@ void PreviewOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 
 	cm_processor = IMB_colormanagement_display_processor_new(this->m_viewSettings, this->m_displaySettings);
 
-	for (int y = rect->ymin; y < rect->ymax; y++) {
-		offset = (y * getWidth() + rect->xmin) * 4;
-		for (int x = rect->xmin; x < rect->xmax; x++) {
-			float rx = floor(x / this->m_divider);
-			float ry = floor(y / this->m_divider);
-	
-			color[0] = 0.0f;
-			color[1] = 0.0f;
-			color[2] = 0.0f;
-			color[3] = 1.0f;
-			this->m_input->readSampled(color, rx, ry, COM_PS_NEAREST);
-			IMB_colormanagement_processor_apply_v4(cm_processor, color);
-			F4TOCHAR4(color, this->m_outputBuffer + offset);
-			offset += 4;
+	if (this->isRowExecution()) {
+		/* input rows are read as far as the downscaled pixels reach */
+		float row[COM_ROW_SIZE * 4];
+
+		for (int y = rect->ymin; y < rect->ymax; y++) {
+			const int ry = floor(y / this->m_divider);
+			const int row_end = floor((rect->xmax - 1) / this->m_divider) + 1;
+			int row_x = 0, row_width = 0;
+
+			offset = (y * getWidth() + rect->xmin) * 4;
+			for (int x = rect->xmin; x < rect->xmax; x++) {
+				const int rx = floor(x / this->m_divider);
+
+				if (row_width == 0 || rx >= row_x + row_width) {
+					row_x = rx;
+					row_width = min_ii(COM_ROW_SIZE, row_end - rx);
+					for (int i = 0; i < row_width; i++) {
+						zero_v3(row + i * 4);
+						row[i * 4 + 3] = 1.0f;
+					}
+					this->m_input->readRow(row, row_x, ry, row_width);
+				}
+
+				copy_v4_v4(color, row + (rx - row_x) * 4);
+				IMB_colormanagement_processor_apply_v4(cm_processor, color);
+				F4TOCHAR4(color, this->m_outputBuffer + offset);
+				offset += 4;
+			}
+		}
+	}
+	else {
+		for (int y = rect->ymin; y < rect->ymax; y++) {
+			offset = (y * getWidth() + rect->xmin) * 4;
+			for (int x = rect->xmin; x < rect->xmax; x++) {
+				float rx = floor(x / this->m_divider);
+				float ry = floor(y / this->m_divider);
+
+				color[0] = 0.0f;
+				color[1] = 0.0f;
+				color[2] = 0.0f;
+				color[3] = 1.0f;
+				this->m_input->readSampled(color, rx, ry, COM_PS_NEAREST);
+				IMB_colormanagement_processor_apply_v4(cm_processor, color);
+				F4TOCHAR4(color, this->m_outputBuffer + offset);
+				offset += 4;
+			}
 		}
 	}
 
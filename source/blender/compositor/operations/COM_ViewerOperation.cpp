@@ -101,6 +101,39 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 	int y;
 	bool breaked = false;
 
+	if (this->isRowExecution()) {
+		float alpha[COM_ROW_SIZE * 4], depth[COM_ROW_SIZE * 4];
+
+		for (y = y1; y < y2 && (!breaked); y++) {
+			for (x = x1; x < x2; x += COM_ROW_SIZE) {
+				const int width = min_ii(COM_ROW_SIZE, x2 - x);
+
+				/* the image has 4 channels per pixel like the viewer buffer */
+				this->m_imageInput->readRow(&(buffer[offset4]), x, y, width);
+				if (this->m_useAlphaInput) {
+					this->m_alphaInput->readRow(alpha, x, y, width);
+				}
+				this->m_depthInput->readRow(depth, x, y, width);
+
+				for (int i = 0; i < width; i++) {
+					if (this->m_useAlphaInput) {
+						buffer[offset4 + 3] = alpha[i * 4];
+					}
+					depthbuffer[offset] = depth[i * 4];
+					offset++;
+					offset4 += 4;
+				}
+			}
+			if (isBreaked()) {
+				breaked = true;
+			}
+			offset += offsetadd;
+			offset4 += offsetadd4;
+		}
+		updateImage(rect);
+		return;
+	}
+
 	for (y = y1; y < y2 && (!breaked); y++) {
 		for (x = x1; x < x2; x++) {
 			this->m_imageInput->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
@@ -87,6 +87,31 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
 			data = NULL;
 		}
 	}
+	else if (this->isRowExecution()) {
+		int x1 = rect->xmin;
+		int y1 = rect->ymin;
+		int x2 = rect->xmax;
+		int y2 = rect->ymax;
+		float row[COM_ROW_SIZE * 4];
+
+		int x;
+		int y;
+		bool breaked = false;
+		for (y = y1; y < y2 && (!breaked); y++) {
+			int offset4 = (y * memoryBuffer->getWidth() + x1) * num_channels;
+			for (x = x1; x < x2; x += COM_ROW_SIZE) {
+				const int width = min_ii(COM_ROW_SIZE, x2 - x);
+				this->m_input->readRow(row, x, y, width);
+				for (int i = 0; i < width; i++) {
+					memcpy(&(buffer[offset4]), &row[i * 4], sizeof(float) * num_channels);
+					offset4 += num_channels;
+				}
+			}
+			if (isBreaked()) {
+				breaked = true;
+			}
+		}
+	}
 	else {
 		int x1 = rect->xmin;
 		int y1 = rect->ymin;
@@ -74,6 +74,12 @@ bool DEG_depsgraph_use_legacy(void);
 void DEG_depsgraph_switch_to_legacy(void);
 void DEG_depsgraph_switch_to_new(void);
 
+/* Schedule operations by the longest remaining path through the graph,
+ * weighted by the evaluation time measured in the previous update.
+ */
+bool DEG_depsgraph_use_cost_priority(void);
+void DEG_depsgraph_set_cost_priority(bool use_cost_priority);
+
 /* ************************************************ */
 /* Depsgraph API */
 
@@ -53,6 +53,21 @@ void DEG_stats_simple(const struct Depsgraph *graph,
 
 void DEG_debug_graphviz(const struct Depsgraph *graph, FILE *stream, const char *label, bool show_eval);
 
+/* ************************************************ */
+/* Evaluation Profiling */
+
+/* Write the timing of the last evaluation as Chrome trace events
+ * (chrome://tracing), with the operations of the critical path in their
+ * own category. Only recorded when running with --debug-depsgraph-profile,
+ * returns false when there is no profile.
+ */
+bool DEG_debug_eval_profile_trace(const struct Depsgraph *graph, FILE *stream);
+
+/* Write the time per thread, the critical path and the slowest operations
+ * of the last evaluation.
+ */
+bool DEG_debug_eval_profile_summary(const struct Depsgraph *graph, FILE *stream);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
@@ -119,6 +119,12 @@ struct DepsgraphNodeBuilder {
 	                                       int name_tag = -1);
 
 	void build_scene(Scene *scene);
+	/* Build nodes of objects which were removed from the graph for an
+	 * incremental update. IDs in built_ids keep their existing nodes.
+	 */
+	void build_scene_objects_update(Scene *scene,
+	                                const vector<ID *> &built_ids,
+	                                const vector<Object *> &objects);
 	void build_group(Base *base, Group *group);
 	void build_object(Base *base, Object *object);
 	void build_object_data(Object *object);
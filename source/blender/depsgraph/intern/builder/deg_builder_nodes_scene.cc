@@ -122,4 +122,21 @@ void DepsgraphNodeBuilder::build_scene(Scene *scene)
 	                   "Scene Eval");
 }
 
+void DepsgraphNodeBuilder::build_scene_objects_update(
+        Scene *scene,
+        const vector<ID *> &built_ids,
+        const vector<Object *> &objects)
+{
+	foreach (ID *id, built_ids) {
+		id->tag |= LIB_TAG_DOIT;
+	}
+	scene_ = scene;
+	/* Layers of the bases are restored by the caller, new IDs referenced by
+	 * the objects get layers flushed from them.
+	 */
+	foreach (Object *object, objects) {
+		build_object(NULL, object);
+	}
+}
+
 }  // namespace DEG
@@ -185,6 +185,13 @@ struct DepsgraphRelationBuilder
 	                              const char *description);
 
 	void build_scene(Scene *scene);
+	/* Build relations of objects for an incremental update, their previous
+	 * incoming relations are expected to be removed already. IDs in built_ids
+	 * keep their existing relations.
+	 */
+	void build_scene_objects_update(Scene *scene,
+	                                const vector<ID *> &built_ids,
+	                                const vector<Object *> &objects);
 	void build_group(Object *object, Group *group);
 	void build_object(Object *object);
 	void build_object_data(Object *object);
@@ -266,6 +273,8 @@ protected:
 
 	bool needs_animdata_node(ID *id);
 
+	void build_object_customdata_masks();
+
 private:
 	/* State which never changes, same for the whole builder time. */
 	Main *bmain_;
@@ -107,6 +107,26 @@ void DepsgraphRelationBuilder::build_scene(Scene *scene)
 	LINKLIST_FOREACH (MovieClip *, clip, &bmain_->movieclip) {
 		build_movieclip(clip);
 	}
+	build_object_customdata_masks();
+}
+
+void DepsgraphRelationBuilder::build_scene_objects_update(
+        Scene *scene,
+        const vector<ID *> &built_ids,
+        const vector<Object *> &objects)
+{
+	foreach (ID *id, built_ids) {
+		id->tag |= LIB_TAG_DOIT;
+	}
+	scene_ = scene;
+	foreach (Object *object, objects) {
+		build_object(object);
+	}
+	build_object_customdata_masks();
+}
+
+void DepsgraphRelationBuilder::build_object_customdata_masks()
+{
 	for (Depsgraph::OperationNodes::const_iterator it_op = graph_->operations.begin();
 	     it_op != graph_->operations.end();
 	     ++it_op)
@@ -51,10 +51,12 @@ extern "C" {
 #include "RNA_access.h"
 }
 
+#include <algorithm>
 #include <cstring>
 
 #include "DEG_depsgraph.h"
 
+#include "intern/eval/deg_eval_profile.h"
 #include "intern/nodes/deg_node.h"
 #include "intern/nodes/deg_node_component.h"
 #include "intern/nodes/deg_node_operation.h"
@@ -71,11 +73,13 @@ static DEG_EditorUpdateScenePreCb deg_editor_update_scene_pre_cb = NULL;
 Depsgraph::Depsgraph()
   : time_source(NULL),
     need_update(false),
-    layers(0)
+    layers(0),
+    eval_profile(NULL)
 {
 	BLI_spin_init(&lock);
 	id_hash = BLI_ghash_ptr_new("Depsgraph id hash");
 	entry_tags = BLI_gset_ptr_new("Depsgraph entry_tags");
+	id_relations_tags = BLI_gset_ptr_new("Depsgraph id_relations_tags");
 }
 
 Depsgraph::~Depsgraph()
@@ -83,9 +87,13 @@ Depsgraph::~Depsgraph()
 	clear_id_nodes();
 	BLI_ghash_free(id_hash, NULL, NULL);
 	BLI_gset_free(entry_tags, NULL);
+	BLI_gset_free(id_relations_tags, NULL);
 	if (time_source != NULL) {
 		OBJECT_GUARDED_DELETE(time_source, TimeSourceDepsNode);
 	}
+	if (eval_profile != NULL) {
+		OBJECT_GUARDED_DELETE(eval_profile, DepsgraphEvalProfile);
+	}
 	BLI_spin_end(&lock);
 }
 
@@ -291,6 +299,43 @@ IDDepsNode *Depsgraph::add_id_node(ID *id, const char *name)
 	return id_node;
 }
 
+static void unlink_node_relations(DepsNode *node)
+{
+	while (!node->inlinks.empty()) {
+		DepsRelation *rel = node->inlinks.back();
+		rel->unlink();
+		OBJECT_GUARDED_DELETE(rel, DepsRelation);
+	}
+	while (!node->outlinks.empty()) {
+		DepsRelation *rel = node->outlinks.back();
+		rel->unlink();
+		OBJECT_GUARDED_DELETE(rel, DepsRelation);
+	}
+}
+
+void Depsgraph::remove_id_node(IDDepsNode *id_node)
+{
+	unlink_node_relations(id_node);
+	GHASH_FOREACH_BEGIN(ComponentDepsNode *, comp_node, id_node->components)
+	{
+		unlink_node_relations(comp_node);
+		foreach (OperationDepsNode *op_node, comp_node->operations) {
+			unlink_node_relations(op_node);
+			BLI_gset_remove(entry_tags, op_node, NULL);
+		}
+	}
+	GHASH_FOREACH_END();
+	/* Keep order of the remaining operations. */
+	OperationNodes::iterator it_last = operations.begin();
+	foreach (OperationDepsNode *op_node, operations) {
+		if (op_node->owner->owner != id_node) {
+			*it_last++ = op_node;
+		}
+	}
+	operations.erase(it_last, operations.end());
+	BLI_ghash_remove(id_hash, id_node->id, NULL, id_node_deleter);
+}
+
 void Depsgraph::clear_id_nodes()
 {
 	BLI_ghash_clear(id_hash, NULL, id_node_deleter);
@@ -382,8 +427,30 @@ DepsRelation::~DepsRelation()
 	BLI_assert(this->from && this->to);
 }
 
+static void relations_remove(DepsNode::Relations *relations, DepsRelation *rel)
+{
+	DepsNode::Relations::iterator it = std::find(relations->begin(),
+	                                             relations->end(),
+	                                             rel);
+	if (it != relations->end()) {
+		relations->erase(it);
+	}
+}
+
+void DepsRelation::unlink()
+{
+	relations_remove(&from->outlinks, this);
+	relations_remove(&to->inlinks, this);
+}
+
 /* Low level tagging -------------------------------------- */
 
+/* Tag relations of a specific ID as needing to be rebuilt. */
+void Depsgraph::add_id_relations_tag(ID *id)
+{
+	BLI_gset_add(id_relations_tags, id);
+}
+
 /* Tag a specific node as needing updates. */
 void Depsgraph::add_entry_tag(OperationDepsNode *node)
 {
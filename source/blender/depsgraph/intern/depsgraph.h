@@ -53,6 +53,7 @@ struct TimeSourceDepsNode;
 struct IDDepsNode;
 struct ComponentDepsNode;
 struct OperationDepsNode;
+struct DepsgraphEvalProfile;
 
 /* *************************** */
 /* Relationships Between Nodes */
@@ -84,6 +85,9 @@ struct DepsRelation {
 	             const char *description);
 
 	~DepsRelation();
+
+	/* Remove relation from the links of both nodes. */
+	void unlink();
 };
 
 /* ********* */
@@ -112,6 +116,8 @@ struct Depsgraph {
 
 	IDDepsNode *find_id_node(const ID *id) const;
 	IDDepsNode *add_id_node(ID *id, const char *name = "");
+	/* Remove ID node with all its components, operations and relations. */
+	void remove_id_node(IDDepsNode *id_node);
 	void clear_id_nodes();
 
 	/* Add new relationship between two nodes. */
@@ -126,6 +132,9 @@ struct Depsgraph {
 	/* Tag a specific node as needing updates. */
 	void add_entry_tag(OperationDepsNode *node);
 
+	/* Tag relations of a specific ID as needing to be rebuilt. */
+	void add_id_relations_tag(ID *id);
+
 	/* Clear storage used by all nodes. */
 	void clear_all_nodes();
 
@@ -141,6 +150,11 @@ struct Depsgraph {
 	/* Indicates whether relations needs to be updated. */
 	bool need_update;
 
+	/* IDs which nodes and relations are to be rebuilt on the next relations
+	 * update, ignored when the whole graph needs update.
+	 */
+	GSet *id_relations_tags;
+
 	/* Quick-Access Temp Data ............. */
 
 	/* Nodes which have been tagged as "directly modified". */
@@ -162,6 +176,11 @@ struct Depsgraph {
 	/* Visible layers bitfield, used for skipping invisible objects updates. */
 	unsigned int layers;
 
+	/* Profiling .......................... */
+
+	/* Timing of the last evaluation, only recorded with --debug-depsgraph-profile. */
+	DepsgraphEvalProfile *eval_profile;
+
 	// XXX: additional stuff like eval contexts, mempools for allocating nodes from, etc.
 };
 
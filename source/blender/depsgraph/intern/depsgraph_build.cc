@@ -36,6 +36,7 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_listbase.h"
 
 #ifdef DEBUG_TIME
 #  include "PIL_time.h"
@@ -44,13 +45,16 @@
 
 extern "C" {
 #include "DNA_cachefile_types.h"
+#include "DNA_key_types.h"
 #include "DNA_object_types.h"
+#include "DNA_particle_types.h"
 #include "DNA_scene_types.h"
 #include "DNA_object_force.h"
 
 #include "BKE_main.h"
 #include "BKE_collision.h"
 #include "BKE_effect.h"
+#include "BKE_key.h"
 #include "BKE_modifier.h"
 } /* extern "C" */
 
@@ -244,6 +248,286 @@ void DEG_graph_build_from_scene(Depsgraph *graph, Main *bmain, Scene *scene)
 #endif
 }
 
+namespace DEG {
+
+static IDDepsNode *deg_node_id_owner(DepsNode *node)
+{
+	switch (node->tclass) {
+		case DEG_NODE_CLASS_OPERATION:
+			return ((OperationDepsNode *)node)->owner->owner;
+		case DEG_NODE_CLASS_COMPONENT:
+			return ((ComponentDepsNode *)node)->owner;
+		case DEG_NODE_CLASS_GENERIC:
+			if (node->type == DEG_NODE_TYPE_ID_REF) {
+				return (IDDepsNode *)node;
+			}
+			break;
+	}
+	return NULL;
+}
+
+/* The ID node itself, its components and operations. */
+static void deg_id_node_collect_nodes(IDDepsNode *id_node, vector<DepsNode *> *r_nodes)
+{
+	r_nodes->push_back(id_node);
+	GHASH_FOREACH_BEGIN(ComponentDepsNode *, comp_node, id_node->components)
+	{
+		r_nodes->push_back(comp_node);
+		foreach (OperationDepsNode *op_node, comp_node->operations) {
+			r_nodes->push_back(op_node);
+		}
+	}
+	GHASH_FOREACH_END();
+}
+
+static void deg_collect_dependents(DepsNode *node,
+                                   GSet *rebuild_ids,
+                                   GSet *dependent_ids)
+{
+	foreach (DepsRelation *rel, node->outlinks) {
+		IDDepsNode *id_to = deg_node_id_owner(rel->to);
+		if (id_to != NULL && !BLI_gset_haskey(rebuild_ids, id_to)) {
+			BLI_gset_add(dependent_ids, id_to);
+		}
+	}
+}
+
+static void deg_free_inlinks(DepsNode *node)
+{
+	while (!node->inlinks.empty()) {
+		DepsRelation *rel = node->inlinks.back();
+		rel->unlink();
+		OBJECT_GUARDED_DELETE(rel, DepsRelation);
+	}
+}
+
+static void deg_id_node_free_inlinks(IDDepsNode *id_node)
+{
+	vector<DepsNode *> nodes;
+	deg_id_node_collect_nodes(id_node, &nodes);
+	foreach (DepsNode *node, nodes) {
+		deg_free_inlinks(node);
+	}
+}
+
+/* Whether all relations to the object are built again by building the
+ * object itself.
+ */
+static bool deg_object_update_is_supported(Object *object)
+{
+	/* Metaballs add relations to their motherball, an object adds relations
+	 * to the pose of its proxy and the scene adds the rigid body relations.
+	 */
+	if (object->type == OB_MBALL ||
+	    object->proxy != NULL ||
+	    object->proxy_from != NULL ||
+	    object->rigidbody_object != NULL ||
+	    object->rigidbody_constraint != NULL)
+	{
+		return false;
+	}
+	/* Relations of shared object data are built by its first user only. */
+	if (object->data != NULL && ID_REAL_USERS(object->data) > 1) {
+		return false;
+	}
+	return true;
+}
+
+/* Colliders and effectors get relations to the cloth, smoke, dynamic paint,
+ * soft body and particle objects that use them. Those are built by scanning
+ * the scene objects, not through existing relations, so objects which get or
+ * lose such data are not found as dependents.
+ */
+static bool deg_object_has_scene_relations(Object *object)
+{
+	if (object->pd != NULL && object->pd->forcefield != 0) {
+		return true;
+	}
+	if (object->soft != NULL ||
+	    !BLI_listbase_is_empty(&object->particlesystem))
+	{
+		return true;
+	}
+	LINKLIST_FOREACH (ModifierData *, md, &object->modifiers) {
+		if (ELEM(md->type,
+		         eModifierType_Collision,
+		         eModifierType_Cloth,
+		         eModifierType_Smoke,
+		         eModifierType_DynamicPaint))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Object data and shape keys, their relations are built with the object. */
+static void deg_object_collect_data_nodes(Depsgraph *graph,
+                                          Object *object,
+                                          GSet *data_ids)
+{
+	ID *ids[2] = {(ID *)object->data, NULL};
+	Key *key = BKE_key_from_object(object);
+	if (key != NULL) {
+		ids[1] = &key->id;
+	}
+	for (int i = 0; i < 2; ++i) {
+		IDDepsNode *id_node = (ids[i] != NULL) ? graph->find_id_node(ids[i]) : NULL;
+		if (id_node != NULL) {
+			BLI_gset_add(data_ids, id_node);
+		}
+	}
+}
+
+/* Rebuild only the IDs tagged with DEG_graph_id_tag_relations_update().
+ *
+ * Nodes of the tagged objects are removed and built again. Relations from
+ * them to other IDs are built by those other IDs, so the dependent objects
+ * get all their incoming relations rebuilt as well, and so do the object data
+ * and shape keys of both. The rest of the graph is kept as is.
+ *
+ * Returns false when the update can not be done incrementally, only objects
+ * which have nodes in the graph and are depended on by other objects only
+ * are supported. Anything else, like scene level relations or relations
+ * built by a third object, is handled by a full rebuild. This includes
+ * colliders and effectors, whose users find them by scanning the scene.
+ */
+static bool deg_graph_build_update_ids(Main *bmain, Scene *scene, Depsgraph *graph)
+{
+	GSet *rebuild_ids = BLI_gset_ptr_new("DEG rebuild ids");
+	GSet *dependent_ids = BLI_gset_ptr_new("DEG dependent ids");
+	bool is_supported = true;
+
+	GSET_FOREACH_BEGIN(ID *, id, graph->id_relations_tags)
+	{
+		IDDepsNode *id_node = graph->find_id_node(id);
+		if (id_node == NULL ||
+		    GS(id->name) != ID_OB ||
+		    !deg_object_update_is_supported((Object *)id) ||
+		    deg_object_has_scene_relations((Object *)id))
+		{
+			is_supported = false;
+			break;
+		}
+		BLI_gset_add(rebuild_ids, id_node);
+	}
+	GSET_FOREACH_END();
+
+	if (is_supported) {
+		GSET_FOREACH_BEGIN(IDDepsNode *, id_node, rebuild_ids)
+		{
+			vector<DepsNode *> nodes;
+			deg_id_node_collect_nodes(id_node, &nodes);
+			foreach (DepsNode *node, nodes) {
+				deg_collect_dependents(node, rebuild_ids, dependent_ids);
+			}
+		}
+		GSET_FOREACH_END();
+		GSET_FOREACH_BEGIN(IDDepsNode *, id_node, dependent_ids)
+		{
+			if (GS(id_node->id->name) != ID_OB ||
+			    !deg_object_update_is_supported((Object *)id_node->id) ||
+			    deg_object_has_scene_relations((Object *)id_node->id))
+			{
+				is_supported = false;
+				break;
+			}
+		}
+		GSET_FOREACH_END();
+	}
+
+	if (!is_supported) {
+		BLI_gset_free(rebuild_ids, NULL);
+		BLI_gset_free(dependent_ids, NULL);
+		return false;
+	}
+
+	/* Remove nodes of the tagged objects, remembering the layers of their
+	 * bases, and incoming relations of the dependent objects and of the data
+	 * of both.
+	 */
+	vector<Object *> rebuild_objects;
+	vector<unsigned int> rebuild_layers;
+	GSET_FOREACH_BEGIN(IDDepsNode *, id_node, rebuild_ids)
+	{
+		rebuild_objects.push_back((Object *)id_node->id);
+		rebuild_layers.push_back(id_node->layers);
+		graph->remove_id_node(id_node);
+	}
+	GSET_FOREACH_END();
+
+	vector<Object *> relation_objects = rebuild_objects;
+	GSET_FOREACH_BEGIN(IDDepsNode *, id_node, dependent_ids)
+	{
+		relation_objects.push_back((Object *)id_node->id);
+		deg_id_node_free_inlinks(id_node);
+	}
+	GSET_FOREACH_END();
+
+	/* Relations of the object data are only built while it is not tagged as
+	 * done, this includes relations to the object itself.
+	 */
+	GSet *data_ids = BLI_gset_ptr_new("DEG object data ids");
+	foreach (Object *object, relation_objects) {
+		deg_object_collect_data_nodes(graph, object, data_ids);
+	}
+	GSET_FOREACH_BEGIN(IDDepsNode *, id_node, data_ids)
+	{
+		deg_id_node_free_inlinks(id_node);
+	}
+	GSET_FOREACH_END();
+
+	vector<ID *> node_built_ids, relation_built_ids;
+	GHASH_FOREACH_BEGIN(IDDepsNode *, id_node, graph->id_hash)
+	{
+		node_built_ids.push_back(id_node->id);
+		if (!BLI_gset_haskey(dependent_ids, id_node) &&
+		    !BLI_gset_haskey(data_ids, id_node))
+		{
+			relation_built_ids.push_back(id_node->id);
+		}
+	}
+	GHASH_FOREACH_END();
+
+	BLI_gset_free(rebuild_ids, NULL);
+	BLI_gset_free(dependent_ids, NULL);
+	BLI_gset_free(data_ids, NULL);
+
+	/* Build nodes of the tagged objects. */
+	DepsgraphNodeBuilder node_builder(bmain, graph);
+	node_builder.begin_build();
+	node_builder.build_scene_objects_update(scene, node_built_ids, rebuild_objects);
+	for (size_t i = 0; i < rebuild_objects.size(); ++i) {
+		IDDepsNode *id_node = graph->find_id_node(&rebuild_objects[i]->id);
+		id_node->layers |= rebuild_layers[i];
+	}
+
+	/* Build relations of the tagged and dependent objects. */
+	DepsgraphRelationBuilder relation_builder(bmain, graph);
+	relation_builder.begin_build();
+	relation_builder.build_scene_objects_update(scene, relation_built_ids, relation_objects);
+
+	/* Cycles might have been introduced or solved anywhere along the paths
+	 * going through the rebuilt objects.
+	 */
+	foreach (OperationDepsNode *node, graph->operations) {
+		foreach (DepsRelation *rel, node->outlinks) {
+			rel->flag &= ~DEPSREL_FLAG_CYCLIC;
+		}
+	}
+	deg_graph_detect_cycles(graph);
+
+	if (G.debug_value == 799) {
+		deg_graph_transitive_reduction(graph);
+	}
+
+	deg_graph_build_finalize(graph);
+
+	return true;
+}
+
+}  // namespace DEG
+
 /* Tag graph relations for update. */
 void DEG_graph_tag_relations_update(Depsgraph *graph)
 {
@@ -251,6 +535,26 @@ void DEG_graph_tag_relations_update(Depsgraph *graph)
 	deg_graph->need_update = true;
 }
 
+/* Tag relations of a single ID for update. */
+void DEG_graph_id_tag_relations_update(Depsgraph *graph, ID *id)
+{
+	DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
+	deg_graph->add_id_relations_tag(id);
+}
+
+/* Tag relations of a single ID for update in all graphs. */
+void DEG_id_tag_relations_update(Main *bmain, ID *id)
+{
+	for (Scene *scene = (Scene *)bmain->scene.first;
+	     scene != NULL;
+	     scene = (Scene *)scene->id.next)
+	{
+		if (scene->depsgraph != NULL) {
+			DEG_graph_id_tag_relations_update(scene->depsgraph, id);
+		}
+	}
+}
+
 /* Tag all relations for update. */
 void DEG_relations_tag_update(Main *bmain)
 {
@@ -277,15 +581,28 @@ void DEG_scene_relations_update(Main *bmain, Scene *scene)
 	}
 
 	DEG::Depsgraph *graph = reinterpret_cast<DEG::Depsgraph *>(scene->depsgraph);
-	if (!graph->need_update) {
+	if (!graph->need_update && BLI_gset_size(graph->id_relations_tags) == 0) {
 		/* Graph is up to date, nothing to do. */
 		return;
 	}
 
+	if (!graph->need_update) {
+		/* Only some of the IDs changed, try to rebuild just them. */
+		const bool updated = DEG::deg_graph_build_update_ids(bmain, scene, graph);
+		BLI_gset_clear(graph->id_relations_tags, NULL);
+		if (updated) {
+			if (G.debug & G_DEBUG_DEPSGRAPH_VALIDATE) {
+				DEG_debug_scene_relations_validate(bmain, scene);
+			}
+			return;
+		}
+	}
+
 	/* Clear all previous nodes and operations. */
 	graph->clear_all_nodes();
 	graph->operations.clear();
 	BLI_gset_clear(graph->entry_tags, NULL);
+	BLI_gset_clear(graph->id_relations_tags, NULL);
 
 	/* Build new nodes and relations. */
 	DEG_graph_build_from_scene(reinterpret_cast< ::Depsgraph * >(graph),
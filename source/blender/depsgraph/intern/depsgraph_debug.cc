@@ -30,8 +30,11 @@
  * Implementation of tools for debugging the depsgraph
  */
 
+#include <set>
+
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_string.h"
 
 extern "C" {
 #include "DNA_scene_types.h"
@@ -41,9 +44,64 @@ extern "C" {
 #include "DEG_depsgraph_debug.h"
 #include "DEG_depsgraph_build.h"
 
+#include "intern/eval/deg_eval_profile.h"
+#include "intern/nodes/deg_node.h"
+#include "intern/nodes/deg_node_component.h"
+#include "intern/nodes/deg_node_operation.h"
 #include "intern/depsgraph_intern.h"
 #include "util/deg_util_foreach.h"
 
+/* Identifier which doesn't depend on the evaluation state of the node. */
+static std::string deg_debug_node_key(const DEG::DepsNode *node)
+{
+	switch (node->tclass) {
+		case DEG::DEG_NODE_CLASS_OPERATION:
+			return ((const DEG::OperationDepsNode *)node)->full_identifier();
+		case DEG::DEG_NODE_CLASS_COMPONENT:
+		{
+			const DEG::ComponentDepsNode *comp_node = (const DEG::ComponentDepsNode *)node;
+			char type[16];
+			BLI_snprintf(type, sizeof(type), "(%d)", comp_node->type);
+			return std::string(comp_node->owner->name) + "." + type + comp_node->name;
+		}
+		default:
+			return node->identifier();
+	}
+}
+
+static void deg_debug_graph_keys(const DEG::Depsgraph *graph,
+                                 std::set<std::string> *r_operations,
+                                 std::set<std::string> *r_relations)
+{
+	foreach (DEG::OperationDepsNode *node, graph->operations) {
+		const std::string key = deg_debug_node_key(node);
+		r_operations->insert(key);
+		foreach (DEG::DepsRelation *rel, node->inlinks) {
+			r_relations->insert(deg_debug_node_key(rel->from) + " -> " + key);
+		}
+	}
+}
+
+static bool deg_debug_compare_keys(const std::set<std::string> &keys1,
+                                   const std::set<std::string> &keys2,
+                                   const char *what)
+{
+	bool equal = true;
+	foreach (const std::string &key, keys1) {
+		if (keys2.find(key) == keys2.end()) {
+			printf("%s only in first graph: %s\n", what, key.c_str());
+			equal = false;
+		}
+	}
+	foreach (const std::string &key, keys2) {
+		if (keys1.find(key) == keys1.end()) {
+			printf("%s only in second graph: %s\n", what, key.c_str());
+			equal = false;
+		}
+	}
+	return equal;
+}
+
 bool DEG_debug_compare(const struct Depsgraph *graph1,
                        const struct Depsgraph *graph2)
 {
@@ -52,16 +110,20 @@ bool DEG_debug_compare(const struct Depsgraph *graph1,
 	const DEG::Depsgraph *deg_graph1 = reinterpret_cast<const DEG::Depsgraph *>(graph1);
 	const DEG::Depsgraph *deg_graph2 = reinterpret_cast<const DEG::Depsgraph *>(graph2);
 	if (deg_graph1->operations.size() != deg_graph2->operations.size()) {
-		return false;
+		printf("Number of operations differ (%d vs. %d)\n",
+		       (int)deg_graph1->operations.size(),
+		       (int)deg_graph2->operations.size());
 	}
-	/* TODO(sergey): Currently we only do real stupid check,
-	 * which is fast but which isn't 100% reliable.
-	 *
-	 * Would be cool to make it more robust, but it's good enough
-	 * for now. Also, proper graph check is actually NP-complex
-	 * problem..
+	/* Operations and relations are compared by their identifiers, which
+	 * includes names of the owner IDs. Duplicated relations between the same
+	 * operations are not distinguished.
 	 */
-	return true;
+	std::set<std::string> operations1, operations2, relations1, relations2;
+	deg_debug_graph_keys(deg_graph1, &operations1, &relations1);
+	deg_debug_graph_keys(deg_graph2, &operations2, &relations2);
+	const bool operations_equal = deg_debug_compare_keys(operations1, operations2, "Operation");
+	const bool relations_equal = deg_debug_compare_keys(relations1, relations2, "Relation");
+	return operations_equal && relations_equal;
 }
 
 bool DEG_debug_scene_relations_validate(Main *bmain,
@@ -71,7 +133,8 @@ bool DEG_debug_scene_relations_validate(Main *bmain,
 	bool valid = true;
 	DEG_graph_build_from_scene(depsgraph, bmain, scene);
 	if (!DEG_debug_compare(depsgraph, scene->depsgraph)) {
-		fprintf(stderr, "ERROR! Depsgraph wasn't tagged for update when it should have!\n");
+		fprintf(stderr, "ERROR! Depsgraph differs from a full rebuild, "
+		        "it wasn't tagged or updated when it should have!\n");
 		BLI_assert(!"This should not happen!");
 		valid = false;
 	}
@@ -173,6 +236,28 @@ bool DEG_debug_consistency_check(Depsgraph *graph)
 
 /* ------------------------------------------------ */
 
+bool DEG_debug_eval_profile_trace(const Depsgraph *graph, FILE *stream)
+{
+	const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+	if (deg_graph->eval_profile == NULL) {
+		return false;
+	}
+	DEG::deg_eval_profile_write_trace(deg_graph->eval_profile, stream);
+	return true;
+}
+
+bool DEG_debug_eval_profile_summary(const Depsgraph *graph, FILE *stream)
+{
+	const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+	if (deg_graph->eval_profile == NULL) {
+		return false;
+	}
+	DEG::deg_eval_profile_write_summary(deg_graph->eval_profile, stream);
+	return true;
+}
+
+/* ------------------------------------------------ */
+
 /**
  * Obtain simple statistics about the complexity of the depsgraph
  * \param[out] r_outer       The number of outer nodes in the graph
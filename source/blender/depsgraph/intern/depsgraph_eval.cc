@@ -56,8 +56,7 @@ extern "C" {
 static bool use_legacy_depsgraph = true;
 #endif
 
-/* Unfinished and unused, and takes quite some pre-processing time. */
-#undef USE_EVAL_PRIORITY
+static bool use_cost_priority = false;
 
 bool DEG_depsgraph_use_legacy(void)
 {
@@ -89,6 +88,16 @@ void DEG_depsgraph_switch_to_new(void)
 #endif
 }
 
+bool DEG_depsgraph_use_cost_priority(void)
+{
+	return use_cost_priority;
+}
+
+void DEG_depsgraph_set_cost_priority(bool use)
+{
+	use_cost_priority = use;
+}
+
 /* ****************** */
 /* Evaluation Context */
 
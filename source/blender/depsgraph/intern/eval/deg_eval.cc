@@ -32,9 +32,12 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+
 #include "PIL_time.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_math_base.h"
 #include "BLI_task.h"
 #include "BLI_ghash.h"
 
@@ -48,6 +51,7 @@ extern "C" {
 #include "atomic_ops.h"
 
 #include "intern/eval/deg_eval_flush.h"
+#include "intern/eval/deg_eval_profile.h"
 #include "intern/nodes/deg_node.h"
 #include "intern/nodes/deg_node_component.h"
 #include "intern/nodes/deg_node_operation.h"
@@ -55,8 +59,10 @@ extern "C" {
 #include "intern/depsgraph_intern.h"
 #include "util/deg_util_foreach.h"
 
-/* Unfinished and unused, and takes quite some pre-processing time. */
-#undef USE_EVAL_PRIORITY
+/* Minimum cost of an operation when scheduling by cost priority, covers the
+ * scheduling overhead and operations which were not measured yet.
+ */
+#define EVAL_PRIORITY_MIN_COST 1e-6f
 
 /* Use integrated debugger to keep track how much each of the nodes was
  * evaluating.
@@ -68,6 +74,8 @@ namespace DEG {
 /* ********************** */
 /* Evaluation Entrypoints */
 
+typedef vector<OperationDepsNode *> ReadyOperations;
+
 /* Forward declarations. */
 static void schedule_children(TaskPool *pool,
                               Depsgraph *graph,
@@ -79,6 +87,14 @@ struct DepsgraphEvalState {
 	EvaluationContext *eval_ctx;
 	Depsgraph *graph;
 	unsigned int layers;
+	/* Only set when profiling. */
+	DepsgraphEvalProfile *profile;
+	/* Schedule by the longest remaining path instead of graph order. */
+	bool use_priority;
+	/* Tasks are being evaluated, pushes from worker threads go to their
+	 * local queue first.
+	 */
+	bool is_running;
 };
 
 static void deg_task_run_func(TaskPool *pool,
@@ -113,9 +129,26 @@ static void deg_task_run_func(TaskPool *pool,
 		DepsgraphDebug::task_started(state->graph, node);
 #endif
 
+		DepsgraphEvalProfile::Entry *profile_entry = NULL;
+		double start_time = 0.0;
+		if (state->profile != NULL) {
+			profile_entry = state->profile->operation_begin(node, thread_id);
+		}
+		if (state->use_priority) {
+			start_time = PIL_check_seconds_timer();
+		}
+
 		/* Perform operation. */
 		node->evaluate(state->eval_ctx);
 
+		/* Cost used for the priorities of the next update. */
+		if (state->use_priority) {
+			node->eval_cost = (float)(PIL_check_seconds_timer() - start_time);
+		}
+		if (profile_entry != NULL) {
+			state->profile->operation_end(profile_entry);
+		}
+
 			/* Note how long this took. */
 #ifdef USE_DEBUGGER
 		double end_time = PIL_check_seconds_timer();
@@ -180,7 +213,11 @@ static void calculate_pending_parents(Depsgraph *graph, unsigned int layers)
 	                        do_threads);
 }
 
-#ifdef USE_EVAL_PRIORITY
+/* Priority is the longest remaining path through the operations which need
+ * an update, weighted by the time they took in the previous update. Chains of
+ * expensive operations are started first, so they don't end up evaluating
+ * alone after the cheap operations have been done.
+ */
 static void calculate_eval_priority(OperationDepsNode *node)
 {
 	if (node->done) {
@@ -189,23 +226,70 @@ static void calculate_eval_priority(OperationDepsNode *node)
 	node->done = 1;
 
 	if (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) {
-		/* XXX standard cost of a node, could be estimated somewhat later on */
-		const float cost = 1.0f;
-		/* NOOP nodes have no cost */
-		node->eval_priority = node->is_noop() ? cost : 0.0f;
-
+		float children_priority = 0.0f;
 		foreach (DepsRelation *rel, node->outlinks) {
+			if (rel->flag & DEPSREL_FLAG_CYCLIC) {
+				continue;
+			}
 			OperationDepsNode *to = (OperationDepsNode *)rel->to;
 			BLI_assert(to->type == DEG_NODE_TYPE_OPERATION);
 			calculate_eval_priority(to);
-			node->eval_priority += to->eval_priority;
+			children_priority = max_ff(children_priority, to->eval_priority);
 		}
+		/* NOOP nodes have no cost */
+		const float cost = node->is_noop() ? 0.0f : max_ff(node->eval_cost, EVAL_PRIORITY_MIN_COST);
+		node->eval_priority = children_priority + cost;
 	}
 	else {
 		node->eval_priority = 0.0f;
 	}
 }
-#endif
+
+static bool eval_priority_less(const OperationDepsNode *a,
+                               const OperationDepsNode *b)
+{
+	return a->eval_priority < b->eval_priority;
+}
+
+static void schedule_operation(TaskPool *pool,
+                               OperationDepsNode *node,
+                               const int thread_id)
+{
+	/* children are scheduled once this task is completed */
+	BLI_task_pool_push_from_thread(pool,
+	                               deg_task_run_func,
+	                               node,
+	                               false,
+	                               TASK_PRIORITY_HIGH,
+	                               thread_id);
+}
+
+/* The task scheduler only knows high and low priority tasks, so priorities
+ * are expressed by the order in which ready operations are pushed.
+ */
+static void schedule_by_priority(TaskPool *pool,
+                                 DepsgraphEvalState *state,
+                                 ReadyOperations &ready,
+                                 const int thread_id)
+{
+	if (ready.empty()) {
+		return;
+	}
+	std::sort(ready.begin(), ready.end(), eval_priority_less);
+	if (state->is_running) {
+		/* First task pushed from a worker goes to its local queue and is
+		 * evaluated next by the same thread, keep the most critical one here.
+		 */
+		schedule_operation(pool, ready.back(), thread_id);
+		ready.pop_back();
+	}
+	/* Other tasks are added to the head of the queue, the last one pushed
+	 * is picked up first.
+	 */
+	foreach (OperationDepsNode *node, ready) {
+		schedule_operation(pool, node, thread_id);
+	}
+}
 
 /* Schedule a node if it needs evaluation.
  *   dec_parents: Decrement pending parents count, true when child nodes are
@@ -213,7 +297,7 @@ static void calculate_eval_priority(OperationDepsNode *node)
  */
 static void schedule_node(TaskPool *pool, Depsgraph *graph, unsigned int layers,
                           OperationDepsNode *node, bool dec_parents,
-                          const int thread_id)
+                          const int thread_id, ReadyOperations *r_ready)
 {
 	unsigned int id_layers = node->owner->owner->layers;
 
@@ -231,16 +315,19 @@ static void schedule_node(TaskPool *pool, Depsgraph *graph, unsigned int layers,
 			if (!is_scheduled) {
 				if (node->is_noop()) {
 					/* skip NOOP node, schedule children right away */
+					DepsgraphEvalState *state =
+					        reinterpret_cast<DepsgraphEvalState *>(BLI_task_pool_userdata(pool));
+					if (state->profile != NULL) {
+						/* Keep the NOOP in the profile so the critical path passes through it. */
+						state->profile->operation_begin(node, thread_id);
+					}
 					schedule_children(pool, graph, node, layers, thread_id);
 				}
+				else if (r_ready != NULL) {
+					r_ready->push_back(node);
+				}
 				else {
-					/* children are scheduled once this task is completed */
-					BLI_task_pool_push_from_thread(pool,
-					                               deg_task_run_func,
-					                               node,
-					                               false,
-					                               TASK_PRIORITY_HIGH,
-					                               thread_id);
+					schedule_operation(pool, node, thread_id);
 				}
 			}
 		}
@@ -251,8 +338,15 @@ static void schedule_graph(TaskPool *pool,
                            Depsgraph *graph,
                            const unsigned int layers)
 {
+	DepsgraphEvalState *state =
+	        reinterpret_cast<DepsgraphEvalState *>(BLI_task_pool_userdata(pool));
+	ReadyOperations ready;
+	ReadyOperations *r_ready = state->use_priority ? &ready : NULL;
 	foreach (OperationDepsNode *node, graph->operations) {
-		schedule_node(pool, graph, layers, node, false, 0);
+		schedule_node(pool, graph, layers, node, false, 0, r_ready);
+	}
+	if (r_ready != NULL) {
+		schedule_by_priority(pool, state, ready, 0);
 	}
 }
 
@@ -262,6 +356,10 @@ static void schedule_children(TaskPool *pool,
                               const unsigned int layers,
                               const int thread_id)
 {
+	DepsgraphEvalState *state =
+	        reinterpret_cast<DepsgraphEvalState *>(BLI_task_pool_userdata(pool));
+	ReadyOperations ready;
+	ReadyOperations *r_ready = state->use_priority ? &ready : NULL;
 	foreach (DepsRelation *rel, node->outlinks) {
 		OperationDepsNode *child = (OperationDepsNode *)rel->to;
 		BLI_assert(child->type == DEG_NODE_TYPE_OPERATION);
@@ -274,7 +372,11 @@ static void schedule_children(TaskPool *pool,
 		              layers,
 		              child,
 		              (rel->flag & DEPSREL_FLAG_CYCLIC) == 0,
-		              thread_id);
+		              thread_id,
+		              r_ready);
+	}
+	if (r_ready != NULL) {
+		schedule_by_priority(pool, state, ready, thread_id);
 	}
 }
 
@@ -311,6 +413,12 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 	state.eval_ctx = eval_ctx;
 	state.graph = graph;
 	state.layers = layers;
+	state.profile = NULL;
+	state.use_priority = DEG_depsgraph_use_cost_priority();
+	state.is_running = false;
+	if (G.debug & G_DEBUG_DEPSGRAPH_PROFILE) {
+		state.profile = deg_eval_profile_begin(graph);
+	}
 
 	TaskScheduler *task_scheduler;
 	bool need_free_scheduler;
@@ -334,17 +442,22 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 	}
 
 	/* Calculate priority for operation nodes. */
-#ifdef USE_EVAL_PRIORITY
-	foreach (OperationDepsNode *node, graph->operations) {
-		calculate_eval_priority(node);
+	if (state.use_priority) {
+		foreach (OperationDepsNode *node, graph->operations) {
+			calculate_eval_priority(node);
+		}
 	}
-#endif
 
 	schedule_graph(task_pool, graph, layers);
 
+	state.is_running = true;
 	BLI_task_pool_work_and_wait(task_pool);
 	BLI_task_pool_free(task_pool);
 
+	if (state.profile != NULL) {
+		deg_eval_profile_end(graph);
+	}
+
 	/* Clear any uncleared tags - just in case. */
 	deg_graph_clear_tags(graph);
 
@@ -0,0 +1,305 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Blender Foundation.
+ * All rights reserved.
+ *
+ * Contributor(s): None Yet
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/depsgraph/intern/eval/deg_eval_profile.cc
+ *  \ingroup depsgraph
+ *
+ * Timing of operations evaluated by the Depsgraph Engine.
+ */
+
+#include "intern/eval/deg_eval_profile.h"
+
+#include <algorithm>
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+
+#include "atomic_ops.h"
+
+#include "intern/nodes/deg_node.h"
+#include "intern/nodes/deg_node_operation.h"
+#include "intern/depsgraph.h"
+#include "util/deg_util_foreach.h"
+
+namespace DEG {
+
+/* Number of slowest operations listed in the summary. */
+#define PROFILE_SUMMARY_SLOWEST 20
+
+DepsgraphEvalProfile::DepsgraphEvalProfile(size_t num_operations)
+  : start_time(PIL_check_seconds_timer()),
+    end_time(start_time),
+    entries(num_operations),
+    num_entries(0),
+    critical_end(-1)
+{
+}
+
+DepsgraphEvalProfile::Entry *DepsgraphEvalProfile::operation_begin(
+        OperationDepsNode *node,
+        int thread_id)
+{
+	/* Every operation is scheduled at most once per evaluation, so there is
+	 * always room for it.
+	 */
+	const unsigned int index = atomic_fetch_and_add_uint32(&num_entries, 1);
+	BLI_assert(index < entries.size());
+	Entry *entry = &entries[index];
+	entry->node = node;
+	entry->thread_id = thread_id;
+	entry->critical_parent = -1;
+	entry->start_time = PIL_check_seconds_timer();
+	entry->end_time = entry->start_time;
+	return entry;
+}
+
+void DepsgraphEvalProfile::operation_end(Entry *entry)
+{
+	entry->end_time = PIL_check_seconds_timer();
+}
+
+vector<int> DepsgraphEvalProfile::critical_path() const
+{
+	vector<int> path;
+	for (int index = critical_end; index != -1; index = entries[index].critical_parent) {
+		path.push_back(index);
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+double DepsgraphEvalProfile::critical_path_time() const
+{
+	double time = 0.0;
+	foreach (int index, critical_path()) {
+		time += entries[index].end_time - entries[index].start_time;
+	}
+	return time;
+}
+
+double DepsgraphEvalProfile::operations_time() const
+{
+	double time = 0.0;
+	for (unsigned int index = 0; index < num_entries; ++index) {
+		time += entries[index].end_time - entries[index].start_time;
+	}
+	return time;
+}
+
+int DepsgraphEvalProfile::num_threads() const
+{
+	int max_thread_id = -1;
+	for (unsigned int index = 0; index < num_entries; ++index) {
+		max_thread_id = std::max(max_thread_id, entries[index].thread_id);
+	}
+	return max_thread_id + 1;
+}
+
+DepsgraphEvalProfile *deg_eval_profile_begin(Depsgraph *graph)
+{
+	if (graph->eval_profile != NULL) {
+		OBJECT_GUARDED_DELETE(graph->eval_profile, DepsgraphEvalProfile);
+	}
+	graph->eval_profile = OBJECT_GUARDED_NEW(DepsgraphEvalProfile,
+	                                         graph->operations.size());
+	return graph->eval_profile;
+}
+
+void deg_eval_profile_end(Depsgraph *graph)
+{
+	DepsgraphEvalProfile *profile = graph->eval_profile;
+	BLI_assert(profile != NULL);
+	profile->end_time = PIL_check_seconds_timer();
+
+	GHash *indices = BLI_ghash_ptr_new_ex("Depsgraph profile indices",
+	                                      profile->num_entries);
+	for (unsigned int index = 0; index < profile->num_entries; ++index) {
+		BLI_ghash_insert(indices,
+		                 profile->entries[index].node,
+		                 SET_INT_IN_POINTER(index));
+	}
+
+	/* Longest path through the evaluated operations, weighted by their time.
+	 * Parents always come before their children in the entries, so a single
+	 * pass is enough.
+	 */
+	vector<double> path_time(profile->num_entries, 0.0);
+	double critical_time = -1.0;
+	for (unsigned int index = 0; index < profile->num_entries; ++index) {
+		DepsgraphEvalProfile::Entry &entry = profile->entries[index];
+		double parent_time = 0.0;
+		foreach (DepsRelation *rel, entry.node->inlinks) {
+			if (rel->from->type != DEG_NODE_TYPE_OPERATION ||
+			    (rel->flag & DEPSREL_FLAG_CYCLIC) != 0)
+			{
+				continue;
+			}
+			void **parent_p = BLI_ghash_lookup_p(indices, rel->from);
+			if (parent_p == NULL) {
+				continue;
+			}
+			const int parent = GET_INT_FROM_POINTER(*parent_p);
+			if (parent < (int)index && path_time[parent] > parent_time) {
+				parent_time = path_time[parent];
+				entry.critical_parent = parent;
+			}
+		}
+		path_time[index] = parent_time + (entry.end_time - entry.start_time);
+		if (path_time[index] > critical_time) {
+			critical_time = path_time[index];
+			profile->critical_end = index;
+		}
+
+		entry.identifier = entry.node->full_identifier();
+		entry.node = NULL;
+	}
+
+	BLI_ghash_free(indices, NULL, NULL);
+
+	deg_eval_profile_write_summary_line(profile, stdout);
+}
+
+static void profile_write_string(FILE *stream, const string &str)
+{
+	fputc('"', stream);
+	foreach (char c, str) {
+		if (c == '"' || c == '\\') {
+			fprintf(stream, "\\%c", c);
+		}
+		else if ((unsigned char)c < 0x20) {
+			fprintf(stream, "\\u%04x", (unsigned char)c);
+		}
+		else {
+			fputc(c, stream);
+		}
+	}
+	fputc('"', stream);
+}
+
+/* Chrome trace event format, can be loaded in chrome://tracing. */
+void deg_eval_profile_write_trace(const DepsgraphEvalProfile *profile, FILE *stream)
+{
+	vector<bool> is_critical(profile->num_entries, false);
+	foreach (int index, profile->critical_path()) {
+		is_critical[index] = true;
+	}
+
+	fprintf(stream, "{\"traceEvents\": [\n");
+	for (unsigned int index = 0; index < profile->num_entries; ++index) {
+		const DepsgraphEvalProfile::Entry &entry = profile->entries[index];
+		fprintf(stream, "\t{\"name\": ");
+		profile_write_string(stream, entry.identifier);
+		fprintf(stream,
+		        ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+		        "\"ts\": %.3f, \"dur\": %.3f},\n",
+		        is_critical[index] ? "critical" : "operation",
+		        entry.thread_id,
+		        (entry.start_time - profile->start_time) * 1e6,
+		        (entry.end_time - entry.start_time) * 1e6);
+	}
+	fprintf(stream,
+	        "\t{\"name\": \"Depsgraph evaluation\", \"cat\": \"graph\", \"ph\": \"X\", "
+	        "\"pid\": 0, \"tid\": -1, \"ts\": 0.000, \"dur\": %.3f}\n",
+	        (profile->end_time - profile->start_time) * 1e6);
+	fprintf(stream, "], \"displayTimeUnit\": \"ms\"}\n");
+}
+
+static bool profile_entry_slower(const DepsgraphEvalProfile::Entry *a,
+                                 const DepsgraphEvalProfile::Entry *b)
+{
+	return (a->end_time - a->start_time) > (b->end_time - b->start_time);
+}
+
+void deg_eval_profile_write_summary_line(const DepsgraphEvalProfile *profile, FILE *stream)
+{
+	const double wall_time = profile->end_time - profile->start_time;
+	fprintf(stream,
+	        "Depsgraph evaluation: %u operations in %.3f ms, "
+	        "critical path %.3f ms, %.3f ms on %d threads\n",
+	        profile->num_entries,
+	        wall_time * 1000.0,
+	        profile->critical_path_time() * 1000.0,
+	        profile->operations_time() * 1000.0,
+	        profile->num_threads());
+}
+
+void deg_eval_profile_write_summary(const DepsgraphEvalProfile *profile, FILE *stream)
+{
+	const double wall_time = profile->end_time - profile->start_time;
+	const double operations_time = profile->operations_time();
+	const int num_threads = profile->num_threads();
+
+	deg_eval_profile_write_summary_line(profile, stream);
+	if (wall_time > 0.0) {
+		fprintf(stream, "Average parallelism: %.2f\n", operations_time / wall_time);
+	}
+
+	/* Time each thread spent evaluating operations. */
+	vector<double> thread_time(num_threads, 0.0);
+	vector<int> thread_operations(num_threads, 0);
+	for (unsigned int index = 0; index < profile->num_entries; ++index) {
+		const DepsgraphEvalProfile::Entry &entry = profile->entries[index];
+		thread_time[entry.thread_id] += entry.end_time - entry.start_time;
+		++thread_operations[entry.thread_id];
+	}
+	fprintf(stream, "\nThreads:\n");
+	for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+		fprintf(stream, "  %2d: %10.3f ms  %6d operations\n",
+		        thread_id,
+		        thread_time[thread_id] * 1000.0,
+		        thread_operations[thread_id]);
+	}
+
+	fprintf(stream, "\nCritical path:\n");
+	foreach (int index, profile->critical_path()) {
+		const DepsgraphEvalProfile::Entry &entry = profile->entries[index];
+		fprintf(stream, "  %10.3f ms  %s\n",
+		        (entry.end_time - entry.start_time) * 1000.0,
+		        entry.identifier.c_str());
+	}
+
+	vector<const DepsgraphEvalProfile::Entry *> slowest;
+	for (unsigned int index = 0; index < profile->num_entries; ++index) {
+		slowest.push_back(&profile->entries[index]);
+	}
+	const size_t num_slowest = std::min(slowest.size(), (size_t)PROFILE_SUMMARY_SLOWEST);
+	std::partial_sort(slowest.begin(),
+	                  slowest.begin() + num_slowest,
+	                  slowest.end(),
+	                  profile_entry_slower);
+	fprintf(stream, "\nSlowest operations:\n");
+	for (size_t index = 0; index < num_slowest; ++index) {
+		const DepsgraphEvalProfile::Entry *entry = slowest[index];
+		fprintf(stream, "  %10.3f ms  %s\n",
+		        (entry->end_time - entry->start_time) * 1000.0,
+		        entry->identifier.c_str());
+	}
+}
+
+}  // namespace DEG
@@ -0,0 +1,96 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2017 Blender Foundation.
+ * All rights reserved.
+ *
+ * Contributor(s): None Yet
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/depsgraph/intern/eval/deg_eval_profile.h
+ *  \ingroup depsgraph
+ *
+ * Timing of operations evaluated by the Depsgraph Engine.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include "intern/depsgraph_types.h"
+
+namespace DEG {
+
+struct Depsgraph;
+struct OperationDepsNode;
+
+/* Timing of a single evaluation of the graph, recorded when running with
+ * --debug-depsgraph-profile.
+ *
+ * Entries are kept in the order operations started evaluating. Since an
+ * operation only starts once all of its parents have finished, this order
+ * is also a topological order of the evaluated operations.
+ */
+struct DepsgraphEvalProfile {
+	struct Entry {
+		/* Only valid during evaluation, identifiers are copied once it is done
+		 * so the profile stays valid when the graph is rebuilt.
+		 */
+		OperationDepsNode *node;
+		string identifier;
+		double start_time;
+		double end_time;
+		int thread_id;
+		/* Index of the parent entry on the longest path leading to this one. */
+		int critical_parent;
+	};
+
+	DepsgraphEvalProfile(size_t num_operations);
+
+	/* Reserve an entry for an operation which starts evaluating, thread safe. */
+	Entry *operation_begin(OperationDepsNode *node, int thread_id);
+	void operation_end(Entry *entry);
+
+	/* Entries on the critical path, from the first operation to the last. */
+	vector<int> critical_path() const;
+	double critical_path_time() const;
+	double operations_time() const;
+	int num_threads() const;
+
+	double start_time;
+	double end_time;
+
+	vector<Entry> entries;
+	unsigned int num_entries;
+	/* Last entry of the critical path, -1 when nothing was evaluated. */
+	int critical_end;
+};
+
+/* Start recording the evaluation of the graph. */
+DepsgraphEvalProfile *deg_eval_profile_begin(Depsgraph *graph);
+
+/* Compute the critical path while the graph relations are still valid. */
+void deg_eval_profile_end(Depsgraph *graph);
+
+void deg_eval_profile_write_trace(const DepsgraphEvalProfile *profile, FILE *stream);
+void deg_eval_profile_write_summary(const DepsgraphEvalProfile *profile, FILE *stream);
+/* Single line with the evaluation time and length of the critical path. */
+void deg_eval_profile_write_summary_line(const DepsgraphEvalProfile *profile, FILE *stream);
+
+}  // namespace DEG
@@ -45,6 +45,8 @@ namespace DEG {
 
 OperationDepsNode::OperationDepsNode() :
     eval_priority(0.0f),
+    eval_cost(0.0f),
+    name_tag(-1),
     flag(0),
     customdata_mask(0)
 {
@@ -74,11 +74,18 @@ struct OperationDepsNode : public DepsNode {
 
 	/* How many inlinks are we still waiting on before we can be evaluated. */
 	uint32_t num_links_pending;
+	/* Longest remaining path to the end of the graph, in seconds. */
 	float eval_priority;
+	/* Time the last evaluation took in seconds, only measured when
+	 * scheduling by cost priority.
+	 */
+	float eval_cost;
 	bool scheduled;
 
 	/* Identifier for the operation being performed. */
 	eDepsOperation_Code opcode;
+	/* Tag to distinguish operations with the same name, -1 when not used. */
+	int name_tag;
 
 	/* (eDepsOperation_Flag) extra settings affecting evaluation. */
 	int flag;
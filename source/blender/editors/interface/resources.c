@@ -2782,7 +2782,9 @@ void init_userdef_do_versions(void)
 	 * (keep this block even if it becomes empty).
 	 */
 	{
-		
+		if (U.seq_prefetch_share == 0) {
+			U.seq_prefetch_share = 50;
+		}
 	}
 
 	if (U.pixelsize == 0.0f)
@@ -868,6 +868,7 @@ static int parent_set_exec(bContext *C, wmOperator *op)
 				ok = false;
 				break;
 			}
+			DAG_id_relations_tag_update(bmain, &ob->id);
 		}
 		CTX_DATA_END;
 	}
@@ -879,7 +880,6 @@ static int parent_set_exec(bContext *C, wmOperator *op)
 	if (!ok)
 		return OPERATOR_CANCELLED;
 
-	DAG_relations_tag_update(bmain);
 	WM_event_add_notifier(C, NC_OBJECT | ND_TRANSFORM, NULL);
 	WM_event_add_notifier(C, NC_OBJECT | ND_PARENT, NULL);
 
@@ -991,6 +991,9 @@ static int screen_render_invoke(bContext *C, wmOperator *op, const wmEvent *even
 	 * have started before the job thread */
 	G.is_rendering = true;
 
+	/* the render uses the movie readers of the strips */
+	BKE_sequencer_prefetch_stop();
+
 	/* add modal handler for ESC */
 	WM_event_add_modal_handler(C, op);
 
@@ -539,6 +539,9 @@ static void screen_opengl_render_apply(OGLRender *oglrender)
 		        oglrender->sizex, oglrender->sizey, 100.0f,
 		        &context);
 
+		/* frames ahead may be rendered by the sequencer during playback */
+		BKE_sequencer_prefetch_render_lock();
+
 		for (view_id = 0; view_id < oglrender->views_len; view_id++) {
 			context.view_id = view_id;
 			context.gpu_offscreen = oglrender->ofs;
@@ -547,6 +550,8 @@ static void screen_opengl_render_apply(OGLRender *oglrender)
 
 			oglrender->seq_data.ibufs_arr[view_id] = BKE_sequencer_give_ibuf(&context, CFRA, chanshown);
 		}
+
+		BKE_sequencer_prefetch_render_unlock();
 	}
 
 	rr = RE_AcquireResultRead(oglrender->re);
@@ -45,6 +45,7 @@
 
 #include "BKE_context.h"
 #include "BKE_depsgraph.h"
+#include "BKE_global.h"
 #include "BKE_library.h"
 #include "BKE_main.h"
 #include "BKE_node.h"
@@ -930,6 +931,18 @@ static void node_draw_basis(const bContext *C, ARegion *ar, SpaceNode *snode, bN
 	
 	nodeLabel(ntree, node, showname, sizeof(showname));
 	
+#ifdef WITH_COMPOSITOR
+	/* time spent on the node in the last execution, when profiling the compositor */
+	if ((G.debug & G_DEBUG_COMPOSITOR) && ntree->type == NTREE_COMPOSIT) {
+		const float time = COM_profile_node_time(node);
+		if (time >= 0.0f) {
+			char label[128];
+			BLI_strncpy(label, showname, sizeof(label));
+			BLI_snprintf(showname, sizeof(showname), "%s (%.1f ms)", label, time);
+		}
+	}
+#endif
+	
 	//if (node->flag & NODE_MUTED)
 	//	BLI_snprintf(showname, sizeof(showname), "[%s]", showname); /* XXX - don't print into self! */
 	
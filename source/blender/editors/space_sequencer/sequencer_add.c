@@ -290,6 +290,8 @@ static int sequencer_add_scene_strip_exec(bContext *C, wmOperator *op)
 	Strip *strip;
 	
 	int start_frame, channel; /* operator props */
+
+	BKE_sequencer_prefetch_stop();
 	
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	channel = RNA_int_get(op->ptr, "channel");
@@ -378,6 +380,8 @@ static int sequencer_add_movieclip_strip_exec(bContext *C, wmOperator *op)
 	Strip *strip;
 	
 	int start_frame, channel; /* operator props */
+
+	BKE_sequencer_prefetch_stop();
 	
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	channel = RNA_int_get(op->ptr, "channel");
@@ -464,6 +468,8 @@ static int sequencer_add_mask_strip_exec(bContext *C, wmOperator *op)
 
 	int start_frame, channel; /* operator props */
 
+	BKE_sequencer_prefetch_stop();
+
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	channel = RNA_int_get(op->ptr, "channel");
 
@@ -545,6 +551,8 @@ static int sequencer_add_generic_strip_exec(bContext *C, wmOperator *op, SeqLoad
 	SeqLoadInfo seq_load;
 	int tot_files;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq_load_operator_info(&seq_load, op);
 
 	if (seq_load.flag & SEQ_LOAD_REPLACE_SEL)
@@ -855,6 +863,8 @@ static int sequencer_add_image_strip_exec(bContext *C, wmOperator *op)
 	StripElem *se;
 	const bool use_placeholders = RNA_boolean_get(op->ptr, "use_placeholders");
 
+	BKE_sequencer_prefetch_stop();
+
 	seq_load_operator_info(&seq_load, op);
 
 	/* images are unique in how they handle this - 1 per strip elem */
@@ -982,6 +992,8 @@ static int sequencer_add_effect_strip_exec(bContext *C, wmOperator *op)
 	Sequence *seq1, *seq2, *seq3;
 	const char *error_msg;
 
+	BKE_sequencer_prefetch_stop();
+
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	end_frame = RNA_int_get(op->ptr, "frame_end");
 	channel = RNA_int_get(op->ptr, "channel");
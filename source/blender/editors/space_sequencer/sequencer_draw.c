@@ -68,6 +68,7 @@
 #include "ED_mask.h"
 #include "ED_sequencer.h"
 #include "ED_screen.h"
+#include "ED_screen_types.h"
 #include "ED_space_api.h"
 
 #include "UI_interface.h"
@@ -75,6 +76,7 @@
 #include "UI_view2d.h"
 
 #include "WM_api.h"
+#include "WM_types.h"
 
 #include "MEM_guardedalloc.h"
 
@@ -909,6 +911,19 @@ void ED_sequencer_special_preview_clear(void)
 	sequencer_special_update_set(NULL);
 }
 
+/* frames ahead are only rendered when playing forward */
+static bool sequencer_is_playing_forward(Main *bmain)
+{
+	bScreen *screen = ED_screen_animation_no_scrub(bmain->wm.first);
+
+	if (screen) {
+		ScreenAnimData *sad = screen->animtimer->customdata;
+		return (sad->flag & ANIMPLAY_FLAG_REVERSE) == 0;
+	}
+
+	return false;
+}
+
 ImBuf *sequencer_ibuf_get(struct Main *bmain, Scene *scene, SpaceSeq *sseq, int cfra, int frame_ofs, const char *viewname)
 {
 	SeqRenderData context = {0};
@@ -917,6 +932,7 @@ ImBuf *sequencer_ibuf_get(struct Main *bmain, Scene *scene, SpaceSeq *sseq, int
 	float render_size;
 	float proxy_size = 100.0;
 	short is_break = G.is_break;
+	const bool is_playing = sequencer_is_playing_forward(bmain);
 
 	render_size = sseq->render_size;
 	if (render_size == 0) {
@@ -950,12 +966,24 @@ ImBuf *sequencer_ibuf_get(struct Main *bmain, Scene *scene, SpaceSeq *sseq, int
 	 */
 	G.is_break = false;
 
-	if (special_seq_update)
-		ibuf = BKE_sequencer_give_ibuf_direct(&context, cfra + frame_ofs, special_seq_update);
-	else if (!U.prefetchframes) // XXX || (G.f & G_PLAYANIM) == 0) {
-		ibuf = BKE_sequencer_give_ibuf(&context, cfra + frame_ofs, sseq->chanshown);
-	else
-		ibuf = BKE_sequencer_give_ibuf_threaded(&context, cfra + frame_ofs, sseq->chanshown);
+	if (!is_playing) {
+		BKE_sequencer_prefetch_stop();
+	}
+
+	if (special_seq_update == NULL && frame_ofs == 0 && U.prefetchframes && is_playing) {
+		ibuf = BKE_sequencer_give_ibuf_threaded(&context, cfra, sseq->chanshown);
+	}
+	else {
+		/* frames ahead may still be rendered, for overlays drawn during playback */
+		BKE_sequencer_prefetch_render_lock();
+
+		if (special_seq_update)
+			ibuf = BKE_sequencer_give_ibuf_direct(&context, cfra + frame_ofs, special_seq_update);
+		else
+			ibuf = BKE_sequencer_give_ibuf(&context, cfra + frame_ofs, sseq->chanshown);
+
+		BKE_sequencer_prefetch_render_unlock();
+	}
 
 	/* restore state so real rendering would be canceled (if needed) */
 	G.is_break = is_break;
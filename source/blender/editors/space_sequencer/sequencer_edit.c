@@ -1014,6 +1014,8 @@ static int sequencer_gap_remove_exec(bContext *C, wmOperator *op)
 	bool first = false, done;
 	bool do_all = RNA_boolean_get(op->ptr, "all");
 
+	BKE_sequencer_prefetch_stop();
+
 	/* get first and last frame */
 	boundbox_seq(scene, &rectf);
 	sfra = (int)rectf.xmin;
@@ -1071,6 +1073,8 @@ static int sequencer_gap_insert_exec(bContext *C, wmOperator *op)
 {
 	Scene *scene = CTX_data_scene(C);
 	int frames = RNA_int_get(op->ptr, "frames");
+
+	BKE_sequencer_prefetch_stop();
 	
 	sequence_offset_after_frame(scene, frames, CFRA);
 	
@@ -1164,6 +1168,8 @@ static int sequencer_snap_exec(bContext *C, wmOperator *op)
 	Sequence *seq;
 	int snap_frame;
 
+	BKE_sequencer_prefetch_stop();
+
 	snap_frame = RNA_int_get(op->ptr, "frame");
 
 	/* also check metas */
@@ -1360,6 +1366,8 @@ static int sequencer_slip_invoke(bContext *C, wmOperator *op, const wmEvent *eve
 	int num_seq, i;
 	View2D *v2d = UI_view2d_fromcontext(C);
 
+	BKE_sequencer_prefetch_stop();
+
 	/* first recursively cound the trimmed elements */
 	num_seq = slip_count_sequences_rec(ed->seqbasep, true);
 
@@ -1470,6 +1478,8 @@ static int sequencer_slip_exec(bContext *C, wmOperator *op)
 	int offset = RNA_int_get(op->ptr, "offset");
 	bool success = false;
 
+	BKE_sequencer_prefetch_stop();
+
 	/* first recursively cound the trimmed elements */
 	num_seq = slip_count_sequences_rec(ed->seqbasep, true);
 
@@ -1697,6 +1707,8 @@ static int sequencer_mute_exec(bContext *C, wmOperator *op)
 	Sequence *seq;
 	bool selected;
 
+	BKE_sequencer_prefetch_stop();
+
 	selected = !RNA_boolean_get(op->ptr, "unselected");
 	
 	for (seq = ed->seqbasep->first; seq; seq = seq->next) {
@@ -1748,6 +1760,8 @@ static int sequencer_unmute_exec(bContext *C, wmOperator *op)
 	Sequence *seq;
 	bool selected;
 
+	BKE_sequencer_prefetch_stop();
+
 	selected = !RNA_boolean_get(op->ptr, "unselected");
 	
 	for (seq = ed->seqbasep->first; seq; seq = seq->next) {
@@ -1865,6 +1879,8 @@ static int sequencer_reload_exec(bContext *C, wmOperator *op)
 	Sequence *seq;
 	const bool adjust_length = RNA_boolean_get(op->ptr, "adjust_length");
 
+	BKE_sequencer_prefetch_stop();
+
 	for (seq = ed->seqbasep->first; seq; seq = seq->next) {
 		if (seq->flag & SELECT) {
 			BKE_sequencer_update_changed_seq_and_deps(scene, seq, 0, 1);
@@ -1917,6 +1933,8 @@ static int sequencer_refresh_all_exec(bContext *C, wmOperator *UNUSED(op))
 	Scene *scene = CTX_data_scene(C);
 	Editing *ed = BKE_sequencer_editing_get(scene, false);
 
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequencer_free_imbuf(scene, &ed->seqbase, false);
 
 	WM_event_add_notifier(C, NC_SCENE | ND_SEQUENCER, scene);
@@ -1942,6 +1960,8 @@ static int sequencer_reassign_inputs_exec(bContext *C, wmOperator *op)
 	Sequence *seq1, *seq2, *seq3, *last_seq = BKE_sequencer_active_get(scene);
 	const char *error_msg;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (!seq_effect_find_selected(scene, last_seq, last_seq->type, &seq1, &seq2, &seq3, &error_msg)) {
 		BKE_report(op->reports, RPT_ERROR, error_msg);
 		return OPERATOR_CANCELLED;
@@ -2002,6 +2022,8 @@ static int sequencer_swap_inputs_exec(bContext *C, wmOperator *op)
 	Scene *scene = CTX_data_scene(C);
 	Sequence *seq, *last_seq = BKE_sequencer_active_get(scene);
 
+	BKE_sequencer_prefetch_stop();
+
 	if (last_seq->seq1 == NULL || last_seq->seq2 == NULL) {
 		BKE_report(op->reports, RPT_ERROR, "No valid inputs to swap");
 		return OPERATOR_CANCELLED;
@@ -2048,6 +2070,8 @@ static int sequencer_cut_exec(bContext *C, wmOperator *op)
 
 	bool changed;
 
+	BKE_sequencer_prefetch_stop();
+
 	cut_frame = RNA_int_get(op->ptr, "frame");
 	cut_hard = RNA_enum_get(op->ptr, "type");
 	cut_side = RNA_enum_get(op->ptr, "side");
@@ -2160,6 +2184,8 @@ static int sequencer_add_duplicate_exec(bContext *C, wmOperator *UNUSED(op))
 
 	ListBase nseqbase = {NULL, NULL};
 
+	BKE_sequencer_prefetch_stop();
+
 	if (ed == NULL)
 		return OPERATOR_CANCELLED;
 
@@ -2207,6 +2233,8 @@ static int sequencer_delete_exec(bContext *C, wmOperator *UNUSED(op))
 	MetaStack *ms;
 	bool nothingSelected = true;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq = BKE_sequencer_active_get(scene);
 	if (seq && seq->flag & SELECT) { /* avoid a loop since this is likely to be selected */
 		nothingSelected = false;
@@ -2297,6 +2325,8 @@ static int sequencer_offset_clear_exec(bContext *C, wmOperator *UNUSED(op))
 	Editing *ed = BKE_sequencer_editing_get(scene, false);
 	Sequence *seq;
 
+	BKE_sequencer_prefetch_stop();
+
 	/* for effects, try to find a replacement input */
 	for (seq = ed->seqbasep->first; seq; seq = seq->next) {
 		if ((seq->type & SEQ_TYPE_EFFECT) == 0 && (seq->flag & SELECT)) {
@@ -2354,6 +2384,8 @@ static int sequencer_separate_images_exec(bContext *C, wmOperator *op)
 	int start_ofs, cfra, frame_end;
 	int step = RNA_int_get(op->ptr, "length");
 
+	BKE_sequencer_prefetch_stop();
+
 	seq = ed->seqbasep->first; /* poll checks this is valid */
 
 	while (seq) {
@@ -2453,6 +2485,8 @@ static int sequencer_meta_toggle_exec(bContext *C, wmOperator *UNUSED(op))
 	Sequence *last_seq = BKE_sequencer_active_get(scene);
 	MetaStack *ms;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (last_seq && last_seq->type == SEQ_TYPE_META && last_seq->flag & SELECT) {
 		/* Enter Metastrip */
 		ms = MEM_mallocN(sizeof(MetaStack), "metastack");
@@ -2540,6 +2574,8 @@ static int sequencer_meta_make_exec(bContext *C, wmOperator *op)
 	Sequence *seq, *seqm, *next, *last_seq = BKE_sequencer_active_get(scene);
 	int channel_max = 1;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (BKE_sequence_base_isolated_sel_check(ed->seqbasep) == false) {
 		BKE_report(op->reports, RPT_ERROR, "Please select all related strips");
 		return OPERATOR_CANCELLED;
@@ -2615,6 +2651,8 @@ static int sequencer_meta_separate_exec(bContext *C, wmOperator *UNUSED(op))
 
 	Sequence *seq, *last_seq = BKE_sequencer_active_get(scene); /* last_seq checks (ed == NULL) */
 
+	BKE_sequencer_prefetch_stop();
+
 	if (last_seq == NULL || last_seq->type != SEQ_TYPE_META)
 		return OPERATOR_CANCELLED;
 
@@ -3047,6 +3085,8 @@ static int sequencer_swap_exec(bContext *C, wmOperator *op)
 	Sequence *seq, *iseq;
 	int side = RNA_enum_get(op->ptr, "side");
 
+	BKE_sequencer_prefetch_stop();
+
 	if (active_seq == NULL) return OPERATOR_CANCELLED;
 
 	seq = find_next_prev_sequence(scene, active_seq, side, -1);
@@ -3265,6 +3305,8 @@ static int sequencer_paste_exec(bContext *C, wmOperator *UNUSED(op))
 	int ofs;
 	Sequence *iseq, *iseq_first;
 
+	BKE_sequencer_prefetch_stop();
+
 	ED_sequencer_deselect_all(scene);
 	ofs = scene->r.cfra - seqbase_clipboard_frame;
 
@@ -3328,6 +3370,8 @@ static int sequencer_swap_data_exec(bContext *C, wmOperator *op)
 	Sequence *seq_other;
 	const char *error_msg;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (BKE_sequencer_active_get_pair(scene, &seq_act, &seq_other) == 0) {
 		BKE_report(op->reports, RPT_ERROR, "Please select two strips");
 		return OPERATOR_CANCELLED;
@@ -3452,6 +3496,8 @@ static int sequencer_rebuild_proxy_exec(bContext *C, wmOperator *UNUSED(op))
 	Editing *ed = BKE_sequencer_editing_get(scene, false);
 	Sequence *seq;
 	GSet *file_list;
+
+	BKE_sequencer_prefetch_stop();
 	
 	if (ed == NULL) {
 		return OPERATOR_CANCELLED;
@@ -3516,6 +3562,8 @@ static int sequencer_enable_proxies_exec(bContext *C, wmOperator *op)
 	bool overwrite = RNA_boolean_get(op->ptr, "overwrite");
 	bool turnon = true;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (ed == NULL || !(proxy_25 || proxy_50 || proxy_75 || proxy_100)) {
 		turnon = false;
 	}
@@ -3601,6 +3649,8 @@ static int sequencer_change_effect_input_exec(bContext *C, wmOperator *op)
 
 	Sequence **seq_1, **seq_2;
 
+	BKE_sequencer_prefetch_stop();
+
 	switch (RNA_enum_get(op->ptr, "swap")) {
 		case 0:
 			seq_1 = &seq->seq1;
@@ -3661,6 +3711,8 @@ static int sequencer_change_effect_type_exec(bContext *C, wmOperator *op)
 	/* free previous effect and init new effect */
 	struct SeqEffectHandle sh;
 
+	BKE_sequencer_prefetch_stop();
+
 	if ((seq->type & SEQ_TYPE_EFFECT) == 0) {
 		return OPERATOR_CANCELLED;
 	}
@@ -3721,6 +3773,8 @@ static int sequencer_change_path_exec(bContext *C, wmOperator *op)
 	const bool use_placeholders = RNA_boolean_get(op->ptr, "use_placeholders");
 	int minframe, numdigits;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (seq->type == SEQ_TYPE_IMAGE) {
 		char directory[FILE_MAX];
 		int len;
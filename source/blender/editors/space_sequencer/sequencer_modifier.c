@@ -71,6 +71,8 @@ static int strip_modifier_add_exec(bContext *C, wmOperator *op)
 	Sequence *seq = BKE_sequencer_active_get(scene);
 	int type = RNA_enum_get(op->ptr, "type");
 
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequence_modifier_new(seq, NULL, type);
 
 	BKE_sequence_invalidate_cache(scene, seq);
@@ -109,6 +111,8 @@ static int strip_modifier_remove_exec(bContext *C, wmOperator *op)
 	char name[MAX_NAME];
 	SequenceModifierData *smd;
 
+	BKE_sequencer_prefetch_stop();
+
 	RNA_string_get(op->ptr, "name", name);
 
 	smd = BKE_sequence_modifier_find_by_name(seq, name);
@@ -157,6 +161,8 @@ static int strip_modifier_move_exec(bContext *C, wmOperator *op)
 	int direction;
 	SequenceModifierData *smd;
 
+	BKE_sequencer_prefetch_stop();
+
 	RNA_string_get(op->ptr, "name", name);
 	direction = RNA_enum_get(op->ptr, "direction");
 
@@ -223,6 +229,8 @@ static int strip_modifier_copy_exec(bContext *C, wmOperator *op)
 	Sequence *seq_iter;
 	const int type = RNA_enum_get(op->ptr, "type");
 
+	BKE_sequencer_prefetch_stop();
+
 	if (!seq || !seq->modifiers.first)
 		return OPERATOR_CANCELLED;
 
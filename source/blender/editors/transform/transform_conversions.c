@@ -2792,6 +2792,9 @@ void flushTransSeq(TransInfo *t)
 	Sequence *seq_prev = NULL;
 	int old_start_prev = 0, sel_flag_prev = 0;
 
+	/* frames ahead are rendered from the strips being moved */
+	BKE_sequencer_prefetch_stop();
+
 	/* flush to 2d vector from internally used 3d vector */
 	for (a = 0, td = t->data, td2d = t->data2d; a < t->total; a++, td++, td2d++) {
 		int old_start;
@@ -5103,6 +5106,7 @@ static void freeSeqData(TransInfo *t, TransCustomData *custom_data)
 		Sequence *seq_prev = NULL;
 		Sequence *seq;
 
+		BKE_sequencer_prefetch_stop();
 
 		if (!(t->state == TRANS_CANCEL)) {
 
@@ -561,6 +561,8 @@ int imb_save_openexr(struct ImBuf *ibuf, const char *name, int flags)
  */
 
 static ListBase exrhandles = {NULL, NULL};
+/* handles are created and closed from compositor tasks too */
+static ThreadMutex exrhandles_mutex = BLI_MUTEX_INITIALIZER;
 
 typedef struct ExrHandle {
 	struct ExrHandle *next, *prev;
@@ -622,7 +624,8 @@ typedef struct ExrLayer {
 
 /* ********************** */
 
-void *IMB_exr_get_handle(void)
+/* call with exrhandles_mutex held */
+static ExrHandle *imb_exr_handle_new(void)
 {
 	ExrHandle *data = (ExrHandle *)MEM_callocN(sizeof(ExrHandle), "exr handle");
 	data->multiView = new StringVector();
@@ -631,14 +634,27 @@ void *IMB_exr_get_handle(void)
 	return data;
 }
 
+void *IMB_exr_get_handle(void)
+{
+	ExrHandle *data;
+
+	BLI_mutex_lock(&exrhandles_mutex);
+	data = imb_exr_handle_new();
+	BLI_mutex_unlock(&exrhandles_mutex);
+	return data;
+}
+
 void *IMB_exr_get_handle_name(const char *name)
 {
-	ExrHandle *data = (ExrHandle *) BLI_rfindstring(&exrhandles, name, offsetof(ExrHandle, name));
+	ExrHandle *data;
 
+	BLI_mutex_lock(&exrhandles_mutex);
+	data = (ExrHandle *) BLI_rfindstring(&exrhandles, name, offsetof(ExrHandle, name));
 	if (data == NULL) {
-		data = (ExrHandle *)IMB_exr_get_handle();
+		data = imb_exr_handle_new();
 		BLI_strncpy(data->name, name, strlen(name) + 1);
 	}
+	BLI_mutex_unlock(&exrhandles_mutex);
 	return data;
 }
 
@@ -1242,7 +1258,9 @@ void IMB_exr_close(void *handle)
 	}
 	BLI_freelistN(&data->layers);
 
+	BLI_mutex_lock(&exrhandles_mutex);
 	BLI_remlink(&exrhandles, data);
+	BLI_mutex_unlock(&exrhandles_mutex);
 	MEM_freeN(data);
 }
 
@@ -356,6 +356,10 @@ enum {
 	/* Datablock was not allocated by standard system (BKE_libblock_alloc), do not free its memory
 	 * (usual type-specific freeing is called though). */
 	LIB_TAG_NOT_ALLOCATED     = 1 << 18,
+
+	/* RESET_AFTER_USE tag datablock kept as is from the old Main when reading an undo memfile,
+	 * instead of being read again (its runtime data is still valid). */
+	LIB_TAG_UNDO_OLD_ID_REUSED = 1 << 19,
 };
 
 /* To filter ID types (filter_id) */
@@ -354,7 +354,7 @@ typedef struct bNodeTree {
 	int update;						/* update flags */
 	short is_updating;				/* flag to prevent reentrant update calls */
 	short done;						/* generic temporary flag for recursion check (DFS/BFS) */
-	int pad2;
+	int cache_limit;				/* compositor result cache size in MB */
 	
 	int nodetype DNA_DEPRECATED;	/* specific node type this tree is used for */
 
@@ -417,6 +417,8 @@ typedef struct bNodeTree {
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER			16	/* use a border for viewer nodes */
 #define NTREE_IS_LOCALIZED			32	/* tree is localized copy, free when deleting node groups */
+#define NTREE_COM_ROW_EXECUTION		64	/* calculate pixel-wise operations a row at a time */
+#define NTREE_COM_RESULT_CACHE		128	/* keep results between compositor executions */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
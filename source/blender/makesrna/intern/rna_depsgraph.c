@@ -42,6 +42,8 @@
 
 #ifdef RNA_RUNTIME
 
+#include "BKE_report.h"
+
 #include "DEG_depsgraph_build.h"
 #include "DEG_depsgraph_debug.h"
 
@@ -60,6 +62,36 @@ static void rna_Depsgraph_debug_tag_update(Depsgraph *graph)
 	DEG_graph_tag_relations_update(graph);
 }
 
+static void rna_Depsgraph_debug_profile_trace(Depsgraph *graph, ReportList *reports, const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) {
+		BKE_reportf(reports, RPT_ERROR, "Cannot open '%s' for writing", filename);
+		return;
+	}
+	if (!DEG_debug_eval_profile_trace(graph, f)) {
+		BKE_report(reports, RPT_ERROR, "No evaluation profile, run with --debug-depsgraph-profile");
+	}
+	fclose(f);
+}
+
+static void rna_Depsgraph_debug_profile_summary(Depsgraph *graph, ReportList *reports)
+{
+	if (!DEG_debug_eval_profile_summary(graph, stdout)) {
+		BKE_report(reports, RPT_ERROR, "No evaluation profile, run with --debug-depsgraph-profile");
+	}
+}
+
+static int rna_Depsgraph_debug_relations_compare(Depsgraph *graph, struct Main *bmain, struct Scene *scene)
+{
+	Depsgraph *rebuilt = DEG_graph_new();
+	bool equal;
+	DEG_graph_build_from_scene(rebuilt, bmain, scene);
+	equal = DEG_debug_compare(rebuilt, graph);
+	DEG_graph_free(rebuilt);
+	return equal;
+}
+
 static void rna_Depsgraph_debug_stats(Depsgraph *graph, char *result)
 {
 	size_t outer, ops, rels;
@@ -87,6 +119,26 @@ static void rna_def_depsgraph(BlenderRNA *brna)
 
 	func = RNA_def_function(srna, "debug_tag_update", "rna_Depsgraph_debug_tag_update");
 
+	func = RNA_def_function(srna, "debug_profile_trace", "rna_Depsgraph_debug_profile_trace");
+	RNA_def_function_ui_description(func, "Write the timing of the last evaluation as Chrome trace events");
+	RNA_def_function_flag(func, FUNC_USE_REPORTS);
+	parm = RNA_def_string_file_path(func, "filename", NULL, FILE_MAX, "File Name",
+	                                "File in which to store the trace events");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
+	func = RNA_def_function(srna, "debug_profile_summary", "rna_Depsgraph_debug_profile_summary");
+	RNA_def_function_ui_description(func, "Print the critical path and slowest operations of the last evaluation");
+	RNA_def_function_flag(func, FUNC_USE_REPORTS);
+
+	func = RNA_def_function(srna, "debug_relations_compare", "rna_Depsgraph_debug_relations_compare");
+	RNA_def_function_ui_description(func, "Compare operations and relations with a full rebuild of the graph, "
+	                                "differences are printed");
+	RNA_def_function_flag(func, FUNC_USE_MAIN);
+	parm = RNA_def_pointer(func, "scene", "Scene", "", "Scene the graph belongs to");
+	RNA_def_parameter_flags(parm, PROP_NEVER_NULL, PARM_REQUIRED);
+	parm = RNA_def_boolean(func, "result", 0, "", "True when the graphs are equal");
+	RNA_def_function_return(func, parm);
+
 	func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
 	RNA_def_function_ui_description(func, "Report the number of elements in the Dependency Graph");
 	/* weak!, no way to return dynamic string type */
@@ -8320,6 +8320,23 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_ui_text(prop, "Two Pass", "Use two pass execution during editing: first calculate fast nodes, "
 	                                           "second pass calculate all nodes");
 
+	prop = RNA_def_property(srna, "use_row_execution", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_ROW_EXECUTION);
+	RNA_def_property_ui_text(prop, "Row Execution", "Calculate simple pixel-wise nodes a row of pixels at a time "
+	                                                "into full-frame buffers, instead of one pixel at a time "
+	                                                "(uses more memory)");
+
+	prop = RNA_def_property(srna, "use_result_cache", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_RESULT_CACHE);
+	RNA_def_property_ui_text(prop, "Cache Results", "Keep results of nodes between updates while editing, "
+	                                                "to only recalculate nodes that changed");
+
+	prop = RNA_def_property(srna, "result_cache_limit", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "cache_limit");
+	RNA_def_property_range(prop, 1, INT_MAX);
+	RNA_def_property_ui_range(prop, 1, 16384, 64, -1);
+	RNA_def_property_ui_text(prop, "Cache Limit", "Maximum memory in megabytes used for cached node results");
+
 	prop = RNA_def_property(srna, "use_viewer_border", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_VIEWER_BORDER);
 	RNA_def_property_ui_text(prop, "Viewer Border", "Use boundaries for viewer nodes and composite backdrop");
@@ -231,6 +231,10 @@ static void rna_Sequence_start_frame_set(PointerRNA *ptr, int value)
 	Sequence *seq = (Sequence *)ptr->data;
 	Scene *scene = (Scene *)ptr->id.data;
 	
+	/* strips are read by the prefetch task, it is stopped before they are changed,
+	 * update callbacks only run after the new value is written */
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequence_translate(scene, seq, value - seq->start);
 	do_sequence_frame_change_update(scene, seq);
 }
@@ -240,6 +244,8 @@ static void rna_Sequence_start_frame_final_set(PointerRNA *ptr, int value)
 	Sequence *seq = (Sequence *)ptr->data;
 	Scene *scene = (Scene *)ptr->id.data;
 
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequence_tx_set_final_left(seq, value);
 	BKE_sequence_single_fix(seq);
 	do_sequence_frame_change_update(scene, seq);
@@ -250,6 +256,8 @@ static void rna_Sequence_end_frame_final_set(PointerRNA *ptr, int value)
 	Sequence *seq = (Sequence *)ptr->data;
 	Scene *scene = (Scene *)ptr->id.data;
 
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequence_tx_set_final_right(seq, value);
 	BKE_sequence_single_fix(seq);
 	do_sequence_frame_change_update(scene, seq);
@@ -260,6 +268,8 @@ static void rna_Sequence_anim_startofs_final_set(PointerRNA *ptr, int value)
 	Sequence *seq = (Sequence *)ptr->data;
 	Scene *scene = (Scene *)ptr->id.data;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq->anim_startofs = MIN2(value, seq->len + seq->anim_startofs);
 
 	BKE_sequence_reload_new_file(scene, seq, false);
@@ -271,6 +281,8 @@ static void rna_Sequence_anim_endofs_final_set(PointerRNA *ptr, int value)
 	Sequence *seq = (Sequence *)ptr->data;
 	Scene *scene = (Scene *)ptr->id.data;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq->anim_endofs = MIN2(value, seq->len + seq->anim_endofs);
 
 	BKE_sequence_reload_new_file(scene, seq, false);
@@ -282,6 +294,8 @@ static void rna_Sequence_frame_length_set(PointerRNA *ptr, int value)
 	Sequence *seq = (Sequence *)ptr->data;
 	Scene *scene = (Scene *)ptr->id.data;
 	
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequence_tx_set_final_right(seq, BKE_sequence_tx_get_final_left(seq, false) + value);
 	do_sequence_frame_change_update(scene, seq);
 }
@@ -308,6 +322,9 @@ static void rna_Sequence_channel_set(PointerRNA *ptr, int value)
 	
 	/* check channel increment or decrement */
 	const int channel_delta = (value >= seq->machine) ? 1 : -1;
+
+	BKE_sequencer_prefetch_stop();
+
 	seq->machine = value;
 
 	if (BKE_sequence_test_overlap(seqbase, seq)) {
@@ -328,12 +345,18 @@ static void rna_Sequence_frame_offset_range(PointerRNA *ptr, int *min, int *max,
 static void rna_Sequence_use_proxy_set(PointerRNA *ptr, int value)
 {
 	Sequence *seq = (Sequence *)ptr->data;
+
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequencer_proxy_set(seq, value != 0);
 }
 
 static void rna_Sequence_use_translation_set(PointerRNA *ptr, int value)
 {
 	Sequence *seq = (Sequence *)ptr->data;
+
+	BKE_sequencer_prefetch_stop();
+
 	if (value) {
 		seq->flag |= SEQ_USE_TRANSFORM;
 		if (seq->strip->transform == NULL) {
@@ -348,6 +371,9 @@ static void rna_Sequence_use_translation_set(PointerRNA *ptr, int value)
 static void rna_Sequence_use_crop_set(PointerRNA *ptr, int value)
 {
 	Sequence *seq = (Sequence *)ptr->data;
+
+	BKE_sequencer_prefetch_stop();
+
 	if (value) {
 		seq->flag |= SEQ_USE_CROP;
 		if (seq->strip->crop == NULL) {
@@ -479,6 +505,8 @@ static void rna_Sequence_name_set(PointerRNA *ptr, const char *value)
 	char oldname[sizeof(seq->name)];
 	AnimData *adt;
 	
+	BKE_sequencer_prefetch_stop();
+
 	/* make a copy of the old name first */
 	BLI_strncpy(oldname, seq->name + 2, sizeof(seq->name) - 2);
 	
@@ -599,6 +627,9 @@ static PointerRNA rna_SequenceEditor_meta_stack_get(CollectionPropertyIterator *
 static void rna_Sequence_filepath_set(PointerRNA *ptr, const char *value)
 {
 	Sequence *seq = (Sequence *)(ptr->data);
+
+	BKE_sequencer_prefetch_stop();
+
 	BLI_split_dirfile(value, seq->strip->dir, seq->strip->stripdata->name, sizeof(seq->strip->dir),
 	                  sizeof(seq->strip->stripdata->name));
 }
@@ -622,6 +653,9 @@ static int rna_Sequence_filepath_length(PointerRNA *ptr)
 static void rna_Sequence_proxy_filepath_set(PointerRNA *ptr, const char *value)
 {
 	StripProxy *proxy = (StripProxy *)(ptr->data);
+
+	BKE_sequencer_prefetch_stop();
+
 	BLI_split_dirfile(value, proxy->dir, proxy->file, sizeof(proxy->dir), sizeof(proxy->file));
 	if (proxy->anim) {
 		IMB_free_anim(proxy->anim);
@@ -994,6 +1028,8 @@ static void rna_SequenceModifier_name_set(PointerRNA *ptr, const char *value)
 	AnimData *adt;
 	char oldname[sizeof(smd->name)];
 
+	BKE_sequencer_prefetch_stop();
+
 	/* make a copy of the old name first */
 	BLI_strncpy(oldname, smd->name, sizeof(smd->name));
 
@@ -1048,6 +1084,8 @@ static SequenceModifierData *rna_Sequence_modifier_new(Sequence *seq, bContext *
 		Scene *scene = CTX_data_scene(C);
 		SequenceModifierData *smd;
 
+		BKE_sequencer_prefetch_stop();
+
 		smd = BKE_sequence_modifier_new(seq, name, type);
 
 		BKE_sequence_invalidate_cache_for_modifier(scene, seq);
@@ -1063,6 +1101,8 @@ static void rna_Sequence_modifier_remove(Sequence *seq, bContext *C, ReportList
 	SequenceModifierData *smd = smd_ptr->data;
 	Scene *scene = CTX_data_scene(C);
 
+	BKE_sequencer_prefetch_stop();
+
 	if (BKE_sequence_modifier_remove(seq, smd) == false) {
 		BKE_report(reports, RPT_ERROR, "Modifier was not found in the stack");
 		return;
@@ -1078,6 +1118,8 @@ static void rna_Sequence_modifier_clear(Sequence *seq, bContext *C)
 {
 	Scene *scene = CTX_data_scene(C);
 
+	BKE_sequencer_prefetch_stop();
+
 	BKE_sequence_modifier_clear(seq);
 
 	BKE_sequence_invalidate_cache_for_modifier(scene, seq);
@@ -63,6 +63,9 @@
 
 static void rna_Sequence_update_rnafunc(ID *id, Sequence *self, int do_data)
 {
+	/* strips are read by the prefetch task, it is stopped before they are changed */
+	BKE_sequencer_prefetch_stop();
+
 	if (do_data) {
 		BKE_sequencer_update_changed_seq_and_deps((Scene *)id, self, true, true);
 		// new_tstripdata(self); // need 2.6x version of this.
@@ -75,6 +78,8 @@ static void rna_Sequence_swap_internal(Sequence *seq_self, ReportList *reports,
 {
 	const char *error_msg;
 	
+	BKE_sequencer_prefetch_stop();
+
 	if (BKE_sequence_swap(seq_self, seq_other, &error_msg) == 0)
 		BKE_report(reports, RPT_ERROR, error_msg);
 }
@@ -86,6 +91,8 @@ static Sequence *alloc_generic_sequence(Editing *ed, const char *name, int frame
 	Strip *strip;
 	StripElem *se;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq = BKE_sequence_alloc(ed->seqbasep, frame_start, channel);
 	seq->type = type;
 
@@ -330,6 +337,8 @@ static void rna_Sequences_remove(ID *id, Editing *ed, ReportList *reports, Point
 	Sequence *seq = seq_ptr->data;
 	Scene *scene = (Scene *)id;
 
+	BKE_sequencer_prefetch_stop();
+
 	if (BLI_remlink_safe(&ed->seqbase, seq) == false) {
 		BKE_reportf(reports, RPT_ERROR, "Sequence '%s' not in scene '%s'", seq->name + 2, scene->id.name + 2);
 		return;
@@ -346,6 +355,8 @@ static StripElem *rna_SequenceElements_append(ID *id, Sequence *seq, const char
 	Scene *scene = (Scene *)id;
 	StripElem *se;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq->strip->stripdata = se = MEM_reallocN(seq->strip->stripdata, sizeof(StripElem) * (seq->len + 1));
 	se += seq->len;
 	BLI_strncpy(se->name, filename, sizeof(se->name));
@@ -378,6 +389,8 @@ static void rna_SequenceElements_pop(ID *id, Sequence *seq, ReportList *reports,
 		return;
 	}
 
+	BKE_sequencer_prefetch_stop();
+
 	new_seq = MEM_callocN(sizeof(StripElem) * (seq->len - 1), "SequenceElements_pop");
 	seq->len--;
 
@@ -4052,6 +4052,13 @@ static void rna_def_userdef_system(BlenderRNA *brna)
 	RNA_def_property_ui_range(prop, 0, 500, 1, -1);
 	RNA_def_property_ui_text(prop, "Prefetch Frames", "Number of frames to render ahead during playback (sequencer only)");
 
+	prop = RNA_def_property(srna, "prefetch_memory_share", PROP_INT, PROP_PERCENTAGE);
+	RNA_def_property_int_sdna(prop, NULL, "seq_prefetch_share");
+	RNA_def_property_range(prop, 1, 100);
+	RNA_def_property_ui_text(prop, "Prefetch Memory",
+	                         "Share of the memory cache limit that frames rendered ahead during playback can use "
+	                         "(sequencer only)");
+
 	prop = RNA_def_property(srna, "memory_cache_limit", PROP_INT, PROP_NONE);
 	RNA_def_property_int_sdna(prop, NULL, "memcachelimit");
 	RNA_def_property_range(prop, 0, (sizeof(void *) == 8) ? 1024 * 32 : 1024); /* 32 bit 2 GB, 64 bit 32 GB */
@@ -238,6 +238,23 @@ void ntreeCompositExecTree(Scene *scene, bNodeTree *ntree, RenderData *rd, int r
 	UNUSED_VARS(do_preview);
 }
 
+/* pipeline the input and output of the frames of an animation */
+void ntreeCompositSequenceBegin(int efra, int frame_step)
+{
+#ifdef WITH_COMPOSITOR
+	COM_sequence_begin(efra, frame_step);
+#else
+	UNUSED_VARS(efra, frame_step);
+#endif
+}
+
+void ntreeCompositSequenceEnd(void)
+{
+#ifdef WITH_COMPOSITOR
+	COM_sequence_end();
+#endif
+}
+
 /* *********************************************** */
 
 /* Update the outputs of the render layer nodes.
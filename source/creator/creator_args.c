@@ -552,8 +552,11 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	BLI_argsPrintArgDoc(ba, "--debug-python");
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph");
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
+	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-profile");
+	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-validate");
 
 	BLI_argsPrintArgDoc(ba, "--debug-gpumem");
+	BLI_argsPrintArgDoc(ba, "--debug-compositor");
 	BLI_argsPrintArgDoc(ba, "--debug-wm");
 	BLI_argsPrintArgDoc(ba, "--debug-all");
 	BLI_argsPrintArgDoc(ba, "--debug-io");
@@ -590,6 +593,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	printf("\n");
 	printf("Experimental Features:\n");
 	BLI_argsPrintArgDoc(ba, "--enable-new-depsgraph");
+	BLI_argsPrintArgDoc(ba, "--depsgraph-cost-priority");
 	BLI_argsPrintArgDoc(ba, "--enable-new-basic-shader-glsl");
 
 	/* Other options _must_ be last (anything not handled will show here) */
@@ -750,8 +754,14 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph[] =
 "\n\tEnable debug messages from dependency graph.";
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_no_threads[] =
 "\n\tSwitch dependency graph to a single threaded evaluation.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_profile[] =
+"\n\tTime the evaluation of dependency graph operations and report the critical path.";
+static const char arg_handle_debug_mode_generic_set_doc_depsgraph_validate[] =
+"\n\tCompare dependency graphs updated for changed IDs only with a full rebuild.";
 static const char arg_handle_debug_mode_generic_set_doc_gpumem[] =
 "\n\tEnable GPU memory stats in status bar.";
+static const char arg_handle_debug_mode_generic_set_doc_compositor[] =
+"\n\tEnable time and memory profiling of the compositor, written to a JSON file in the temp directory.";
 
 static int arg_handle_debug_mode_generic_set(int UNUSED(argc), const char **UNUSED(argv), void *data)
 {
@@ -760,7 +770,7 @@ static int arg_handle_debug_mode_generic_set(int UNUSED(argc), const char **UNUS
 }
 
 static const char arg_handle_debug_mode_io_doc[] =
-"\n\tEnable debug messages for I/O (collada, ...).";
+"\n\tEnable debug messages for I/O (collada, time of .blend file loading phases, ...).";
 static int arg_handle_debug_mode_io(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
 {
 	G.debug |= G_DEBUG_IO;
@@ -1203,6 +1213,15 @@ static int arg_handle_depsgraph_use_new(int UNUSED(argc), const char **UNUSED(ar
 	return 0;
 }
 
+static const char arg_handle_depsgraph_cost_priority_doc[] =
+"\n\tSchedule dependency graph operations by the time they took in the previous update."
+;
+static int arg_handle_depsgraph_cost_priority(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	DEG_depsgraph_set_cost_priority(true);
+	return 0;
+}
+
 static const char arg_handle_basic_shader_glsl_use_new_doc[] =
 "\n\tUse new GLSL basic shader."
 ;
@@ -1859,10 +1878,17 @@ void main_args_setup(bContext *C, bArgs *ba, SYS_SystemHandle *syshandle)
 	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph), (void *)G_DEBUG_DEPSGRAPH);
 	BLI_argsAdd(ba, 1, NULL, "--debug-depsgraph-no-threads",
 	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph_no_threads), (void *)G_DEBUG_DEPSGRAPH_NO_THREADS);
+	BLI_argsAdd(ba, 1, NULL, "--debug-depsgraph-profile",
+	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph_profile), (void *)G_DEBUG_DEPSGRAPH_PROFILE);
+	BLI_argsAdd(ba, 1, NULL, "--debug-depsgraph-validate",
+	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph_validate), (void *)G_DEBUG_DEPSGRAPH_VALIDATE);
 	BLI_argsAdd(ba, 1, NULL, "--debug-gpumem",
 	            CB_EX(arg_handle_debug_mode_generic_set, gpumem), (void *)G_DEBUG_GPU_MEM);
+	BLI_argsAdd(ba, 1, NULL, "--debug-compositor",
+	            CB_EX(arg_handle_debug_mode_generic_set, compositor), (void *)G_DEBUG_COMPOSITOR);
 
 	BLI_argsAdd(ba, 1, NULL, "--enable-new-depsgraph", CB(arg_handle_depsgraph_use_new), NULL);
+	BLI_argsAdd(ba, 1, NULL, "--depsgraph-cost-priority", CB(arg_handle_depsgraph_cost_priority), NULL);
 	BLI_argsAdd(ba, 1, NULL, "--enable-new-basic-shader-glsl", CB(arg_handle_basic_shader_glsl_use_new), NULL);
 
 	BLI_argsAdd(ba, 1, NULL, "--verbose", CB(arg_handle_verbosity_set), NULL);
@@ -0,0 +1,132 @@
+# Apache License, Version 2.0
+
+# ./blender.bin --background -noaudio --enable-new-depsgraph --debug-depsgraph-validate \
+#     --python tests/python/bl_depsgraph_relations_update.py -- --verbose
+#
+# Compares the dependency graph after an incremental relations update of an
+# edited object with a full rebuild of the graph.
+import bpy
+import unittest
+
+
+class TestHelper:
+
+    def setUp(self):
+        self._objects = []
+
+    def tearDown(self):
+        scene = bpy.context.scene
+        for ob in self._objects:
+            scene.objects.unlink(ob)
+            bpy.data.objects.remove(ob)
+        scene.update()
+
+    def object_add(self, name, data):
+        scene = bpy.context.scene
+        ob = bpy.data.objects.new(name, data)
+        scene.objects.link(ob)
+        self._objects.append(ob)
+        return ob
+
+    def object_activate(self, ob):
+        scene = bpy.context.scene
+        for other in scene.objects:
+            other.select = False
+        ob.select = True
+        scene.objects.active = ob
+
+    def assertRelationsUpdate(self, ob, edit):
+        scene = bpy.context.scene
+        depsgraph = scene.depsgraph
+        self.assertIsNotNone(depsgraph, "Run with --enable-new-depsgraph")
+        scene.update()
+
+        self.object_activate(ob)
+        edit()
+        scene.update()
+        stats_update = depsgraph.debug_stats()
+        self.assertTrue(depsgraph.debug_relations_compare(scene),
+                        "Relations differ from a full rebuild, see the output")
+
+        depsgraph.debug_tag_update()
+        scene.update()
+        stats_rebuild = depsgraph.debug_stats()
+
+        self.assertEqual(stats_update, stats_rebuild)
+
+
+def add_modifier():
+    bpy.ops.object.modifier_add(type='WAVE')
+
+
+def add_constraint():
+    bpy.ops.object.constraint_add(type='COPY_ROTATION')
+
+
+def add_collision():
+    bpy.ops.object.modifier_add(type='COLLISION')
+
+
+def remove_collision():
+    bpy.ops.object.modifier_remove(modifier="Collision")
+
+
+class TestRelationsUpdate(TestHelper, unittest.TestCase):
+
+    def test_mesh_particles(self):
+        ob = self.object_add("Emitter", bpy.data.meshes.new("Emitter"))
+        ob.modifiers.new("Particles", 'PARTICLE_SYSTEM')
+        self.assertRelationsUpdate(ob, add_modifier)
+
+    def test_curve_bevel_taper(self):
+        bevel = self.object_add("Bevel", bpy.data.curves.new("Bevel", 'CURVE'))
+        taper = self.object_add("Taper", bpy.data.curves.new("Taper", 'CURVE'))
+        curve = bpy.data.curves.new("Curve", 'CURVE')
+        curve.bevel_object = bevel
+        curve.taper_object = taper
+        ob = self.object_add("Curve", curve)
+        self.assertRelationsUpdate(ob, add_modifier)
+        self.assertRelationsUpdate(bevel, add_constraint)
+
+    def test_text_on_curve(self):
+        path = self.object_add("Path", bpy.data.curves.new("Path", 'CURVE'))
+        text = bpy.data.curves.new("Text", 'FONT')
+        text.follow_curve = path
+        ob = self.object_add("Text", text)
+        self.assertRelationsUpdate(ob, add_constraint)
+        self.assertRelationsUpdate(path, add_constraint)
+
+    def test_metaball(self):
+        mom = self.object_add("Ball", bpy.data.metaballs.new("Ball"))
+        child = self.object_add("Ball.001", bpy.data.metaballs.new("Ball.001"))
+        self.assertRelationsUpdate(child, add_constraint)
+        self.assertRelationsUpdate(mom, add_constraint)
+
+    def test_camera_dof(self):
+        target = self.object_add("Target", None)
+        camera = bpy.data.cameras.new("Camera")
+        camera.dof_object = target
+        ob = self.object_add("Camera", camera)
+        self.assertRelationsUpdate(ob, add_constraint)
+        self.assertRelationsUpdate(target, add_constraint)
+
+    def test_collision(self):
+        cloth = self.object_add("Cloth", bpy.data.meshes.new("Cloth"))
+        cloth.modifiers.new("Cloth", 'CLOTH')
+        collider = self.object_add("Collider", bpy.data.meshes.new("Collider"))
+        self.assertRelationsUpdate(collider, add_collision)
+        self.assertRelationsUpdate(collider, remove_collision)
+
+    def test_parent_dependents(self):
+        parent = self.object_add("Parent", bpy.data.meshes.new("Parent"))
+        child = self.object_add("Child", bpy.data.meshes.new("Child"))
+        child.parent = parent
+        child.modifiers.new("Particles", 'PARTICLE_SYSTEM')
+        self.assertRelationsUpdate(parent, add_modifier)
+        self.assertRelationsUpdate(child, add_constraint)
+
+
+if __name__ == '__main__':
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()